@@ -0,0 +1,137 @@
+// Packs the asset directory into a single file (see AssetPack.hpp), so the program opens one
+// file at startup instead of one per shader, texture and mesh.
+//
+// AssetPacker <assetDirectory> <out.pack>
+//
+// Textures and meshes are stored raw and aligned, so they can be uploaded straight from the
+// mapped pack. Everything else is LZ4 compressed if that saves at least an eighth.
+// settings.ini is left out, as it is always read as a loose file.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <cstdlib>
+#include "AssetPack.hpp"
+#include "Lz4.hpp"
+#include "Vfs.hpp"
+#include "readFile.hpp"
+#include "Log.hpp"
+namespace fs = std::filesystem;
+
+struct PackedFile {
+    std::string name;
+    fs::path path;
+    PackEntry entry;
+};
+
+static bool storeRaw(const fs::path &path) {
+    std::string extension = packName(path.extension().string());
+    return extension == ".dds" || extension == ".mesh";
+}
+
+int main(int argc, char** argv)
+{
+    // The vfs reports through the log, which prints what is left when the program ends
+    Log::Start(LogSeverity::Low, 0);
+    if (argc != 3) {
+        std::cout << "AssetPacker <assetDirectory> <out.pack>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    fs::path root = argv[1];
+    fs::path out = argv[2];
+
+    std::vector<PackedFile> files;
+    for (const fs::directory_entry &item : fs::recursive_directory_iterator(root)) {
+        if (!item.is_regular_file()) { continue; }
+        std::string name = packName(fs::relative(item.path(), root).generic_string());
+        if (name == "settings.ini") { continue; }
+        files.push_back({ name, item.path(), {} });
+    }
+    std::sort(files.begin(), files.end(), [](const PackedFile &a, const PackedFile &b) { return a.name < b.name; });
+
+    std::ofstream pack(out, std::ios::binary);
+    if (!pack) {
+        std::cout << "Could not write " << out.string() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const char padding[PACK_ALIGNMENT] = {};
+    auto align = [&]() {
+        uint64_t position = (uint64_t)pack.tellp();
+        pack.write(padding, (std::streamsize)((PACK_ALIGNMENT - position % PACK_ALIGNMENT) % PACK_ALIGNMENT));
+    };
+
+    PackHeader header = {};
+    pack.write((const char*)&header, sizeof(header));
+
+    uint64_t totalSize = 0;
+    uint64_t totalStored = 0;
+    std::vector<unsigned char> compressed;
+    for (PackedFile &file : files) {
+        std::string contents = readFile(file.path);
+        PackEntry &entry = file.entry;
+        entry.size = contents.size();
+        entry.codec = PACK_CODEC_RAW;
+
+        compressed.clear();
+        if (!storeRaw(file.path) && !contents.empty()) {
+            lz4Compress((const unsigned char*)contents.data(), contents.size(), compressed);
+            if (compressed.size() <= contents.size() - contents.size() / 8) { entry.codec = PACK_CODEC_LZ4; }
+        }
+
+        align();
+        entry.offset = (uint64_t)pack.tellp();
+        if (entry.codec == PACK_CODEC_LZ4) {
+            entry.storedSize = compressed.size();
+            pack.write((const char*)compressed.data(), compressed.size());
+        }
+        else {
+            entry.storedSize = contents.size();
+            pack.write(contents.data(), contents.size());
+        }
+        totalSize += entry.size;
+        totalStored += entry.storedSize;
+    }
+
+    // The index, then the names it points to
+    align();
+    header.entriesOffset = (uint64_t)pack.tellp();
+    uint32_t nameOffset = 0;
+    for (PackedFile &file : files) {
+        file.entry.nameOffset = nameOffset;
+        file.entry.nameLength = (uint32_t)file.name.size();
+        nameOffset += file.entry.nameLength;
+        pack.write((const char*)&file.entry, sizeof(PackEntry));
+    }
+    header.namesOffset = (uint64_t)pack.tellp();
+    header.namesSize = nameOffset;
+    for (PackedFile &file : files) { pack.write(file.name.data(), file.name.size()); }
+
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.entryCount = (uint32_t)files.size();
+    pack.seekp(0);
+    pack.write((const char*)&header, sizeof(header));
+    pack.close();
+    if (!pack) {
+        std::cout << "Could not write " << out.string() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Read everything back through the vfs, without loose files to fall back on
+    Vfs vfs(fs::path(), out);
+    for (PackedFile &file : files) {
+        VfsFile packed = vfs.Open(file.name);
+        std::string contents = readFile(file.path);
+        if (!packed.IsOpen() && contents.empty()) { continue; }
+        if (packed.Text() != contents) {
+            std::cout << file.name << " does not read back the way it was packed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "Packed " << files.size() << " files, " << totalSize << " bytes stored in " << totalStored << std::endl;
+    return EXIT_SUCCESS;
+}
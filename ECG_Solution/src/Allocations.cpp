@@ -0,0 +1,217 @@
+#include "Allocations.hpp"
+#include "Profiler.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <new>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    // Everything here is in static arrays, counting must not allocate itself
+    struct Counter {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> frees;
+    };
+
+    struct Phase {
+        std::atomic<const char*> name;
+        Counter counter;
+    };
+
+    // Only the owning thread adds zones and counts, Print reads them from another
+    struct Zone {
+        std::atomic<const char*> name;
+        std::atomic<bool> used;
+        Counter counter;
+    };
+
+    struct ThreadAllocations {
+        Zone zones[ALLOCATION_MAX_ZONES];
+    };
+
+    // Phase 0 is everything before the first BeginPhase
+    Phase phases[ALLOCATION_MAX_PHASES];
+    std::atomic<unsigned int> phaseCount(1);
+    std::atomic<unsigned int> currentPhase(0);
+    ThreadAllocations threads[ALLOCATION_MAX_THREADS];
+    std::atomic<unsigned int> threadCount(0);
+
+    thread_local ThreadAllocations *thread = nullptr;
+    thread_local bool threadFull = false;
+    thread_local bool forbidden = false;
+
+    void add(Counter &counter, uint64_t bytes) {
+        counter.count.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // The slot of the zone in the thread's table, null if the table is full
+    Zone *findZone(ThreadAllocations &t, const char *name) {
+        size_t start = ((uintptr_t)name >> 3) % ALLOCATION_MAX_ZONES;
+        for (size_t i = 0; i < ALLOCATION_MAX_ZONES; i++) {
+            Zone &zone = t.zones[(start + i) % ALLOCATION_MAX_ZONES];
+            if (!zone.used.load(std::memory_order_relaxed)) {
+                zone.name.store(name, std::memory_order_relaxed);
+                zone.used.store(true, std::memory_order_release);
+                return &zone;
+            }
+            if (zone.name.load(std::memory_order_relaxed) == name) { return &zone; }
+        }
+        return nullptr;
+    }
+}
+
+namespace Allocations {
+    bool Enabled() {
+#ifdef TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void BeginPhase(const char *name) {
+        unsigned int index = phaseCount.load(std::memory_order_relaxed);
+        if (index == ALLOCATION_MAX_PHASES) { return; }
+        phases[index].name.store(name, std::memory_order_relaxed);
+        phaseCount.store(index + 1, std::memory_order_release);
+        currentPhase.store(index, std::memory_order_relaxed);
+    }
+
+    void Forbid(bool f) { forbidden = f; }
+    bool Forbidden() { return forbidden; }
+
+    void Print(std::ostream &out) {
+        if (!Enabled()) { return; }
+        const double KB = 1024.0;
+        out << "Allocations (count / KB / frees)" << std::endl;
+        unsigned int phaseTotal = phaseCount.load(std::memory_order_acquire);
+        for (unsigned int i = 0; i < phaseTotal; i++) {
+            Counter &c = phases[i].counter;
+            if (i == 0 && c.count.load() == 0) { continue; }
+            const char *name = phases[i].name.load(std::memory_order_relaxed);
+            out << "  " << std::left << std::setw(24) << (name ? name : "(before the first phase)") << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << c.count.load() << std::setw(12) << c.bytes.load() / KB << std::setw(10) << c.frees.load() << std::endl;
+        }
+
+        // The same name may be a different literal in every file, so zones are merged by name
+        struct Total { const char *name; uint64_t count; uint64_t bytes; };
+        std::vector<Total> totals;
+        unsigned int threadTotal = (std::min)(threadCount.load(std::memory_order_acquire), (unsigned int)ALLOCATION_MAX_THREADS);
+        for (unsigned int t = 0; t < threadTotal; t++) {
+            for (Zone &zone : threads[t].zones) {
+                if (!zone.used.load(std::memory_order_acquire)) { continue; }
+                const char *name = zone.name.load(std::memory_order_relaxed);
+                if (!name) { name = "(no zone)"; }
+                auto it = std::find_if(totals.begin(), totals.end(), [&](const Total &total) { return std::strcmp(total.name, name) == 0; });
+                if (it == totals.end()) { it = totals.insert(totals.end(), { name, 0, 0 }); }
+                it->count += zone.counter.count.load(std::memory_order_relaxed);
+                it->bytes += zone.counter.bytes.load(std::memory_order_relaxed);
+            }
+        }
+        std::sort(totals.begin(), totals.end(), [](const Total &a, const Total &b) { return a.count > b.count; });
+        out << "Allocations per zone (count / KB)" << std::endl;
+        for (Total &total : totals) {
+            out << "  " << std::left << std::setw(24) << total.name << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << total.count << std::setw(12) << total.bytes / KB << std::endl;
+        }
+    }
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+namespace {
+    void record(size_t size) {
+        add(phases[currentPhase.load(std::memory_order_relaxed)].counter, size);
+
+        if (!thread && !threadFull) {
+            unsigned int index = threadCount.fetch_add(1, std::memory_order_acq_rel);
+            if (index < ALLOCATION_MAX_THREADS) { thread = &threads[index]; }
+            else { threadFull = true; }
+        }
+        const char *zone = Profiler::CurrentZone();
+        if (thread) {
+            Zone *slot = findZone(*thread, zone);
+            if (slot) { add(slot->counter, size); }
+        }
+
+        if (forbidden) {
+            // Printing through iostreams could allocate again
+            std::fprintf(stderr, "Allocation of %zu bytes in zone \"%s\" while allocations are forbidden\n", size, zone ? zone : "(none)");
+            std::fflush(stderr);
+            std::abort();
+        }
+    }
+
+    void recordFree() { phases[currentPhase.load(std::memory_order_relaxed)].counter.frees.fetch_add(1, std::memory_order_relaxed); }
+
+    void *allocate(size_t size) {
+        record(size);
+        return std::malloc(size ? size : 1);
+    }
+
+    void *allocateAligned(size_t size, std::align_val_t alignment) {
+        record(size);
+        size_t a = (size_t)alignment;
+#ifdef _MSC_VER
+        return _aligned_malloc(size ? size : 1, a);
+#else
+        return std::aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a));
+#endif
+    }
+
+    void release(void *p) {
+        if (!p) { return; }
+        recordFree();
+        std::free(p);
+    }
+
+    void releaseAligned(void *p) {
+        if (!p) { return; }
+        recordFree();
+#ifdef _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+void *operator new(size_t size) {
+    void *p = allocate(size);
+    if (!p) { throw std::bad_alloc(); }
+    return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    void *p = allocateAligned(size, alignment);
+    if (!p) { throw std::bad_alloc(); }
+    return p;
+}
+void *operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocateAligned(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocateAligned(size, alignment); }
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { release(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { releaseAligned(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { releaseAligned(p); }
+
+#endif
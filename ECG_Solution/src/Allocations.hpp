@@ -0,0 +1,34 @@
+#pragma once
+
+#include <ostream>
+
+// Threads and zones per thread that are told apart. Beyond that allocations only count towards the phase.
+#define ALLOCATION_MAX_THREADS 64
+#define ALLOCATION_MAX_ZONES 256
+#define ALLOCATION_MAX_PHASES 16
+
+// Counts heap allocations and their bytes per phase of the program, per thread and per profiler
+// zone, by replacing the global operator new and delete. An allocation counts towards the
+// innermost zone open on the allocating thread (see Profiler.hpp).
+// The replacement is only compiled in with TRACK_ALLOCATIONS, Debug builds define it.
+// Without it nothing is counted and forbidding allocations has no effect.
+namespace Allocations {
+    bool Enabled();
+    // Allocations from now on count towards the phase, on every thread. Pass a string literal.
+    void BeginPhase(const char *name);
+    // While forbidden, an allocation on the calling thread says where it happened and aborts
+    void Forbid(bool forbidden);
+    bool Forbidden();
+    // Allocations and bytes of every phase, then of every zone with all threads added up
+    void Print(std::ostream &out);
+}
+
+// Lets the calling thread allocate while in scope, for work a forbidden stretch may do on request
+struct AllowAllocations {
+private:
+    bool wasForbidden;
+
+public:
+    AllowAllocations() : wasForbidden(Allocations::Forbidden()) { Allocations::Forbid(false); }
+    ~AllowAllocations() { Allocations::Forbid(wasForbidden); }
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+// The asset pack (assets.pack), written by the AssetPacker and read through the Vfs.
+//
+// Layout:
+//   PackHeader
+//   entry data, every entry aligned to PACK_ALIGNMENT
+//   PackEntry[entryCount], sorted by name
+//   names, not terminated, pointed to by the entries
+//
+// Names are relative to the asset directory, in lower case and with forward slashes.
+// Textures and meshes are stored raw, so the GPU can read them straight from the mapped pack.
+#define PACK_MAGIC 0x50474345u // "ECGP"
+#define PACK_VERSION 1
+#define PACK_ALIGNMENT 16
+
+#define PACK_CODEC_RAW 0
+#define PACK_CODEC_LZ4 1 // see Lz4.hpp
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t entriesOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct PackEntry {
+    uint32_t nameOffset;  // from namesOffset
+    uint32_t nameLength;
+    uint32_t codec;
+    uint32_t reserved;
+    uint64_t offset;      // from the start of the pack
+    uint64_t storedSize;
+    uint64_t size;        // after decompression
+};
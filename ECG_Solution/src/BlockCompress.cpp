@@ -0,0 +1,325 @@
+#include "BlockCompress.hpp"
+#include "Dds.hpp"
+#include "Profiler.hpp"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BLOCK_COMPRESS_SSE2
+#endif
+
+namespace {
+    // Block rows per job, so small mip levels do not cost a job each
+    const unsigned int ROWS_PER_JOB = 4;
+
+    uint16_t to565(float r, float g, float b) {
+        auto quantize = [](float v, int max) { return (int)(std::min)((std::max)(v * max / 255.0f + 0.5f, 0.0f), (float)max); };
+        return (uint16_t)((quantize(r, 31) << 11) | (quantize(g, 63) << 5) | quantize(b, 31));
+    }
+
+    void from565(uint16_t c, unsigned char *rgba) {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgba[0] = (unsigned char)((r << 3) | (r >> 2));
+        rgba[1] = (unsigned char)((g << 2) | (g >> 4));
+        rgba[2] = (unsigned char)((b << 3) | (b >> 2));
+        rgba[3] = 0;
+    }
+
+    // The four colors of a four color BC1 block, in index order
+    void palette(uint16_t c0, uint16_t c1, unsigned char colors[4][4]) {
+        from565(c0, colors[0]);
+        from565(c1, colors[1]);
+        for (int c = 0; c < 3; c++) {
+            colors[2][c] = (unsigned char)((2 * colors[0][c] + colors[1][c] + 1) / 3);
+            colors[3][c] = (unsigned char)((colors[0][c] + 2 * colors[1][c] + 1) / 3);
+        }
+        colors[2][3] = colors[3][3] = 0;
+    }
+
+    // Picks the nearest palette color for each of the 16 pixels, ignoring alpha.
+    // Returns the summed squared error, the two bit indices go to indices.
+    uint32_t selectIndices(const unsigned char block[64], const unsigned char colors[4][4], uint32_t &indices) {
+        indices = 0;
+        uint32_t error = 0;
+#if defined(BLOCK_COMPRESS_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+        __m128i palette16[4];
+        for (int k = 0; k < 4; k++) {
+            uint32_t color;
+            std::memcpy(&color, colors[k], 4);
+            palette16[k] = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color & 0x00FFFFFF)), zero);
+        }
+        for (int group = 0; group < 4; group++) {
+            // Four pixels, widened to 16 bits per channel, two pixels per register
+            __m128i pixels = _mm_and_si128(_mm_loadu_si128((const __m128i*)(block + group * 16)), rgbMask);
+            __m128i low = _mm_unpacklo_epi8(pixels, zero);
+            __m128i high = _mm_unpackhi_epi8(pixels, zero);
+
+            __m128i best = _mm_set1_epi32(INT32_MAX);
+            __m128i bestIndex = zero;
+            for (int k = 0; k < 4; k++) {
+                __m128i dLow = _mm_sub_epi16(low, palette16[k]);
+                __m128i dHigh = _mm_sub_epi16(high, palette16[k]);
+                // r*r + g*g and b*b + 0 per pixel, then summed across the pairs
+                __m128 sLow = _mm_castsi128_ps(_mm_madd_epi16(dLow, dLow));
+                __m128 sHigh = _mm_castsi128_ps(_mm_madd_epi16(dHigh, dHigh));
+                __m128i even = _mm_castps_si128(_mm_shuffle_ps(sLow, sHigh, _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i odd = _mm_castps_si128(_mm_shuffle_ps(sLow, sHigh, _MM_SHUFFLE(3, 1, 3, 1)));
+                __m128i distance = _mm_add_epi32(even, odd);
+
+                __m128i closer = _mm_cmplt_epi32(distance, best);
+                best = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, best));
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+            }
+
+            alignas(16) uint32_t lanes[4], distances[4];
+            _mm_store_si128((__m128i*)lanes, bestIndex);
+            _mm_store_si128((__m128i*)distances, best);
+            for (int i = 0; i < 4; i++) {
+                indices |= lanes[i] << ((group * 4 + i) * 2);
+                error += distances[i];
+            }
+        }
+#else
+        for (int i = 0; i < 16; i++) {
+            const unsigned char *pixel = block + i * 4;
+            uint32_t best = UINT32_MAX, bestIndex = 0;
+            for (uint32_t k = 0; k < 4; k++) {
+                int dr = pixel[0] - colors[k][0], dg = pixel[1] - colors[k][1], db = pixel[2] - colors[k][2];
+                uint32_t distance = (uint32_t)(dr * dr + dg * dg + db * db);
+                if (distance < best) { best = distance; bestIndex = k; }
+            }
+            indices |= bestIndex << (i * 2);
+            error += best;
+        }
+#endif
+        return error;
+    }
+
+    // Endpoints that reproduce the given indices best, by least squares
+    bool refineEndpoints(const unsigned char block[64], uint32_t indices, uint16_t &c0, uint16_t &c1) {
+        static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++) {
+            float a = WEIGHTS[(indices >> (i * 2)) & 3], b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; c++) {
+                ax[c] += a * block[i * 4 + c];
+                bx[c] += b * block[i * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f) { return false; }
+        float e0[3], e1[3];
+        for (int c = 0; c < 3; c++) {
+            e0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+            e1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+        }
+        c0 = to565(e0[0], e0[1], e0[2]);
+        c1 = to565(e1[0], e1[1], e1[2]);
+        return true;
+    }
+
+    // Four color mode needs c0 > c1. Swapping the endpoints swaps indices 0 and 1, and 2 and 3.
+    void orderEndpoints(uint16_t &c0, uint16_t &c1, uint32_t &indices) {
+        if (c0 >= c1) { return; }
+        std::swap(c0, c1);
+        indices ^= 0x55555555;
+    }
+
+    void compressColor(const unsigned char block[64], unsigned char *out) {
+        // Mean and covariance of the colors
+        float mean[3] = {};
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 3; c++) { mean[c] += block[i * 4 + c]; }
+        }
+        for (int c = 0; c < 3; c++) { mean[c] /= 16.0f; }
+        float cov[6] = {};
+        for (int i = 0; i < 16; i++) {
+            float r = block[i * 4] - mean[0], g = block[i * 4 + 1] - mean[1], b = block[i * 4 + 2] - mean[2];
+            cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+            cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+        }
+
+        // The principal axis, by a few power iterations
+        float axis[3] = { 0.9f, 1.0f, 0.7f };
+        for (int iteration = 0; iteration < 4; iteration++) {
+            float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+            float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+            float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+            float length = (std::max)((std::max)(std::fabs(x), std::fabs(y)), std::fabs(z));
+            if (length < 1e-6f) { break; }
+            axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+        }
+
+        // The pixels furthest along the axis, pulled in a little as the palette never reaches them exactly
+        int minPixel = 0, maxPixel = 0;
+        float minDot = 1e30f, maxDot = -1e30f;
+        for (int i = 0; i < 16; i++) {
+            float dot = block[i * 4] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+            if (dot < minDot) { minDot = dot; minPixel = i; }
+            if (dot > maxDot) { maxDot = dot; maxPixel = i; }
+        }
+        float high[3], low[3];
+        for (int c = 0; c < 3; c++) {
+            float inset = (block[maxPixel * 4 + c] - block[minPixel * 4 + c]) / 16.0f;
+            high[c] = block[maxPixel * 4 + c] - inset;
+            low[c] = block[minPixel * 4 + c] + inset;
+        }
+
+        uint16_t c0 = to565(high[0], high[1], high[2]);
+        uint16_t c1 = to565(low[0], low[1], low[2]);
+        unsigned char colors[4][4];
+        uint32_t indices = 0;
+        uint32_t error = 0;
+        if (c0 != c1) {
+            palette(c0, c1, colors);
+            error = selectIndices(block, colors, indices);
+
+            uint16_t r0, r1;
+            if (error > 0 && refineEndpoints(block, indices, r0, r1) && r0 != r1) {
+                unsigned char refined[4][4];
+                uint32_t refinedIndices;
+                palette(r0, r1, refined);
+                if (selectIndices(block, refined, refinedIndices) < error) {
+                    c0 = r0;
+                    c1 = r1;
+                    indices = refinedIndices;
+                }
+            }
+            orderEndpoints(c0, c1, indices);
+            // Rounding can make the endpoints equal after all, then every index must be 0
+            if (c0 == c1) { indices = 0; }
+        }
+
+        out[0] = (unsigned char)(c0 & 0xFF);
+        out[1] = (unsigned char)(c0 >> 8);
+        out[2] = (unsigned char)(c1 & 0xFF);
+        out[3] = (unsigned char)(c1 >> 8);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    // BC3 alpha: the two extremes and six steps between them
+    void compressAlpha(const unsigned char block[64], unsigned char *out) {
+        int a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; i++) {
+            a0 = (std::max)(a0, (int)block[i * 4 + 3]);
+            a1 = (std::min)(a1, (int)block[i * 4 + 3]);
+        }
+        out[0] = (unsigned char)a0;
+        out[1] = (unsigned char)a1;
+
+        uint64_t bits = 0;
+        if (a0 > a1) {
+            for (int i = 0; i < 16; i++) {
+                // Step 0 is a0, step 7 is a1, in between they are indices 2 to 7
+                int step = ((a0 - block[i * 4 + 3]) * 14 + (a0 - a1)) / ((a0 - a1) * 2);
+                uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : (uint64_t)step + 1);
+                bits |= index << (i * 3);
+            }
+        }
+        for (int i = 0; i < 6; i++) { out[2 + i] = (unsigned char)(bits >> (i * 8)); }
+    }
+}
+
+void compressBlocks(const Image &image, bool alpha, unsigned int firstRow, unsigned int rowCount, unsigned char *out) {
+    unsigned int blocksWide = (image.width + 3) / 4;
+    size_t blockSize = alpha ? 16 : 8;
+    alignas(16) unsigned char block[64];
+    for (unsigned int by = firstRow; by < firstRow + rowCount; by++) {
+        for (unsigned int bx = 0; bx < blocksWide; bx++) {
+            for (unsigned int y = 0; y < 4; y++) {
+                unsigned int sy = (std::min)(by * 4 + y, image.height - 1);
+                for (unsigned int x = 0; x < 4; x++) {
+                    unsigned int sx = (std::min)(bx * 4 + x, image.width - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, image.pixels.data() + ((size_t)sy * image.width + sx) * 4, 4);
+                }
+            }
+            unsigned char *target = out + ((size_t)by * blocksWide + bx) * blockSize;
+            if (alpha) {
+                compressAlpha(block, target);
+                compressColor(block, target + 8);
+            }
+            else {
+                compressColor(block, target);
+            }
+        }
+    }
+}
+
+bool hasAlpha(const Image &image) {
+    for (size_t i = 3; i < image.pixels.size(); i += 4) {
+        if (image.pixels[i] != 255) { return true; }
+    }
+    return false;
+}
+
+Image halveImage(const Image &image) {
+    Image half;
+    half.width = (std::max)(1u, image.width / 2);
+    half.height = (std::max)(1u, image.height / 2);
+    half.pixels.resize((size_t)half.width * half.height * 4);
+    for (unsigned int y = 0; y < half.height; y++) {
+        unsigned int y0 = (std::min)(y * 2, image.height - 1), y1 = (std::min)(y * 2 + 1, image.height - 1);
+        for (unsigned int x = 0; x < half.width; x++) {
+            unsigned int x0 = (std::min)(x * 2, image.width - 1), x1 = (std::min)(x * 2 + 1, image.width - 1);
+            const unsigned char *p00 = &image.pixels[((size_t)y0 * image.width + x0) * 4];
+            const unsigned char *p01 = &image.pixels[((size_t)y0 * image.width + x1) * 4];
+            const unsigned char *p10 = &image.pixels[((size_t)y1 * image.width + x0) * 4];
+            const unsigned char *p11 = &image.pixels[((size_t)y1 * image.width + x1) * 4];
+            unsigned char *out = &half.pixels[((size_t)y * half.width + x) * 4];
+            for (int c = 0; c < 4; c++) { out[c] = (unsigned char)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4); }
+        }
+    }
+    return half;
+}
+
+std::vector<unsigned char> compressToDDS(const Image &image) {
+    PROFILE_ZONE("compress texture");
+    bool alpha = hasAlpha(image);
+    GLenum format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+
+    std::vector<Image> levels;
+    {
+        PROFILE_ZONE("build mip chain");
+        levels.push_back(image);
+        while (levels.back().width > 1 || levels.back().height > 1) { levels.push_back(halveImage(levels.back())); }
+    }
+
+    // Every level goes to its offset in the file, so the jobs can write in any order
+    struct Job { size_t level; unsigned int firstRow, rowCount; size_t offset; };
+    std::vector<Job> jobs;
+    size_t offset = DDS_DATA_OFFSET;
+    for (size_t level = 0; level < levels.size(); level++) {
+        unsigned int blockRows = (levels[level].height + 3) / 4;
+        for (unsigned int row = 0; row < blockRows; row += ROWS_PER_JOB) {
+            jobs.push_back({ level, row, (std::min)(ROWS_PER_JOB, blockRows - row), offset });
+        }
+        offset += ddsLevelSize(format, levels[level].width, levels[level].height);
+    }
+    std::vector<unsigned char> file(offset, 0);
+    writeDDSHeader(format, image.width, image.height, (unsigned int)levels.size(), file.data());
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t j = next++; j < jobs.size(); j = next++) {
+            Job &job = jobs[j];
+            compressBlocks(levels[job.level], alpha, job.firstRow, job.rowCount, file.data() + job.offset);
+        }
+    };
+    size_t threadCount = (std::min)((size_t)(std::max)(1u, std::thread::hardware_concurrency()), jobs.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) { workers.emplace_back(work); }
+    work();
+    for (std::thread &worker : workers) { worker.join(); }
+    return file;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Image.hpp"
+
+// Block compression of RGBA8 images to the formats the DDS path uploads.
+// Opaque images become BC1 (DXT1, 8 bytes per 4x4 block), images with alpha become
+// BC3 (DXT5, 16 bytes per block). Colors are fit along the principal axis of each block and
+// refined once by least squares. The palette search uses SSE2 where available.
+
+// Compresses the block rows [firstRow, firstRow + rowCount) of one image into out, which
+// points at the first block of the image. Edge blocks repeat the last row and column.
+void compressBlocks(const Image &image, bool alpha, unsigned int firstRow, unsigned int rowCount, unsigned char *out);
+
+// True if any pixel is not fully opaque
+bool hasAlpha(const Image &image);
+
+// Halves the image with a box filter, down to 1x1
+Image halveImage(const Image &image);
+
+// A complete DDS file with a full mip chain. Blocks of all levels are compressed on all cores.
+// The header leaves the application bytes (see DDS_USER_OFFSET) zeroed.
+std::vector<unsigned char> compressToDDS(const Image &image);
@@ -1,4 +1,5 @@
 #include "Camera.hpp"
+#include "GlCapture.hpp"
 #include <iostream>
 
 Camera::Camera(float fov, int height, int width, float zNear, float zFar) {
@@ -8,8 +9,8 @@ Camera::Camera(float fov, int height, int width, float zNear, float zFar) {
     rotationX = 1.0f; rotationY = 1.0f;
     updateViewProj();
     wireframe = false;
+    // Main turns culling on along with the rest of the GL state, so cameras work without a context
     backfaceCulling = true;
-    glEnable(GL_CULL_FACE);
 }
 
 
@@ -56,6 +57,10 @@ glm::vec4 Camera::ViewPosMatrix(){
     return  bla;
     //return glm::vec4(1.0, 1.0, 1.0, 1.0);
 }
+bool Camera::BackfaceCulling() {
+    return backfaceCulling;
+}
+
 void Camera::toggleBackfaceCulling() {
     if (backfaceCulling = backfaceCulling != true) { glEnable(GL_CULL_FACE); }
     else { glDisable(GL_CULL_FACE); }
@@ -22,6 +22,7 @@ public:
     Camera(float fov, int height, int width, float zNear, float zFar);
     glm::mat4 ViewProjMatrix();
     glm::vec4 ViewPosMatrix();
+    bool BackfaceCulling();
     void translate(glm::vec3 trans);
     void rotate(glm::vec3 rot);
     void toggleBackfaceCulling();
@@ -0,0 +1,278 @@
+#include "Config.hpp"
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <charconv>
+#include <cstdlib>
+#include <cctype>
+
+namespace {
+    char lower(char c) { return (char)std::tolower((unsigned char)c); }
+
+    bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && isSpace(s.front())) { s.remove_prefix(1); }
+        while (!s.empty() && isSpace(s.back())) { s.remove_suffix(1); }
+        return s;
+    }
+
+    bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) { return false; }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (lower(a[i]) != lower(b[i])) { return false; }
+        }
+        return true;
+    }
+
+    // FNV-1a over the lowercased section, a separator and the lowercased key
+    size_t hashKey(std::string_view section, std::string_view key) {
+        size_t hash = 14695981039346656037ull;
+        for (char c : section) { hash = (hash ^ (unsigned char)lower(c)) * 1099511628211ull; }
+        hash = (hash ^ '.') * 1099511628211ull;
+        for (char c : key) { hash = (hash ^ (unsigned char)lower(c)) * 1099511628211ull; }
+        return hash;
+    }
+
+    bool parseNumber(std::string_view s, long long &out) {
+        const char *end = s.data() + s.size();
+        int base = 10;
+        const char *begin = s.data();
+        if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) { begin += 2; base = 16; }
+        auto result = std::from_chars(begin, end, out, base);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    bool parseNumber(std::string_view s, double &out) {
+        if (!s.empty() && s.front() == '+') { s.remove_prefix(1); }
+#if defined(__cpp_lib_to_chars)
+        auto result = std::from_chars(s.data(), s.data() + s.size(), out);
+        return result.ec == std::errc() && result.ptr == s.data() + s.size();
+#else
+        // Standard libraries without floating point from_chars
+        char tmp[64];
+        if (s.empty() || s.size() >= sizeof(tmp)) { return false; }
+        s.copy(tmp, s.size());
+        tmp[s.size()] = '\0';
+        char *end;
+        out = std::strtod(tmp, &end);
+        return end == tmp + s.size();
+#endif
+    }
+
+    bool parseBool(std::string_view s, bool &out) {
+        if (equalsIgnoreCase(s, "true") || equalsIgnoreCase(s, "yes") || equalsIgnoreCase(s, "on") || s == "1") { out = true; return true; }
+        if (equalsIgnoreCase(s, "false") || equalsIgnoreCase(s, "no") || equalsIgnoreCase(s, "off") || s == "0") { out = false; return true; }
+        return false;
+    }
+}
+
+ConfigFile::ConfigFile(std::filesystem::path path) : errorLine(0) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) { errorLine = -1; return; }
+    buffer.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read(&buffer[0], buffer.size());
+    parse();
+}
+
+// Walks the buffer once, line by line, and inserts every key into the table
+void ConfigFile::parse() {
+    rehash(64);
+    std::string_view text(buffer);
+    std::string_view section;
+    int lineNumber = 0;
+
+    // Skip a UTF-8 byte order mark
+    if (text.size() >= 3 && text.substr(0, 3) == "\xEF\xBB\xBF") { text.remove_prefix(3); }
+
+    while (!text.empty()) {
+        size_t lineEnd = text.find('\n');
+        std::string_view line = text.substr(0, lineEnd);
+        text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+        lineNumber++;
+
+        line = trim(line);
+        if (line.empty() || line.front() == ';' || line.front() == '#') { continue; }
+
+        if (line.front() == '[') {
+            size_t close = line.find(']');
+            if (close == std::string_view::npos) {
+                if (errorLine == 0) { errorLine = lineNumber; }
+                continue;
+            }
+            section = trim(line.substr(1, close - 1));
+            sections.push_back(section);
+            continue;
+        }
+
+        size_t separator = line.find_first_of("=:");
+        if (separator == std::string_view::npos) {
+            if (errorLine == 0) { errorLine = lineNumber; }
+            continue;
+        }
+        std::string_view key = trim(line.substr(0, separator));
+        std::string_view value = line.substr(separator + 1);
+
+        // Inline comments need whitespace in front of them
+        for (size_t i = 1; i < value.size(); i++) {
+            if (value[i] == ';' && isSpace(value[i - 1])) { value = value.substr(0, i); break; }
+        }
+        insert(section, key, trim(value));
+    }
+}
+
+void ConfigFile::insert(std::string_view section, std::string_view key, std::string_view value) {
+    size_t hash = hashKey(section, key);
+    int existing = find(section, key, hash);
+    if (existing >= 0) {
+        // Later values win, like in INIReader
+        entries[existing].value = value;
+        return;
+    }
+
+    if ((entries.size() + 1) * 2 > table.size()) { rehash(table.size() * 2); }
+    entries.push_back({ section, key, value, hash, false });
+    size_t mask = table.size() - 1;
+    size_t slot = hash & mask;
+    while (table[slot] >= 0) { slot = (slot + 1) & mask; }
+    table[slot] = (int)entries.size() - 1;
+}
+
+// The capacity must be a power of two
+void ConfigFile::rehash(size_t capacity) {
+    table.assign(capacity, -1);
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < entries.size(); i++) {
+        size_t slot = entries[i].hash & mask;
+        while (table[slot] >= 0) { slot = (slot + 1) & mask; }
+        table[slot] = (int)i;
+    }
+}
+
+int ConfigFile::find(std::string_view section, std::string_view key, size_t hash) {
+    if (table.empty()) { return -1; }
+    size_t mask = table.size() - 1;
+    for (size_t slot = hash & mask; table[slot] >= 0; slot = (slot + 1) & mask) {
+        Entry &entry = entries[table[slot]];
+        if (entry.hash == hash && equalsIgnoreCase(entry.section, section) && equalsIgnoreCase(entry.key, key)) {
+            return table[slot];
+        }
+    }
+    return -1;
+}
+
+int ConfigFile::ParseError() { return errorLine; }
+
+const std::string_view *ConfigFile::Find(std::string_view section, std::string_view key) {
+    int index = find(section, key, hashKey(section, key));
+    if (index < 0) { return nullptr; }
+    entries[index].used = true;
+    return &entries[index].value;
+}
+
+const std::vector<std::string_view> &ConfigFile::Sections() { return sections; }
+
+std::vector<std::string> ConfigFile::Unused() {
+    std::vector<std::string> unused;
+    for (Entry &entry : entries) {
+        if (!entry.used) {
+            unused.push_back(std::string(entry.section) + "." + std::string(entry.key));
+        }
+    }
+    return unused;
+}
+
+
+
+void ConfigReport::Print(std::ostream &out) {
+    for (std::string &key : missing) { out << "Settings: missing " << key << ", using default" << std::endl; }
+    for (std::string &key : invalid) { out << "Settings: invalid value for " << key << ", using default" << std::endl; }
+    for (std::string &key : unknown) { out << "Settings: unknown key " << key << std::endl; }
+}
+
+void ConfigReport::Merge(ConfigReport &other) {
+    missing.insert(missing.end(), other.missing.begin(), other.missing.end());
+    invalid.insert(invalid.end(), other.invalid.begin(), other.invalid.end());
+    unknown.insert(unknown.end(), other.unknown.begin(), other.unknown.end());
+}
+
+ConfigSchema &ConfigSchema::Bind(std::string section, std::string key, float &field, float defaultValue, bool required) {
+    bindings.push_back({ section, key, Type::Float, &field, defaultValue, "", required });
+    return *this;
+}
+
+ConfigSchema &ConfigSchema::Bind(std::string section, std::string key, int &field, int defaultValue, bool required) {
+    bindings.push_back({ section, key, Type::Int, &field, (double)defaultValue, "", required });
+    return *this;
+}
+
+ConfigSchema &ConfigSchema::Bind(std::string section, std::string key, unsigned int &field, unsigned int defaultValue, bool required) {
+    bindings.push_back({ section, key, Type::Unsigned, &field, (double)defaultValue, "", required });
+    return *this;
+}
+
+ConfigSchema &ConfigSchema::Bind(std::string section, std::string key, bool &field, bool defaultValue, bool required) {
+    bindings.push_back({ section, key, Type::Bool, &field, defaultValue ? 1.0 : 0.0, "", required });
+    return *this;
+}
+
+ConfigSchema &ConfigSchema::Bind(std::string section, std::string key, std::string &field, std::string defaultValue, bool required) {
+    bindings.push_back({ section, key, Type::String, &field, 0.0, defaultValue, required });
+    return *this;
+}
+
+ConfigSchema &ConfigSchema::BindXYZ(std::string section, std::string prefix, glm::vec3 &field, float defaultValue) {
+    Bind(section, prefix + "X", field.x, defaultValue);
+    Bind(section, prefix + "Y", field.y, defaultValue);
+    return Bind(section, prefix + "Z", field.z, defaultValue);
+}
+
+ConfigSchema &ConfigSchema::BindColor(std::string section, glm::vec3 &field, float defaultValue, bool required) {
+    Bind(section, "red", field.r, defaultValue, required);
+    Bind(section, "green", field.g, defaultValue, required);
+    return Bind(section, "blue", field.b, defaultValue, required);
+}
+
+ConfigReport ConfigSchema::Apply(ConfigFile &file) {
+    ConfigReport report;
+    for (Binding &binding : bindings) {
+        const std::string_view *value = file.Find(binding.section, binding.key);
+        bool valid = value != nullptr;
+        if (!value && binding.required) { report.missing.push_back(binding.section + "." + binding.key); }
+
+        switch (binding.type) {
+            case Type::Float: {
+                double number = binding.defaultNumber;
+                if (value && !parseNumber(*value, number)) { valid = false; number = binding.defaultNumber; }
+                *(float*)binding.field = (float)number;
+                break;
+            }
+            case Type::Int:
+            case Type::Unsigned: {
+                long long number = (long long)binding.defaultNumber;
+                if (value && !parseNumber(*value, number)) { valid = false; number = (long long)binding.defaultNumber; }
+                // Out of range would wrap around when cast, e.g. -1 to a huge count
+                long long lowest = binding.type == Type::Int ? (long long)INT_MIN : 0;
+                long long highest = binding.type == Type::Int ? (long long)INT_MAX : (long long)UINT_MAX;
+                if (number < lowest || number > highest) { valid = false; number = (long long)binding.defaultNumber; }
+                if (binding.type == Type::Int) { *(int*)binding.field = (int)number; }
+                else { *(unsigned int*)binding.field = (unsigned int)number; }
+                break;
+            }
+            case Type::Bool: {
+                bool flag = binding.defaultNumber != 0.0;
+                if (value && !parseBool(*value, flag)) { valid = false; flag = binding.defaultNumber != 0.0; }
+                *(bool*)binding.field = flag;
+                break;
+            }
+            case Type::String: {
+                *(std::string*)binding.field = value ? std::string(*value) : binding.defaultString;
+                break;
+            }
+        }
+
+        if (value && !valid) { report.invalid.push_back(binding.section + "." + binding.key); }
+    }
+    return report;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+#include "glm\matrix.hpp"
+
+// The values of an INI file, parsed in a single pass.
+// The whole file is kept in one buffer and every section, key and value is a view into it.
+// Lookups go through a flat open-addressing hash table and ignore case, like INIReader.
+class ConfigFile {
+private:
+    struct Entry {
+        std::string_view section;
+        std::string_view key;
+        std::string_view value;
+        size_t hash;
+        bool used;
+    };
+
+    std::string buffer;
+    std::vector<Entry> entries;
+    std::vector<int> table; // indices into entries, -1 for empty slots
+    std::vector<std::string_view> sections;
+    int errorLine;
+    void parse();
+    void insert(std::string_view section, std::string_view key, std::string_view value);
+    void rehash(size_t capacity);
+    int find(std::string_view section, std::string_view key, size_t hash);
+
+public:
+    explicit ConfigFile(std::filesystem::path path);
+    // Everything points into the buffer, so the file can be neither copied nor moved
+    ConfigFile(const ConfigFile &) = delete;
+    ConfigFile &operator=(const ConfigFile &) = delete;
+    // Line of the first syntax error, 0 if there was none, -1 if the file could not be read
+    int ParseError();
+    // Returns nullptr if the key is not there. Marks the key as used.
+    const std::string_view *Find(std::string_view section, std::string_view key);
+    // Sections in the order they appear in the file
+    const std::vector<std::string_view> &Sections();
+    // Keys no Find has asked for, as "section.key"
+    std::vector<std::string> Unused();
+};
+
+// The outcome of applying a schema to a file
+struct ConfigReport {
+    std::vector<std::string> missing;  // in the schema but not in the file, so the default was used
+    std::vector<std::string> invalid;  // in the file but not of the bound type, so the default was used
+    std::vector<std::string> unknown;  // in the file but asked for by no schema, see ConfigFile::Unused
+    void Print(std::ostream &out);
+    // Appends the entries of another report
+    void Merge(ConfigReport &other);
+};
+
+// Binds sections and keys to fields of typed structs.
+// Applying the schema fills every field from the file, or with its default.
+class ConfigSchema {
+private:
+    enum class Type { Float, Int, Unsigned, Bool, String };
+    struct Binding {
+        std::string section;
+        std::string key;
+        Type type;
+        void *field;
+        double defaultNumber;
+        std::string defaultString;
+        bool required;
+    };
+    std::vector<Binding> bindings;
+
+public:
+    // Optional keys are not reported as missing
+    ConfigSchema &Bind(std::string section, std::string key, float &field, float defaultValue, bool required = true);
+    ConfigSchema &Bind(std::string section, std::string key, int &field, int defaultValue, bool required = true);
+    ConfigSchema &Bind(std::string section, std::string key, unsigned int &field, unsigned int defaultValue, bool required = true);
+    ConfigSchema &Bind(std::string section, std::string key, bool &field, bool defaultValue, bool required = true);
+    ConfigSchema &Bind(std::string section, std::string key, std::string &field, std::string defaultValue, bool required = true);
+    // Binds the three components to the keys prefix + X/Y/Z, e.g. transX, transY, transZ
+    ConfigSchema &BindXYZ(std::string section, std::string prefix, glm::vec3 &field, float defaultValue);
+    // Binds the three components to the keys red, green and blue
+    ConfigSchema &BindColor(std::string section, glm::vec3 &field, float defaultValue, bool required = true);
+    ConfigReport Apply(ConfigFile &file);
+};
@@ -0,0 +1,299 @@
+#include "Culling.hpp"
+#include "Profiler.hpp"
+#include "Allocations.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+namespace {
+    // The compute shader's work group is 8x8
+    const unsigned int GROUP_SIZE = 8;
+
+    unsigned int nextPowerOfTwo(unsigned int n) {
+        unsigned int p = 1;
+        while (p < n) { p *= 2; }
+        return p;
+    }
+
+    glm::vec4 corner(const glm::mat4 &m, glm::vec3 boundsMin, glm::vec3 boundsMax, int c) {
+        return m * glm::vec4((c & 1) ? boundsMax.x : boundsMin.x, (c & 2) ? boundsMax.y : boundsMin.y, (c & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+    }
+
+    // Whether all corners of the bounds are outside the same clip plane
+    bool outsideFrustum(const glm::mat4 &m, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+        int outside[6] = { 0, 0, 0, 0, 0, 0 };
+        for (int c = 0; c < 8; c++) {
+            glm::vec4 clip = corner(m, boundsMin, boundsMax, c);
+            outside[0] += clip.x < -clip.w;
+            outside[1] += clip.x > clip.w;
+            outside[2] += clip.y < -clip.w;
+            outside[3] += clip.y > clip.w;
+            outside[4] += clip.z < -clip.w;
+            outside[5] += clip.z > clip.w;
+        }
+        for (int plane = 0; plane < 6; plane++) {
+            if (outside[plane] == 8) { return true; }
+        }
+        return false;
+    }
+}
+
+Culler::Culler(std::string hizSource, bool frustumCulling, bool occlusionCulling, unsigned int age)
+    : frustum(frustumCulling), occlusion(occlusionCulling), maxAge(age),
+      fromDepth(insertAfterVersion(hizSource, "#define FROM_DEPTH\n")), reduce(hizSource),
+      width(0), height(0), baseSize(0), levelCount(0), readbackLevel(0), nextReadback(0),
+      frame(0), viewProj(1.0f), culledFrame(0), pyramidFrame(0), pyramidViewProj(1.0f), frames(0), tested(0), frustumCulled(0), occlusionCulled(0) {
+    for (Readback &readback : readbacks) { readback.fence = nullptr; }
+    cpu.frame = 0;
+}
+
+Culler::~Culler() {
+    for (Readback &readback : readbacks) {
+        if (readback.fence) { glDeleteSync(readback.fence); }
+    }
+}
+
+void Culler::resize(int framebufferWidth, int framebufferHeight) {
+    width = framebufferWidth;
+    height = framebufferHeight;
+    depthCopy = GlTexture::Create();
+    glBindTexture(GL_TEXTURE_2D, depthCopy.ID());
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // Power of two sizes halve exactly, so every texel covers the same square of pixels on its level
+    baseSize = glm::uvec2(nextPowerOfTwo(((unsigned int)width + 1) / 2), nextPowerOfTwo(((unsigned int)height + 1) / 2));
+    levelCount = 1;
+    for (unsigned int size = (std::max)(baseSize.x, baseSize.y); size > 1; size /= 2) { levelCount++; }
+    pyramid = GlTexture::Create();
+    glBindTexture(GL_TEXTURE_2D, pyramid.ID());
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)levelCount, GL_R32F, (GLsizei)baseSize.x, (GLsizei)baseSize.y);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    readbackLevel = 0;
+    while ((std::max)(baseSize.x >> readbackLevel, baseSize.y >> readbackLevel) > OCCLUSION_READBACK_SIZE) { readbackLevel++; }
+    glm::uvec2 size = glm::max(baseSize >> readbackLevel, glm::uvec2(1));
+    cpu.levels.clear();
+    cpu.sizes.clear();
+    while (true) {
+        cpu.levels.emplace_back((size_t)size.x * size.y, 1.0f);
+        cpu.sizes.push_back(size);
+        if (size.x == 1 && size.y == 1) { break; }
+        size = glm::max(size / 2u, glm::uvec2(1));
+    }
+    cpu.frame = 0;
+    pyramidFrame = 0;
+
+    // Readbacks in flight are for the old size, they are dropped and the buffers sized anew
+    size_t bytes = cpu.levels[0].size() * sizeof(float);
+    for (Readback &readback : readbacks) {
+        if (readback.fence) { glDeleteSync(readback.fence); }
+        readback.fence = nullptr;
+        readback.buffer = GlBuffer::Create();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.ID());
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// Takes the newest readback that has arrived
+void Culler::collect() {
+    Readback *newest = nullptr;
+    for (Readback &readback : readbacks) {
+        if (!readback.fence) { continue; }
+        GLenum result = glClientWaitSync(readback.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) { continue; }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        if (!newest || readback.frame > newest->frame) { newest = &readback; }
+    }
+    if (!newest || newest->frame <= cpu.frame) { return; }
+
+    PROFILE_ZONE("collect depth pyramid");
+    std::vector<float> &base = cpu.levels[0];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->buffer.ID());
+    void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, base.size() * sizeof(float), GL_MAP_READ_BIT);
+    if (data) {
+        std::memcpy(base.data(), data, base.size() * sizeof(float));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!data) { return; }
+
+    for (size_t l = 1; l < cpu.levels.size(); l++) {
+        std::vector<float> &below = cpu.levels[l - 1];
+        glm::uvec2 belowSize = cpu.sizes[l - 1];
+        glm::uvec2 size = cpu.sizes[l];
+        for (unsigned int y = 0; y < size.y; y++) {
+            for (unsigned int x = 0; x < size.x; x++) {
+                unsigned int x0 = (std::min)(x * 2, belowSize.x - 1), x1 = (std::min)(x * 2 + 1, belowSize.x - 1);
+                unsigned int y0 = (std::min)(y * 2, belowSize.y - 1), y1 = (std::min)(y * 2 + 1, belowSize.y - 1);
+                cpu.levels[l][(size_t)y * size.x + x] = (std::max)((std::max)(below[(size_t)y0 * belowSize.x + x0], below[(size_t)y0 * belowSize.x + x1]),
+                                                                   (std::max)(below[(size_t)y1 * belowSize.x + x0], below[(size_t)y1 * belowSize.x + x1]));
+            }
+        }
+    }
+    cpu.frame = newest->frame;
+    cpu.viewProj = newest->viewProj;
+}
+
+bool Culler::occluded(const glm::mat4 &model, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+    glm::mat4 m = cpu.viewProj * model;
+    glm::vec2 low(1.0f), high(-1.0f);
+    float nearest = 1.0f;
+    for (int c = 0; c < 8; c++) {
+        glm::vec4 clip = corner(m, boundsMin, boundsMax, c);
+        // Behind the camera of then, where the pyramid knows nothing
+        if (clip.w <= 0.0f) { return false; }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        low = glm::min(low, glm::vec2(ndc));
+        high = glm::max(high, glm::vec2(ndc));
+        nearest = (std::min)(nearest, ndc.z * 0.5f + 0.5f);
+    }
+    // Partly outside the view of then
+    if (low.x < -1.0f || low.y < -1.0f || high.x > 1.0f || high.y > 1.0f || nearest < 0.0f) { return false; }
+
+    // In pixels, then in texels of the coarsest level where the bounds cover at most 2x2
+    glm::vec2 framebuffer((float)width, (float)height);
+    glm::vec2 lowPixel = (low * 0.5f + 0.5f) * framebuffer;
+    glm::vec2 highPixel = (high * 0.5f + 0.5f) * framebuffer;
+    size_t level = 0;
+    glm::uvec2 first, last;
+    while (true) {
+        float texelSize = (float)(2u << (readbackLevel + level));
+        glm::uvec2 size = cpu.sizes[level];
+        first = glm::min(glm::uvec2(lowPixel / texelSize), size - 1u);
+        last = glm::min(glm::uvec2(highPixel / texelSize), size - 1u);
+        if ((last.x - first.x <= 1 && last.y - first.y <= 1) || level + 1 == cpu.levels.size()) { break; }
+        level++;
+    }
+
+    float farthest = 0.0f;
+    const std::vector<float> &depth = cpu.levels[level];
+    for (unsigned int y = first.y; y <= last.y; y++) {
+        for (unsigned int x = first.x; x <= last.x; x++) {
+            farthest = (std::max)(farthest, depth[(size_t)y * cpu.sizes[level].x + x]);
+        }
+    }
+    return nearest > farthest;
+}
+
+void Culler::BeginFrame(const glm::mat4 &frameViewProj) {
+    frame++;
+    viewProj = frameViewProj;
+}
+
+void Culler::Cull(std::vector<std::unique_ptr<Shape>> &shapes, const glm::mat4 &frameViewProj) {
+    PROFILE_ZONE("cull");
+    BeginFrame(frameViewProj);
+    culledFrame = frame;
+    frames++;
+    if (occlusion) { collect(); }
+    // Only grows while the scene loads
+    if (visible.size() < shapes.size()) {
+        visible.resize(shapes.size());
+        firstDrawn.resize(shapes.size(), 0);
+    }
+    bool testOcclusion = occlusion && cpu.frame > 0 && frame - cpu.frame <= maxAge;
+
+    for (size_t i = 0; i < shapes.size(); i++) {
+        Shape &shape = *shapes[i];
+        glm::mat4 model = shape.ModelMatrix();
+        tested++;
+        visible[i] = 0;
+        if (frustum && outsideFrustum(viewProj * model, shape.BoundsMin(), shape.BoundsMax())) {
+            frustumCulled++;
+            continue;
+        }
+        if (testOcclusion && firstDrawn[i] != 0 && firstDrawn[i] < cpu.frame && occluded(model, shape.BoundsMin(), shape.BoundsMax())) {
+            occlusionCulled++;
+            continue;
+        }
+        visible[i] = 1;
+        if (firstDrawn[i] == 0) { firstDrawn[i] = frame; }
+    }
+}
+
+bool Culler::Visible(size_t shape) { return shape >= visible.size() || visible[shape] != 0; }
+
+void Culler::BuildPyramid(int framebufferWidth, int framebufferHeight) {
+    if (!occlusion || framebufferWidth <= 0 || framebufferHeight <= 0 || !fromDepth.IsReady() || !reduce.IsReady()) { return; }
+    if (framebufferWidth != width || framebufferHeight != height) {
+        // The window may be resized in steady frames, which are otherwise forbidden to allocate
+        AllowAllocations allow;
+        resize(framebufferWidth, framebufferHeight);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, depthCopy.ID());
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    glm::uvec2 sourceSize((unsigned int)width, (unsigned int)height);
+    for (unsigned int level = 0; level < levelCount; level++) {
+        glm::uvec2 size = glm::max(baseSize >> level, glm::uvec2(1));
+        if (level == 0) {
+            fromDepth.Use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, depthCopy.ID());
+        }
+        else {
+            if (level == 1) { reduce.Use(); }
+            glBindImageTexture(0, pyramid.ID(), (GLint)level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+            // The level below has to be written before it is read
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        glBindImageTexture(1, pyramid.ID(), (GLint)level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glUniform2i(0, (GLint)sourceSize.x, (GLint)sourceSize.y);
+        glDispatchCompute((size.x + GROUP_SIZE - 1) / GROUP_SIZE, (size.y + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+        sourceSize = size;
+    }
+    glUseProgram(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    pyramidFrame = frame;
+    pyramidViewProj = viewProj;
+
+    if (culledFrame != frame) { return; }
+    Readback &readback = readbacks[nextReadback];
+    if (readback.fence) { return; }
+    nextReadback = (nextReadback + 1) % OCCLUSION_READBACKS;
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.ID());
+    glBindTexture(GL_TEXTURE_2D, pyramid.ID());
+    glGetTexImage(GL_TEXTURE_2D, (GLint)readbackLevel, GL_RED, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.frame = frame;
+    readback.viewProj = viewProj;
+}
+
+bool Culler::Pyramid(PyramidView &view) {
+    if (!occlusion || pyramidFrame == 0 || frame - pyramidFrame > maxAge) { return false; }
+    view.texture = pyramid.ID();
+    view.viewProj = pyramidViewProj;
+    view.uvScale = glm::vec2((float)width, (float)height) / (2.0f * glm::vec2(baseSize));
+    return true;
+}
+
+void Culler::Print(std::ostream &out) {
+    if (frames == 0) { return; }
+    out << "Culling (shapes per frame)" << std::endl << std::fixed << std::setprecision(1)
+        << "  " << std::left << std::setw(16) << "tested" << std::right << std::setw(10) << (double)tested / frames << std::endl
+        << "  " << std::left << std::setw(16) << "outside view" << std::right << std::setw(10) << (double)frustumCulled / frames << std::endl
+        << "  " << std::left << std::setw(16) << "occluded" << std::right << std::setw(10) << (double)occlusionCulled / frames << std::endl;
+}
+
+void Culler::ReportMemory(MemoryReport &report) {
+    if (!pyramid.ID()) { return; }
+    size_t pyramidBytes = 0;
+    for (unsigned int level = 0; level < levelCount; level++) {
+        glm::uvec2 size = glm::max(baseSize >> level, glm::uvec2(1));
+        pyramidBytes += (size_t)size.x * size.y * sizeof(float);
+    }
+    size_t cpuBytes = 0;
+    for (std::vector<float> &level : cpu.levels) { cpuBytes += level.capacity() * sizeof(float); }
+    size_t readbackBytes = cpu.levels[0].size() * sizeof(float) * OCCLUSION_READBACKS;
+    report.Add("depth pyramid", cpuBytes, (size_t)width * height * sizeof(float) + pyramidBytes + readbackBytes);
+}
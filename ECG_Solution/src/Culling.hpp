@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <GL\glew.h>
+#include "glm\matrix.hpp"
+#include "GlHandle.hpp"
+#include "Shader.hpp"
+#include "MemoryReport.hpp"
+#include "Shapes\Shape.hpp"
+
+// Readbacks of the depth pyramid in flight. No new one starts while all of them are.
+#define OCCLUSION_READBACKS 3
+// The pyramid level that is read back is the first at most this wide and high, the CPU reduces it further
+#define OCCLUSION_READBACK_SIZE 256
+
+// Decides which shapes are drawn each frame: frustum culling against the current camera, then
+// hierarchical-Z occlusion culling against the depth of an earlier frame.
+//
+// After the draws the depth buffer is copied and reduced on the GPU to a pyramid (assets/shaders/hiz.comp)
+// in which every texel holds the farthest depth below it. A coarse level is read back without
+// stalling, a fence tells when it has arrived, and the CPU builds the levels above it. A shape is
+// hidden if the nearest point of its bounds, seen from the camera of that frame, is behind the
+// farthest depth in the rectangle its bounds covered then.
+// The pyramid is a few frames old, so the test is conservative: shapes reaching outside the view
+// of then are visible, as are shapes not drawn yet when it was made (just loaded or just in view).
+// The test is off while the newest pyramid is more than maxAge frames old.
+// Occluders have to be drawn to hide anything, and what they hide pops in up to a readback late.
+// GPU-driven culling (see GpuCuller) tests against the pyramid itself, without the readback.
+class Culler {
+private:
+    struct Readback {
+        GlBuffer buffer;
+        GLsync fence;
+        unsigned long long frame;
+        glm::mat4 viewProj;
+    };
+    // The levels from the one read back up, each a quarter of the one before
+    struct CpuPyramid {
+        std::vector<std::vector<float>> levels;
+        std::vector<glm::uvec2> sizes;
+        unsigned long long frame; // 0 while there is none
+        glm::mat4 viewProj;
+    };
+
+    bool frustum;
+    bool occlusion;
+    unsigned int maxAge;
+    Shader fromDepth;
+    Shader reduce;
+    GlTexture depthCopy;
+    GlTexture pyramid;
+    int width, height;        // of the framebuffer the textures are for
+    glm::uvec2 baseSize;      // of pyramid level 0, powers of two covering half the framebuffer
+    unsigned int levelCount;
+    unsigned int readbackLevel;
+    Readback readbacks[OCCLUSION_READBACKS];
+    unsigned int nextReadback;
+    CpuPyramid cpu;
+    unsigned long long frame;
+    glm::mat4 viewProj;       // of the frame, the pyramid built after its draws is seen with it
+    unsigned long long culledFrame;  // the last frame Cull ran in, pyramids are only read back for it
+    unsigned long long pyramidFrame; // the frame the pyramid texture holds the depth of, 0 if none
+    glm::mat4 pyramidViewProj;
+    std::vector<unsigned long long> firstDrawn; // frame each shape was first drawn in, 0 if never
+    std::vector<unsigned char> visible;
+    unsigned long long frames;
+    unsigned long long tested, frustumCulled, occlusionCulled; // over all frames
+    void resize(int framebufferWidth, int framebufferHeight);
+    void collect();
+    bool occluded(const glm::mat4 &model, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+public:
+    // The pyramid texture as the GPU sees it, see Pyramid
+    struct PyramidView {
+        GLuint texture;      // GL_R32F, level 0 half the framebuffer size rounded up to powers of two
+        glm::mat4 viewProj;  // of the frame it holds the depth of
+        glm::vec2 uvScale;   // from normalized screen to texture coordinates
+    };
+
+    Culler(std::string hizSource, bool frustum, bool occlusion, unsigned int maxAge);
+    Culler(const Culler &) = delete;
+    Culler &operator=(const Culler &) = delete;
+    ~Culler();
+
+    // Once per frame when the shapes are culled on the GPU instead of by Cull
+    void BeginFrame(const glm::mat4 &viewProj);
+    // Once per frame before Visible: collects arrived readbacks and tests every shape
+    void Cull(std::vector<std::unique_ptr<Shape>> &shapes, const glm::mat4 &viewProj);
+    bool Visible(size_t shape);
+    // After the frame's draws and before the swap: builds the pyramid from the depth buffer,
+    // then starts reading it back if a readback is free
+    void BuildPyramid(int framebufferWidth, int framebufferHeight);
+    // The pyramid to test against this frame, false if occlusion culling is off or the newest is too old
+    bool Pyramid(PyramidView &view);
+    // Shapes culled per frame, on average
+    void Print(std::ostream &out);
+    // Adds the depth copy and the pyramid as "depth pyramid"
+    void ReportMemory(MemoryReport &report);
+};
@@ -0,0 +1,178 @@
+#include "Dds.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    // Offsets into the file, which is "DDS " followed by the 124 byte DDS_HEADER
+    const size_t SIZE_OFFSET = 4;
+    const size_t FLAGS_OFFSET = 8;
+    const size_t HEIGHT_OFFSET = 12;
+    const size_t WIDTH_OFFSET = 16;
+    const size_t LINEAR_SIZE_OFFSET = 20;
+    const size_t MIP_COUNT_OFFSET = 28;
+    const size_t PIXEL_FORMAT_OFFSET = 76;
+    const size_t FOURCC_OFFSET = 84;
+    const size_t CAPS_OFFSET = 108;
+
+    // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE
+    const uint32_t HEADER_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+    const uint32_t PIXEL_FORMAT_FOURCC = 0x4;
+    // DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP
+    const uint32_t CAPS = 0x8 | 0x1000 | 0x400000;
+
+    uint32_t read32(const unsigned char *p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    void write32(unsigned char *p, uint32_t value) { std::memcpy(p, &value, sizeof(value)); }
+
+    uint32_t fourCC(const char *code) {
+        return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+    }
+
+    unsigned int blockSizeOf(GLenum format) { return format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16; }
+
+    void expand565(uint16_t color, unsigned char *out) {
+        unsigned int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+        out[0] = (unsigned char)((r << 3) | (r >> 2));
+        out[1] = (unsigned char)((g << 2) | (g >> 4));
+        out[2] = (unsigned char)((b << 3) | (b >> 2));
+        out[3] = 255;
+    }
+
+    // The 16 pixels of a color block, row by row. DXT3 and DXT5 always use four colors.
+    void decodeColorBlock(const unsigned char *block, bool fourColors, unsigned char pixels[16][4]) {
+        uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+        uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+        unsigned char palette[4][4];
+        expand565(c0, palette[0]);
+        expand565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            if (fourColors || c0 > c1) {
+                palette[2][c] = (unsigned char)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                palette[3][c] = (unsigned char)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+            }
+            else {
+                palette[2][c] = (unsigned char)((palette[0][c] + palette[1][c] + 1) / 2);
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = (fourColors || c0 > c1) ? 255 : 0;
+
+        uint32_t indices = read32(block + 4);
+        for (int i = 0; i < 16; i++) { std::memcpy(pixels[i], palette[(indices >> (2 * i)) & 3], 4); }
+    }
+
+    void decodeAlphaBlock(GLenum format, const unsigned char *block, unsigned char pixels[16][4]) {
+        if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
+            // Explicit 4 bit alpha
+            for (int i = 0; i < 16; i++) {
+                unsigned int alpha = (block[i / 2] >> (4 * (i & 1))) & 15;
+                pixels[i][3] = (unsigned char)(alpha * 17);
+            }
+            return;
+        }
+
+        // Two endpoints and 3 bit indices into 8 interpolated values
+        unsigned int a0 = block[0], a1 = block[1];
+        unsigned char palette[8];
+        palette[0] = (unsigned char)a0;
+        palette[1] = (unsigned char)a1;
+        if (a0 > a1) {
+            for (unsigned int k = 1; k < 7; k++) { palette[k + 1] = (unsigned char)(((7 - k) * a0 + k * a1 + 3) / 7); }
+        }
+        else {
+            for (unsigned int k = 1; k < 5; k++) { palette[k + 1] = (unsigned char)(((5 - k) * a0 + k * a1 + 2) / 5); }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++) { indices |= (uint64_t)block[2 + i] << (8 * i); }
+        for (int i = 0; i < 16; i++) { pixels[i][3] = palette[(indices >> (3 * i)) & 7]; }
+    }
+}
+
+bool parseDDS(const unsigned char *data, size_t size, DdsTexture &texture) {
+    if (!data || size < DDS_DATA_OFFSET || read32(data) != fourCC("DDS ")) { return false; }
+
+    uint32_t code = read32(data + FOURCC_OFFSET);
+    if (code == fourCC("DXT1"))      { texture.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; }
+    else if (code == fourCC("DXT3")) { texture.format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; }
+    else if (code == fourCC("DXT5")) { texture.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; }
+    else { return false; }
+
+    texture.width = read32(data + WIDTH_OFFSET);
+    texture.height = read32(data + HEIGHT_OFFSET);
+    uint32_t mipCount = read32(data + MIP_COUNT_OFFSET);
+    if (mipCount == 0) { mipCount = 1; }
+    if (texture.width == 0 || texture.height == 0) { return false; }
+
+    texture.levels.clear();
+    size_t offset = DDS_DATA_OFFSET;
+    unsigned int width = texture.width;
+    unsigned int height = texture.height;
+    for (uint32_t level = 0; level < mipCount; level++) {
+        unsigned int levelSize = ddsLevelSize(texture.format, width, height);
+        // Files that promise more levels than they contain just lose the missing ones
+        if (size - offset < levelSize) { break; }
+        texture.levels.push_back({ data + offset, width, height, levelSize });
+        offset += levelSize;
+        if (width == 1 && height == 1) { break; }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return !texture.levels.empty();
+}
+
+unsigned int ddsLevelSize(GLenum format, unsigned int width, unsigned int height) {
+    return ((width + 3) / 4) * ((height + 3) / 4) * blockSizeOf(format);
+}
+
+void writeDDSHeader(GLenum format, unsigned int width, unsigned int height, unsigned int levelCount, unsigned char *header) {
+    std::memset(header, 0, DDS_DATA_OFFSET);
+    const char *code = format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? "DXT1" : (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT ? "DXT3" : "DXT5");
+    write32(header, fourCC("DDS "));
+    write32(header + SIZE_OFFSET, DDS_DATA_OFFSET - 4);
+    write32(header + FLAGS_OFFSET, HEADER_FLAGS);
+    write32(header + HEIGHT_OFFSET, height);
+    write32(header + WIDTH_OFFSET, width);
+    write32(header + LINEAR_SIZE_OFFSET, ddsLevelSize(format, width, height));
+    write32(header + MIP_COUNT_OFFSET, levelCount);
+    write32(header + PIXEL_FORMAT_OFFSET, 32);
+    write32(header + PIXEL_FORMAT_OFFSET + 4, PIXEL_FORMAT_FOURCC);
+    write32(header + FOURCC_OFFSET, fourCC(code));
+    write32(header + CAPS_OFFSET, CAPS);
+}
+
+Image decodeDDSLevel(GLenum format, const DdsLevel &level) {
+    Image image;
+    image.width = level.width;
+    image.height = level.height;
+    image.pixels.resize((size_t)level.width * level.height * 4);
+
+    unsigned int blockSize = blockSizeOf(format);
+    unsigned int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+    const unsigned char *block = level.data;
+    for (unsigned int by = 0; by < blocksY; by++) {
+        for (unsigned int bx = 0; bx < blocksX; bx++, block += blockSize) {
+            unsigned char pixels[16][4];
+            if (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
+                decodeColorBlock(block, false, pixels);
+            }
+            else {
+                decodeColorBlock(block + 8, true, pixels);
+                decodeAlphaBlock(format, block, pixels);
+            }
+            // Edge blocks hang over the image
+            for (unsigned int y = 0; y < 4 && by * 4 + y < level.height; y++) {
+                for (unsigned int x = 0; x < 4 && bx * 4 + x < level.width; x++) {
+                    std::memcpy(&image.pixels[(((size_t)by * 4 + y) * level.width + bx * 4 + x) * 4], pixels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+    return image;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <GL\glew.h>
+#include "Image.hpp"
+
+// "DDS " and the 124 byte DDS_HEADER come before the first level
+#define DDS_DATA_OFFSET 128
+// The 44 reserved bytes of the header, free for applications to mark their files
+#define DDS_USER_OFFSET 32
+#define DDS_USER_SIZE 44
+
+// One mip level of a compressed texture, pointing into the file it was parsed from
+struct DdsLevel {
+    const unsigned char *data;
+    unsigned int width;
+    unsigned int height;
+    unsigned int size;
+};
+
+struct DdsTexture {
+    GLenum format;
+    unsigned int width;
+    unsigned int height;
+    std::vector<DdsLevel> levels; // level 0 first
+};
+
+// Parses a DXT1/3/5 compressed .dds file that is already in memory, e.g. mapped from the asset pack.
+// Nothing is copied, so the levels are only valid as long as the data is.
+// Returns false if the file is not a DDS file or uses another format.
+bool parseDDS(const unsigned char *data, size_t size, DdsTexture &texture);
+
+// Bytes of one level of a DXT1/3/5 texture
+unsigned int ddsLevelSize(GLenum format, unsigned int width, unsigned int height);
+
+// Writes the DDS_DATA_OFFSET bytes in front of the levels of a DXT1/3/5 texture
+void writeDDSHeader(GLenum format, unsigned int width, unsigned int height, unsigned int levelCount, unsigned char *header);
+
+// Decodes one DXT1/3/5 level to RGBA8 like the hardware does. DXT1 blocks with the colors
+// in the other order have a transparent black fourth color.
+Image decodeDDSLevel(GLenum format, const DdsLevel &level);
@@ -0,0 +1,362 @@
+#include "Environment.hpp"
+#include "Dds.hpp"
+#include "Profiler.hpp"
+#include "Log.hpp"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ENVIRONMENT_SSE2
+#endif
+
+namespace {
+    // Bump the version when the convolution changes, so old caches are made again
+    const char CACHE_MAGIC[4] = { 'E', 'C', 'G', 'E' };
+    const uint32_t CACHE_VERSION = 1;
+    const char *CACHE_NAME = "environment.ibl";
+    // In GL's face order, +X -X +Y -Y +Z -Z
+    const char *FACE_NAMES[6] = { "posx", "negx", "posy", "negy", "posz", "negz" };
+    // Output rows per job of the convolution
+    const unsigned int ROWS_PER_JOB = 4;
+
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t size;
+        uint32_t levels;
+        float irradiance[9][4];
+    };
+
+    // The texels of all six faces of one size, four at a time for the convolution.
+    // The color is the radiance times the texel's solid angle. Padding has no weight.
+    struct CubeTexels {
+        std::vector<float> x, y, z, r, g, b, weight;
+    };
+
+    // Direction through the texel center (s, t) in [-1, 1] of a face, see the GL cube map face table
+    glm::vec3 faceDirection(int face, float s, float t) {
+        switch (face) {
+            case 0: return glm::normalize(glm::vec3(1.0f, -t, -s));
+            case 1: return glm::normalize(glm::vec3(-1.0f, -t, s));
+            case 2: return glm::normalize(glm::vec3(s, 1.0f, t));
+            case 3: return glm::normalize(glm::vec3(s, -1.0f, -t));
+            case 4: return glm::normalize(glm::vec3(s, -t, 1.0f));
+            default: return glm::normalize(glm::vec3(-s, -t, -1.0f));
+        }
+    }
+
+    float faceCoordinate(unsigned int i, unsigned int size) {
+        return 2.0f * (i + 0.5f) / size - 1.0f;
+    }
+
+    // Solid angle of the texel (i, j) of a face, from the area of its projection on the unit sphere
+    float texelSolidAngle(unsigned int i, unsigned int j, unsigned int size) {
+        auto area = [](float x, float y) { return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f)); };
+        float x0 = 2.0f * i / size - 1.0f, x1 = 2.0f * (i + 1) / size - 1.0f;
+        float y0 = 2.0f * j / size - 1.0f, y1 = 2.0f * (j + 1) / size - 1.0f;
+        return area(x0, y0) - area(x0, y1) - area(x1, y0) + area(x1, y1);
+    }
+
+    CubeTexels gatherTexels(const Image faces[6]) {
+        unsigned int size = faces[0].width;
+        size_t count = 6 * (size_t)size * size;
+        size_t padded = (count + 3) & ~(size_t)3;
+        CubeTexels texels;
+        for (std::vector<float> *v : { &texels.x, &texels.y, &texels.z, &texels.r, &texels.g, &texels.b, &texels.weight }) {
+            v->assign(padded, 0.0f);
+        }
+        size_t k = 0;
+        for (int face = 0; face < 6; face++) {
+            for (unsigned int j = 0; j < size; j++) {
+                for (unsigned int i = 0; i < size; i++, k++) {
+                    glm::vec3 d = faceDirection(face, faceCoordinate(i, size), faceCoordinate(j, size));
+                    float weight = texelSolidAngle(i, j, size);
+                    const unsigned char *p = &faces[face].pixels[((size_t)j * size + i) * 4];
+                    texels.x[k] = d.x;
+                    texels.y[k] = d.y;
+                    texels.z[k] = d.z;
+                    texels.r[k] = p[0] / 255.0f * weight;
+                    texels.g[k] = p[1] / 255.0f * weight;
+                    texels.b[k] = p[2] / 255.0f * weight;
+                    texels.weight[k] = weight;
+                }
+            }
+        }
+        return texels;
+    }
+
+    // The average of the texels weighted by max(dot(d, texel), 0) raised to 2 to the squarings
+    glm::vec3 convolve(const CubeTexels &texels, glm::vec3 d, int squarings) {
+        size_t count = texels.x.size();
+#if defined(ENVIRONMENT_SSE2)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+        __m128 r = zero, g = zero, b = zero, w = zero;
+        for (size_t k = 0; k < count; k += 4) {
+            __m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&texels.x[k])), _mm_mul_ps(dy, _mm_loadu_ps(&texels.y[k]))),
+                                  _mm_mul_ps(dz, _mm_loadu_ps(&texels.z[k])));
+            c = _mm_max_ps(c, zero);
+            for (int s = 0; s < squarings; s++) { c = _mm_mul_ps(c, c); }
+            r = _mm_add_ps(r, _mm_mul_ps(c, _mm_loadu_ps(&texels.r[k])));
+            g = _mm_add_ps(g, _mm_mul_ps(c, _mm_loadu_ps(&texels.g[k])));
+            b = _mm_add_ps(b, _mm_mul_ps(c, _mm_loadu_ps(&texels.b[k])));
+            w = _mm_add_ps(w, _mm_mul_ps(c, _mm_loadu_ps(&texels.weight[k])));
+        }
+        float sums[4][4];
+        _mm_storeu_ps(sums[0], r);
+        _mm_storeu_ps(sums[1], g);
+        _mm_storeu_ps(sums[2], b);
+        _mm_storeu_ps(sums[3], w);
+        glm::vec3 color(sums[0][0] + sums[0][1] + sums[0][2] + sums[0][3],
+                        sums[1][0] + sums[1][1] + sums[1][2] + sums[1][3],
+                        sums[2][0] + sums[2][1] + sums[2][2] + sums[2][3]);
+        float weight = sums[3][0] + sums[3][1] + sums[3][2] + sums[3][3];
+#else
+        glm::vec3 color(0.0f);
+        float weight = 0.0f;
+        for (size_t k = 0; k < count; k++) {
+            float c = (std::max)(d.x * texels.x[k] + d.y * texels.y[k] + d.z * texels.z[k], 0.0f);
+            for (int s = 0; s < squarings; s++) { c *= c; }
+            color += c * glm::vec3(texels.r[k], texels.g[k], texels.b[k]);
+            weight += c * texels.weight[k];
+        }
+#endif
+        return weight > 0.0f ? color / weight : glm::vec3(0.0f);
+    }
+
+    // Convolves every texel of one level with a Phong lobe of exponent 2 to the squarings,
+    // on all cores. The texels are read from the source level of the same size.
+    void prefilterLevel(const CubeTexels &texels, unsigned int size, int squarings, unsigned char *out) {
+        struct Job {
+            int face;
+            unsigned int firstRow;
+        };
+        std::vector<Job> jobs;
+        for (int face = 0; face < 6; face++) {
+            for (unsigned int row = 0; row < size; row += ROWS_PER_JOB) { jobs.push_back({ face, row }); }
+        }
+
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t j = next++; j < jobs.size(); j = next++) {
+                Job &job = jobs[j];
+                unsigned int lastRow = (std::min)(job.firstRow + ROWS_PER_JOB, size);
+                for (unsigned int row = job.firstRow; row < lastRow; row++) {
+                    unsigned char *texel = out + (((size_t)job.face * size + row) * size) * 4;
+                    for (unsigned int i = 0; i < size; i++, texel += 4) {
+                        glm::vec3 d = faceDirection(job.face, faceCoordinate(i, size), faceCoordinate(row, size));
+                        glm::vec3 color = glm::clamp(convolve(texels, d, squarings), 0.0f, 1.0f);
+                        texel[0] = (unsigned char)(color.r * 255.0f + 0.5f);
+                        texel[1] = (unsigned char)(color.g * 255.0f + 0.5f);
+                        texel[2] = (unsigned char)(color.b * 255.0f + 0.5f);
+                        texel[3] = 255;
+                    }
+                }
+            }
+        };
+        size_t threadCount = (std::min)((size_t)(std::max)(1u, std::thread::hardware_concurrency()), jobs.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threadCount; i++) { workers.emplace_back(work); }
+        work();
+        for (std::thread &worker : workers) { worker.join(); }
+    }
+
+    // Projects the radiance onto the first nine spherical harmonics and convolves it with the cosine
+    // lobe (Ramamoorthi and Hanrahan). The coefficients come out divided by pi and with the basis
+    // constants folded in, so the shader gets the average radiance over the hemisphere of n as
+    // c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2).
+    void projectIrradiance(const CubeTexels &texels, glm::vec4 irradiance[9]) {
+        glm::vec3 sh[9] = {};
+        for (size_t k = 0; k < texels.x.size(); k++) {
+            float x = texels.x[k], y = texels.y[k], z = texels.z[k];
+            glm::vec3 radiance(texels.r[k], texels.g[k], texels.b[k]); // already times the solid angle
+            float basis[9] = {
+                0.282095f,
+                0.488603f * y, 0.488603f * z, 0.488603f * x,
+                1.092548f * x * y, 1.092548f * y * z, 0.315392f * (3.0f * z * z - 1.0f), 1.092548f * x * z, 0.546274f * (x * x - y * y)
+            };
+            for (int i = 0; i < 9; i++) { sh[i] += radiance * basis[i]; }
+        }
+        // The cosine lobe's bands, pi, 2 pi / 3 and pi / 4, over pi
+        const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+        const float constant[9] = { 0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+        for (int i = 0; i < 9; i++) { irradiance[i] = glm::vec4(sh[i] * band[i] * constant[i], 0.0f); }
+    }
+
+    size_t levelBytes(unsigned int level) {
+        size_t size = ENVIRONMENT_SIZE >> level;
+        return 6 * size * size * 4;
+    }
+
+    size_t totalBytes() {
+        size_t bytes = 0;
+        for (unsigned int level = 0; level < ENVIRONMENT_LEVELS; level++) { bytes += levelBytes(level); }
+        return bytes;
+    }
+
+    // The decoded DXT level of the face that is size wide, empty if there is none
+    Image faceLevel(const DdsTexture &dds, unsigned int size) {
+        for (const DdsLevel &level : dds.levels) {
+            if (level.width == size && level.height == size) { return decodeDDSLevel(dds.format, level); }
+        }
+        return Image();
+    }
+}
+
+EnvironmentMap::EnvironmentMap(Vfs &v, std::string dir)
+    : vfs(v), directory(dir), loaded(false), uploaded(false), valid(false) {
+    for (glm::vec4 &coefficient : irradiance) { coefficient = glm::vec4(0.0f); }
+    worker = std::thread([this]() {
+        load();
+        loaded.store(true, std::memory_order_release);
+    });
+}
+
+EnvironmentMap::~EnvironmentMap() {
+    if (worker.joinable()) { worker.join(); }
+}
+
+void EnvironmentMap::load() {
+    PROFILE_ZONE("load environment");
+    VfsFile files[6];
+    DdsTexture faces[6];
+    uint64_t sourceHash = hashAsset(nullptr, 0);
+    for (int face = 0; face < 6; face++) {
+        std::string name = directory + "/" + FACE_NAMES[face] + ".dds";
+        files[face] = vfs.Open(name);
+        if (!parseDDS(files[face].Data(), files[face].Size(), faces[face])) {
+            if (files[face].IsOpen()) { Log::Message(LogSeverity::Medium, "Environment face is not a DXT1/3/5 compressed DDS file: ", name.c_str()); }
+            return;
+        }
+        sourceHash = hashAsset(files[face].Data(), files[face].Size(), sourceHash);
+    }
+
+    std::string cachePath = directory + "/" + CACHE_NAME;
+    if (readCache(cachePath, sourceHash)) {
+        valid = true;
+        return;
+    }
+
+    PROFILE_ZONE("prefilter environment");
+    pixels.resize(totalBytes());
+    Image levels[6];
+    size_t offset = 0;
+    for (unsigned int level = 0; level < ENVIRONMENT_LEVELS; level++) {
+        unsigned int size = ENVIRONMENT_SIZE >> level;
+        for (int face = 0; face < 6; face++) {
+            levels[face] = faceLevel(faces[face], size);
+            if (levels[face].pixels.empty()) {
+                Log::Message(LogSeverity::Medium, "Environment face lacks a level: ", (std::string(FACE_NAMES[face]) + " has no " + std::to_string(size) + "x" + std::to_string(size) + " level").c_str());
+                pixels.clear();
+                return;
+            }
+        }
+        if (level == 0) {
+            // Mirror reflections, as sharp as the cubemap is at this size
+            for (int face = 0; face < 6; face++) {
+                std::memcpy(pixels.data() + offset + (size_t)face * size * size * 4, levels[face].pixels.data(), levels[face].pixels.size());
+            }
+        }
+        else {
+            // Exponents from 512 at level 1 down to 2 at the last level, a quarter each level
+            int squarings = 2 * (ENVIRONMENT_LEVELS - (int)level) - 1;
+            prefilterLevel(gatherTexels(levels), size, squarings, pixels.data() + offset);
+        }
+        offset += levelBytes(level);
+    }
+
+    for (int face = 0; face < 6; face++) {
+        levels[face] = faceLevel(faces[face], ENVIRONMENT_IRRADIANCE_SIZE);
+        if (levels[face].pixels.empty()) {
+            std::string size = std::to_string(ENVIRONMENT_IRRADIANCE_SIZE);
+            Log::Message(LogSeverity::Medium, "Environment face lacks a level: ", (std::string(FACE_NAMES[face]) + " has no " + size + "x" + size + " level").c_str());
+            pixels.clear();
+            return;
+        }
+    }
+    projectIrradiance(gatherTexels(levels), irradiance);
+
+    writeCache(cachePath, sourceHash);
+    valid = true;
+}
+
+bool EnvironmentMap::readCache(const std::string &path, uint64_t sourceHash) {
+    if (!vfs.Exists(path)) { return false; }
+    VfsFile cache = vfs.Open(path);
+    CacheHeader header;
+    if (cache.Size() != sizeof(header) + totalBytes()) { return false; }
+    std::memcpy(&header, cache.Data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION || header.sourceHash != sourceHash
+        || header.size != ENVIRONMENT_SIZE || header.levels != ENVIRONMENT_LEVELS) {
+        return false;
+    }
+    for (int i = 0; i < 9; i++) { irradiance[i] = glm::vec4(header.irradiance[i][0], header.irradiance[i][1], header.irradiance[i][2], 0.0f); }
+    pixels.assign(cache.Data() + sizeof(header), cache.Data() + cache.Size());
+    return true;
+}
+
+void EnvironmentMap::writeCache(const std::string &path, uint64_t sourceHash) {
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.size = ENVIRONMENT_SIZE;
+    header.levels = ENVIRONMENT_LEVELS;
+    for (int i = 0; i < 9; i++) {
+        for (int c = 0; c < 4; c++) { header.irradiance[i][c] = irradiance[i][c]; }
+    }
+    // A failed write only costs the next start another convolution
+    std::ofstream cache(vfs.LoosePath(path), std::ios::binary);
+    if (!cache.write((const char*)&header, sizeof(header)) || !cache.write((const char*)pixels.data(), (std::streamsize)pixels.size())) {
+        Log::Message(LogSeverity::Low, "Could not cache the environment: ", path.c_str());
+    }
+}
+
+void EnvironmentMap::Update() {
+    if (uploaded || !loaded.load(std::memory_order_acquire)) { return; }
+    PROFILE_ZONE("upload environment");
+    worker.join();
+    uploaded = true;
+    if (!valid) { return; }
+
+    texture = GlTexture::Create();
+    glActiveTexture(GL_TEXTURE0 + ENVIRONMENT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture.ID());
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, ENVIRONMENT_LEVELS, GL_RGBA8, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE);
+    size_t offset = 0;
+    for (unsigned int level = 0; level < ENVIRONMENT_LEVELS; level++) {
+        GLsizei size = ENVIRONMENT_SIZE >> level;
+        for (int face = 0; face < 6; face++, offset += (size_t)size * size * 4) {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, (GLint)level, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() + offset);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+    // Filtering across face edges, so the blurry levels have no seams
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    pixels = std::vector<unsigned char>();
+}
+
+bool EnvironmentMap::IsReady() { return uploaded && valid; }
+
+bool EnvironmentMap::Done() { return uploaded; }
+
+void EnvironmentMap::SetUniforms(FrameUniforms &frame, float diffuse, float specular) {
+    // The worker writes the coefficients until Update has joined it
+    bool ready = IsReady();
+    for (int i = 0; i < 9; i++) { frame.irradiance[i] = ready ? irradiance[i] : glm::vec4(0.0f); }
+    frame.environment = glm::vec4(ready ? diffuse : 0.0f, ready ? specular : 0.0f, (float)(ENVIRONMENT_LEVELS - 1), 0.0f);
+}
+
+void EnvironmentMap::ReportMemory(MemoryReport &report) {
+    report.Add("environment", sizeof(*this) + pixels.capacity(), IsReady() ? totalBytes() : 0);
+}
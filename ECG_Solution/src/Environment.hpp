@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <GL\glew.h>
+#include "glm\matrix.hpp"
+#include "GlHandle.hpp"
+#include "Vfs.hpp"
+#include "Uniforms.hpp"
+#include "MemoryReport.hpp"
+
+// Face size of the prefiltered cubemap and its number of levels, down to 4x4
+#define ENVIRONMENT_SIZE 128
+#define ENVIRONMENT_LEVELS 6
+// Face size the irradiance is projected from
+#define ENVIRONMENT_IRRADIANCE_SIZE 32
+
+// Image based lighting from the cubemap in a texture directory, faces posx.dds to negz.dds.
+//
+// Two things are made from it on the CPU. The first is the irradiance as nine spherical harmonics
+// coefficients (SH9), which light the ambient part of the diffuse term. The second is a cubemap
+// whose levels hold the environment convolved with ever wider Phong lobes, so the specular term
+// can read the reflection for the material's shininess from one level. Level 0 is the mirror image.
+// The sources are the DXT levels of the faces at those sizes. The convolution runs on all cores,
+// four source texels at a time with SSE2.
+// The result is cached as environment.ibl next to the faces, stamped with a hash of them, so
+// starts after the first only read it. Loading runs on a worker thread and the shaders keep the
+// constant ambient term until the cubemap is uploaded.
+// Like the textures, the faces are taken as they are. The renderer has no sRGB handling, so
+// neither does the convolution.
+class EnvironmentMap {
+private:
+    Vfs &vfs;
+    std::string directory;
+    std::thread worker;
+    std::atomic<bool> loaded;
+    bool uploaded;
+    bool valid;                        // the worker made or read a cubemap
+    glm::vec4 irradiance[9];           // see FrameUniforms
+    std::vector<unsigned char> pixels; // RGBA8, level by level and face by face in GL order
+    GlTexture texture;
+
+    void load();
+    bool readCache(const std::string &path, uint64_t sourceHash);
+    void writeCache(const std::string &path, uint64_t sourceHash);
+
+public:
+    // Starts loading right away
+    EnvironmentMap(Vfs &vfs, std::string directory);
+    EnvironmentMap(const EnvironmentMap &) = delete;
+    EnvironmentMap &operator=(const EnvironmentMap &) = delete;
+    ~EnvironmentMap();
+
+    // Once per frame: uploads the cubemap once it is loaded and binds it to ENVIRONMENT_TEXTURE_UNIT for good
+    void Update();
+    bool IsReady();
+    // Whether loading is over, with a cubemap or without one for missing faces
+    bool Done();
+    // Writes the irradiance and the strengths to the frame block, zeros until it is ready
+    void SetUniforms(FrameUniforms &frame, float diffuse, float specular);
+    // Adds the cubemap as "environment"
+    void ReportMemory(MemoryReport &report);
+};
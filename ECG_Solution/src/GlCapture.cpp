@@ -0,0 +1,847 @@
+#define GL_CAPTURE_KEEP_NAMES
+#include "GlCapture.hpp"
+#include "GlTrace.hpp"
+#include "Log.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Until Install swaps them for the hooks, the pointers lead straight to opengl32
+#define GL_CAPTURE_DEFINE(name) decltype(&::gl##name) glCapture##name = &::gl##name;
+GL_CAPTURE_CORE_FUNCTIONS(GL_CAPTURE_DEFINE)
+#undef GL_CAPTURE_DEFINE
+
+// The GLEW functions that get hooked. Their GLEW pointers are swapped for the hooks.
+#define GL_CAPTURE_GLEW_FUNCTIONS(X) \
+    X(GenBuffers) X(DeleteBuffers) X(BindBuffer) X(BufferData) X(BufferSubData) X(BufferStorage) X(BindBufferBase) X(BindBufferRange) \
+    X(GenVertexArrays) X(DeleteVertexArrays) X(BindVertexArray) X(VertexAttribPointer) X(EnableVertexAttribArray) \
+    X(CreateShader) X(ShaderSource) X(CompileShader) X(DeleteShader) \
+    X(CreateProgram) X(AttachShader) X(DetachShader) X(LinkProgram) X(DeleteProgram) X(UseProgram) \
+    X(ActiveTexture) X(TexStorage2D) X(TexStorage3D) X(CompressedTexSubImage3D) X(GenerateMipmap) \
+    X(GenQueries) X(QueryCounter) X(FenceSync) X(ClientWaitSync) X(DeleteSync) \
+    X(CopyBufferSubData) X(ClearBufferData) X(VertexAttribIPointer) X(VertexAttribDivisor) \
+    X(Uniform1i) X(Uniform1ui) X(Uniform1f) X(Uniform2i) X(Uniform2f) X(Uniform2fv) X(Uniform3fv) X(UniformMatrix4fv) \
+    X(DispatchCompute) X(MemoryBarrier) X(MultiDrawElementsIndirect) X(MultiDrawElementsIndirectCountARB) \
+    X(BindImageTexture) X(MapBufferRange) X(UnmapBuffer) X(DispatchComputeIndirect) X(DrawArraysIndirect)
+
+namespace {
+    // The functions the hooks forward to
+    namespace real {
+#define GL_CAPTURE_REAL_CORE(name) decltype(&::gl##name) name;
+#define GL_CAPTURE_REAL_GLEW(name) decltype(__glew##name) name;
+        GL_CAPTURE_CORE_FUNCTIONS(GL_CAPTURE_REAL_CORE)
+        GL_CAPTURE_GLEW_FUNCTIONS(GL_CAPTURE_REAL_GLEW)
+#undef GL_CAPTURE_REAL_CORE
+#undef GL_CAPTURE_REAL_GLEW
+    }
+
+    struct CapturedProgram {
+        std::vector<GLuint> attached;
+        std::vector<std::pair<GLenum, std::string>> shaders; // what it was last linked from
+    };
+
+    // What the capture knows about the GL objects and state, from Install on
+    struct Capture {
+        std::filesystem::path file;
+        unsigned int firstFrame = 0;
+        unsigned int frameCount = 0;
+        unsigned int frame = 0;
+        bool installed = false;
+        bool recording = false;
+        GlTraceHeader header = {};
+        std::vector<unsigned char> trace;
+
+        std::set<GLuint> buffers;
+        std::map<GLuint, GLenum> textures;                         // target it was first bound to, 0 before that
+        std::map<GLuint, std::vector<unsigned char>> vertexArrays; // the calls that set each one up
+        std::map<GLuint, std::pair<GLenum, std::string>> shaders;  // type and source
+        std::map<GLuint, CapturedProgram> programs;
+        std::unordered_map<GLsync, uint64_t> syncs;
+        uint64_t nextSync = 1;
+
+        GLuint vertexArray = 0;
+        GLenum activeTexture = GL_TEXTURE0;
+        std::map<GLenum, GLuint> bufferBindings;                      // element arrays belong to the vertex array
+        std::map<std::pair<GLenum, GLenum>, GLuint> textureBindings;  // by unit and target
+        std::map<uint64_t, std::vector<unsigned char>> state;         // last call setting each piece of state
+    };
+    Capture capture;
+
+    template <typename... Args>
+    void encode(std::vector<unsigned char> &out, GlTraceOp op, Args... args) {
+        GlTraceWriter writer(out);
+        writer.Begin(op);
+        (writer.Put(args), ...);
+        writer.End();
+    }
+
+    template <typename... Args>
+    void record(GlTraceOp op, Args... args) {
+        if (capture.recording) { encode(capture.trace, op, args...); }
+    }
+
+    // Keeps the call as the current value of a piece of state, for the snapshot
+    template <typename... Args>
+    void setState(GlTraceOp op, uint32_t which, Args... args) {
+        std::vector<unsigned char> &call = capture.state[((uint64_t)op << 32) | which];
+        call.clear();
+        encode(call, op, args...);
+    }
+
+    // Appends a call to the setup of the bound vertex array
+    template <typename... Args>
+    void setVertexArray(GlTraceOp op, Args... args) {
+        if (capture.vertexArray) { encode(capture.vertexArrays[capture.vertexArray], op, args...); }
+    }
+
+    void recordNames(GlTraceOp op, GLsizei n, const GLuint *names) {
+        if (!capture.recording) { return; }
+        GlTraceWriter writer(capture.trace);
+        writer.Begin(op);
+        writer.Put((uint32_t)n);
+        for (GLsizei i = 0; i < n; i++) { writer.Put((uint32_t)names[i]); }
+        writer.End();
+    }
+
+    // Client memory the call reads, size bytes of it
+    void recordWithData(GlTraceOp op, std::vector<uint64_t> args, const void *data, size_t size) {
+        if (!capture.recording) { return; }
+        GlTraceWriter writer(capture.trace);
+        writer.Begin(op);
+        for (uint64_t arg : args) { writer.Put(arg); }
+        writer.PutBytes(data, size);
+        writer.End();
+    }
+
+    // Bytes of one pixel in client memory, for the formats and types buffers are cleared and textures uploaded with
+    size_t pixelSize(GLenum format, GLenum type) {
+        size_t components = 4;
+        switch (format) {
+            case GL_RED: case GL_RED_INTEGER: components = 1; break;
+            case GL_RG: case GL_RG_INTEGER: components = 2; break;
+            case GL_RGB: case GL_RGB_INTEGER: components = 3; break;
+        }
+        switch (type) {
+            case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components * 2;
+            default: return components * 4;
+        }
+    }
+
+    uint64_t syncId(GLsync sync) {
+        auto found = capture.syncs.find(sync);
+        return found == capture.syncs.end() ? 0 : found->second;
+    }
+
+    /* --------------------------------------------- */
+    // Hooks
+    /* --------------------------------------------- */
+
+    void GLAPIENTRY hookGenBuffers(GLsizei n, GLuint *names) {
+        real::GenBuffers(n, names);
+        for (GLsizei i = 0; i < n; i++) { capture.buffers.insert(names[i]); }
+        recordNames(GlTraceOp::GenBuffers, n, names);
+    }
+
+    void GLAPIENTRY hookDeleteBuffers(GLsizei n, const GLuint *names) {
+        real::DeleteBuffers(n, names);
+        for (GLsizei i = 0; i < n; i++) {
+            capture.buffers.erase(names[i]);
+            for (auto &binding : capture.bufferBindings) {
+                if (binding.second == names[i]) { binding.second = 0; }
+            }
+        }
+        recordNames(GlTraceOp::DeleteBuffers, n, names);
+    }
+
+    void GLAPIENTRY hookBindBuffer(GLenum target, GLuint buffer) {
+        real::BindBuffer(target, buffer);
+        if (target == GL_ELEMENT_ARRAY_BUFFER) { setVertexArray(GlTraceOp::BindBuffer, target, buffer); }
+        else { capture.bufferBindings[target] = buffer; }
+        record(GlTraceOp::BindBuffer, target, buffer);
+    }
+
+    void GLAPIENTRY hookBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+        real::BufferData(target, size, data, usage);
+        recordWithData(GlTraceOp::BufferData, { target, (uint64_t)size, usage }, data, (size_t)size);
+    }
+
+    void GLAPIENTRY hookBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+        real::BufferSubData(target, offset, size, data);
+        recordWithData(GlTraceOp::BufferSubData, { target, (uint64_t)offset }, data, (size_t)size);
+    }
+
+    void GLAPIENTRY hookBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) {
+        real::BufferStorage(target, size, data, flags);
+        recordWithData(GlTraceOp::BufferStorage, { target, (uint64_t)size, flags }, data, (size_t)size);
+    }
+
+    // The replay maps and unmaps the same ranges. What is written through the pointer is not recorded.
+    void *GLAPIENTRY hookMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        void *data = real::MapBufferRange(target, offset, length, access);
+        record(GlTraceOp::MapBufferRange, target, (int64_t)offset, (int64_t)length, access);
+        return data;
+    }
+
+    GLboolean GLAPIENTRY hookUnmapBuffer(GLenum target) {
+        GLboolean result = real::UnmapBuffer(target);
+        record(GlTraceOp::UnmapBuffer, target);
+        return result;
+    }
+
+    void GLAPIENTRY hookBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        real::BindBufferBase(target, index, buffer);
+        // Also binds the generic target
+        capture.bufferBindings[target] = buffer;
+        setState(GlTraceOp::BindBufferBase, (target << 8) ^ index, target, index, buffer);
+        record(GlTraceOp::BindBufferBase, target, index, buffer);
+    }
+
+    void GLAPIENTRY hookBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+        real::BindBufferRange(target, index, buffer, offset, size);
+        capture.bufferBindings[target] = buffer;
+        setState(GlTraceOp::BindBufferBase, (target << 8) ^ index, target, index, buffer, (int64_t)offset, (int64_t)size);
+        // Shares the key with BindBufferBase, so the op has to be patched in
+        std::vector<unsigned char> &call = capture.state[((uint64_t)GlTraceOp::BindBufferBase << 32) | ((target << 8) ^ index)];
+        uint16_t op = (uint16_t)GlTraceOp::BindBufferRange;
+        std::memcpy(call.data(), &op, sizeof(op));
+        record(GlTraceOp::BindBufferRange, target, index, buffer, (int64_t)offset, (int64_t)size);
+    }
+
+    void GLAPIENTRY hookCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) {
+        real::CopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+        record(GlTraceOp::CopyBufferSubData, readTarget, writeTarget, (int64_t)readOffset, (int64_t)writeOffset, (int64_t)size);
+    }
+
+    void GLAPIENTRY hookClearBufferData(GLenum target, GLenum internalFormat, GLenum format, GLenum type, const void *data) {
+        real::ClearBufferData(target, internalFormat, format, type, data);
+        // No data clears to zero
+        recordWithData(GlTraceOp::ClearBufferData, { target, internalFormat, format, type }, data, pixelSize(format, type));
+    }
+
+    void GLAPIENTRY hookGenVertexArrays(GLsizei n, GLuint *names) {
+        real::GenVertexArrays(n, names);
+        for (GLsizei i = 0; i < n; i++) { capture.vertexArrays[names[i]].clear(); }
+        recordNames(GlTraceOp::GenVertexArrays, n, names);
+    }
+
+    void GLAPIENTRY hookDeleteVertexArrays(GLsizei n, const GLuint *names) {
+        real::DeleteVertexArrays(n, names);
+        for (GLsizei i = 0; i < n; i++) {
+            capture.vertexArrays.erase(names[i]);
+            if (capture.vertexArray == names[i]) { capture.vertexArray = 0; }
+        }
+        recordNames(GlTraceOp::DeleteVertexArrays, n, names);
+    }
+
+    void GLAPIENTRY hookBindVertexArray(GLuint array) {
+        real::BindVertexArray(array);
+        capture.vertexArray = array;
+        record(GlTraceOp::BindVertexArray, array);
+    }
+
+    void GLAPIENTRY hookVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) {
+        real::VertexAttribPointer(index, size, type, normalized, stride, pointer);
+        // The attribute reads from the array buffer bound right now
+        setVertexArray(GlTraceOp::BindBuffer, (GLenum)GL_ARRAY_BUFFER, capture.bufferBindings[GL_ARRAY_BUFFER]);
+        setVertexArray(GlTraceOp::VertexAttribPointer, index, size, type, (uint8_t)normalized, stride, (int64_t)(intptr_t)pointer);
+        record(GlTraceOp::VertexAttribPointer, index, size, type, (uint8_t)normalized, stride, (int64_t)(intptr_t)pointer);
+    }
+
+    void GLAPIENTRY hookVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer) {
+        real::VertexAttribIPointer(index, size, type, stride, pointer);
+        setVertexArray(GlTraceOp::BindBuffer, (GLenum)GL_ARRAY_BUFFER, capture.bufferBindings[GL_ARRAY_BUFFER]);
+        setVertexArray(GlTraceOp::VertexAttribIPointer, index, size, type, stride, (int64_t)(intptr_t)pointer);
+        record(GlTraceOp::VertexAttribIPointer, index, size, type, stride, (int64_t)(intptr_t)pointer);
+    }
+
+    void GLAPIENTRY hookVertexAttribDivisor(GLuint index, GLuint divisor) {
+        real::VertexAttribDivisor(index, divisor);
+        setVertexArray(GlTraceOp::VertexAttribDivisor, index, divisor);
+        record(GlTraceOp::VertexAttribDivisor, index, divisor);
+    }
+
+    void GLAPIENTRY hookEnableVertexAttribArray(GLuint index) {
+        real::EnableVertexAttribArray(index);
+        setVertexArray(GlTraceOp::EnableVertexAttribArray, index);
+        record(GlTraceOp::EnableVertexAttribArray, index);
+    }
+
+    GLuint GLAPIENTRY hookCreateShader(GLenum type) {
+        GLuint shader = real::CreateShader(type);
+        capture.shaders[shader] = { type, std::string() };
+        record(GlTraceOp::CreateShader, type, shader);
+        return shader;
+    }
+
+    void GLAPIENTRY hookShaderSource(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths) {
+        real::ShaderSource(shader, count, strings, lengths);
+        std::string source;
+        for (GLsizei i = 0; i < count; i++) {
+            if (lengths && lengths[i] >= 0) { source.append(strings[i], (size_t)lengths[i]); }
+            else { source.append(strings[i]); }
+        }
+        if (capture.recording) {
+            GlTraceWriter writer(capture.trace);
+            writer.Begin(GlTraceOp::ShaderSource);
+            writer.Put(shader);
+            writer.PutString(source);
+            writer.End();
+        }
+        capture.shaders[shader].second = std::move(source);
+    }
+
+    void GLAPIENTRY hookCompileShader(GLuint shader) {
+        real::CompileShader(shader);
+        record(GlTraceOp::CompileShader, shader);
+    }
+
+    void GLAPIENTRY hookDeleteShader(GLuint shader) {
+        real::DeleteShader(shader);
+        capture.shaders.erase(shader);
+        record(GlTraceOp::DeleteShader, shader);
+    }
+
+    GLuint GLAPIENTRY hookCreateProgram() {
+        GLuint program = real::CreateProgram();
+        capture.programs[program] = CapturedProgram();
+        record(GlTraceOp::CreateProgram, program);
+        return program;
+    }
+
+    void GLAPIENTRY hookAttachShader(GLuint program, GLuint shader) {
+        real::AttachShader(program, shader);
+        capture.programs[program].attached.push_back(shader);
+        record(GlTraceOp::AttachShader, program, shader);
+    }
+
+    void GLAPIENTRY hookDetachShader(GLuint program, GLuint shader) {
+        real::DetachShader(program, shader);
+        std::vector<GLuint> &attached = capture.programs[program].attached;
+        for (size_t i = 0; i < attached.size(); i++) {
+            if (attached[i] == shader) { attached.erase(attached.begin() + i); break; }
+        }
+        record(GlTraceOp::DetachShader, program, shader);
+    }
+
+    void GLAPIENTRY hookLinkProgram(GLuint program) {
+        real::LinkProgram(program);
+        CapturedProgram &captured = capture.programs[program];
+        captured.shaders.clear();
+        for (GLuint shader : captured.attached) { captured.shaders.push_back(capture.shaders[shader]); }
+        record(GlTraceOp::LinkProgram, program);
+    }
+
+    void GLAPIENTRY hookDeleteProgram(GLuint program) {
+        real::DeleteProgram(program);
+        capture.programs.erase(program);
+        record(GlTraceOp::DeleteProgram, program);
+    }
+
+    void GLAPIENTRY hookUseProgram(GLuint program) {
+        real::UseProgram(program);
+        setState(GlTraceOp::UseProgram, 0, program);
+        record(GlTraceOp::UseProgram, program);
+    }
+
+    // Uniforms go to the program in use, they are recorded but not kept for the snapshot
+    void GLAPIENTRY hookUniform1i(GLint location, GLint v0) {
+        real::Uniform1i(location, v0);
+        record(GlTraceOp::Uniform1i, location, v0);
+    }
+
+    void GLAPIENTRY hookUniform1ui(GLint location, GLuint v0) {
+        real::Uniform1ui(location, v0);
+        record(GlTraceOp::Uniform1ui, location, v0);
+    }
+
+    void GLAPIENTRY hookUniform1f(GLint location, GLfloat v0) {
+        real::Uniform1f(location, v0);
+        record(GlTraceOp::Uniform1f, location, v0);
+    }
+
+    void GLAPIENTRY hookUniform2i(GLint location, GLint v0, GLint v1) {
+        real::Uniform2i(location, v0, v1);
+        record(GlTraceOp::Uniform2i, location, v0, v1);
+    }
+
+    void GLAPIENTRY hookUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+        real::Uniform2f(location, v0, v1);
+        record(GlTraceOp::Uniform2f, location, v0, v1);
+    }
+
+    void GLAPIENTRY hookUniform2fv(GLint location, GLsizei count, const GLfloat *value) {
+        real::Uniform2fv(location, count, value);
+        recordWithData(GlTraceOp::Uniform2fv, { (uint64_t)(int64_t)location }, value, (size_t)count * 2 * sizeof(GLfloat));
+    }
+
+    void GLAPIENTRY hookUniform3fv(GLint location, GLsizei count, const GLfloat *value) {
+        real::Uniform3fv(location, count, value);
+        recordWithData(GlTraceOp::Uniform3fv, { (uint64_t)(int64_t)location }, value, (size_t)count * 3 * sizeof(GLfloat));
+    }
+
+    void GLAPIENTRY hookUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        real::UniformMatrix4fv(location, count, transpose, value);
+        recordWithData(GlTraceOp::UniformMatrix4fv, { (uint64_t)(int64_t)location, transpose }, value, (size_t)count * 16 * sizeof(GLfloat));
+    }
+
+    void GLAPIENTRY hookActiveTexture(GLenum texture) {
+        real::ActiveTexture(texture);
+        capture.activeTexture = texture;
+        record(GlTraceOp::ActiveTexture, texture);
+    }
+
+    void GLAPIENTRY hookGenTextures(GLsizei n, GLuint *names) {
+        real::GenTextures(n, names);
+        for (GLsizei i = 0; i < n; i++) { capture.textures[names[i]] = 0; }
+        recordNames(GlTraceOp::GenTextures, n, names);
+    }
+
+    void GLAPIENTRY hookDeleteTextures(GLsizei n, const GLuint *names) {
+        real::DeleteTextures(n, names);
+        for (GLsizei i = 0; i < n; i++) {
+            capture.textures.erase(names[i]);
+            for (auto &binding : capture.textureBindings) {
+                if (binding.second == names[i]) { binding.second = 0; }
+            }
+        }
+        recordNames(GlTraceOp::DeleteTextures, n, names);
+    }
+
+    void GLAPIENTRY hookBindTexture(GLenum target, GLuint texture) {
+        real::BindTexture(target, texture);
+        auto found = capture.textures.find(texture);
+        if (found != capture.textures.end() && found->second == 0) { found->second = target; }
+        capture.textureBindings[{ capture.activeTexture, target }] = texture;
+        record(GlTraceOp::BindTexture, target, texture);
+    }
+
+    void GLAPIENTRY hookTexParameteri(GLenum target, GLenum pname, GLint param) {
+        real::TexParameteri(target, pname, param);
+        record(GlTraceOp::TexParameteri, target, pname, param);
+    }
+
+    void GLAPIENTRY hookTexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) {
+        real::TexStorage2D(target, levels, internalFormat, width, height);
+        record(GlTraceOp::TexStorage2D, target, levels, internalFormat, width, height);
+    }
+
+    void GLAPIENTRY hookTexStorage3D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth) {
+        real::TexStorage3D(target, levels, internalFormat, width, height, depth);
+        record(GlTraceOp::TexStorage3D, target, levels, internalFormat, width, height, depth);
+    }
+
+    // Rows are read with the default unpack alignment of 4, the app never changes it.
+    // From a pixel unpack buffer the pointer is an offset and no bytes are kept.
+    void GLAPIENTRY hookTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                                      GLenum format, GLenum type, const void *pixels) {
+        real::TexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+        if (!capture.recording) { return; }
+        bool unpackBuffer = capture.bufferBindings[GL_PIXEL_UNPACK_BUFFER] != 0;
+        size_t rowSize = (size_t)width * pixelSize(format, type);
+        size_t size = height > 0 ? (size_t)(height - 1) * ((rowSize + 3) / 4 * 4) + rowSize : 0;
+        GlTraceWriter writer(capture.trace);
+        writer.Begin(GlTraceOp::TexSubImage2D);
+        for (uint32_t arg : { (uint32_t)target, (uint32_t)level, (uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)height,
+                              (uint32_t)format, (uint32_t)type }) {
+            writer.Put(arg);
+        }
+        writer.Put((int64_t)(unpackBuffer ? (intptr_t)pixels : 0));
+        writer.PutBytes(unpackBuffer ? nullptr : pixels, size);
+        writer.End();
+    }
+
+    void GLAPIENTRY hookCopyTexSubImage2D(GLenum target, GLint level, GLint xOffset, GLint yOffset, GLint x, GLint y, GLsizei width, GLsizei height) {
+        real::CopyTexSubImage2D(target, level, xOffset, yOffset, x, y, width, height);
+        record(GlTraceOp::CopyTexSubImage2D, target, level, xOffset, yOffset, x, y, width, height);
+    }
+
+    // Only reads into a pixel pack buffer are recorded, the pointer is an offset into it.
+    // Reads into client memory only feed the CPU, the replay has nothing to do with them.
+    void GLAPIENTRY hookGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void *pixels) {
+        real::GetTexImage(target, level, format, type, pixels);
+        if (capture.bufferBindings[GL_PIXEL_PACK_BUFFER] == 0) { return; }
+        record(GlTraceOp::GetTexImage, target, level, format, type, (int64_t)(intptr_t)pixels);
+    }
+
+    void GLAPIENTRY hookBindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) {
+        real::BindImageTexture(unit, texture, level, layered, layer, access, format);
+        setState(GlTraceOp::BindImageTexture, unit, unit, texture, level, (uint8_t)layered, layer, access, format);
+        record(GlTraceOp::BindImageTexture, unit, texture, level, (uint8_t)layered, layer, access, format);
+    }
+
+    void GLAPIENTRY hookCompressedTexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z,
+                                                GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *data) {
+        real::CompressedTexSubImage3D(target, level, x, y, z, width, height, depth, format, imageSize, data);
+        if (!capture.recording) { return; }
+        GlTraceWriter writer(capture.trace);
+        writer.Begin(GlTraceOp::CompressedTexSubImage3D);
+        for (uint32_t arg : { (uint32_t)target, (uint32_t)level, (uint32_t)x, (uint32_t)y, (uint32_t)z,
+                              (uint32_t)width, (uint32_t)height, (uint32_t)depth, (uint32_t)format }) {
+            writer.Put(arg);
+        }
+        writer.PutBytes(data, (size_t)imageSize);
+        writer.End();
+    }
+
+    void GLAPIENTRY hookGenerateMipmap(GLenum target) {
+        real::GenerateMipmap(target);
+        record(GlTraceOp::GenerateMipmap, target);
+    }
+
+    void GLAPIENTRY hookGenQueries(GLsizei n, GLuint *names) {
+        real::GenQueries(n, names);
+        recordNames(GlTraceOp::GenQueries, n, names);
+    }
+
+    void GLAPIENTRY hookQueryCounter(GLuint query, GLenum target) {
+        real::QueryCounter(query, target);
+        record(GlTraceOp::QueryCounter, query, target);
+    }
+
+    GLsync GLAPIENTRY hookFenceSync(GLenum condition, GLbitfield flags) {
+        GLsync sync = real::FenceSync(condition, flags);
+        uint64_t id = capture.nextSync++;
+        capture.syncs[sync] = id;
+        record(GlTraceOp::FenceSync, id, condition, flags);
+        return sync;
+    }
+
+    GLenum GLAPIENTRY hookClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+        GLenum status = real::ClientWaitSync(sync, flags, timeout);
+        // Only the wait that got through is kept, the replayer waits as long as it takes
+        if (status != GL_TIMEOUT_EXPIRED) { record(GlTraceOp::ClientWaitSync, syncId(sync), flags); }
+        return status;
+    }
+
+    void GLAPIENTRY hookDeleteSync(GLsync sync) {
+        real::DeleteSync(sync);
+        record(GlTraceOp::DeleteSync, syncId(sync));
+        capture.syncs.erase(sync);
+    }
+
+    void GLAPIENTRY hookClear(GLbitfield mask) {
+        real::Clear(mask);
+        record(GlTraceOp::Clear, mask);
+    }
+
+    void GLAPIENTRY hookClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+        real::ClearColor(r, g, b, a);
+        setState(GlTraceOp::ClearColor, 0, r, g, b, a);
+        record(GlTraceOp::ClearColor, r, g, b, a);
+    }
+
+    void GLAPIENTRY hookEnable(GLenum cap) {
+        real::Enable(cap);
+        setState(GlTraceOp::Enable, cap, cap);
+        record(GlTraceOp::Enable, cap);
+    }
+
+    void GLAPIENTRY hookDisable(GLenum cap) {
+        real::Disable(cap);
+        // Same key as Enable, the later call wins
+        setState(GlTraceOp::Enable, cap, cap);
+        std::vector<unsigned char> &call = capture.state[((uint64_t)GlTraceOp::Enable << 32) | cap];
+        uint16_t op = (uint16_t)GlTraceOp::Disable;
+        std::memcpy(call.data(), &op, sizeof(op));
+        record(GlTraceOp::Disable, cap);
+    }
+
+    void GLAPIENTRY hookBlendFunc(GLenum source, GLenum destination) {
+        real::BlendFunc(source, destination);
+        setState(GlTraceOp::BlendFunc, 0, source, destination);
+        record(GlTraceOp::BlendFunc, source, destination);
+    }
+
+    void GLAPIENTRY hookDepthFunc(GLenum func) {
+        real::DepthFunc(func);
+        setState(GlTraceOp::DepthFunc, 0, func);
+        record(GlTraceOp::DepthFunc, func);
+    }
+
+    void GLAPIENTRY hookDepthMask(GLboolean flag) {
+        real::DepthMask(flag);
+        setState(GlTraceOp::DepthMask, 0, (uint8_t)flag);
+        record(GlTraceOp::DepthMask, (uint8_t)flag);
+    }
+
+    void GLAPIENTRY hookColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
+        real::ColorMask(r, g, b, a);
+        setState(GlTraceOp::ColorMask, 0, (uint8_t)r, (uint8_t)g, (uint8_t)b, (uint8_t)a);
+        record(GlTraceOp::ColorMask, (uint8_t)r, (uint8_t)g, (uint8_t)b, (uint8_t)a);
+    }
+
+    void GLAPIENTRY hookPolygonMode(GLenum face, GLenum mode) {
+        real::PolygonMode(face, mode);
+        setState(GlTraceOp::PolygonMode, 0, face, mode);
+        record(GlTraceOp::PolygonMode, face, mode);
+    }
+
+    void GLAPIENTRY hookPointSize(GLfloat size) {
+        real::PointSize(size);
+        setState(GlTraceOp::PointSize, 0, size);
+        record(GlTraceOp::PointSize, size);
+    }
+
+    void GLAPIENTRY hookViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        real::Viewport(x, y, width, height);
+        setState(GlTraceOp::Viewport, 0, x, y, width, height);
+        record(GlTraceOp::Viewport, x, y, width, height);
+    }
+
+    void GLAPIENTRY hookDrawArrays(GLenum mode, GLint first, GLsizei count) {
+        real::DrawArrays(mode, first, count);
+        record(GlTraceOp::DrawArrays, mode, first, count);
+    }
+
+    void GLAPIENTRY hookDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {
+        real::DrawElements(mode, count, type, indices);
+        // Always drawn from an element array buffer, so the pointer is an offset
+        record(GlTraceOp::DrawElements, mode, count, type, (int64_t)(intptr_t)indices);
+    }
+
+    void GLAPIENTRY hookDispatchCompute(GLuint x, GLuint y, GLuint z) {
+        real::DispatchCompute(x, y, z);
+        record(GlTraceOp::DispatchCompute, x, y, z);
+    }
+
+    // The arguments always come from the dispatch indirect buffer, so the pointer is an offset
+    void GLAPIENTRY hookDispatchComputeIndirect(GLintptr indirect) {
+        real::DispatchComputeIndirect(indirect);
+        record(GlTraceOp::DispatchComputeIndirect, (int64_t)indirect);
+    }
+
+    void GLAPIENTRY hookMemoryBarrier(GLbitfield barriers) {
+        real::MemoryBarrier(barriers);
+        record(GlTraceOp::MemoryBarrier, barriers);
+    }
+
+    // The commands always come from the draw indirect buffer, so the pointer is an offset
+    void GLAPIENTRY hookDrawArraysIndirect(GLenum mode, const void *indirect) {
+        real::DrawArraysIndirect(mode, indirect);
+        record(GlTraceOp::DrawArraysIndirect, mode, (int64_t)(intptr_t)indirect);
+    }
+
+    void GLAPIENTRY hookMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawCount, GLsizei stride) {
+        real::MultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+        record(GlTraceOp::MultiDrawElementsIndirect, mode, type, (int64_t)(intptr_t)indirect, drawCount, stride);
+    }
+
+    void GLAPIENTRY hookMultiDrawElementsIndirectCountARB(GLenum mode, GLenum type, const void *indirect, GLintptr drawCount,
+                                                          GLsizei maxDrawCount, GLsizei stride) {
+        real::MultiDrawElementsIndirectCountARB(mode, type, indirect, drawCount, maxDrawCount, stride);
+        record(GlTraceOp::MultiDrawElementsIndirectCountARB, mode, type, (int64_t)(intptr_t)indirect, (int64_t)drawCount, maxDrawCount, stride);
+    }
+
+    /* --------------------------------------------- */
+    // Snapshot
+    /* --------------------------------------------- */
+
+    void snapshotBuffer(GlTraceWriter &writer, GLuint buffer) {
+        real::BindBuffer(GL_COPY_READ_BUFFER, buffer);
+        GLint64 size = 0;
+        GLint usage = GL_STATIC_DRAW, mapped = GL_FALSE;
+        glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_MAPPED, &mapped);
+        std::vector<unsigned char> data;
+        if (mapped) { Log::Message(LogSeverity::Medium, "GL capture: leaving out the contents of mapped buffer ", std::to_string(buffer).c_str()); }
+        else { data.resize((size_t)size); }
+        if (!data.empty()) { glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)data.size(), data.data()); }
+
+        writer.Begin(GlTraceOp::SnapshotBuffer);
+        writer.Put(buffer);
+        writer.Put((uint32_t)usage);
+        writer.Put((uint64_t)size);
+        writer.PutBytes(data.data(), data.size());
+        writer.End();
+    }
+
+    // How uncompressed levels are read back and uploaded again. Depth has nothing worth keeping.
+    bool pixelTransfer(GLenum internalFormat, GLenum &format, GLenum &type) {
+        switch (internalFormat) {
+            case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F:
+            case GL_DEPTH24_STENCIL8: case GL_DEPTH32F_STENCIL8:
+                return false;
+            case GL_R8UI: case GL_R16UI: case GL_R32UI: case GL_RG8UI: case GL_RG16UI: case GL_RG32UI: case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI:
+                format = GL_RGBA_INTEGER; type = GL_UNSIGNED_INT;
+                return true;
+            case GL_R8I: case GL_R16I: case GL_R32I: case GL_RG8I: case GL_RG16I: case GL_RG32I: case GL_RGBA8I: case GL_RGBA16I: case GL_RGBA32I:
+                format = GL_RGBA_INTEGER; type = GL_INT;
+                return true;
+            default:
+                format = GL_RGBA; type = GL_FLOAT;
+                return true;
+        }
+    }
+
+    void snapshotTexture(GlTraceWriter &writer, GLuint texture, GLenum target) {
+        if (target != GL_TEXTURE_2D && target != GL_TEXTURE_2D_ARRAY && target != GL_TEXTURE_CUBE_MAP) {
+            Log::Message(LogSeverity::Medium, "GL capture: leaving out texture of a target traces do not support ", std::to_string(texture).c_str());
+            return;
+        }
+        real::BindTexture(target, texture);
+        GLenum levelTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+        GLint immutable = 0, levels = 0, internalFormat = 0, width = 0, height = 0, depth = 0;
+        glGetTexParameteriv(target, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+        if (immutable) { glGetTexParameteriv(target, GL_TEXTURE_IMMUTABLE_LEVELS, &levels); }
+        else {
+            for (GLint w = 1; w > 0 && levels < 16; levels++) {
+                glGetTexLevelParameteriv(levelTarget, levels, GL_TEXTURE_WIDTH, &w);
+                if (w == 0) { break; }
+            }
+        }
+        glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_DEPTH, &depth);
+        GLint parameters[4];
+        GLenum names[4] = { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T };
+        for (int i = 0; i < 4; i++) { glGetTexParameteriv(target, names[i], &parameters[i]); }
+
+        writer.Begin(GlTraceOp::SnapshotTexture);
+        writer.Put(texture);
+        writer.Put((uint32_t)target);
+        writer.Put((uint32_t)internalFormat);
+        writer.Put((uint32_t)levels);
+        writer.Put((uint32_t)width);
+        writer.Put((uint32_t)height);
+        writer.Put((uint32_t)depth);
+        for (GLint parameter : parameters) { writer.Put((uint32_t)parameter); }
+
+        std::vector<unsigned char> data;
+        GLenum format = GL_RGBA, type = GL_FLOAT;
+        bool readable = pixelTransfer((GLenum)internalFormat, format, type);
+        int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        for (GLint level = 0; level < levels; level++) {
+            for (int face = 0; face < faces; face++) {
+                GLenum imageTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+                GLint compressed = 0, w = 0, h = 0, d = 0;
+                glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_COMPRESSED, &compressed);
+                glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_WIDTH, &w);
+                glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_HEIGHT, &h);
+                glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_DEPTH, &d);
+                data.clear();
+                if (compressed) {
+                    GLint size = 0;
+                    glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                    data.resize((size_t)size);
+                    if (size > 0) { glGetCompressedTexImage(imageTarget, level, data.data()); }
+                }
+                else if (readable) {
+                    // Four 32 bit components, rows stay aligned for any pack alignment
+                    data.resize((size_t)w * h * d * 16);
+                    if (!data.empty()) { glGetTexImage(imageTarget, level, format, type, data.data()); }
+                }
+                writer.Put((uint8_t)(compressed ? 1 : 0));
+                writer.Put((uint32_t)format);
+                writer.Put((uint32_t)type);
+                writer.PutBytes(data.data(), data.size());
+            }
+        }
+        writer.End();
+
+        real::BindTexture(target, capture.textureBindings[{ capture.activeTexture, target }]);
+    }
+
+    // Everything the first frame relies on, see GlTraceOp
+    void writeSnapshot() {
+        GlTraceWriter writer(capture.trace);
+        for (GLuint buffer : capture.buffers) { snapshotBuffer(writer, buffer); }
+        real::BindBuffer(GL_COPY_READ_BUFFER, capture.bufferBindings[GL_COPY_READ_BUFFER]);
+
+        for (auto &texture : capture.textures) {
+            if (texture.second) { snapshotTexture(writer, texture.first, texture.second); }
+        }
+
+        for (auto &program : capture.programs) {
+            writer.Begin(GlTraceOp::SnapshotProgram);
+            writer.Put(program.first);
+            writer.Put((uint32_t)program.second.shaders.size());
+            for (auto &shader : program.second.shaders) {
+                writer.Put((uint32_t)shader.first);
+                writer.PutString(shader.second);
+            }
+            writer.End();
+        }
+
+        for (auto &vertexArray : capture.vertexArrays) {
+            encode(capture.trace, GlTraceOp::SnapshotVertexArray, vertexArray.first);
+            capture.trace.insert(capture.trace.end(), vertexArray.second.begin(), vertexArray.second.end());
+            encode(capture.trace, GlTraceOp::BindVertexArray, (GLuint)0);
+        }
+
+        // Then the bindings and state, as they are now
+        for (auto &binding : capture.bufferBindings) { encode(capture.trace, GlTraceOp::BindBuffer, binding.first, binding.second); }
+        for (auto &binding : capture.textureBindings) {
+            encode(capture.trace, GlTraceOp::ActiveTexture, binding.first.first);
+            encode(capture.trace, GlTraceOp::BindTexture, binding.first.second, binding.second);
+        }
+        encode(capture.trace, GlTraceOp::ActiveTexture, capture.activeTexture);
+        for (auto &call : capture.state) { capture.trace.insert(capture.trace.end(), call.second.begin(), call.second.end()); }
+        encode(capture.trace, GlTraceOp::BindVertexArray, capture.vertexArray);
+    }
+
+    void writeTrace() {
+        std::ofstream out(capture.file, std::ios::binary);
+        out.write((const char*)&capture.header, sizeof(capture.header));
+        out.write((const char*)capture.trace.data(), (std::streamsize)capture.trace.size());
+        if (!out) {
+            Log::Message(LogSeverity::High, "GL capture: can not write ", capture.file.string().c_str());
+            return;
+        }
+        std::string detail = std::to_string(capture.header.frameCount) + " frames, " + std::to_string(capture.trace.size() >> 10) + " KB to " + capture.file.string();
+        Log::Message(LogSeverity::Low, "GL capture: wrote ", detail.c_str());
+    }
+}
+
+void GlCapture::Install(std::filesystem::path file, unsigned int firstFrame, unsigned int frameCount) {
+    if (capture.installed || frameCount == 0) { return; }
+    capture.file = file;
+    capture.firstFrame = firstFrame;
+    capture.frameCount = frameCount;
+    capture.installed = true;
+
+#define GL_CAPTURE_HOOK_CORE(name) real::name = glCapture##name; glCapture##name = hook##name;
+#define GL_CAPTURE_HOOK_GLEW(name) real::name = __glew##name; if (__glew##name) { __glew##name = hook##name; }
+    GL_CAPTURE_CORE_FUNCTIONS(GL_CAPTURE_HOOK_CORE)
+    GL_CAPTURE_GLEW_FUNCTIONS(GL_CAPTURE_HOOK_GLEW)
+#undef GL_CAPTURE_HOOK_CORE
+#undef GL_CAPTURE_HOOK_GLEW
+
+    std::cout << "GL capture: recording frames " << firstFrame << " to " << firstFrame + frameCount - 1
+              << " into " << file.string() << std::endl;
+}
+
+bool GlCapture::Installed() { return capture.installed; }
+
+void GlCapture::BeginFrame(int framebufferWidth, int framebufferHeight) {
+    if (!capture.installed || capture.frame != capture.firstFrame) {
+        if (capture.recording) { record(GlTraceOp::FrameBegin, capture.frame); }
+        return;
+    }
+    capture.header = { GL_TRACE_MAGIC, GL_TRACE_VERSION, (uint32_t)framebufferWidth, (uint32_t)framebufferHeight, 0 };
+    writeSnapshot();
+    capture.recording = true;
+    record(GlTraceOp::FrameBegin, capture.frame);
+}
+
+void GlCapture::EndFrame() {
+    if (!capture.installed) { return; }
+    if (capture.recording) {
+        record(GlTraceOp::FrameEnd, capture.frame);
+        capture.header.frameCount++;
+        if (capture.header.frameCount == capture.frameCount) {
+            capture.recording = false;
+            writeTrace();
+            std::vector<unsigned char>().swap(capture.trace);
+        }
+    }
+    capture.frame++;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <filesystem>
+
+// OpenGL 1.1 functions are linked from opengl32 directly, not through GLEW's function pointers.
+// The ones the app calls go through the pointers below instead, so GlCapture can hook them too.
+// Files calling them have to include this header, or their calls are missing from traces.
+#define GL_CAPTURE_CORE_FUNCTIONS(X) \
+    X(Clear) X(ClearColor) X(Enable) X(Disable) X(DepthFunc) X(DepthMask) X(ColorMask) X(PolygonMode) \
+    X(PointSize) X(Viewport) X(DrawArrays) X(DrawElements) X(GenTextures) X(DeleteTextures) X(BindTexture) X(TexParameteri) \
+    X(TexSubImage2D) X(CopyTexSubImage2D) X(GetTexImage) X(BlendFunc)
+
+#define GL_CAPTURE_DECLARE(name) extern decltype(&::gl##name) glCapture##name;
+GL_CAPTURE_CORE_FUNCTIONS(GL_CAPTURE_DECLARE)
+#undef GL_CAPTURE_DECLARE
+
+// GlCapture.cpp keeps the real names to reach opengl32
+#ifndef GL_CAPTURE_KEEP_NAMES
+#define glClear glCaptureClear
+#define glClearColor glCaptureClearColor
+#define glEnable glCaptureEnable
+#define glDisable glCaptureDisable
+#define glDepthFunc glCaptureDepthFunc
+#define glDepthMask glCaptureDepthMask
+#define glColorMask glCaptureColorMask
+#define glPolygonMode glCapturePolygonMode
+#define glPointSize glCapturePointSize
+#define glViewport glCaptureViewport
+#define glDrawArrays glCaptureDrawArrays
+#define glDrawElements glCaptureDrawElements
+#define glGenTextures glCaptureGenTextures
+#define glDeleteTextures glCaptureDeleteTextures
+#define glBindTexture glCaptureBindTexture
+#define glTexParameteri glCaptureTexParameteri
+#define glTexSubImage2D glCaptureTexSubImage2D
+#define glCopyTexSubImage2D glCaptureCopyTexSubImage2D
+#define glGetTexImage glCaptureGetTexImage
+#define glBlendFunc glCaptureBlendFunc
+#endif
+
+// Records the GL calls of a range of frames into a trace (see GlTrace.hpp) that GlReplay plays back.
+// Installing hooks every GL function the app calls, from then on the capture follows which objects
+// exist and how the vertex arrays are set up. The first captured frame starts with a snapshot of
+// them: buffer and texture contents are read back, programs are rebuilt from the sources they were
+// linked from.
+// Bindless texture handles and writes to mapped buffers never go through a GL call the trace could
+// record, so the app has to do without them while it captures. Uniforms are not read back for the
+// snapshot either, programs get theirs set every time they are used.
+namespace GlCapture {
+    // Hooks GL, right after glewInit and before anything else is created.
+    // Frames firstFrame to firstFrame + frameCount - 1 are written to file.
+    void Install(std::filesystem::path file, unsigned int firstFrame, unsigned int frameCount);
+    bool Installed();
+    // Around everything a frame draws, before swapping buffers. The framebuffer size goes into the trace.
+    void BeginFrame(int framebufferWidth, int framebufferHeight);
+    void EndFrame();
+}
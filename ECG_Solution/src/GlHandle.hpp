@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GL\glew.h>
+#include "GlCapture.hpp"
+
+// Owns one GL object and deletes it when it goes out of scope. Moving hands the object on.
+// Handles have to go before the context does, see main.
+template <typename Traits>
+class GlHandle {
+private:
+    GLuint id;
+
+public:
+    GlHandle() : id(0) { }
+    GlHandle(const GlHandle &) = delete;
+    GlHandle &operator=(const GlHandle &) = delete;
+    GlHandle(GlHandle &&other) noexcept : id(other.id) { other.id = 0; }
+    GlHandle &operator=(GlHandle &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+    ~GlHandle() { Reset(); }
+
+    // A new object of the kind
+    static GlHandle Create() {
+        GlHandle handle;
+        handle.id = Traits::Create();
+        return handle;
+    }
+    // Deletes the object, if there is one
+    void Reset() {
+        if (id) { Traits::Delete(id); }
+        id = 0;
+    }
+    GLuint ID() const { return id; }
+};
+
+struct GlBufferTraits {
+    static GLuint Create() { GLuint id; glGenBuffers(1, &id); return id; }
+    static void Delete(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+struct GlVertexArrayTraits {
+    static GLuint Create() { GLuint id; glGenVertexArrays(1, &id); return id; }
+    static void Delete(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct GlTextureTraits {
+    static GLuint Create() { GLuint id; glGenTextures(1, &id); return id; }
+    static void Delete(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+struct GlProgramTraits {
+    static GLuint Create() { return glCreateProgram(); }
+    static void Delete(GLuint id) { glDeleteProgram(id); }
+};
+
+typedef GlHandle<GlBufferTraits> GlBuffer;
+typedef GlHandle<GlVertexArrayTraits> GlVertexArray;
+typedef GlHandle<GlTextureTraits> GlTexture;
+typedef GlHandle<GlProgramTraits> GlProgram;
@@ -0,0 +1,92 @@
+#include "GlTrace.hpp"
+
+namespace {
+    const char *opNames[] = {
+        "FrameBegin", "FrameEnd",
+        "SnapshotBuffer", "SnapshotTexture", "SnapshotProgram", "SnapshotVertexArray",
+        "GenBuffers", "DeleteBuffers", "BindBuffer", "BufferData", "BufferSubData", "BufferStorage", "BindBufferBase", "BindBufferRange",
+        "GenVertexArrays", "DeleteVertexArrays", "BindVertexArray", "VertexAttribPointer", "EnableVertexAttribArray",
+        "CreateShader", "ShaderSource", "CompileShader", "DeleteShader",
+        "CreateProgram", "AttachShader", "DetachShader", "LinkProgram", "DeleteProgram", "UseProgram",
+        "ActiveTexture", "GenTextures", "DeleteTextures", "BindTexture", "TexParameteri", "TexStorage3D", "CompressedTexSubImage3D", "GenerateMipmap",
+        "GenQueries", "QueryCounter",
+        "FenceSync", "ClientWaitSync", "DeleteSync",
+        "Clear", "ClearColor", "Enable", "Disable", "DepthFunc", "DepthMask", "ColorMask", "PolygonMode", "PointSize", "Viewport",
+        "DrawArrays", "DrawElements",
+        "CopyBufferSubData", "ClearBufferData", "VertexAttribIPointer", "VertexAttribDivisor",
+        "Uniform1i", "Uniform1ui", "Uniform1f", "Uniform2i", "Uniform2f", "Uniform2fv", "Uniform3fv", "UniformMatrix4fv",
+        "DispatchCompute", "MemoryBarrier", "MultiDrawElementsIndirect", "MultiDrawElementsIndirectCountARB",
+        "TexStorage2D", "TexSubImage2D",
+        "CopyTexSubImage2D", "GetTexImage", "BindImageTexture", "MapBufferRange", "UnmapBuffer",
+        "DispatchComputeIndirect", "DrawArraysIndirect", "BlendFunc"
+    };
+    static_assert(sizeof(opNames) / sizeof(opNames[0]) == (size_t)GlTraceOp::Count, "every op needs a name");
+}
+
+const char *glTraceOpName(GlTraceOp op) {
+    return (size_t)op < (size_t)GlTraceOp::Count ? opNames[(size_t)op] : "unknown";
+}
+
+void GlTraceWriter::Begin(GlTraceOp op) {
+    Put((uint16_t)op);
+    sizeAt = out.size();
+    Put((uint32_t)0);
+}
+
+void GlTraceWriter::End() {
+    uint32_t size = (uint32_t)(out.size() - sizeAt - sizeof(uint32_t));
+    std::memcpy(&out[sizeAt], &size, sizeof(size));
+}
+
+void GlTraceWriter::PutBytes(const void *data, size_t size) {
+    if (!data) { size = 0; }
+    Put((uint64_t)size);
+    if (size == 0) { return; }
+    size_t at = out.size();
+    out.resize(at + size);
+    std::memcpy(&out[at], data, size);
+}
+
+void GlTraceWriter::PutString(std::string_view text) { PutBytes(text.data(), text.size()); }
+
+const unsigned char *GlTraceReader::GetBytes(size_t &size) {
+    size = (size_t)Get<uint64_t>();
+    if (size > (size_t)(end - at)) { overrun = true; size = 0; }
+    if (size == 0) { return nullptr; }
+    const unsigned char *data = at;
+    at += size;
+    return data;
+}
+
+std::string GlTraceReader::GetString() {
+    size_t size;
+    const unsigned char *data = GetBytes(size);
+    return data ? std::string((const char*)data, size) : std::string();
+}
+
+bool GlTraceReader::Overrun() { return overrun; }
+
+bool parseGlTrace(const std::vector<unsigned char> &file, GlTraceHeader &header, std::vector<GlTraceRecord> &records, std::string &error) {
+    if (file.size() < sizeof(GlTraceHeader)) { error = "too short for a trace"; return false; }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != GL_TRACE_MAGIC) { error = "not a GL trace"; return false; }
+    if (header.version != GL_TRACE_VERSION) {
+        error = "trace version " + std::to_string(header.version) + ", expected " + std::to_string(GL_TRACE_VERSION);
+        return false;
+    }
+
+    size_t at = sizeof(GlTraceHeader);
+    while (at < file.size()) {
+        uint16_t op;
+        uint32_t size;
+        if (file.size() - at < sizeof(op) + sizeof(size)) { error = "truncated record"; return false; }
+        std::memcpy(&op, &file[at], sizeof(op));
+        std::memcpy(&size, &file[at + sizeof(op)], sizeof(size));
+        at += sizeof(op) + sizeof(size);
+        if (op >= (uint16_t)GlTraceOp::Count) { error = "unknown op " + std::to_string(op); return false; }
+        if (file.size() - at < size) { error = std::string("truncated ") + opNames[op]; return false; }
+        records.push_back({ (GlTraceOp)op, file.data() + at, size });
+        at += size;
+    }
+    return true;
+}
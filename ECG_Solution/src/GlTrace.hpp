@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The binary trace GlCapture writes and GlReplay plays back:
+//   GlTraceHeader
+//   records: uint16 op, uint32 payload size, payload
+// The records before the first FrameBegin recreate the objects and state the frames start from,
+// every frame is FrameBegin ... FrameEnd. Numbers are little endian, as written by x86.
+#define GL_TRACE_MAGIC 0x52544C47 // "GLTR"
+#define GL_TRACE_VERSION 1
+
+struct GlTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;  // of the framebuffer the frames were drawn to
+    uint32_t height;
+    uint32_t frameCount;
+};
+
+// Object names in the payloads are the ones the app got, the replayer maps them to its own.
+// Pointers into buffers are offsets, client memory is inlined as a byte count and the bytes.
+// Ops are appended at the end, so older traces keep their numbers.
+enum class GlTraceOp : uint16_t {
+    FrameBegin,
+    FrameEnd,
+
+    // Snapshot of an object that existed before the first frame
+    SnapshotBuffer,      // name, usage, size, data
+    SnapshotTexture,     // name, target, internal format, levels, width, height, depth, min and mag filter,
+                         // wrap s and t, then for each level and face: compressed, data
+    SnapshotProgram,     // name, shader count, then type and source of each
+    SnapshotVertexArray, // name, followed by the calls that set it up and BindVertexArray(0)
+
+    GenBuffers, DeleteBuffers, BindBuffer, BufferData, BufferSubData, BufferStorage, BindBufferBase, BindBufferRange,
+    GenVertexArrays, DeleteVertexArrays, BindVertexArray, VertexAttribPointer, EnableVertexAttribArray,
+    CreateShader, ShaderSource, CompileShader, DeleteShader,
+    CreateProgram, AttachShader, DetachShader, LinkProgram, DeleteProgram, UseProgram,
+    ActiveTexture, GenTextures, DeleteTextures, BindTexture, TexParameteri, TexStorage3D, CompressedTexSubImage3D, GenerateMipmap,
+    GenQueries, QueryCounter,
+    FenceSync, ClientWaitSync, DeleteSync,
+    Clear, ClearColor, Enable, Disable, DepthFunc, DepthMask, ColorMask, PolygonMode, PointSize, Viewport,
+    DrawArrays, DrawElements,
+    CopyBufferSubData, ClearBufferData, VertexAttribIPointer, VertexAttribDivisor,
+    Uniform1i, Uniform1ui, Uniform1f, Uniform2i, Uniform2f, Uniform2fv, Uniform3fv, UniformMatrix4fv,
+    DispatchCompute, MemoryBarrier, MultiDrawElementsIndirect, MultiDrawElementsIndirectCountARB,
+    TexStorage2D, TexSubImage2D,
+    CopyTexSubImage2D, GetTexImage, BindImageTexture, MapBufferRange, UnmapBuffer,
+    DispatchComputeIndirect, DrawArraysIndirect, BlendFunc,
+
+    Count
+};
+
+const char *glTraceOpName(GlTraceOp op);
+
+// Appends records to a byte buffer
+class GlTraceWriter {
+private:
+    std::vector<unsigned char> &out;
+    size_t sizeAt;
+
+public:
+    GlTraceWriter(std::vector<unsigned char> &out) : out(out), sizeAt(0) { }
+    // Starts a record, the payload follows with Put and PutBytes
+    void Begin(GlTraceOp op);
+    // Fills in the payload size of the record Begin started
+    void End();
+
+    template <typename T>
+    void Put(T value) {
+        size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(&out[at], &value, sizeof(T));
+    }
+    // A byte count and the bytes, no bytes if data is null
+    void PutBytes(const void *data, size_t size);
+    void PutString(std::string_view text);
+};
+
+// One record of a trace
+struct GlTraceRecord {
+    GlTraceOp op;
+    const unsigned char *payload;
+    uint32_t size;
+};
+
+// Reads the payload of a record in the order it was written
+class GlTraceReader {
+private:
+    const unsigned char *at;
+    const unsigned char *end;
+    bool overrun;
+
+public:
+    GlTraceReader(const GlTraceRecord &record) : at(record.payload), end(record.payload + record.size), overrun(false) { }
+
+    template <typename T>
+    T Get() {
+        T value = T();
+        if ((size_t)(end - at) < sizeof(T)) { overrun = true; return value; }
+        std::memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+    // Points into the record, null for no bytes
+    const unsigned char *GetBytes(size_t &size);
+    std::string GetString();
+    // Whether a read went past the end of the record
+    bool Overrun();
+};
+
+// Splits a trace file into its records. Returns false and says why if it is not a valid trace.
+bool parseGlTrace(const std::vector<unsigned char> &file, GlTraceHeader &header, std::vector<GlTraceRecord> &records, std::string &error);
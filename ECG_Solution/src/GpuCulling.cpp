@@ -0,0 +1,280 @@
+#include "GpuCulling.hpp"
+#include "Profiler.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <string>
+
+namespace {
+    // The compute shader's work group size
+    const unsigned int GROUP_SIZE = 64;
+    const size_t VERTEX_STRIDE = GEOMETRY_FLOATS_PER_VERTEX * sizeof(float);
+
+    // As glMultiDrawElementsIndirect reads it
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Makes room for needed bytes, keeping the used ones. Shared buffers only grow while the scene loads.
+    void grow(GlBuffer &buffer, size_t &capacity, size_t used, size_t needed) {
+        if (needed <= capacity) { return; }
+        size_t newCapacity = (std::max)({ needed, capacity * 2, (size_t)1 << 20 });
+        GlBuffer bigger = GlBuffer::Create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bigger.ID());
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, GL_STATIC_DRAW);
+        if (used > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer.ID());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = std::move(bigger);
+        capacity = newCapacity;
+    }
+
+    // A new buffer holding the data, or an empty one
+    GlBuffer makeBuffer(const void *data, size_t bytes) {
+        GlBuffer buffer = GlBuffer::Create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.ID());
+        glBufferData(GL_COPY_WRITE_BUFFER, (std::max)(bytes, (size_t)4), data, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    void clearBuffer(GLuint buffer) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+GpuCuller::GpuCuller(std::string cullSource, ShaderCache &shaderCache, Shader &indirectFallback, unsigned int features,
+                     float gouraud, bool force, float lod, bool frustumCulling)
+    : cullShader(insertAfterVersion(cullSource, "#define MAX_LODS " + std::to_string(GPU_CULL_MAX_LODS) + "\n")),
+      shaders(shaderCache), sceneFeatures(features), gouraudDistance(gouraud), forceGouraud(force), lodDistance(lod),
+      frustum(frustumCulling), countDraws(GLEW_ARB_indirect_parameters != 0),
+      vertexCapacity(0), indexCapacity(0), vertexCount(0), indexCount(0), instanceCapacity(0),
+      commandCount(0), dirty(false), culled(false) {
+    shaders.SetFallback(indirectFallback, SHADER_INDIRECT);
+}
+
+unsigned int GpuCuller::featuresOf(Shape &shape) {
+    return shape.Features() | sceneFeatures | SHADER_INDIRECT | (forceGouraud ? SHADER_GOURAUD : 0);
+}
+
+void GpuCuller::add(Shape &shape) {
+    PROFILE_ZONE("gpu cull add");
+    ShapeBuffers source = shape.Buffers();
+    size_t vertexBytes = (size_t)source.vertexCount * VERTEX_STRIDE;
+    size_t indexBytes = (size_t)source.indexCount * sizeof(unsigned int);
+    grow(vertexBuffer, vertexCapacity, vertexCount * VERTEX_STRIDE, vertexCount * VERTEX_STRIDE + vertexBytes);
+    grow(indexBuffer, indexCapacity, indexCount * sizeof(unsigned int), indexCount * sizeof(unsigned int) + indexBytes);
+    // GPU to GPU, the shape's data is not in system memory any more
+    glBindBuffer(GL_COPY_READ_BUFFER, source.vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer.ID());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, vertexCount * VERTEX_STRIDE, vertexBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, source.indexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer.ID());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, indexCount * sizeof(unsigned int), indexBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    CullData cull = {};
+    cull.boundsMin = glm::vec4(shape.BoundsMin(), 0.0f);
+    cull.boundsMax = glm::vec4(shape.BoundsMax(), 0.0f);
+    const std::vector<MeshLod> &lods = shape.Lods();
+    unsigned int levels = (std::min)((unsigned int)lods.size(), (unsigned int)GPU_CULL_MAX_LODS);
+    for (unsigned int l = 0; l < levels; l++) {
+        cull.lods[l] = glm::uvec4(indexCount + lods[l].firstIndex, lods[l].indexCount, 0, 0);
+    }
+    cull.info = glm::uvec4(vertexCount, levels, 0, 0);
+    cullData.push_back(cull);
+
+    ObjectUniforms uniforms;
+    uniforms.model = shape.ModelMatrix();
+    uniforms.normalMatrix = glm::transpose(glm::inverse(uniforms.model));
+    uniforms.material = glm::uvec4(shape.Material().index, 0, 0, 0);
+    objectData.push_back(uniforms);
+    objects.push_back({ shape.Material(), featuresOf(shape) });
+
+    vertexCount += source.vertexCount;
+    indexCount += source.indexCount;
+}
+
+void GpuCuller::Sync(std::vector<std::unique_ptr<Shape>> &shapes) {
+    for (size_t i = 0; i < objects.size() && i < shapes.size(); i++) {
+        MaterialRef material = shapes[i]->Material();
+        unsigned int features = featuresOf(*shapes[i]);
+        if (material.index != objects[i].material.index || features != objects[i].features) {
+            objects[i] = { material, features };
+            objectData[i].material = glm::uvec4(material.index, 0, 0, 0);
+            dirty = true;
+        }
+    }
+    for (size_t i = objects.size(); i < shapes.size(); i++) {
+        add(*shapes[i]);
+        dirty = true;
+    }
+    if (dirty) { layout(); }
+}
+
+// Every object can end up in its bucket and, when it is lit per vertex far away, in that one,
+// so each bucket gets a slot for every object that could land in it
+void GpuCuller::layout() {
+    buckets.clear();
+    auto bucketOf = [&](unsigned int features) {
+        for (size_t b = 0; b < buckets.size(); b++) {
+            if (buckets[b].features == features) { return (unsigned int)b; }
+        }
+        buckets.push_back({ features, 0, 0 });
+        // Queue the build right away
+        shaders.Get(features);
+        return (unsigned int)buckets.size() - 1;
+    };
+    for (size_t i = 0; i < objects.size(); i++) {
+        unsigned int nearBucket = bucketOf(objects[i].features);
+        unsigned int farBucket = gouraudDistance > 0.0f ? bucketOf(objects[i].features | SHADER_GOURAUD) : nearBucket;
+        cullData[i].info.z = nearBucket;
+        cullData[i].info.w = farBucket;
+        buckets[nearBucket].capacity++;
+        if (farBucket != nearBucket) { buckets[farBucket].capacity++; }
+    }
+    commandCount = 0;
+    for (Bucket &bucket : buckets) {
+        bucket.first = commandCount;
+        commandCount += bucket.capacity;
+    }
+    upload();
+}
+
+void GpuCuller::upload() {
+    objectBuffer = makeBuffer(objectData.data(), objectData.size() * sizeof(ObjectUniforms));
+    cullBuffer = makeBuffer(cullData.data(), cullData.size() * sizeof(CullData));
+    commandBuffer = makeBuffer(nullptr, (size_t)commandCount * sizeof(DrawCommand));
+    clearBuffer(commandBuffer.ID());
+    countBuffer = makeBuffer(nullptr, buckets.size() * sizeof(GLuint));
+    std::vector<glm::uvec2> ranges;
+    for (Bucket &bucket : buckets) { ranges.push_back(glm::uvec2(bucket.first, bucket.capacity)); }
+    bucketBuffer = makeBuffer(ranges.data(), ranges.size() * sizeof(glm::uvec2));
+
+    // Instance i of a draw with base instance b reads entry b of this, which is b
+    if (instanceCapacity < objects.size()) {
+        instanceCapacity = (std::max)(objects.size(), instanceCapacity * 2);
+        std::vector<GLuint> indices(instanceCapacity);
+        for (size_t i = 0; i < indices.size(); i++) { indices[i] = (GLuint)i; }
+        instanceBuffer = makeBuffer(indices.data(), indices.size() * sizeof(GLuint));
+    }
+    bindVertexArray();
+    dirty = false;
+}
+
+// The same attributes as Shape::upload, and the object index per instance
+void GpuCuller::bindVertexArray() {
+    vao = GlVertexArray::Create();
+    glBindVertexArray(vao.ID());
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.ID());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ID());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (GLsizei)VERTEX_STRIDE, (void*)(0 * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, (GLsizei)VERTEX_STRIDE, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, (GLsizei)VERTEX_STRIDE, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.ID());
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool GpuCuller::IsReady() { return cullShader.IsReady(); }
+
+void GpuCuller::Cull(const glm::mat4 &viewProj, glm::vec3 cameraPos, Culler &culler) {
+    culled = false;
+    if (objects.empty() || !cullShader.IsReady()) { return; }
+
+    // The counts always, the commands when every slot is drawn
+    clearBuffer(countBuffer.ID());
+    if (!countDraws) { clearBuffer(commandBuffer.ID()); }
+
+    cullShader.Use();
+    glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(viewProj));
+    glUniform3fv(1, 1, glm::value_ptr(cameraPos));
+    glUniform2f(2, gouraudDistance, lodDistance);
+    glUniform1ui(3, (GLuint)objects.size());
+    glUniform1i(4, frustum ? 1 : 0);
+    Culler::PyramidView pyramid;
+    bool occlusion = culler.Pyramid(pyramid);
+    glUniform1i(5, occlusion ? 1 : 0);
+    if (occlusion) {
+        glUniformMatrix4fv(6, 1, GL_FALSE, glm::value_ptr(pyramid.viewProj));
+        glUniform2fv(7, 1, glm::value_ptr(pyramid.uvScale));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, pyramid.texture);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STORAGE_BINDING, objectBuffer.ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_STORAGE_BINDING, cullBuffer.ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_STORAGE_BINDING, commandBuffer.ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_STORAGE_BINDING, countBuffer.ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BUCKET_STORAGE_BINDING, bucketBuffer.ID());
+    glDispatchCompute(((GLuint)objects.size() + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+    // The draws read the commands and counts written above
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    glUseProgram(0);
+    if (occlusion) { glBindTexture(GL_TEXTURE_2D, 0); }
+    culled = true;
+}
+
+void GpuCuller::drawBucket(const Bucket &bucket, size_t index) {
+    if (bucket.capacity == 0) { return; }
+    const void *commands = (const void*)((size_t)bucket.first * sizeof(DrawCommand));
+    if (countDraws) {
+        glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, commands, (GLintptr)(index * sizeof(GLuint)), (GLsizei)bucket.capacity, 0);
+    }
+    else {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, (GLsizei)bucket.capacity, 0);
+    }
+}
+
+void GpuCuller::DrawDepth(Shader &shader) {
+    if (!culled) { return; }
+    glBindVertexArray(vao.ID());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.ID());
+    if (countDraws) { glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer.ID()); }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STORAGE_BINDING, objectBuffer.ID());
+    shader.Use();
+    for (size_t b = 0; b < buckets.size(); b++) { drawBucket(buckets[b], b); }
+    glUseProgram(0);
+    if (countDraws) { glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0); }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GpuCuller::Draw() {
+    if (!culled) { return; }
+    glBindVertexArray(vao.ID());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.ID());
+    if (countDraws) { glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer.ID()); }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STORAGE_BINDING, objectBuffer.ID());
+    for (size_t b = 0; b < buckets.size(); b++) {
+        shaders.Get(buckets[b].features).Use();
+        drawBucket(buckets[b], b);
+    }
+    glUseProgram(0);
+    if (countDraws) { glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0); }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GpuCuller::ReportMemory(MemoryReport &report) {
+    size_t cpuBytes = objects.capacity() * sizeof(Object) + objectData.capacity() * sizeof(ObjectUniforms)
+                    + cullData.capacity() * sizeof(CullData) + buckets.capacity() * sizeof(Bucket);
+    size_t gpuBytes = vertexCapacity + indexCapacity + instanceCapacity * sizeof(GLuint)
+                    + objectData.size() * sizeof(ObjectUniforms) + cullData.size() * sizeof(CullData)
+                    + commandCount * sizeof(DrawCommand) + buckets.size() * (sizeof(GLuint) + sizeof(glm::uvec2));
+    report.Add("gpu culling", cpuBytes, gpuBytes);
+}
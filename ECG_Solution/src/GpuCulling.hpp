@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <GL\glew.h>
+#include "glm\matrix.hpp"
+#include "GlHandle.hpp"
+#include "Shader.hpp"
+#include "ShaderCache.hpp"
+#include "Culling.hpp"
+#include "MemoryReport.hpp"
+#include "Uniforms.hpp"
+#include "Shapes\Shape.hpp"
+
+// Levels of detail the GPU picks from, a shape's coarser levels are not drawn
+#define GPU_CULL_MAX_LODS 4
+
+// Culls and draws the shapes without touching them on the CPU each frame.
+//
+// Sync copies the geometry of new shapes into one shared vertex and index buffer and their
+// transform, bounds and levels of detail into storage buffers. Each frame a compute shader
+// (assets/shaders/cull.comp) tests every object against the view and the depth pyramid of the
+// Culler, picks its level of detail, and appends a draw command for it to the bucket of its shader
+// variant with an atomic counter. Every bucket is then drawn with one multi-draw: the indirect
+// count draw of GL_ARB_indirect_parameters if the driver has it, otherwise one of a fixed count
+// over all slots of the bucket, where the ones left empty draw nothing.
+// The draws pass the object index as their base instance, the INDIRECT shader variants read
+// the object from the object buffer with it (see lighting.glsl).
+//
+// Shapes are taken as they are when synced. Moving one afterwards does not move it here.
+class GpuCuller {
+private:
+    // std430 layout of one entry of the cull buffer, see cull.comp
+    struct CullData {
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+        glm::uvec4 lods[GPU_CULL_MAX_LODS]; // first index in the shared index buffer, index count
+        glm::uvec4 info;                    // base vertex, level count, bucket, bucket when far away
+    };
+    // Commands of the shader variant are at [first, first + capacity) of the command buffer
+    struct Bucket {
+        unsigned int features;
+        unsigned int first;
+        unsigned int capacity;
+    };
+    // Bookkeeping of an object to notice when its shape changes material
+    struct Object {
+        MaterialRef material;
+        unsigned int features;
+    };
+
+    Shader cullShader;
+    ShaderCache &shaders;
+    unsigned int sceneFeatures;
+    float gouraudDistance;
+    bool forceGouraud;
+    float lodDistance;
+    bool frustum;
+    bool countDraws; // GL_ARB_indirect_parameters is there
+
+    GlBuffer vertexBuffer, indexBuffer;
+    size_t vertexCapacity, indexCapacity;       // in bytes
+    unsigned int vertexCount, indexCount;       // used
+    GlVertexArray vao;
+    GlBuffer instanceBuffer; // the object index of every instance, see lighting.glsl
+    size_t instanceCapacity;
+
+    std::vector<Object> objects;
+    std::vector<ObjectUniforms> objectData;
+    std::vector<CullData> cullData;
+    std::vector<Bucket> buckets;
+    GlBuffer objectBuffer, cullBuffer, commandBuffer, countBuffer, bucketBuffer;
+    unsigned int commandCount;
+    bool dirty;  // the buffers above have to be uploaded again
+    bool culled; // the commands are this frame's
+
+    unsigned int featuresOf(Shape &shape);
+    void add(Shape &shape);
+    void layout();
+    void upload();
+    void bindVertexArray();
+    void drawBucket(const Bucket &bucket, size_t index);
+
+public:
+    // The shaders get INDIRECT variants of the scene features, indirectFallback stands in for them while they build
+    GpuCuller(std::string cullSource, ShaderCache &shaders, Shader &indirectFallback, unsigned int sceneFeatures,
+              float gouraudDistance, bool forceGouraud, float lodDistance, bool frustum);
+    GpuCuller(const GpuCuller &) = delete;
+    GpuCuller &operator=(const GpuCuller &) = delete;
+
+    // Takes in shapes added since the last call and shapes whose material changed.
+    // Walks every shape, so it is only needed while the scene loads.
+    void Sync(std::vector<std::unique_ptr<Shape>> &shapes);
+    // Writes this frame's draw commands, tests against the pyramid of the culler if it has one
+    void Cull(const glm::mat4 &viewProj, glm::vec3 cameraPos, Culler &culler);
+    // Draws the commands with one shader, for the depth pre-pass
+    void DrawDepth(Shader &shader);
+    // Draws the commands with the shader variant of each bucket.
+    // Needs the frame uniforms and the material buffer and textures to be bound, see MaterialTable::Bind.
+    void Draw();
+    // Whether the programs it needs are built, Cull and the draws do nothing until then
+    bool IsReady();
+    // Adds the shared geometry and the object and command buffers as "gpu culling"
+    void ReportMemory(MemoryReport &report);
+};
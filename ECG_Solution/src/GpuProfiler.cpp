@@ -0,0 +1,95 @@
+#include "GpuProfiler.hpp"
+#include <GL\glew.h>
+#include <algorithm>
+#include <iomanip>
+#include <cstring>
+
+GpuProfiler::GpuProfiler() : frame(0), inFrame(false) { }
+
+int GpuProfiler::findOrCreate(const char *name) {
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (passes[i].name == name) { return (int)i; }
+    }
+
+    Pass pass;
+    pass.name = name;
+    glGenQueries(2 * GPU_PROFILER_FRAMES, &pass.queries[0][0]);
+    std::memset(pass.issued, 0, sizeof(pass.issued));
+    std::memset(pass.history, 0, sizeof(pass.history));
+    pass.samples = 0;
+    pass.lastMs = 0.0;
+    passes.push_back(pass);
+    return (int)passes.size() - 1;
+}
+
+// Reads back the queries of a ring slot if the GPU has finished them.
+// Results that are still not available are dropped rather than waited for.
+void GpuProfiler::collect(unsigned int slot) {
+    for (Pass &pass : passes) {
+        if (!pass.issued[slot]) { continue; }
+        pass.issued[slot] = false;
+
+        // The end query is issued last, so if it is available the start query is as well
+        GLint available = 0;
+        glGetQueryObjectiv(pass.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) { continue; }
+
+        GLuint64 start, end;
+        glGetQueryObjectui64v(pass.queries[slot][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(pass.queries[slot][1], GL_QUERY_RESULT, &end);
+        pass.lastMs = (double)(end - start) / 1000000.0;
+        pass.history[pass.samples % GPU_PROFILER_HISTORY] = pass.lastMs;
+        pass.samples++;
+    }
+}
+
+void GpuProfiler::BeginFrame() {
+    collect(frame % GPU_PROFILER_FRAMES);
+    inFrame = true;
+    Begin("frame");
+}
+
+void GpuProfiler::EndFrame() {
+    while (!open.empty()) { End(); }
+    inFrame = false;
+    frame++;
+}
+
+void GpuProfiler::Begin(const char *name) {
+    if (!inFrame) { return; }
+    int index = findOrCreate(name);
+    glQueryCounter(passes[index].queries[frame % GPU_PROFILER_FRAMES][0], GL_TIMESTAMP);
+    open.push_back(index);
+}
+
+void GpuProfiler::End() {
+    if (open.empty()) { return; }
+    Pass &pass = passes[open.back()];
+    open.pop_back();
+    unsigned int slot = frame % GPU_PROFILER_FRAMES;
+    glQueryCounter(pass.queries[slot][1], GL_TIMESTAMP);
+    pass.issued[slot] = true;
+}
+
+// Returns the latest, average and max time of every pass seen so far
+std::vector<GpuPassTiming> GpuProfiler::Timings() {
+    std::vector<GpuPassTiming> timings;
+    for (Pass &pass : passes) {
+        unsigned int count = std::min(pass.samples, (unsigned int)GPU_PROFILER_HISTORY);
+        double sum = 0.0, max = 0.0;
+        for (unsigned int i = 0; i < count; i++) {
+            sum += pass.history[i];
+            max = std::max(max, pass.history[i]);
+        }
+        timings.push_back({ pass.name, pass.lastMs, count ? sum / count : 0.0, max });
+    }
+    return timings;
+}
+
+void GpuProfiler::Print(std::ostream &out) {
+    out << "GPU timings (last / avg / max ms over " << GPU_PROFILER_HISTORY << " frames)" << std::endl;
+    for (GpuPassTiming &t : Timings()) {
+        out << "  " << std::left << std::setw(16) << t.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(9) << t.lastMs << std::setw(9) << t.avgMs << std::setw(9) << t.maxMs << std::endl;
+    }
+}
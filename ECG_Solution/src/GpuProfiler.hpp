@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <GL\glew.h>
+
+// Number of frames in flight in the query ring. Results are read back this many
+// frames after they were issued, by which time the GPU is long done with them.
+#define GPU_PROFILER_FRAMES 4
+// Number of samples the rolling average and max are taken over
+#define GPU_PROFILER_HISTORY 120
+
+// Timing of a single pass, in milliseconds
+struct GpuPassTiming {
+    std::string name;
+    double lastMs;
+    double avgMs;
+    double maxMs;
+};
+
+// Measures GPU time per render pass with GL_TIMESTAMP queries.
+// Every pass gets a pair of timestamp queries per frame in the ring, so passes may be nested.
+// A pass name should only be begun once per frame.
+class GpuProfiler {
+private:
+    struct Pass {
+        std::string name;
+        GLuint queries[GPU_PROFILER_FRAMES][2];
+        bool issued[GPU_PROFILER_FRAMES];
+        double history[GPU_PROFILER_HISTORY];
+        unsigned int samples;
+        double lastMs;
+    };
+
+    std::vector<Pass> passes;
+    std::vector<int> open; // indices of passes begun but not yet ended
+    unsigned int frame;
+    bool inFrame;
+    int findOrCreate(const char *name);
+    void collect(unsigned int slot);
+
+public:
+    // The query objects are owned by the context and go away with it
+    GpuProfiler();
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    // Starts a new frame. Collects the results of the frame that last used this ring slot.
+    void BeginFrame();
+    void EndFrame();
+    void Begin(const char *name);
+    void End();
+    std::vector<GpuPassTiming> Timings();
+    void Print(std::ostream &out);
+};
+
+// Times everything issued while it is in scope as one pass
+struct GpuZone {
+private:
+    GpuProfiler &profiler;
+
+public:
+    GpuZone(GpuProfiler &prof, const char *name) : profiler(prof) { profiler.Begin(name); }
+    ~GpuZone() { profiler.End(); }
+};
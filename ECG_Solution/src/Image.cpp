@@ -0,0 +1,295 @@
+#include "Image.hpp"
+#include "Inflate.hpp"
+#include "Profiler.hpp"
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+
+namespace {
+    // Images bigger than this are rejected before anything is allocated for them
+    const uint64_t MAX_PIXELS = 1ull << 28;
+
+    uint32_t readBig32(const unsigned char *p) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    uint16_t readLittle16(const unsigned char *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+    unsigned char paeth(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) { return (unsigned char)a; }
+        return (unsigned char)(pb <= pc ? b : c);
+    }
+
+    // Undoes the per row filters in place. Each row starts with its filter type.
+    bool unfilter(unsigned char *data, size_t rowSize, unsigned int height, size_t bytesPerPixel) {
+        const unsigned char *previous = nullptr;
+        for (unsigned int y = 0; y < height; y++) {
+            unsigned char filter = data[0];
+            unsigned char *row = data + 1;
+            for (size_t x = 0; x < rowSize; x++) {
+                int left = x >= bytesPerPixel ? row[x - bytesPerPixel] : 0;
+                int up = previous ? previous[x] : 0;
+                int upLeft = previous && x >= bytesPerPixel ? previous[x - bytesPerPixel] : 0;
+                switch (filter) {
+                    case 0: break;
+                    case 1: row[x] = (unsigned char)(row[x] + left); break;
+                    case 2: row[x] = (unsigned char)(row[x] + up); break;
+                    case 3: row[x] = (unsigned char)(row[x] + ((left + up) >> 1)); break;
+                    case 4: row[x] = (unsigned char)(row[x] + paeth(left, up, upLeft)); break;
+                    default: return false;
+                }
+            }
+            previous = row;
+            data += rowSize + 1;
+        }
+        return true;
+    }
+
+    // Sample x of a row, scaled to 8 bits
+    unsigned int sample(const unsigned char *row, size_t index, int bitDepth, bool scale) {
+        switch (bitDepth) {
+            case 16: return row[index * 2];
+            case 8: return row[index];
+            default: {
+                unsigned int bitOffset = (unsigned int)(index * bitDepth);
+                unsigned int value = (row[bitOffset / 8] >> (8 - bitDepth - bitOffset % 8)) & ((1u << bitDepth) - 1);
+                // Palette indices stay as they are, grey levels are stretched to 0..255
+                return scale ? value * 255 / ((1u << bitDepth) - 1) : value;
+            }
+        }
+    }
+}
+
+bool decodePng(const unsigned char *data, size_t size, Image &image, std::string &error) {
+    PROFILE_ZONE("decode png");
+    static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (size < 8 || std::memcmp(data, SIGNATURE, 8) != 0) { error = "not a PNG file"; return false; }
+
+    unsigned int width = 0, height = 0;
+    int bitDepth = 0, colorType = -1;
+    unsigned char palette[256][4];
+    unsigned int paletteSize = 0;
+    int transparentGrey = -1;
+    int transparentColor[3] = { -1, -1, -1 };
+    std::vector<unsigned char> compressed;
+
+    // Walk the chunks, gathering the image data
+    size_t offset = 8;
+    bool ended = false;
+    while (!ended && offset + 12 <= size) {
+        uint32_t length = readBig32(data + offset);
+        const unsigned char *type = data + offset + 4;
+        const unsigned char *chunk = data + offset + 8;
+        if (length > size - offset - 12) { error = "truncated chunk"; return false; }
+        offset += 12 + (size_t)length;
+
+        if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            width = readBig32(chunk);
+            height = readBig32(chunk + 4);
+            bitDepth = chunk[8];
+            colorType = chunk[9];
+            if (chunk[12] != 0) { error = "interlaced PNG files are not supported"; return false; }
+        }
+        else if (std::memcmp(type, "PLTE", 4) == 0) {
+            paletteSize = (std::min)(length / 3, 256u);
+            for (unsigned int i = 0; i < paletteSize; i++) {
+                palette[i][0] = chunk[i * 3];
+                palette[i][1] = chunk[i * 3 + 1];
+                palette[i][2] = chunk[i * 3 + 2];
+                palette[i][3] = 255;
+            }
+        }
+        else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (colorType == 3) {
+                for (unsigned int i = 0; i < length && i < paletteSize; i++) { palette[i][3] = chunk[i]; }
+            }
+            else if (colorType == 0 && length >= 2) {
+                transparentGrey = (chunk[0] << 8) | chunk[1];
+            }
+            else if (colorType == 2 && length >= 6) {
+                for (int c = 0; c < 3; c++) { transparentColor[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1]; }
+            }
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+    }
+
+    int channels;
+    switch (colorType) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: error = "missing or unknown image header"; return false;
+    }
+    bool validDepth = bitDepth == 8 || bitDepth == 16 || ((colorType == 0 || colorType == 3) && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4));
+    if (!validDepth || (colorType == 3 && bitDepth == 16)) { error = "unsupported bit depth"; return false; }
+    if (width == 0 || height == 0 || (uint64_t)width * height > MAX_PIXELS) { error = "unsupported image size"; return false; }
+    if (colorType == 3 && paletteSize == 0) { error = "missing palette"; return false; }
+
+    size_t rowSize = ((size_t)width * channels * bitDepth + 7) / 8;
+    size_t bytesPerPixel = (std::max)((size_t)1, (size_t)channels * bitDepth / 8);
+    std::vector<unsigned char> filtered;
+    size_t filteredSize = (rowSize + 1) * height;
+    filtered.reserve(filteredSize);
+    if (!zlibDecompress(compressed.data(), compressed.size(), filtered, filteredSize) || filtered.size() != filteredSize) {
+        error = "corrupt image data";
+        return false;
+    }
+    if (!unfilter(filtered.data(), rowSize, height, bytesPerPixel)) { error = "unknown row filter"; return false; }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    for (unsigned int y = 0; y < height; y++) {
+        const unsigned char *row = filtered.data() + y * (rowSize + 1) + 1;
+        unsigned char *out = image.pixels.data() + (size_t)y * width * 4;
+        for (unsigned int x = 0; x < width; x++, out += 4) {
+            switch (colorType) {
+                case 0: {
+                    unsigned int grey = sample(row, x, bitDepth, true);
+                    unsigned int raw = bitDepth == 16 ? (row[x * 2] << 8 | row[x * 2 + 1]) : sample(row, x, bitDepth, false);
+                    out[0] = out[1] = out[2] = (unsigned char)grey;
+                    out[3] = (int)raw == transparentGrey ? 0 : 255;
+                    break;
+                }
+                case 2: {
+                    bool transparent = true;
+                    for (int c = 0; c < 3; c++) {
+                        out[c] = (unsigned char)sample(row, x * 3 + c, bitDepth, true);
+                        int raw = bitDepth == 16 ? (row[(x * 3 + c) * 2] << 8 | row[(x * 3 + c) * 2 + 1]) : out[c];
+                        transparent = transparent && raw == transparentColor[c];
+                    }
+                    out[3] = transparent ? 0 : 255;
+                    break;
+                }
+                case 3: {
+                    unsigned int index = sample(row, x, bitDepth, false);
+                    if (index >= paletteSize) { index = 0; }
+                    std::memcpy(out, palette[index], 4);
+                    break;
+                }
+                case 4:
+                    out[0] = out[1] = out[2] = (unsigned char)sample(row, x * 2, bitDepth, true);
+                    out[3] = (unsigned char)sample(row, x * 2 + 1, bitDepth, true);
+                    break;
+                case 6:
+                    for (int c = 0; c < 4; c++) { out[c] = (unsigned char)sample(row, x * 4 + c, bitDepth, true); }
+                    break;
+            }
+        }
+    }
+    return true;
+}
+
+bool decodeTga(const unsigned char *data, size_t size, Image &image, std::string &error) {
+    PROFILE_ZONE("decode tga");
+    if (size < 18) { error = "not a TGA file"; return false; }
+    unsigned int idLength = data[0];
+    unsigned int colorMapType = data[1];
+    unsigned int imageType = data[2];
+    unsigned int colorMapLength = readLittle16(data + 5);
+    unsigned int colorMapDepth = data[7];
+    unsigned int width = readLittle16(data + 12);
+    unsigned int height = readLittle16(data + 14);
+    unsigned int depth = data[16];
+    unsigned int descriptor = data[17];
+
+    bool rle = imageType == 10 || imageType == 11;
+    bool grey = imageType == 3 || imageType == 11;
+    if (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11) { error = "only true color and greyscale TGA files are supported"; return false; }
+    if (grey ? depth != 8 : (depth != 24 && depth != 32)) { error = "unsupported pixel depth"; return false; }
+    if (width == 0 || height == 0) { error = "empty image"; return false; }
+
+    size_t offset = 18 + idLength + (colorMapType == 1 ? colorMapLength * ((colorMapDepth + 7) / 8) : 0);
+    unsigned int bytesPerPixel = depth / 8;
+    size_t pixelCount = (size_t)width * height;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(pixelCount * 4);
+
+    // Decode in file order, then put the rows and columns where they belong
+    bool bottomUp = (descriptor & 0x20) == 0;
+    bool rightToLeft = (descriptor & 0x10) != 0;
+    auto store = [&](size_t index, const unsigned char *pixel) {
+        size_t x = index % width, y = index / width;
+        if (bottomUp) { y = height - 1 - y; }
+        if (rightToLeft) { x = width - 1 - x; }
+        unsigned char *out = image.pixels.data() + (y * width + x) * 4;
+        if (grey) {
+            out[0] = out[1] = out[2] = pixel[0];
+            out[3] = 255;
+        }
+        else {
+            out[0] = pixel[2];
+            out[1] = pixel[1];
+            out[2] = pixel[0];
+            out[3] = bytesPerPixel == 4 ? pixel[3] : 255;
+        }
+    };
+
+    size_t index = 0;
+    while (index < pixelCount) {
+        if (!rle) {
+            if (offset + bytesPerPixel > size) { break; }
+            store(index++, data + offset);
+            offset += bytesPerPixel;
+            continue;
+        }
+        if (offset >= size) { break; }
+        unsigned char header = data[offset++];
+        size_t count = (size_t)(header & 0x7F) + 1;
+        if (index + count > pixelCount) { error = "corrupt run length encoding"; return false; }
+        if (header & 0x80) {
+            // A run of one pixel
+            if (offset + bytesPerPixel > size) { break; }
+            for (size_t i = 0; i < count; i++) { store(index++, data + offset); }
+            offset += bytesPerPixel;
+        }
+        else {
+            if (offset + count * bytesPerPixel > size) { break; }
+            for (size_t i = 0; i < count; i++, offset += bytesPerPixel) { store(index++, data + offset); }
+        }
+    }
+    if (index < pixelCount) { error = "truncated image data"; return false; }
+    return true;
+}
+
+bool decodeImage(std::string_view extension, const unsigned char *data, size_t size, Image &image, std::string &error) {
+    if (extension == ".png") { return decodePng(data, size, image, error); }
+    if (extension == ".tga") { return decodeTga(data, size, image, error); }
+    error = "unknown image format " + std::string(extension);
+    return false;
+}
+
+bool writeTga(std::filesystem::path path, const Image &image) {
+    unsigned char header[18] = {};
+    header[2] = 2; // uncompressed true color
+    header[12] = (unsigned char)(image.width & 0xFF);
+    header[13] = (unsigned char)(image.width >> 8);
+    header[14] = (unsigned char)(image.height & 0xFF);
+    header[15] = (unsigned char)(image.height >> 8);
+    header[16] = 32;
+    header[17] = 0x20 | 8; // top left origin, 8 alpha bits
+
+    std::vector<unsigned char> bgra(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        bgra[i] = image.pixels[i + 2];
+        bgra[i + 1] = image.pixels[i + 1];
+        bgra[i + 2] = image.pixels[i];
+        bgra[i + 3] = image.pixels[i + 3];
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)header, sizeof(header));
+    file.write((const char*)bgra.data(), (std::streamsize)bgra.size());
+    return (bool)file;
+}
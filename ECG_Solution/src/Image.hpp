@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+// An uncompressed image with 8 bit RGBA pixels, first row first like the rows of a DDS file
+struct Image {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// PNG of any color type, with 1 to 16 bits per channel. Interlaced files are not supported.
+bool decodePng(const unsigned char *data, size_t size, Image &image, std::string &error);
+
+// Uncompressed or run length encoded true color (24/32 bit) and greyscale (8 bit) TGA
+bool decodeTga(const unsigned char *data, size_t size, Image &image, std::string &error);
+
+// Picks the decoder by extension (".png" or ".tga")
+bool decodeImage(std::string_view extension, const unsigned char *data, size_t size, Image &image, std::string &error);
+
+// Writes an uncompressed 32 bit TGA, first row at the top
+bool writeTga(std::filesystem::path path, const Image &image);
@@ -0,0 +1,225 @@
+#include "Inflate.hpp"
+#include <cstdint>
+#include <cstring>
+
+#define INFLATE_FAST_BITS 10
+
+namespace {
+    const unsigned short LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const unsigned char LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const unsigned short DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const unsigned char DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    // The order in which the code length code lengths are stored
+    const unsigned char CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // Reads bits from least to most significant, as deflate stores them
+    class BitReader {
+    private:
+        const unsigned char *p;
+        const unsigned char *end;
+        uint64_t buffer = 0;
+        int count = 0;
+
+    public:
+        bool overrun = false;
+
+        BitReader(const unsigned char *data, size_t size) : p(data), end(data + size) { }
+
+        void Refill() {
+            while (count <= 56 && p < end) {
+                buffer |= (uint64_t)*p++ << count;
+                count += 8;
+            }
+        }
+
+        // Past the end there are zeros, and overrun is set once they are consumed
+        uint32_t Peek(int bits) {
+            if (count < bits) { Refill(); }
+            return (uint32_t)(buffer & ((1ull << bits) - 1));
+        }
+
+        void Consume(int bits) {
+            if (count < bits) { overrun = true; count = bits; }
+            buffer >>= bits;
+            count -= bits;
+        }
+
+        uint32_t Bits(int bits) {
+            if (bits == 0) { return 0; }
+            uint32_t value = Peek(bits);
+            Consume(bits);
+            return value;
+        }
+
+        // Stored blocks start at the next byte
+        void AlignToByte() { Consume(count % 8); }
+    };
+
+    class Huffman {
+    private:
+        uint16_t counts[16];       // number of codes of each length
+        uint16_t symbols[288];     // sorted by code
+        uint16_t fast[1 << INFLATE_FAST_BITS]; // symbol << 4 | length, 0 if the code is longer
+
+    public:
+        bool Build(const unsigned char *lengths, int symbolCount) {
+            std::memset(counts, 0, sizeof(counts));
+            std::memset(fast, 0, sizeof(fast));
+            for (int s = 0; s < symbolCount; s++) { counts[lengths[s]]++; }
+            counts[0] = 0;
+
+            // Reject oversubscribed codes, incomplete ones are allowed
+            int left = 1;
+            for (int length = 1; length < 16; length++) {
+                left = (left << 1) - counts[length];
+                if (left < 0) { return false; }
+            }
+
+            uint16_t offsets[16];
+            uint32_t nextCode[16];
+            offsets[1] = 0;
+            nextCode[1] = 0;
+            for (int length = 1; length < 15; length++) {
+                offsets[length + 1] = offsets[length] + counts[length];
+                nextCode[length + 1] = (nextCode[length] + counts[length]) << 1;
+            }
+            for (int s = 0; s < symbolCount; s++) {
+                int length = lengths[s];
+                if (length == 0) { continue; }
+                symbols[offsets[length]++] = (uint16_t)s;
+
+                uint32_t code = nextCode[length]++;
+                if (length > INFLATE_FAST_BITS) { continue; }
+                // The table is indexed with the bits in stream order, so the code is reversed
+                uint32_t reversed = 0;
+                for (int i = 0; i < length; i++) { reversed |= ((code >> i) & 1) << (length - 1 - i); }
+                for (uint32_t i = reversed; i < (1u << INFLATE_FAST_BITS); i += 1u << length) {
+                    fast[i] = (uint16_t)(s << 4 | length);
+                }
+            }
+            return true;
+        }
+
+        // Returns -1 for codes that do not exist
+        int Decode(BitReader &bits) {
+            uint16_t entry = fast[bits.Peek(INFLATE_FAST_BITS)];
+            if (entry) {
+                bits.Consume(entry & 15);
+                return entry >> 4;
+            }
+            // Longer codes are walked bit by bit
+            int code = 0, first = 0, index = 0;
+            for (int length = 1; length < 16; length++) {
+                code |= (int)bits.Bits(1);
+                int count = counts[length];
+                if (code - first < count) { return symbols[index + code - first]; }
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+    };
+
+    bool inflateBlock(BitReader &bits, Huffman &lengths, Huffman &distances, std::vector<unsigned char> &out, size_t start, size_t maxSize) {
+        while (true) {
+            int symbol = lengths.Decode(bits);
+            if (symbol < 0 || bits.overrun) { return false; }
+            if (symbol < 256) {
+                if (out.size() - start >= maxSize) { return false; }
+                out.push_back((unsigned char)symbol);
+                continue;
+            }
+            if (symbol == 256) { return true; }
+
+            symbol -= 257;
+            if (symbol >= 29) { return false; }
+            size_t length = LENGTH_BASE[symbol] + bits.Bits(LENGTH_EXTRA[symbol]);
+            int distanceSymbol = distances.Decode(bits);
+            if (distanceSymbol < 0 || distanceSymbol >= 30) { return false; }
+            size_t distance = DISTANCE_BASE[distanceSymbol] + bits.Bits(DISTANCE_EXTRA[distanceSymbol]);
+            if (distance > out.size() - start || out.size() - start + length > maxSize) { return false; }
+
+            // The match may overlap what it writes, so it is copied byte by byte
+            size_t from = out.size() - distance;
+            for (size_t i = 0; i < length; i++) { out.push_back(out[from + i]); }
+        }
+    }
+
+    bool readDynamicCodes(BitReader &bits, Huffman &lengths, Huffman &distances) {
+        int lengthCount = (int)bits.Bits(5) + 257;
+        int distanceCount = (int)bits.Bits(5) + 1;
+        int codeLengthCount = (int)bits.Bits(4) + 4;
+        if (lengthCount > 286 || distanceCount > 30) { return false; }
+
+        unsigned char codeLengths[19] = {};
+        for (int i = 0; i < codeLengthCount; i++) { codeLengths[CODE_LENGTH_ORDER[i]] = (unsigned char)bits.Bits(3); }
+        Huffman codeLengthCode;
+        if (!codeLengthCode.Build(codeLengths, 19)) { return false; }
+
+        unsigned char all[286 + 30] = {};
+        int count = 0;
+        while (count < lengthCount + distanceCount) {
+            int symbol = codeLengthCode.Decode(bits);
+            if (symbol < 0 || bits.overrun) { return false; }
+            if (symbol < 16) {
+                all[count++] = (unsigned char)symbol;
+                continue;
+            }
+            int repeat;
+            unsigned char value = 0;
+            if (symbol == 16) {
+                if (count == 0) { return false; }
+                value = all[count - 1];
+                repeat = 3 + (int)bits.Bits(2);
+            }
+            else if (symbol == 17) { repeat = 3 + (int)bits.Bits(3); }
+            else { repeat = 11 + (int)bits.Bits(7); }
+            if (count + repeat > lengthCount + distanceCount) { return false; }
+            std::memset(all + count, value, repeat);
+            count += repeat;
+        }
+        if (all[256] == 0) { return false; }
+        return lengths.Build(all, lengthCount) && distances.Build(all + lengthCount, distanceCount);
+    }
+}
+
+bool zlibDecompress(const unsigned char *data, size_t size, std::vector<unsigned char> &out, size_t maxSize) {
+    // Deflate without a preset dictionary
+    if (size < 2 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) { return false; }
+
+    BitReader bits(data + 2, size - 2);
+    size_t start = out.size();
+    Huffman lengths, distances;
+    bool last = false;
+    while (!last) {
+        last = bits.Bits(1) != 0;
+        uint32_t type = bits.Bits(2);
+        if (type == 0) {
+            bits.AlignToByte();
+            uint32_t length = bits.Bits(16);
+            uint32_t inverse = bits.Bits(16);
+            if ((length ^ 0xFFFF) != inverse || out.size() - start + length > maxSize) { return false; }
+            for (uint32_t i = 0; i < length; i++) { out.push_back((unsigned char)bits.Bits(8)); }
+        }
+        else if (type == 1) {
+            unsigned char fixed[288 + 30];
+            std::memset(fixed, 8, 144);
+            std::memset(fixed + 144, 9, 112);
+            std::memset(fixed + 256, 7, 24);
+            std::memset(fixed + 280, 8, 8);
+            std::memset(fixed + 288, 5, 30);
+            lengths.Build(fixed, 288);
+            distances.Build(fixed + 288, 30);
+            if (!inflateBlock(bits, lengths, distances, out, start, maxSize)) { return false; }
+        }
+        else if (type == 2) {
+            if (!readDynamicCodes(bits, lengths, distances) || !inflateBlock(bits, lengths, distances, out, start, maxSize)) { return false; }
+        }
+        else {
+            return false;
+        }
+        if (bits.overrun) { return false; }
+    }
+    return true;
+}
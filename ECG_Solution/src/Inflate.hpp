@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Decompression of zlib streams (RFC 1950 around RFC 1951 deflate), as found in PNG files.
+// Codes of up to INFLATE_FAST_BITS bits are decoded with a single table lookup.
+
+// Appends the decompressed data to out. Stops with false if the data is corrupt or would
+// decompress to more than maxSize bytes. The checksum is not verified.
+bool zlibDecompress(const unsigned char *data, size_t size, std::vector<unsigned char> &out, size_t maxSize);
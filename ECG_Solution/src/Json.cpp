@@ -0,0 +1,189 @@
+#include "Json.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const JsonValue NULL_VALUE;
+
+    class Parser {
+    public:
+        const char *begin;
+        const char *p;
+        const char *end;
+        int depth = 0;
+
+        void skipSpace() {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) { p++; }
+        }
+
+        bool literal(const char *word) {
+            size_t length = std::strlen(word);
+            if ((size_t)(end - p) < length || std::memcmp(p, word, length) != 0) { return false; }
+            p += length;
+            return true;
+        }
+
+        void appendUtf8(std::string &out, unsigned int code) {
+            if (code < 0x80) { out += (char)code; }
+            else if (code < 0x800) { out += (char)(0xC0 | (code >> 6)); out += (char)(0x80 | (code & 0x3F)); }
+            else if (code < 0x10000) { out += (char)(0xE0 | (code >> 12)); out += (char)(0x80 | ((code >> 6) & 0x3F)); out += (char)(0x80 | (code & 0x3F)); }
+            else { out += (char)(0xF0 | (code >> 18)); out += (char)(0x80 | ((code >> 12) & 0x3F)); out += (char)(0x80 | ((code >> 6) & 0x3F)); out += (char)(0x80 | (code & 0x3F)); }
+        }
+
+        bool hex4(unsigned int &code) {
+            if (end - p < 4) { return false; }
+            code = 0;
+            for (int i = 0; i < 4; i++) {
+                char c = *p++;
+                code <<= 4;
+                if (c >= '0' && c <= '9') { code |= c - '0'; }
+                else if (c >= 'a' && c <= 'f') { code |= c - 'a' + 10; }
+                else if (c >= 'A' && c <= 'F') { code |= c - 'A' + 10; }
+                else { return false; }
+            }
+            return true;
+        }
+
+        bool parseString(std::string &out) {
+            p++; // opening quote
+            while (p < end && *p != '"') {
+                char c = *p++;
+                if (c != '\\') { out += c; continue; }
+                if (p == end) { return false; }
+                char escape = *p++;
+                switch (escape) {
+                    case '"': case '\\': case '/': out += escape; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        unsigned int code;
+                        if (!hex4(code)) { return false; }
+                        // Surrogate pairs
+                        if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                            p += 2;
+                            unsigned int low;
+                            if (!hex4(low)) { return false; }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(out, code);
+                        break;
+                    }
+                    default: return false;
+                }
+            }
+            if (p == end) { return false; }
+            p++; // closing quote
+            return true;
+        }
+
+        bool parseValue(JsonValue &value) {
+            // Deeply nested documents would overflow the stack
+            if (++depth > 256) { return false; }
+            skipSpace();
+            if (p == end) { return false; }
+            bool ok = true;
+            switch (*p) {
+                case '{': {
+                    value.type = JsonValue::Type::Object;
+                    p++;
+                    skipSpace();
+                    if (p < end && *p == '}') { p++; break; }
+                    while (ok) {
+                        skipSpace();
+                        if (p == end || *p != '"') { ok = false; break; }
+                        value.object.emplace_back();
+                        if (!parseString(value.object.back().first)) { ok = false; break; }
+                        skipSpace();
+                        if (p == end || *p != ':') { ok = false; break; }
+                        p++;
+                        if (!parseValue(value.object.back().second)) { ok = false; break; }
+                        skipSpace();
+                        if (p < end && *p == ',') { p++; continue; }
+                        if (p < end && *p == '}') { p++; break; }
+                        ok = false;
+                    }
+                    break;
+                }
+                case '[': {
+                    value.type = JsonValue::Type::Array;
+                    p++;
+                    skipSpace();
+                    if (p < end && *p == ']') { p++; break; }
+                    while (ok) {
+                        value.array.emplace_back();
+                        if (!parseValue(value.array.back())) { ok = false; break; }
+                        skipSpace();
+                        if (p < end && *p == ',') { p++; continue; }
+                        if (p < end && *p == ']') { p++; break; }
+                        ok = false;
+                    }
+                    break;
+                }
+                case '"':
+                    value.type = JsonValue::Type::String;
+                    ok = parseString(value.string);
+                    break;
+                case 't':
+                    value.type = JsonValue::Type::Bool;
+                    value.boolean = true;
+                    ok = literal("true");
+                    break;
+                case 'f':
+                    value.type = JsonValue::Type::Bool;
+                    ok = literal("false");
+                    break;
+                case 'n':
+                    ok = literal("null");
+                    break;
+                default: {
+                    // strtod needs a terminated string, numbers are short
+                    char buffer[64];
+                    size_t length = 0;
+                    while (p + length < end && length < sizeof(buffer) - 1 && p[length] != '\0' && std::strchr("+-0123456789.eE", p[length])) { length++; }
+                    if (length == 0) { ok = false; break; }
+                    std::memcpy(buffer, p, length);
+                    buffer[length] = '\0';
+                    char *numberEnd;
+                    value.type = JsonValue::Type::Number;
+                    value.number = std::strtod(buffer, &numberEnd);
+                    ok = numberEnd == buffer + length;
+                    p += length;
+                    break;
+                }
+            }
+            depth--;
+            return ok;
+        }
+    };
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const {
+    for (const auto &member : object) {
+        if (member.first == key) { return member.second; }
+    }
+    return NULL_VALUE;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    return index < array.size() ? array[index] : NULL_VALUE;
+}
+
+size_t JsonValue::Size() const { return type == Type::Object ? object.size() : array.size(); }
+bool JsonValue::IsNull() const { return type == Type::Null; }
+double JsonValue::Number(double fallback) const { return type == Type::Number ? number : fallback; }
+int JsonValue::Int(int fallback) const { return type == Type::Number ? (int)number : fallback; }
+
+bool parseJson(std::string_view text, JsonValue &value, size_t &errorOffset) {
+    Parser parser;
+    parser.begin = parser.p = text.data();
+    parser.end = text.data() + text.size();
+    value = JsonValue();
+    bool ok = parser.parseValue(value);
+    parser.skipSpace();
+    if (ok && parser.p != parser.end) { ok = false; }
+    errorOffset = ok ? 0 : (size_t)(parser.p - parser.begin);
+    return ok;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+// A parsed JSON document, as needed for the glTF headers. Not meant for big documents.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    // Member of an object, or a null value if there is none
+    const JsonValue &operator[](std::string_view key) const;
+    // Element of an array, or a null value if there is none
+    const JsonValue &operator[](size_t index) const;
+    size_t Size() const;
+    bool IsNull() const;
+    // The number, or the fallback if this is not a number
+    double Number(double fallback) const;
+    int Int(int fallback) const;
+};
+
+// Returns false and the offset of the error if the text is not valid JSON
+bool parseJson(std::string_view text, JsonValue &value, size_t &errorOffset);
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include "glm\matrix.hpp"
 #include "glm/ext.hpp"
+#include <vector>
 
 struct PointLight {
     glm::vec3 color;
@@ -15,8 +16,8 @@ struct DirectionLight {
     glm::vec3 direction;
 };
 
-// Bundle the two lights twogether for moving them about together easier
+// Bundle the lights together for moving them about together easier
 struct Lights {
-    PointLight pointLight;
+    std::vector<PointLight> pointLights;
     DirectionLight dirLight;
 };
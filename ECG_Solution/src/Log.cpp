@@ -0,0 +1,311 @@
+#include "Log.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+
+namespace {
+    // How long the writer sleeps when the ring is empty
+    const std::chrono::milliseconds WRITER_IDLE(2);
+    const uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+    // A message as it was logged, formatting is left to the writer
+    struct Entry {
+        bool gl;
+        GLenum source;
+        GLenum type;
+        GLuint id;
+        LogSeverity severity;
+        uint64_t time; // steady nanoseconds
+        unsigned int length;
+        unsigned int idLength; // the leading part that makes up an engine message's ID
+        char text[LOG_MESSAGE_SIZE];
+    };
+
+    // The sequence is kept relative to the slot's index, so the zero-initialized ring starts out
+    // with slot i free for position i. A slot at position p is free while sequence + i == p and
+    // holds a message while it is p + 1.
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        Entry entry;
+    };
+
+    // Per ID, the messages printed in the current second and the ones held back
+    struct Seen {
+        uint64_t second;
+        unsigned int count;
+        unsigned int heldBack;
+    };
+
+    Slot slots[LOG_RING_SIZE];
+    std::atomic<uint64_t> enqueuePos(0);
+    uint64_t dequeuePos = 0; // only the consumer touches it
+    std::atomic<int> minimum((int)LogSeverity::Notification);
+    unsigned int perSecond = 0;
+
+    std::thread writer;
+    std::atomic<bool> running(false);
+    std::atomic<uint64_t> printed(0), repeated(0), heldBack(0), dropped(0);
+
+    // The writer's state
+    std::unordered_map<uint64_t, Seen> seenIds;
+    Entry current;
+    Entry last;
+    bool haveLast = false;
+    unsigned int lastRepeats = 0;
+    uint64_t lastPrinted = 0;
+
+    // Stops the writer when the program ends without calling Stop, a running thread would terminate it
+    struct StopAtExit {
+        ~StopAtExit() { Log::Stop(); }
+    } stopAtExit;
+
+    uint64_t now() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    LogSeverity fromGl(GLenum severity) {
+        switch (severity) {
+            case GL_DEBUG_SEVERITY_HIGH: return LogSeverity::High;
+            case GL_DEBUG_SEVERITY_MEDIUM: return LogSeverity::Medium;
+            case GL_DEBUG_SEVERITY_NOTIFICATION: return LogSeverity::Notification;
+            default: return LogSeverity::Low;
+        }
+    }
+
+    bool wanted(LogSeverity severity) {
+        return (int)severity >= minimum.load(std::memory_order_relaxed);
+    }
+
+    // Claims the slot of the next position, null if the ring is full
+    Slot *claim(uint64_t &pos) {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            uint64_t index = pos % LOG_RING_SIZE;
+            Slot &slot = slots[index];
+            int64_t difference = (int64_t)(slot.sequence.load(std::memory_order_acquire) + index - pos);
+            if (difference == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { return &slot; }
+            }
+            else if (difference < 0) { return nullptr; }
+            else { pos = enqueuePos.load(std::memory_order_relaxed); }
+        }
+    }
+
+    void publish(Slot &slot, uint64_t pos) {
+        slot.sequence.store(pos + 1 - pos % LOG_RING_SIZE, std::memory_order_release);
+    }
+
+    // Copies the next message into current, false if there is none
+    bool take() {
+        uint64_t index = dequeuePos % LOG_RING_SIZE;
+        Slot &slot = slots[index];
+        if (slot.sequence.load(std::memory_order_acquire) + index != dequeuePos + 1) { return false; }
+        current = slot.entry;
+        slot.sequence.store(dequeuePos + LOG_RING_SIZE - index, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+    // Copies at most what still fits behind length, always leaving room for the terminator
+    void append(Entry &entry, const char *text, size_t length) {
+        length = (std::min)(length, (size_t)(LOG_MESSAGE_SIZE - 1 - entry.length));
+        std::memcpy(entry.text + entry.length, text, length);
+        entry.length += (unsigned int)length;
+        entry.text[entry.length] = '\0';
+    }
+
+    // GL messages are told apart by source, type and ID, engine messages by their text without the detail (FNV-1a)
+    uint64_t idOf(const Entry &entry) {
+        if (entry.gl) { return ((uint64_t)(entry.source & 0xFFFF) << 48) | ((uint64_t)(entry.type & 0xFFFF) << 32) | entry.id; }
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned int i = 0; i < entry.idLength; i++) { hash = (hash ^ (unsigned char)entry.text[i]) * 1099511628211ull; }
+        return hash;
+    }
+
+    bool sameMessage(const Entry &a, const Entry &b) {
+        return a.gl == b.gl && a.source == b.source && a.type == b.type && a.id == b.id
+            && a.length == b.length && std::memcmp(a.text, b.text, a.length) == 0;
+    }
+
+    const char *sourceName(GLenum source) {
+        switch (source) {
+            case GL_DEBUG_SOURCE_API: return "API";
+            case GL_DEBUG_SOURCE_APPLICATION: return "Application";
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "Window System";
+            case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+            case GL_DEBUG_SOURCE_THIRD_PARTY: return "Third Party";
+            case GL_DEBUG_SOURCE_OTHER: return "Other";
+            default: return "Unknown";
+        }
+    }
+
+    const char *typeName(GLenum type) {
+        switch (type) {
+            case GL_DEBUG_TYPE_ERROR: return "Error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behavior";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "Undefined Behavior";
+            case GL_DEBUG_TYPE_PORTABILITY_ARB: return "Portability";
+            case GL_DEBUG_TYPE_PERFORMANCE: return "Performance";
+            case GL_DEBUG_TYPE_OTHER: return "Other";
+            default: return "Unknown";
+        }
+    }
+
+    const char *severityName(LogSeverity severity) {
+        switch (severity) {
+            case LogSeverity::High: return "High";
+            case LogSeverity::Medium: return "Medium";
+            case LogSeverity::Low: return "Low";
+            default: return "Notification";
+        }
+    }
+
+    void print(const Entry &entry) {
+        if (entry.gl) {
+            std::cout << "OpenGL: " << entry.text << " [Source = " << sourceName(entry.source) << ", Type = " << typeName(entry.type)
+                      << ", Severity = " << severityName(entry.severity) << ", ID = " << entry.id << "]" << std::endl;
+        }
+        else { std::cout << entry.text << std::endl; }
+        printed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void printRepeats() {
+        if (lastRepeats > 0) { std::cout << "  (repeated " << lastRepeats << " times)" << std::endl; }
+        lastRepeats = 0;
+    }
+
+    void printHeldBack(Seen &seen) {
+        if (seen.heldBack > 0) { std::cout << "  (" << seen.heldBack << " more of this ID held back)" << std::endl; }
+        seen.heldBack = 0;
+    }
+
+    void handle(const Entry &entry) {
+        if (!wanted(entry.severity)) { return; }
+
+        // Repeats of the message just printed are folded into a count, said at most once a second
+        if (haveLast && sameMessage(entry, last)) {
+            lastRepeats++;
+            repeated.fetch_add(1, std::memory_order_relaxed);
+            if (entry.time - lastPrinted >= NANOSECONDS_PER_SECOND) {
+                printRepeats();
+                lastPrinted = entry.time;
+            }
+            return;
+        }
+        printRepeats();
+
+        Seen &seen = seenIds.emplace(idOf(entry), Seen{ 0, 0, 0 }).first->second;
+        uint64_t second = entry.time / NANOSECONDS_PER_SECOND;
+        if (seen.second != second) {
+            printHeldBack(seen);
+            seen.second = second;
+            seen.count = 0;
+        }
+        if (perSecond > 0 && ++seen.count > perSecond) {
+            seen.heldBack++;
+            heldBack.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        print(entry);
+        last = entry;
+        haveLast = true;
+        lastPrinted = entry.time;
+    }
+
+    void drain() {
+        while (take()) { handle(current); }
+    }
+
+    void writeLoop() {
+        while (running.load(std::memory_order_acquire)) {
+            if (!take()) {
+                std::this_thread::sleep_for(WRITER_IDLE);
+                continue;
+            }
+            handle(current);
+            drain();
+        }
+        drain();
+        printRepeats();
+        for (auto &seen : seenIds) { printHeldBack(seen.second); }
+    }
+}
+
+LogSeverity parseLogSeverity(std::string name) {
+    if (name == "notification") { return LogSeverity::Notification; }
+    if (name == "medium") { return LogSeverity::Medium; }
+    if (name == "high") { return LogSeverity::High; }
+    return LogSeverity::Low;
+}
+
+namespace Log {
+    void Start(LogSeverity minimumSeverity, unsigned int messagesPerSecond) {
+        if (running.load()) { return; }
+        minimum.store((int)minimumSeverity);
+        perSecond = messagesPerSecond;
+        running.store(true, std::memory_order_release);
+        writer = std::thread(writeLoop);
+    }
+
+    void Stop() {
+        if (!running.exchange(false)) { return; }
+        writer.join();
+    }
+
+    LogSeverity Minimum() {
+        return (LogSeverity)minimum.load(std::memory_order_relaxed);
+    }
+
+    void Gl(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const char *message) {
+        LogSeverity logSeverity = fromGl(severity);
+        if (!wanted(logSeverity)) { return; }
+        uint64_t pos;
+        Slot *slot = claim(pos);
+        if (!slot) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Entry &entry = slot->entry;
+        entry.gl = true;
+        entry.source = source;
+        entry.type = type;
+        entry.id = id;
+        entry.severity = logSeverity;
+        entry.time = now();
+        entry.length = 0;
+        append(entry, message, length >= 0 ? (size_t)length : std::strlen(message));
+        entry.idLength = entry.length;
+        publish(*slot, pos);
+    }
+
+    void Message(LogSeverity severity, const char *text, const char *detail) {
+        if (!wanted(severity)) { return; }
+        uint64_t pos;
+        Slot *slot = claim(pos);
+        if (!slot) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Entry &entry = slot->entry;
+        entry.gl = false;
+        entry.source = entry.type = 0;
+        entry.id = 0;
+        entry.severity = severity;
+        entry.time = now();
+        entry.length = 0;
+        append(entry, text, std::strlen(text));
+        entry.idLength = entry.length;
+        append(entry, detail, std::strlen(detail));
+        publish(*slot, pos);
+    }
+
+    void Print(std::ostream &out) {
+        out << "Log: " << printed.load() << " printed, " << repeated.load() << " repeats folded, "
+            << heldBack.load() << " held back, " << dropped.load() << " dropped for a full ring" << std::endl;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <GL\glew.h>
+
+// Messages waiting for the writer. Further ones are dropped and counted until it catches up.
+#define LOG_RING_SIZE 1024
+// Longer messages are cut off
+#define LOG_MESSAGE_SIZE 1024
+
+// Severities of the GL debug output, engine messages use them too
+enum class LogSeverity { Notification, Low, Medium, High };
+
+// "notification", "low", "medium" or "high", anything else is low
+LogSeverity parseLogSeverity(std::string name);
+
+// Logging that costs the logging thread no more than copying the message.
+//
+// Messages are copied as they are into a fixed ring of slots that any thread may fill, without
+// locks or allocations (a bounded queue after Vyukov with a single consumer). A writer thread
+// takes them out, formats them and prints them to std::cout. It prints a message repeated right
+// after itself only once with the number of repeats, and at most perSecond messages of one ID a
+// second. What it held back it counts and says when the ID shows up again or the log stops.
+// Messages below the minimum severity are dropped before they are queued.
+// Messages logged before Start wait in the ring, at most LOG_RING_SIZE of them.
+namespace Log {
+    void Start(LogSeverity minimum, unsigned int perSecond);
+    // Prints what is still queued and ends the writer thread
+    void Stop();
+    LogSeverity Minimum();
+
+    // Queues a message of the GL debug output, with the fields GL passed to the callback
+    void Gl(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const char *message);
+    // Queues a message of the engine, the two parts are printed one after the other.
+    // Messages with the same text count as the same ID whatever their detail, so the text should
+    // be the fixed part and the detail what changes, like a path.
+    void Message(LogSeverity severity, const char *text, const char *detail = "");
+
+    // Messages printed, repeated, held back and dropped for a full ring
+    void Print(std::ostream &out);
+}
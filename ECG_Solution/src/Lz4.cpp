@@ -0,0 +1,119 @@
+#include "Lz4.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    const size_t MIN_MATCH = 4;
+    const size_t LAST_LITERALS = 5;   // the block always ends with at least this many literals
+    const size_t MATCH_LIMIT = 12;    // no match may start this close to the end
+    const int HASH_BITS = 16;
+
+    uint32_t read32(const unsigned char *p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - HASH_BITS); }
+
+    void writeLength(std::vector<unsigned char> &out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((unsigned char)length);
+    }
+
+    void writeSequence(std::vector<unsigned char> &out, const unsigned char *literals, size_t literalLength, size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+        out.push_back((unsigned char)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+        if (literalLength >= 15) { writeLength(out, literalLength - 15); }
+        out.insert(out.end(), literals, literals + literalLength);
+        if (matchLength == 0) { return; }
+        out.push_back((unsigned char)(offset & 0xFF));
+        out.push_back((unsigned char)(offset >> 8));
+        if (matchCode >= 15) { writeLength(out, matchCode - 15); }
+    }
+}
+
+size_t lz4Compress(const unsigned char *data, size_t size, std::vector<unsigned char> &out) {
+    size_t start = out.size();
+    out.reserve(start + size + size / 255 + 16);
+
+    // Positions of the last sequence with each hash, +1 so that 0 means none
+    std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0);
+    size_t anchor = 0;
+    size_t position = 0;
+    size_t matchEnd = size > LAST_LITERALS ? size - LAST_LITERALS : 0;
+
+    while (size > MATCH_LIMIT && position < size - MATCH_LIMIT) {
+        uint32_t sequence = read32(data + position);
+        uint32_t &slot = table[hash(sequence)];
+        size_t candidate = slot;
+        slot = (uint32_t)position + 1;
+
+        if (candidate == 0 || position - (candidate - 1) > 0xFFFF || read32(data + candidate - 1) != sequence) {
+            position++;
+            continue;
+        }
+        candidate--;
+
+        size_t length = MIN_MATCH;
+        while (position + length < matchEnd && data[candidate + length] == data[position + length]) { length++; }
+
+        writeSequence(out, data + anchor, position - anchor, position - candidate, length);
+        position += length;
+        anchor = position;
+    }
+
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return out.size() - start;
+}
+
+bool lz4Decompress(const unsigned char *data, size_t size, unsigned char *out, size_t outSize) {
+    const unsigned char *end = data + size;
+    size_t written = 0;
+
+    while (data < end) {
+        unsigned char token = *data++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            unsigned char byte;
+            do {
+                if (data == end) { return false; }
+                byte = *data++;
+                literalLength += byte;
+            } while (byte == 255);
+        }
+        if ((size_t)(end - data) < literalLength || outSize - written < literalLength) { return false; }
+        std::memcpy(out + written, data, literalLength);
+        data += literalLength;
+        written += literalLength;
+
+        // The last sequence has no match
+        if (data == end) { break; }
+
+        if (end - data < 2) { return false; }
+        size_t offset = data[0] | ((size_t)data[1] << 8);
+        data += 2;
+        if (offset == 0 || offset > written) { return false; }
+
+        size_t matchLength = (token & 0x0F) + MIN_MATCH;
+        if ((token & 0x0F) == 15) {
+            unsigned char byte;
+            do {
+                if (data == end) { return false; }
+                byte = *data++;
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        if (outSize - written < matchLength) { return false; }
+
+        // Byte by byte, as the match may overlap the bytes it produces
+        const unsigned char *match = out + written - offset;
+        for (size_t i = 0; i < matchLength; i++) { out[written + i] = match[i]; }
+        written += matchLength;
+    }
+    return written == outSize;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Compression in the LZ4 block format: a token with the literal and match lengths,
+// the literals, then a two byte offset back into the output. Fast to decode, which is
+// what matters for assets that are decompressed at every start.
+
+// Appends the compressed data to out. Returns the compressed size.
+size_t lz4Compress(const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+
+// Decompresses exactly outSize bytes. Returns false if the data is corrupt.
+bool lz4Decompress(const unsigned char *data, size_t size, unsigned char *out, size_t outSize);
@@ -5,7 +5,6 @@
 */
 
 #include <string>
-#include <sstream>
 #include <GL\glew.h>
 #include <GLFW/glfw3.h>
 #include "Utils.h"
@@ -18,11 +17,29 @@
 #include "Cursor.hpp"
 #include "Shader.hpp"
 #include "WindowInfo.hpp"
-#include "Shapes/Box.hpp"
-#include "Shapes/Cylinder.hpp"
-#include "Shapes/Sphere.hpp"
 #include "Lights.hpp"
-#include "readFile.hpp"
+#include "Vfs.hpp"
+#include "Profiler.hpp"
+#include "UploadRing.hpp"
+#include "Uniforms.hpp"
+#include "ShaderCache.hpp"
+#include "Settings.hpp"
+#include "Scene.hpp"
+#include "Materials.hpp"
+#include "SoftwareRenderer.hpp"
+#include "MemoryReport.hpp"
+#include "GlCapture.hpp"
+#include "Memory.hpp"
+#include "Allocations.hpp"
+#include "Culling.hpp"
+#include "GpuCulling.hpp"
+#include "Particles.hpp"
+#include "Log.hpp"
+#include "Environment.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 namespace fs = std::filesystem;
 
 
@@ -30,103 +47,6 @@ namespace fs = std::filesystem;
 // Callbacks
 /* --------------------------------------------- */
 
-static std::string FormatDebugOutput(GLenum source, GLenum type, GLuint id, GLenum severity, const char* msg) {
-    std::stringstream stringStream;
-    std::string sourceString;
-    std::string typeString;
-    std::string severityString; 
-    
-    switch (source) {
-        case GL_DEBUG_SOURCE_API: {
-            sourceString = "API";
-            break;
-        }
-        case GL_DEBUG_SOURCE_APPLICATION: {
-            sourceString = "Application";
-            break;
-        }
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: {
-            sourceString = "Window System";
-            break;
-        }
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: {
-            sourceString = "Shader Compiler";
-            break;
-        }
-        case GL_DEBUG_SOURCE_THIRD_PARTY: {
-            sourceString = "Third Party";
-            break;
-        }
-        case GL_DEBUG_SOURCE_OTHER: {
-            sourceString = "Other";
-            break;
-        }
-        default: {
-            sourceString = "Unknown";
-            break;
-        }
-    }
- 
-    switch (type) {
-        case GL_DEBUG_TYPE_ERROR: {
-            typeString = "Error";
-            break;
-        }
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: {
-            typeString = "Deprecated Behavior";
-            break;
-        }
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: {
-            typeString = "Undefined Behavior";
-            break;
-        }
-        case GL_DEBUG_TYPE_PORTABILITY_ARB: {
-            typeString = "Portability";
-            break;
-        }
-        case GL_DEBUG_TYPE_PERFORMANCE: {
-            typeString = "Performance";
-            break;
-        }
-        case GL_DEBUG_TYPE_OTHER: {
-            typeString = "Other";
-            break;
-        }
-        default: {
-            typeString = "Unknown";
-            break;
-        }
-    }
- 
-    switch (severity) {
-        case GL_DEBUG_SEVERITY_HIGH: {
-            severityString = "High";
-            break;
-        }
-        case GL_DEBUG_SEVERITY_MEDIUM: {
-            severityString = "Medium";
-            break;
-        }
-        case GL_DEBUG_SEVERITY_LOW: {
-            severityString = "Low";
-            break;
-        }
-        default: {
-            severityString = "Unknown";
-            break;
-        }
-    }
- 
-    stringStream << "OpenGL Error: " << msg;
-    stringStream << " [Source = " << sourceString;
-    stringStream << ", Type = " << typeString;
-    stringStream << ", Severity = " << severityString;
-    stringStream << ", ID = " << id << "]";
- 
-    return stringStream.str();
-}
-
-
 void error_callback(int error, const char* description)
 {
 	fprintf(stderr, "Error: %s\n", description);
@@ -135,6 +55,8 @@ void error_callback(int error, const char* description)
 // Handles key presses
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    // Debug keys print and write files, which is fine in frames that must not allocate otherwise
+    AllowAllocations allow;
     Camera &camera = ((WindowInfo*)glfwGetWindowUserPointer(window))->camera;
 
     // Close window upon ESC press
@@ -151,6 +73,29 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
     else if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
         camera.toggleBackfaceCulling();
     }
+
+    // Print the GPU timings of each pass upon F3 press
+    else if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        ((WindowInfo*)glfwGetWindowUserPointer(window))->gpuProfiler.Print(std::cout);
+    }
+
+    // Write the CPU zones recorded so far as a Chrome trace upon F4 press
+    else if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+        std::filesystem::path &traceFile = ((WindowInfo*)glfwGetWindowUserPointer(window))->traceFile;
+        if (Profiler::WriteChromeTrace(traceFile)) {
+            Log::Message(LogSeverity::Low, "Wrote trace to ", traceFile.string().c_str());
+        }
+    }
+
+    // Write the next frame as rendered by GL and by the software renderer upon F5 press
+    else if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        ((WindowInfo*)glfwGetWindowUserPointer(window))->captureFrame = true;
+    }
+
+    // Print the CPU and GPU memory held by each kind of resource upon F6 press
+    else if (key == GLFW_KEY_F6 && action == GLFW_PRESS) {
+        ((WindowInfo*)glfwGetWindowUserPointer(window))->printMemory = true;
+    }
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
@@ -186,11 +131,119 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.translate(glm::vec3(0.0, 0.0, yoffset));
 }
 
+/* --------------------------------------------- */
+// Shading
+/* --------------------------------------------- */
+
+// Only the lights that are switched on are compiled into the shaders
+static unsigned int lightFeatures(Lights &lights) {
+    unsigned int features = 0;
+    if (lights.dirLight.color != glm::vec3(0.0f))   { features |= SHADER_DIR_LIGHT; }
+    if (!lights.pointLights.empty())                 { features |= SHADER_POINT_LIGHT; }
+    return features;
+}
+
+// Picks the cheapest shader variant that matches the shape's settings.
+// Shapes further away than gouraudDistance are lit per vertex (0 turns that off).
+static unsigned int shaderFeatures(Shape &shape, unsigned int lights, glm::vec3 cameraPos, float gouraudDistance, bool forceGouraud) {
+    unsigned int features = shape.Features() | lights;
+    if (forceGouraud) {
+        features |= SHADER_GOURAUD;
+    }
+    else if (gouraudDistance > 0.0f && glm::distance(cameraPos, shape.GetTransformation().translation) > gouraudDistance) {
+        features |= SHADER_GOURAUD;
+    }
+    return features;
+}
+
+// Destroys the framework, window and context when it goes out of scope
+struct ContextGuard {
+    GLFWwindow *window;
+    ContextGuard(GLFWwindow *w) : window(w) { }
+    ~ContextGuard() {
+        destroyFramework();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+};
+
+/* --------------------------------------------- */
+// Software rendering
+/* --------------------------------------------- */
+
+// Renders the scene on the CPU without opening a window, for machines without a GPU.
+// The frame is rendered frameCount times to time it, then written to outPath.
+static int renderHeadless(Settings &settings, SceneDescription &scene, fs::path outPath, int frameCount) {
+    std::filesystem::path p = "";
+    Vfs vfs(p / "assets", p / "assets.pack");
+    TextureCache textures(vfs, "textures");
+    SoftwareScene softwareScene = buildSoftwareScene(scene, textures, vfs, "meshes");
+    textures.Clear();
+
+    Camera camera(settings.camera.fov, settings.window.height, settings.window.width, settings.camera.zNear, settings.camera.zFar);
+    SoftwareRenderer renderer(settings.window.width, settings.window.height);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frameCount; i++) {
+        renderer.Render(softwareScene, camera.ViewProjMatrix(), glm::vec3(camera.ViewPosMatrix()), camera.BackfaceCulling());
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frameCount;
+    std::cout << "Rendered " << renderer.TriangleCount() << " triangles in " << ms << " ms per frame" << std::endl;
+
+    if (!writeTga(outPath, renderer.Frame())) {
+        std::cout << "Can not write " << outPath.string() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << outPath.string() << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// The back buffer, first row at the top
+static Image readFramebuffer(GLFWwindow *window) {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    std::vector<unsigned char> rows(image.pixels.size());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+    size_t rowSize = (size_t)width * 4;
+    for (int y = 0; y < height; y++) {
+        std::copy(&rows[(size_t)(height - 1 - y) * rowSize], &rows[(size_t)(height - y) * rowSize], &image.pixels[(size_t)y * rowSize]);
+    }
+    return image;
+}
+
+// Prints how far apart two frames of the same size are
+static void compareFrames(const Image &a, const Image &b) {
+    if (a.width != b.width || a.height != b.height) {
+        Log::Message(LogSeverity::Low, "Frames differ in size");
+        return;
+    }
+    size_t differentPixels = 0;
+    double totalError = 0.0;
+    for (size_t i = 0; i < a.pixels.size(); i += 4) {
+        int maxError = 0;
+        for (int c = 0; c < 3; c++) {
+            int error = std::abs(a.pixels[i + c] - b.pixels[i + c]);
+            totalError += error;
+            maxError = (std::max)(maxError, error);
+        }
+        // Off by a few steps is rounding and filtering, not a different picture
+        if (maxError > 8) { differentPixels++; }
+    }
+    size_t pixels = a.pixels.size() / 4;
+    char detail[128];
+    std::snprintf(detail, sizeof(detail), "%g, %zu of %zu pixels differ by more than 8", totalError / (pixels * 3.0), differentPixels, pixels);
+    Log::Message(LogSeverity::Low, "Mean error ", detail);
+}
+
 static void APIENTRY DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
                                    GLsizei length, const GLchar* message, const GLvoid* userParam) 
 {
-    std::string error = FormatDebugOutput(source, type, id, severity, message);
-    std::cout << error << std::endl;
+    // Only copies the message, the log's writer thread formats and prints it
+    Log::Gl(source, type, id, severity, length, message);
 }
 
  /* --------------------------------------------- */
@@ -203,103 +256,36 @@ int main(int argc, char** argv)
     // Load settings.ini
     /* --------------------------------------------- */
 
-    // init reader for ini files
-    INIReader reader("assets/settings.ini");
-
-    // load values from ini file
-    // first param: section [window], second param: property name, third param: default value
-    int width                    = reader.GetInteger("window", "width", 80);
-    int height                   = reader.GetInteger("window", "height", 80);
-    std::string tmp_window_title = reader.Get("window", "title", "Title not loaded");
-    const char * window_title    = tmp_window_title.c_str();
-    float fovy                   = (float)reader.GetReal("camera", "fov", 360.0);
-    float zNear                  = (float)reader.GetReal("camera", "near", 0.5);
-    float zFar                   = (float)reader.GetReal("camera", "far", 50.0);
-
-    // directional light
-    float dirLightRed   = (float)reader.GetReal("directionalLight", "red", 50.0);
-    float dirLightGreen = (float)reader.GetReal("directionalLight", "green", 50.0);
-    float dirLightBlue  = (float)reader.GetReal("directionalLight", "blue", 50.0);
-    float dirLightDirX  = (float)reader.GetReal("directionalLight", "dirX", 50.0);
-    float dirLightDirY  = (float)reader.GetReal("directionalLight", "dirY", 50.0);
-    float dirLightDirZ  = (float)reader.GetReal("directionalLight", "dirZ", 50.0);
-
-    // point light
-    float pointLightRed      = (float)reader.GetReal("pointLight", "red", 50.0);
-    float pointLightGreen    = (float)reader.GetReal("pointLight", "green", 50.0);
-    float pointLightBlue     = (float)reader.GetReal("pointLight", "blue", 50.0);
-    float pointLightTransX   = (float)reader.GetReal("pointLight", "transX", 50.0);
-    float pointLightTransY   = (float)reader.GetReal("pointLight", "transY", 50.0);
-    float pointLightTransZ   = (float)reader.GetReal("pointLight", "transZ", 50.0);
-    float pointLightAttConst = (float)reader.GetReal("pointLight", "attenuationConst", 50.0);
-    float pointLightAttLin   = (float)reader.GetReal("pointLight", "attenuationLin", 50.0);
-    float pointLightAttQuad  = (float)reader.GetReal("pointLight", "attenuationQuad", 50.0);
-
-    // box
-    float boxWidth         = (float)reader.GetReal("box", "width", 50.0);
-    float boxHeight        = (float)reader.GetReal("box", "height", 50.0);
-    float boxDepth         = (float)reader.GetReal("box", "depth", 50.0);
-    float boxTransX        = (float)reader.GetReal("box", "transX", 50.0);
-    float boxTransY        = (float)reader.GetReal("box", "transY", 50.0);
-    float boxTransZ        = (float)reader.GetReal("box", "transZ", 50.0);
-    float boxRotX          = (float)reader.GetReal("box", "rotX", 50.0);
-    float boxRotY          = (float)reader.GetReal("box", "rotY", 50.0);
-    float boxRotZ          = (float)reader.GetReal("box", "rotZ", 50.0);
-    float boxScaleX        = (float)reader.GetReal("box", "scaleX", 50.0);
-    float boxScaleY        = (float)reader.GetReal("box", "scaleY", 50.0);
-    float boxScaleZ        = (float)reader.GetReal("box", "scaleZ", 50.0);
-    float boxRed           = (float)reader.GetReal("box", "red", 1.0);
-    float boxGreen         = (float)reader.GetReal("box", "green", 1.0);
-    float boxBlue          = (float)reader.GetReal("box", "blue", 1.0);
-    float boxKA            = (float)reader.GetReal("box", "ka", 10);
-    float boxKD            = (float)reader.GetReal("box", "kd", 10);
-    float boxKS            = (float)reader.GetReal("box", "ks", 10);
-    int boxAlpha           = reader.GetInteger("box", "alpha", 2);
-    std::string boxTexture = reader.Get("box", "texture", "");
-
-    // cylinder
-    float cylinderHeight        = (float)reader.GetReal("cylinder", "height", 50.0);
-    float cylinderRadius        = (float)reader.GetReal("cylinder", "radius", 50.0);
-    unsigned int cylinderSides  =     reader.GetInteger("cylinder", "sides", 50);
-    float cylinderTransX        = (float)reader.GetReal("cylinder", "transX", 50.0);
-    float cylinderTransY        = (float)reader.GetReal("cylinder", "transY", 50.0);
-    float cylinderTransZ        = (float)reader.GetReal("cylinder", "transZ", 50.0);
-    float cylinderRotX          = (float)reader.GetReal("cylinder", "rotX", 50.0);
-    float cylinderRotY          = (float)reader.GetReal("cylinder", "rotY", 50.0);
-    float cylinderRotZ          = (float)reader.GetReal("cylinder", "rotZ", 50.0);
-    float cylinderScaleX        = (float)reader.GetReal("cylinder", "scaleX", 50.0);
-    float cylinderScaleY        = (float)reader.GetReal("cylinder", "scaleY", 50.0);
-    float cylinderScaleZ        = (float)reader.GetReal("cylinder", "scaleZ", 50.0);
-    float cylinderRed           = (float)reader.GetReal("cylinder", "red", 1.0);
-    float cylinderGreen         = (float)reader.GetReal("cylinder", "green", 1.0);
-    float cylinderBlue          = (float)reader.GetReal("cylinder", "blue", 1.0);
-    float cylinderKA            = (float)reader.GetReal("cylinder", "ka", 10);
-    float cylinderKD            = (float)reader.GetReal("cylinder", "kd", 10);
-    float cylinderKS            = (float)reader.GetReal("cylinder", "ks", 10);
-    int cylinderAlpha           =     reader.GetInteger("cylinder", "alpha", 2);
-    std::string cylinderTexture = reader.Get("cylinder", "texture", "");
-
-    // sphere
-    unsigned int sphereLongSegments = reader.GetInteger("sphere", "longSegments", 50);
-    unsigned int sphereLatSegments  = reader.GetInteger("sphere", "latSegments", 50);
-    float sphereRadius              = (float)reader.GetReal("sphere", "radius", 50.0);
-    float sphereTransX              = (float)reader.GetReal("sphere", "transX", 50.0);
-    float sphereTransY              = (float)reader.GetReal("sphere", "transY", 50.0);
-    float sphereTransZ              = (float)reader.GetReal("sphere", "transZ", 50.0);
-    float sphereRotX                = (float)reader.GetReal("sphere", "rotX", 50.0);
-    float sphereRotY                = (float)reader.GetReal("sphere", "rotY", 50.0);
-    float sphereRotZ                = (float)reader.GetReal("sphere", "rotZ", 50.0);
-    float sphereScaleX              = (float)reader.GetReal("sphere", "scaleX", 50.0);
-    float sphereScaleY              = (float)reader.GetReal("sphere", "scaleY", 50.0);
-    float sphereScaleZ              = (float)reader.GetReal("sphere", "scaleZ", 50.0);
-    float sphereRed                 = (float)reader.GetReal("sphere", "red", 1.0);
-    float sphereGreen               = (float)reader.GetReal("sphere", "green", 1.0);
-    float sphereBlue                = (float)reader.GetReal("sphere", "blue", 1.0);
-    float sphereKA                  = (float)reader.GetReal("sphere", "ka", 10);
-    float sphereKD                  = (float)reader.GetReal("sphere", "kd", 10);
-    float sphereKS                  = (float)reader.GetReal("sphere", "ks", 10);
-    int sphereAlpha                 = reader.GetInteger("sphere", "alpha", 2);
-    std::string sphereTexture       = reader.Get("sphere", "texture", "");
+    Allocations::BeginPhase("startup");
+    ProfileZone startupZone("startup");
+    // Both end in the render loop, see there
+    auto launchTime = std::chrono::steady_clock::now();
+    ProfileZone firstFrameZone("time to first frame");
+    ProfileZone loadedZone("time to fully loaded");
+
+    // load values from ini file into typed settings and a description of the scene,
+    // and tell about anything that did not fit
+    std::filesystem::path settingsPath = "assets/settings.ini";
+    ConfigFile settingsFile(settingsPath);
+    Settings settings;
+    SceneDescription scene;
+    ConfigReport settingsReport = loadSettings(settingsFile, settingsPath, settings);
+    ConfigReport sceneReport = describeScene(settingsFile, scene);
+    settingsReport.Merge(sceneReport);
+    settingsReport.unknown = settingsFile.Unused();
+    settingsReport.Print(std::cout);
+    Log::Start(parseLogSeverity(settings.logging.minSeverity), settings.logging.perSecond);
+
+    const char * window_title = settings.window.title.c_str();
+    int width                 = settings.window.width;
+    int height                = settings.window.height;
+    ShadingSettings &shading  = settings.shading;
+    Lights &lights            = scene.lights;
+
+    // --software out.tga [frames] renders on the CPU and exits without opening a window
+    if (argc >= 3 && std::string(argv[1]) == "--software") {
+        return renderHeadless(settings, scene, argv[2], argc >= 4 ? (std::max)(1, std::atoi(argv[3])) : 1);
+    }
 
 
     /* --------------------------------------------- */
@@ -347,17 +333,34 @@ int main(int argc, char** argv)
 #if _DEBUG
         // Register your debug callback function.
         glDebugMessageCallback(DebugCallback, NULL);
-        // Enable synchronous callback. This ensures that your callback function is called
-        // right after an error has occurred. 
-        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        // The driver need not even produce the messages the log would drop
+        if (Log::Minimum() > LogSeverity::Notification) {
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+        }
+        if (Log::Minimum() > LogSeverity::Low) {
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_LOW, 0, nullptr, GL_FALSE);
+        }
+        if (Log::Minimum() > LogSeverity::Medium) {
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_MEDIUM, 0, nullptr, GL_FALSE);
+        }
+        // Synchronous output calls the callback right after the call that caused the message,
+        // on its thread, so a breakpoint in it shows the culprit. Otherwise the driver may batch them.
+        if (settings.logging.synchronous) { glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS); }
 #endif
 
+        // Hooked before anything is created, so the capture knows every object
+        if (settings.capture.frameCount > 0) {
+            GlCapture::Install(settings.capture.file, settings.capture.firstFrame, settings.capture.frameCount);
+        }
+
         glfwSwapInterval(1);
 
         if (!initFramework()) {
             EXIT_WITH_ERROR("Failed to init framework")
         }
     }
+    // Declared before anything that owns GL objects, so it goes last and takes the context with it
+    ContextGuard contextGuard(window);
 
     /* --------------------------------------------- */
     // Initialize scene and render loop
@@ -366,141 +369,389 @@ int main(int argc, char** argv)
     // Enable Z depth testing
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
+    // Back faces are culled until F2 toggles it, see Camera
+    glEnable(GL_CULL_FACE);
 
-    // For reading files
+    // For reading files. Assets come from assets.pack, or from the asset directory if there is no pack.
+    // settings.ini is never packed, so it can be edited without repacking.
     std::filesystem::path p = "";
-
-    // Read Textures
-    std::filesystem::path wood_texture_path  = p / "assets" / "textures" / "wood_texture.dds";
-    std::filesystem::path tiles_diffuse_path = p / "assets" / "textures" / "tiles_diffuse.dds";
+    Vfs vfs(p / "assets", p / "assets.pack");
+    std::cout << (vfs.HasPack() ? "Loading assets from assets.pack" : "No assets.pack, loading loose assets") << std::endl;
 
     // Read shaders
-    string vertexShaderGouraudSource   = readFile(p / "assets" / "shaders" / "vertexShaderGouraud.vs");
-    string fragmentShaderGouraudSource = readFile(p / "assets" / "shaders" / "fragmentShaderGouraud.fs");
-    string vertexShaderPhongSource     = readFile(p / "assets" / "shaders" / "vertexShaderPhong.vs");
-    string fragmentShaderPhongSource   = readFile(p / "assets" / "shaders" / "fragmentShaderPhong.fs");
-
-    // Create the point light
-    PointLight pointLight;
-    pointLight.color       = glm::vec3(pointLightRed, pointLightGreen, pointLightBlue);
-    pointLight.position    = glm::vec3(pointLightTransX, pointLightTransY, pointLightTransZ);
-    pointLight.attenuation = glm::vec3(pointLightAttQuad, pointLightAttLin, pointLightAttConst);
-
-    // Create the directional light
-    DirectionLight dirLight;
-    dirLight.color     = glm::vec3(dirLightRed, dirLightGreen, dirLightBlue);
-    dirLight.direction = glm::vec3(dirLightDirX, dirLightDirY, dirLightDirZ);
-
-    // Bundle the two lights together to be used as argument to the shaders
-    Lights lights;
-    lights.dirLight   = dirLight;
-    lights.pointLight = pointLight;
-
-    // Specify the properties of the surfaces of the four objects
-    Surface boxSurface;
-    boxSurface.ka = boxKA;
-    boxSurface.kd = boxKD;
-    boxSurface.ks = boxKS;
-    boxSurface.alpha = boxAlpha;
-
-    Surface cylinderSurface;
-    cylinderSurface.ka = cylinderKA;
-    cylinderSurface.kd = cylinderKD;
-    cylinderSurface.ks = cylinderKS;
-    cylinderSurface.alpha = cylinderAlpha;
-    
-    Surface sphereSurface;
-    sphereSurface.ka = sphereKA;
-    sphereSurface.kd = sphereKD;
-    sphereSurface.ks = sphereKS;
-    sphereSurface.alpha = sphereAlpha;
-
-    // Transformations of each object
-    Transformation boxTransformation;
-    boxTransformation.translation = glm::vec3(boxTransX, boxTransY, boxTransZ);
-    boxTransformation.rotation    = glm::vec3(boxRotX, boxRotY, boxRotZ);
-    boxTransformation.scaling     = glm::vec3(boxScaleX, boxScaleY, boxScaleZ);
-
-    Transformation cylinderTransformation;
-    cylinderTransformation.translation = glm::vec3(cylinderTransX, cylinderTransY, cylinderTransZ);
-    cylinderTransformation.rotation    = glm::vec3(cylinderRotX, cylinderRotY, cylinderRotZ);
-    cylinderTransformation.scaling     = glm::vec3(cylinderScaleX, cylinderScaleY, cylinderScaleZ);
-
-    Transformation sphereTransformation;
-    sphereTransformation.translation = glm::vec3(sphereTransX, sphereTransY, sphereTransZ);
-    sphereTransformation.rotation    = glm::vec3(sphereRotX, sphereRotY, sphereRotZ);
-    sphereTransformation.scaling     = glm::vec3(sphereScaleX, sphereScaleY, sphereScaleZ);
-
-    glm::vec3 boxColor      = glm::vec3(boxRed, boxGreen, boxBlue);
-    glm::vec3 cylinderColor = glm::vec3(cylinderRed, cylinderGreen, cylinderBlue);
-    glm::vec3 sphereColor   = glm::vec3(sphereRed, sphereGreen, sphereBlue);
-
-
-    
-    // Generate Shapes
-    Box box           = Box(boxWidth, boxHeight, boxDepth, boxSurface, boxTransformation, boxColor, wood_texture_path);
-    Cylinder cylinder = Cylinder(cylinderHeight, cylinderRadius, cylinderSides, cylinderSurface, cylinderTransformation, cylinderColor, tiles_diffuse_path);
-    Sphere sphere     = Sphere(sphereLongSegments, sphereLatSegments, sphereRadius, sphereSurface, sphereTransformation, sphereColor, tiles_diffuse_path);
-
-    //Box box           = Box(boxWidth, boxHeight, boxDepth, boxSurface, boxTransformation, boxColor, loadDDS(wood_texture_path.string().c_str()));
-    //Cylinder cylinder = Cylinder(cylinderHeight, cylinderRadius, cylinderSides, cylinderSurface, cylinderTransformation, cylinderColor, loadDDS(tiles_diffuse_path.string().c_str()));
-    //Sphere sphere     = Sphere(sphereLongSegments, sphereLatSegments, sphereRadius, sphereSurface, sphereTransformation, sphereColor, loadDDS(tiles_diffuse_path.string().c_str()));
-    
-    // Generate shaders
-    Shader &boxShader = Shader(
-        vertexShaderPhongSource,
-        fragmentShaderPhongSource,
-        box, lights);
-
-    Shader &cylinderShader = Shader(
-        vertexShaderPhongSource,
-        fragmentShaderPhongSource,
-        cylinder, lights);
-
-    Shader &sphereShader = Shader(
-        vertexShaderPhongSource,
-        fragmentShaderPhongSource,
-        sphere, lights);
+    string vertexShaderLitSource    = vfs.ReadText("shaders/vertexShaderLit.vs");
+    string fragmentShaderLitSource  = vfs.ReadText("shaders/fragmentShaderLit.fs");
+    string lightingSource           = vfs.ReadText("shaders/lighting.glsl");
+    string vertexShaderFlatSource   = vfs.ReadText("shaders/vertexShader.vs");
+    string fragmentShaderFlatSource = vfs.ReadText("shaders/fragmentShader.fs");
+    string fragmentShaderDepthSource = vfs.ReadText("shaders/fragmentShaderDepth.fs");
+
+    // Queue the shader variants the objects will start out with before loading anything else,
+    // so the driver compiles them while the assets load.
+    Shader::EnableParallelCompile();
+    ShaderCache litShaders(vertexShaderLitSource, fragmentShaderLitSource, lightingSource);
+    // Bindless handles live in buffer contents a trace could not remap, so captures go without
+    bool bindless = shading.bindless && !GlCapture::Installed() && MaterialTable::BindlessSupported();
+    unsigned int sceneLights = lightFeatures(lights) | (bindless ? SHADER_BINDLESS : 0);
+    // Loading progressively, textured objects start out untextured
+    for (ObjectDescription &object : scene.objects) {
+        unsigned int features = sceneLights;
+        if (object.object.surface.illumination == Illumination::Gouraud || shading.forceGouraud) { features |= SHADER_GOURAUD; }
+        unsigned int variants[2] = { features, features };
+        if (!object.object.texture.empty()) { variants[1] |= SHADER_TEXTURED; }
+        for (unsigned int v = settings.startup.progressive ? 0 : 1; v < 2; v++) {
+            litShaders.Get(variants[v]);
+            if (shading.gouraudDistance > 0.0f) { litShaders.Get(variants[v] | SHADER_GOURAUD); }
+        }
+    }
+    // Flat colored stand-in for objects whose shader is not ready yet
+    Shader flatShader(vertexShaderFlatSource, fragmentShaderFlatSource);
+    // Writes only depth, from the position-only vertex streams of the shapes
+    Shader depthShader(vertexShaderFlatSource, fragmentShaderDepthSource);
+    // GPU-driven draws read their objects from a buffer, so they need stand-ins of their own
+    bool gpuCulling = settings.culling.gpu;
+    std::unique_ptr<Shader> flatIndirectShader, depthIndirectShader;
+    if (gpuCulling) {
+        flatIndirectShader = std::make_unique<Shader>(insertAfterVersion(vertexShaderFlatSource, "#define INDIRECT\n"),
+                                                      insertAfterVersion(fragmentShaderFlatSource, "#define INDIRECT\n"));
+        depthIndirectShader = std::make_unique<Shader>(insertAfterVersion(vertexShaderFlatSource, "#define INDIRECT\n"), fragmentShaderDepthSource);
+    }
+    // The GPU-driven pre-pass draws from the shared interleaved vertices
+    Shape::UsePositionStreams(shading.depthPrePass && !gpuCulling);
+
+    // Generate Shapes. Their materials and textures are uploaded together afterwards.
+    // Progressive startup leaves that to the loader, which builds them while the first frames are drawn.
+    TextureCache textures(vfs, "textures");
+    MaterialTable materials(textures, bindless, (size_t)settings.streaming.textureBudgetMB << 20, settings.streaming.textureBytesPerFrame);
+    std::vector<std::unique_ptr<Shape>> shapes;
+    std::unique_ptr<SceneLoader> loader;
+    auto printMaterials = [&]() {
+        char detail[128];
+        std::snprintf(detail, sizeof(detail), "%zu materials, textures in %zu%s texture arrays", materials.Count(), materials.ArrayCount(),
+                      materials.Bindless() ? " bindless" : " bound");
+        Log::Message(LogSeverity::Low, "Materials: ", detail);
+    };
+    if (settings.startup.progressive) {
+        loader = std::make_unique<SceneLoader>(scene, materials, vfs, "meshes");
+    }
+    else {
+        shapes = buildScene(scene, materials, vfs, "meshes");
+        materials.Upload();
+        printMaterials();
+    }
+
+    // The stand-in is tiny, so it is fine to wait for it
+    flatShader.Wait();
+    litShaders.SetFallback(flatShader);
 
     // Create Camera and cursor
     WindowInfo windowInfo = {
-        Camera(fovy, height, width, zNear, zFar),
+        Camera(settings.camera.fov, height, width, settings.camera.zNear, settings.camera.zFar),
         Cursor()
     };
 
     // window has a pointer to windowInfo in order to use the camera and cursor in the callbacks
     glfwSetWindowUserPointer(window, (void*)&windowInfo);
+    windowInfo.traceFile = settings.profiling.traceFile;
     Camera& camera = windowInfo.camera;
     Cursor& cursor = windowInfo.cursor;
+    GpuProfiler& gpuProfiler = windowInfo.gpuProfiler;
+
+    // Per-frame data is streamed through the upload ring
+    // Captures need the data to go up through glBufferSubData, not a mapping
+    UploadRing uploadRing(settings.streaming.bytesPerFrame, !GlCapture::Installed());
+
+    // Built on the first F5 press, textures are loaded again if the GL upload dropped them
+    std::unique_ptr<SoftwareScene> softwareScene;
+
+    // Shapes outside the view or hidden behind others are not drawn
+    Culler culler(vfs.ReadText("shaders/hiz.comp"), settings.culling.frustum, settings.culling.occlusion, settings.culling.occlusionMaxAge);
+    std::unique_ptr<GpuCuller> gpuCuller;
+    if (gpuCulling) {
+        gpuCuller = std::make_unique<GpuCuller>(vfs.ReadText("shaders/cull.comp"), litShaders, *flatIndirectShader, sceneLights,
+                                                shading.gouraudDistance, shading.forceGouraud, shading.lodDistance, settings.culling.frustum);
+    }
+    // Shapes are handed to the GPU culler until the scene is loaded
+    bool gpuSynced = false;
+    // Simulated and drawn on the GPU alone
+    std::unique_ptr<ParticleSystem> particles;
+    if (settings.particles.count > 0) {
+        particles = std::make_unique<ParticleSystem>(vfs.ReadText("shaders/particles.comp"), vfs.ReadText("shaders/particles.vs"),
+                                                     vfs.ReadText("shaders/particles.fs"), settings.particles, scene);
+    }
+    // Prefiltered on a worker, or read from its cache
+    std::unique_ptr<EnvironmentMap> environment;
+    if (settings.environment.enabled) {
+        environment = std::make_unique<EnvironmentMap>(vfs, "textures/cubemap");
+    }
+
+    // Geometry is gone from system memory by now, and so is the texture data unless it is streamed
+    auto printMemory = [&]() {
+        MemoryReport report;
+        for (std::unique_ptr<Shape> &shape : shapes) { shape->ReportMemory(report); }
+        Shape::ReportPoolMemory(report);
+        Memory::ReportMemory(report);
+        materials.ReportMemory(report);
+        textures.ReportMemory(report);
+        litShaders.ReportMemory(report);
+        report.Add("shader", sizeof(Shader), flatShader.BinarySize());
+        uploadRing.ReportMemory(report);
+        culler.ReportMemory(report);
+        if (gpuCuller) { gpuCuller->ReportMemory(report); }
+        if (particles) { particles->ReportMemory(report); }
+        if (environment) { environment->ReportMemory(report); }
+        report.Print(std::cout);
+    };
+    if (!loader) { printMemory(); }
 
 	glClearColor(1, 1, 1, 1);
+    startupZone.End();
+    Allocations::BeginPhase("loading");
+    // Frames after loading settle in first, arenas grow and GPU passes appear, then they count as steady.
+    // Steady frames may be forbidden to allocate, which a capture would, as it records into memory.
+    unsigned int warmupFrames = 0;
+    bool steady = false;
+    bool forbidFrameAllocations = settings.profiling.forbidFrameAllocations && !GlCapture::Installed();
+
     // Render loop
+    auto lastFrame = std::chrono::steady_clock::now();
 	while (!glfwWindowShouldClose(window))
 	{	
+        PROFILE_ZONE("frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        float frameSeconds = std::chrono::duration<float>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+        Allocations::Forbid(steady && forbidFrameAllocations);
+        // Whatever the last frame put in the frame arena is done with
+        Memory::BeginFrame();
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        GlCapture::BeginFrame(framebufferWidth, framebufferHeight);
+        gpuProfiler.BeginFrame();
+
         // Clear the screen
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        {
+            PROFILE_ZONE("clear");
+            GpuZone zone(gpuProfiler, "clear");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
         // poll events
-		glfwPollEvents();
-        // Bind the shader of each shape and draw it
-        BindShader useBox(boxShader, camera);
-        box.Draw();
-        BindShader useCylinder(cylinderShader, camera);
-        cylinder.Draw();
-        BindShader useSphere(sphereShader, camera);
-        sphere.Draw();
+        {
+            PROFILE_ZONE("poll events");
+            glfwPollEvents();
+        }
+        if (loader) { loader->Update(shapes, settings.startup.loadBudgetMs); }
+        if (environment) { environment->Update(); }
+        if (gpuCuller) { culler.BeginFrame(camera.ViewProjMatrix()); }
+        else { culler.Cull(shapes, camera.ViewProjMatrix()); }
+        glm::vec3 cameraPos = glm::vec3(camera.ViewPosMatrix());
+        // Write this frame's camera and object data, then make it visible to the GPU before drawing
+        {
+            PROFILE_ZONE("stream uniforms");
+            uploadRing.BeginFrame();
+            UploadAllocation frameAllocation = uploadRing.AllocateUniform(sizeof(FrameUniforms));
+            if (frameAllocation.data) {
+                // Written in place, the light array makes the block too big to build on the stack every frame
+                FrameUniforms &frameUniforms = *(FrameUniforms*)frameAllocation.data;
+                frameUniforms.viewProj = camera.ViewProjMatrix();
+                frameUniforms.cameraPos = camera.ViewPosMatrix();
+                frameUniforms.dirLightColor = glm::vec4(lights.dirLight.color, 0.0f);
+                frameUniforms.dirLightDir = glm::vec4(lights.dirLight.direction, 0.0f);
+                frameUniforms.pointLightCount = glm::ivec4((int)lights.pointLights.size(), 0, 0, 0);
+                for (size_t i = 0; i < lights.pointLights.size(); i++) {
+                    PointLight &light = lights.pointLights[i];
+                    frameUniforms.pointLights[i] = {
+                        glm::vec4(light.color, 0.0f),
+                        glm::vec4(light.position, 1.0f),
+                        glm::vec4(light.attenuation, 0.0f)
+                    };
+                }
+                // The software renderer has the constant ambient term only, so the frame compared against it does too
+                bool comparing = windowInfo.captureFrame && !loader;
+                if (environment && !comparing) { environment->SetUniforms(frameUniforms, settings.environment.diffuse, settings.environment.specular); }
+                else { frameUniforms.environment = glm::vec4(0.0f); }
+                glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameAllocation.buffer, frameAllocation.offset, frameAllocation.size);
+            }
+            // GPU-driven draws have their objects in a buffer of their own
+            for (size_t i = 0; i < shapes.size() && !gpuCuller; i++) {
+                if (!culler.Visible(i)) { continue; }
+                shapes[i]->StreamUniforms(uploadRing);
+                shapes[i]->SelectLod(glm::distance(cameraPos, shapes[i]->GetTransformation().translation), shading.lodDistance);
+            }
+            uploadRing.Flush();
+        }
+        // Bring the texture levels in line with how big the shapes are on screen
+        {
+            PROFILE_ZONE("stream textures");
+            // Nothing is asked for while the window is minimized and has no pixels
+            if (materials.Streaming() && framebufferHeight > 0) {
+                glm::mat4 viewProj = camera.ViewProjMatrix();
+                // The GPU culler leaves no results on the CPU, so there UvPerPixel's own view test alone
+                // keeps shapes out of view from asking for levels. Occluded shapes still do.
+                for (size_t i = 0; i < shapes.size(); i++) {
+                    if (!gpuCuller && !culler.Visible(i)) { continue; }
+                    materials.Request(shapes[i]->Material(), shapes[i]->UvPerPixel(viewProj, (float)framebufferHeight));
+                }
+            }
+            materials.Stream();
+        }
+        // Test every shape and write the draws on the GPU
+        if (gpuCuller) {
+            PROFILE_ZONE("gpu cull");
+            GpuZone zone(gpuProfiler, "gpu cull");
+            if (!gpuSynced) {
+                gpuCuller->Sync(shapes);
+                gpuSynced = !loader;
+            }
+            gpuCuller->Cull(camera.ViewProjMatrix(), cameraPos, culler);
+        }
+        // Lay down the depth of the visible shapes, so the colour pass below only shades what ends up on screen
+        Shader &prePassShader = gpuCuller ? *depthIndirectShader : depthShader;
+        bool depthPrePass = shading.depthPrePass && prePassShader.IsReady();
+        if (depthPrePass) {
+            PROFILE_ZONE("depth pre-pass");
+            GpuZone zone(gpuProfiler, "depth pre-pass");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            if (gpuCuller) { gpuCuller->DrawDepth(prePassShader); }
+            else {
+                depthShader.Use();
+                for (size_t i = 0; i < shapes.size(); i++) {
+                    if (culler.Visible(i)) { shapes[i]->DrawDepth(); }
+                }
+                glUseProgram(0);
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            // The depth is final, only fragments exactly on it get shaded
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        // Bind the shader variant of each shape and draw it.
+        // The program only changes when the variant does, textures are bound once for all shapes.
+        {
+            PROFILE_ZONE("draw objects");
+            GpuZone zone(gpuProfiler, "objects");
+            materials.Bind();
+            if (gpuCuller) { gpuCuller->Draw(); }
+            Shader *bound = nullptr;
+            for (size_t i = 0; i < shapes.size() && !gpuCuller; i++) {
+                if (!culler.Visible(i)) { continue; }
+                std::unique_ptr<Shape> &shape = shapes[i];
+                Shader &shader = litShaders.Get(shaderFeatures(*shape, sceneLights, cameraPos, shading.gouraudDistance, shading.forceGouraud));
+                if (&shader != bound) {
+                    shader.Use();
+                    bound = &shader;
+                }
+                shape->Draw();
+            }
+            glUseProgram(0);
+        }
+        if (depthPrePass) {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+        // Move the particles on and draw them over the opaque objects
+        if (particles) {
+            {
+                PROFILE_ZONE("simulate particles");
+                GpuZone zone(gpuProfiler, "particles simulate");
+                particles->Update(frameSeconds);
+            }
+            PROFILE_ZONE("draw particles");
+            GpuZone zone(gpuProfiler, "particles");
+            particles->Draw();
+        }
+        // Reduce this frame's depth for the occlusion tests of the coming frames
+        {
+            PROFILE_ZONE("depth pyramid");
+            GpuZone zone(gpuProfiler, "depth pyramid");
+            culler.BuildPyramid(framebufferWidth, framebufferHeight);
+        }
+
+        // The loader's worker owns the texture cache, so both wait until it is done
+        if (windowInfo.printMemory && !loader) {
+            AllowAllocations allow;
+            windowInfo.printMemory = false;
+            printMemory();
+        }
+
+        // Compare the frame against the software renderer
+        if (windowInfo.captureFrame && !loader) {
+            PROFILE_ZONE("capture frame");
+            AllowAllocations allow;
+            windowInfo.captureFrame = false;
+            Image glFrame = readFramebuffer(window);
+            if (!softwareScene) {
+                softwareScene = std::make_unique<SoftwareScene>(buildSoftwareScene(scene, textures, vfs, "meshes"));
+                // Streaming still needs the texture data
+                if (!materials.Streaming()) { textures.Clear(); }
+            }
+            SoftwareRenderer renderer(glFrame.width, glFrame.height);
+            renderer.Render(*softwareScene, camera.ViewProjMatrix(), cameraPos, camera.BackfaceCulling());
+            Image softwareFrame = renderer.Frame();
+            if (writeTga("frame_gl.tga", glFrame) && writeTga("frame_software.tga", softwareFrame)) {
+                Log::Message(LogSeverity::Low, "Wrote frame_gl.tga and frame_software.tga");
+            }
+            compareFrames(glFrame, softwareFrame);
+        }
+
+        uploadRing.EndFrame();
+        gpuProfiler.EndFrame();
+        GlCapture::EndFrame();
 
         // swap buffers
-		glfwSwapBuffers(window);
+        {
+            PROFILE_ZONE("swap buffers");
+            glfwSwapBuffers(window);
+        }
+
+        // Formatted on the stack, like everything logged in frames
+        auto logSinceLaunch = [&](const char *text) {
+            char detail[32];
+            std::snprintf(detail, sizeof(detail), "%g ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count());
+            Log::Message(LogSeverity::Low, text, detail);
+        };
+        if (firstFrameZone.Running()) {
+            firstFrameZone.End();
+            logSinceLaunch("First frame after ");
+        }
+        // The loader goes as soon as every shape is built and every texture uploaded, whatever the shaders do
+        if (loader && loader->Done()) {
+            loader.reset();
+            printMaterials();
+            printMemory();
+        }
+        // Fully loaded once the loader is gone and every shader is compiled, or failed to and left to its fallback
+        if (loadedZone.Running() && !loader && litShaders.AllSettled() && (!environment || environment->Done())) {
+            loadedZone.End();
+            logSinceLaunch("Fully loaded after ");
+            Profiler::EndStartup();
+            Allocations::BeginPhase("warm-up");
+        }
+        else if (!loadedZone.Running() && !steady && ++warmupFrames > settings.profiling.allocationWarmupFrames) {
+            steady = true;
+            Allocations::BeginPhase("frames");
+        }
 	}
+    Allocations::Forbid(false);
+    Allocations::BeginPhase("shutdown");
+
+    // Report where the GPU time went
+    gpuProfiler.Print(std::cout);
+    culler.Print(std::cout);
+    if (settings.profiling.traceOnExit) {
+        Profiler::WriteChromeTrace(settings.profiling.traceFile);
+    }
+    // Everything logged until here is printed before the summary
+    Log::Stop();
+    Log::Print(std::cout);
+    // Who allocated in which phase, steady frames should not have any
+    Allocations::Print(std::cout);
 
 
 	/* --------------------------------------------- */
 	// Destroy framework, context and exit
 	/* --------------------------------------------- */
 
-	destroyFramework();
-	glfwDestroyWindow(window);
-	glfwTerminate();
-
+    // Done by contextGuard, after everything declared after it has deleted its GL objects
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
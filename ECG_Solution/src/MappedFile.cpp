@@ -0,0 +1,68 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::filesystem::path path) : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+    file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return; }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return; }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) { close(); return; }
+    data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) { close(); return; }
+    size = (size_t)fileSize.QuadPart;
+}
+
+void MappedFile::close() {
+    if (data) { UnmapViewOfFile(data); }
+    if (mapping) { CloseHandle(mapping); }
+    if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+    data = nullptr;
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+    size = 0;
+}
+
+#else
+
+MappedFile::MappedFile(std::filesystem::path path) : data(nullptr), size(0), file(-1) {
+    file = open(path.c_str(), O_RDONLY);
+    if (file < 0) { return; }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) { close(); return; }
+
+    void *view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED) { close(); return; }
+    data = (const unsigned char*)view;
+    size = (size_t)status.st_size;
+}
+
+void MappedFile::close() {
+    if (data) { munmap((void*)data, size); }
+    if (file >= 0) { ::close(file); }
+    data = nullptr;
+    file = -1;
+    size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::IsOpen() { return data != nullptr; }
+const unsigned char *MappedFile::Data() { return data; }
+size_t MappedFile::Size() { return size; }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// A read-only view of a whole file, mapped into memory instead of read.
+// Pages are only loaded when they are touched, so opening a big file costs next to nothing.
+class MappedFile {
+private:
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int file;
+#endif
+    void close();
+
+public:
+    MappedFile(std::filesystem::path path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // False if the file could not be opened or is empty
+    bool IsOpen();
+    const unsigned char *Data();
+    size_t Size();
+};
@@ -0,0 +1,299 @@
+#include "Materials.hpp"
+#include "Profiler.hpp"
+#include "UploadRing.hpp"
+#include "GlCapture.hpp"
+#include "Memory.hpp"
+#include "Log.hpp"
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Streamed arrays start out at the level where they are at most this big
+    const unsigned int STREAM_START_SIZE = 64;
+}
+
+MaterialTable::MaterialTable(TextureCache &t, bool useBindless, size_t textureBudget, size_t uploadBytes)
+    : textures(t), budget(textureBudget), uploadBytesPerFrame(uploadBytes), frame(1) {
+    bindless = useBindless && BindlessSupported();
+}
+
+bool MaterialTable::BindlessSupported() { return GLEW_ARB_bindless_texture != 0; }
+
+// Finds the array for the texture, or starts a new one
+bool MaterialTable::place(TextureData *texture, glm::uvec2 &arrayLayer) {
+    auto it = placement.find(texture);
+    if (it != placement.end()) {
+        arrayLayer = it->second;
+        return true;
+    }
+
+    DdsTexture &dds = texture->dds;
+    unsigned int levelCount = (unsigned int)dds.levels.size();
+    size_t a = 0;
+    while (a < arrays.size() && !(arrays[a].format == dds.format && arrays[a].width == dds.width && arrays[a].height == dds.height && arrays[a].levelCount == levelCount)) { a++; }
+    if (a == arrays.size()) {
+        if (!bindless && arrays.size() == MAX_TEXTURE_ARRAYS) {
+            char detail[96];
+            std::snprintf(detail, sizeof(detail), "more than %d texture sizes need bindless textures", MAX_TEXTURE_ARRAYS);
+            Log::Message(LogSeverity::Medium, "Drawing the rest untextured, ", detail);
+            return false;
+        }
+        arrays.push_back({ dds.format, dds.width, dds.height, levelCount, {}, 0, GlTexture(), 0, 0, 0, 0 });
+    }
+    arrayLayer = glm::uvec2((unsigned int)a, (unsigned int)arrays[a].layers.size());
+    arrays[a].layers.push_back(texture);
+    placement[texture] = arrayLayer;
+    return true;
+}
+
+MaterialRef MaterialTable::Add(const Surface &surface, glm::vec3 color, std::string texture) {
+    MaterialData material;
+    material.color = glm::vec4(color, 1.0f);
+    material.surface = glm::vec4(surface.ka, surface.kd, surface.ks, (float)surface.alpha);
+    material.texture = glm::uvec4(NO_TEXTURE_ARRAY, 0, 0, 0);
+
+    TextureData *data = textures.Get(texture);
+    glm::uvec2 arrayLayer;
+    if (data && place(data, arrayLayer)) {
+        material.texture.x = arrayLayer.x;
+        material.texture.y = arrayLayer.y;
+    }
+    materials.push_back(material);
+    pending.push_back(false);
+    return Ref((unsigned int)materials.size() - 1);
+}
+
+MaterialRef MaterialTable::AddDeferred(const Surface &surface, glm::vec3 color, std::string texture) {
+    MaterialRef material = Add(surface, color, "");
+    if (!texture.empty()) {
+        deferred.push_back({ material.index, texture, nullptr });
+        pending[material.index] = true;
+    }
+    return Ref(material.index);
+}
+
+void MaterialTable::LoadDeferred() {
+    PROFILE_ZONE("load deferred textures");
+    for (DeferredTexture &d : deferred) { d.data = textures.Get(d.name); }
+}
+
+void MaterialTable::UploadDeferred() {
+    PROFILE_ZONE("upload deferred textures");
+    for (DeferredTexture &d : deferred) {
+        MaterialData &material = materials[d.material];
+        glm::uvec2 arrayLayer;
+        if (d.data && place(d.data, arrayLayer)) {
+            material.texture.x = arrayLayer.x;
+            material.texture.y = arrayLayer.y;
+        }
+        pending[d.material] = false;
+    }
+    deferred.clear();
+
+    allocateNew();
+    writeHandles();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, materials.size() * sizeof(MaterialData), materials.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    dropTextureData();
+}
+
+MaterialRef MaterialTable::Ref(unsigned int index) {
+    return { index, materials[index].texture.x != NO_TEXTURE_ARRAY, pending[index] };
+}
+
+bool MaterialTable::streamable(const TextureArray &array) { return budget > 0 && array.levelCount > 1; }
+
+unsigned int MaterialTable::chainLength(const TextureArray &array) {
+    // Files without a mip chain get one generated, like single textures did
+    if (array.levelCount > 1) { return array.levelCount; }
+    unsigned int levels = 1;
+    for (unsigned int size = (std::max)(array.width, array.height); size > 1; size /= 2) { levels++; }
+    return levels;
+}
+
+size_t MaterialTable::bytesFrom(const TextureArray &array, unsigned int level) {
+    size_t bytes = 0;
+    for (unsigned int l = level; l < chainLength(array); l++) {
+        bytes += ddsLevelSize(array.format, (std::max)(1u, array.width >> l), (std::max)(1u, array.height >> l));
+    }
+    return bytes * array.layerCount;
+}
+
+void MaterialTable::allocate(TextureArray &array, unsigned int level) {
+    if (array.texture.ID()) {
+        retired.push_back({ std::move(array.texture), array.handle, frame });
+        array.handle = 0;
+    }
+
+    bool generateMips = array.levelCount == 1;
+    unsigned int levels = chainLength(array) - level;
+    array.residentLevel = level;
+    array.texture = GlTexture::Create();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture.ID());
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, array.format, (std::max)(1u, array.width >> level), (std::max)(1u, array.height >> level), (GLsizei)array.layerCount);
+    for (size_t layer = 0; layer < array.layers.size(); layer++) {
+        DdsTexture &dds = array.layers[layer]->dds;
+        for (size_t l = level; l < dds.levels.size(); l++) {
+            DdsLevel &d = dds.levels[l];
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)(l - level), 0, 0, (GLint)layer, d.width, d.height, 1, array.format, d.size, d.data);
+        }
+    }
+    if (generateMips) { glGenerateMipmap(GL_TEXTURE_2D_ARRAY); }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // The sampler state is baked into the handle, so it has to be set before
+    if (bindless) {
+        array.handle = glGetTextureHandleARB(array.texture.ID());
+        glMakeTextureHandleResidentARB(array.handle);
+    }
+}
+
+void MaterialTable::allocateNew() {
+    // Every array can be replaced once a frame, and lives on for UPLOAD_RING_FRAMES.
+    // Reserved here so streaming does not allocate in the frames.
+    retired.reserve(arrays.size() * (UPLOAD_RING_FRAMES + 1));
+    for (TextureArray &array : arrays) {
+        if (array.texture.ID() && array.layerCount == array.layers.size()) { continue; }
+        bool reallocate = array.texture.ID() != 0;
+        array.layerCount = (unsigned int)array.layers.size();
+        unsigned int level = 0;
+        if (reallocate) {
+            level = array.residentLevel;
+        } else if (streamable(array)) {
+            while (level + 1 < array.levelCount && (std::max)(array.width >> level, array.height >> level) > STREAM_START_SIZE) { level++; }
+        }
+        allocate(array, level);
+    }
+}
+
+void MaterialTable::writeHandles() {
+    if (!bindless) { return; }
+    for (MaterialData &material : materials) {
+        if (material.texture.x == NO_TEXTURE_ARRAY) { continue; }
+        GLuint64 handle = arrays[material.texture.x].handle;
+        material.texture.z = (unsigned int)(handle & 0xFFFFFFFFu);
+        material.texture.w = (unsigned int)(handle >> 32);
+    }
+}
+
+void MaterialTable::dropTextureData() {
+    // Streaming uploads the levels again later, so it keeps the texture data.
+    // Arrays still waiting for deferred layers need theirs to be reallocated.
+    if (budget > 0 || !deferred.empty()) { return; }
+    placement.clear();
+    for (TextureArray &array : arrays) { array.layers.clear(); }
+    textures.Clear();
+}
+
+void MaterialTable::Upload() {
+    PROFILE_ZONE("upload materials");
+    allocateNew();
+    writeHandles();
+
+    // An empty buffer can not be bound, so there is always at least one material
+    if (materials.empty()) { Add({ 0.0f, 0.0f, 0.0f, 1 }, glm::vec3(0.0f), ""); }
+    buffer = GlBuffer::Create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(MaterialData), materials.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    dropTextureData();
+}
+
+void MaterialTable::Request(MaterialRef material, float uvPerPixel) {
+    if (budget == 0 || !material.textured || uvPerPixel < 0.0f) { return; }
+    TextureArray &array = arrays[materials[material.index].texture.x];
+    float texelsPerPixel = uvPerPixel * (float)(std::max)(array.width, array.height);
+    unsigned int level = texelsPerPixel > 1.0f ? (unsigned int)std::log2(texelsPerPixel) : 0;
+    level = (std::min)(level, array.levelCount - 1);
+    array.wantedLevel = array.lastUsed == frame ? (std::min)(array.wantedLevel, level) : level;
+    array.lastUsed = frame;
+}
+
+void MaterialTable::Stream() {
+    if (budget == 0) { return; }
+    PROFILE_ZONE("texture residency");
+
+    // The GPU is done with textures replaced that many frames ago
+    auto done = [&](RetiredTexture &texture) { return frame - texture.frame >= UPLOAD_RING_FRAMES; };
+    for (RetiredTexture &texture : retired) {
+        if (done(texture) && bindless) { glMakeTextureHandleNonResidentARB(texture.handle); }
+    }
+    retired.erase(std::remove_if(retired.begin(), retired.end(), done), retired.end());
+
+    // Requested arrays get at least the detail they asked for. Nothing loses detail until the budget runs out.
+    std::pmr::vector<unsigned int> target(arrays.size(), &Memory::Frame());
+    size_t total = 0;
+    for (size_t i = 0; i < arrays.size(); i++) {
+        TextureArray &array = arrays[i];
+        target[i] = array.residentLevel;
+        if (streamable(array) && array.lastUsed == frame) { target[i] = (std::min)(array.wantedLevel, array.residentLevel); }
+        total += bytesFrom(array, target[i]);
+    }
+    // Then the least recently used arrays, the biggest first, give up their most detailed level
+    while (total > budget) {
+        size_t victim = arrays.size();
+        for (size_t i = 0; i < arrays.size(); i++) {
+            if (!streamable(arrays[i]) || target[i] + 1 >= arrays[i].levelCount) { continue; }
+            if (victim == arrays.size() || arrays[i].lastUsed < arrays[victim].lastUsed ||
+                (arrays[i].lastUsed == arrays[victim].lastUsed && bytesFrom(arrays[i], target[i]) > bytesFrom(arrays[victim], target[victim]))) {
+                victim = i;
+            }
+        }
+        if (victim == arrays.size()) { break; }
+        total -= bytesFrom(arrays[victim], target[victim]);
+        target[victim]++;
+        total += bytesFrom(arrays[victim], target[victim]);
+    }
+
+    // Evictions first, as they free memory, then the arrays that gain detail while there is upload budget left
+    size_t uploaded = 0;
+    bool changed = false;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < arrays.size(); i++) {
+            TextureArray &array = arrays[i];
+            bool evict = target[i] > array.residentLevel;
+            if (target[i] == array.residentLevel || evict != (pass == 0)) { continue; }
+            size_t bytes = bytesFrom(array, target[i]);
+            if (uploaded > 0 && uploaded + bytes > uploadBytesPerFrame) { continue; }
+            allocate(array, target[i]);
+            uploaded += bytes;
+            changed = true;
+        }
+    }
+
+    // New textures have new handles
+    if (changed && bindless) {
+        writeHandles();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, materials.size() * sizeof(MaterialData), materials.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    frame++;
+}
+
+void MaterialTable::Bind() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_STORAGE_BINDING, buffer.ID());
+    if (bindless) { return; }
+    for (size_t i = 0; i < arrays.size(); i++) {
+        glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[i].texture.ID());
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+bool MaterialTable::Bindless() { return bindless; }
+size_t MaterialTable::Count() { return materials.size(); }
+size_t MaterialTable::ArrayCount() { return arrays.size(); }
+bool MaterialTable::Streaming() { return budget > 0; }
+
+void MaterialTable::ReportMemory(MemoryReport &report) {
+    for (TextureArray &array : arrays) {
+        report.Add("texture array", sizeof(TextureArray) + array.layers.capacity() * sizeof(TextureData*), bytesFrom(array, array.residentLevel));
+    }
+    size_t materialBytes = materials.size() * sizeof(MaterialData);
+    report.Add("materials", materials.capacity() * sizeof(MaterialData), buffer.ID() ? materialBytes : 0);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <GL\glew.h>
+#include "glm\matrix.hpp"
+#include "Uniforms.hpp"
+#include "Textures.hpp"
+#include "GlHandle.hpp"
+#include "MemoryReport.hpp"
+#include "Shapes\Shape.hpp"
+
+// Every material of the scene in one shader storage buffer, so shapes only pass an index.
+// Textures of the same format, size and mip count share a GL_TEXTURE_2D_ARRAY, one layer each.
+// With ARB_bindless_texture the material holds the handle of its array. Without it the arrays
+// are bound to units 0 to MAX_TEXTURE_ARRAYS - 1 and the material holds the unit.
+// Either way the whole scene draws without binding a texture per object.
+//
+// With a texture budget the arrays are streamed: each only holds the levels from its resident
+// level down. Shapes request the level their size on screen needs (see Request), and Stream
+// reallocates arrays whose resident level should change, uploading the levels again from the
+// loaded DDS files. Over the budget, the arrays that were requested least recently lose their
+// most detailed levels first. An array is shared by all its layers, so it is as detailed as the
+// most demanding of them. Arrays without a mip chain in their files are always fully resident.
+class MaterialTable {
+private:
+    struct TextureArray {
+        GLenum format;
+        unsigned int width, height, levelCount;
+        std::vector<TextureData*> layers;
+        unsigned int layerCount;
+        GlTexture texture;
+        GLuint64 handle;
+        unsigned int residentLevel;  // the most detailed level in the texture
+        unsigned int wantedLevel;    // the most detailed level requested in the current frame
+        unsigned long long lastUsed; // frame of the last request, 0 if there was none
+    };
+    // A texture AddDeferred left to LoadDeferred
+    struct DeferredTexture {
+        unsigned int material;
+        std::string name;
+        TextureData *data;
+    };
+    // Replaced textures live on until the GPU is done with the frames that used them
+    struct RetiredTexture {
+        GlTexture texture;
+        GLuint64 handle;
+        unsigned long long frame;
+    };
+
+    TextureCache &textures;
+    std::vector<MaterialData> materials;
+    std::vector<bool> pending; // per material, whether its texture is deferred and not uploaded yet
+    std::vector<DeferredTexture> deferred;
+    std::vector<TextureArray> arrays;
+    std::unordered_map<TextureData*, glm::uvec2> placement; // array and layer of each texture
+    GlBuffer buffer;
+    bool bindless;
+    size_t budget;
+    size_t uploadBytesPerFrame;
+    unsigned long long frame;
+    std::vector<RetiredTexture> retired;
+    bool place(TextureData *texture, glm::uvec2 &arrayLayer);
+    bool streamable(const TextureArray &array);
+    // Levels of the full chain, including the ones glGenerateMipmap makes
+    unsigned int chainLength(const TextureArray &array);
+    size_t bytesFrom(const TextureArray &array, unsigned int level);
+    // Creates the texture with the levels from level on, retiring the current one
+    void allocate(TextureArray &array, unsigned int level);
+    // Allocates the arrays that gained layers since their last allocation
+    void allocateNew();
+    // Puts the handles of the arrays into the materials, if they are bindless
+    void writeHandles();
+    // Without streaming the texture data is not needed once it is uploaded
+    void dropTextureData();
+
+public:
+    // Bindless textures are only used if asked for and supported.
+    // A textureBudget of 0 keeps every level of every array resident and drops the texture data after the upload.
+    MaterialTable(TextureCache &textures, bool useBindless, size_t textureBudget = 0, size_t uploadBytesPerFrame = 0);
+    MaterialTable(const MaterialTable &) = delete;
+    MaterialTable &operator=(const MaterialTable &) = delete;
+
+    static bool BindlessSupported();
+    // Loads the texture (none if empty) and returns the new material
+    MaterialRef Add(const Surface &surface, glm::vec3 color, std::string texture);
+    // Adds the material untextured, its texture only comes with LoadDeferred and UploadDeferred.
+    // The returned ref is a placeholder until then, Ref gives the final one.
+    MaterialRef AddDeferred(const Surface &surface, glm::vec3 color, std::string texture);
+    // Loads the deferred textures. Runs on any thread, which owns the TextureCache until it returns.
+    void LoadDeferred();
+    // After Upload and LoadDeferred: places the deferred textures and uploads the arrays they went into
+    void UploadDeferred();
+    MaterialRef Ref(unsigned int index);
+    // Creates the texture arrays and the material buffer. Without streaming it then drops the
+    // loaded texture data, with it the arrays start out at their 64x64 level.
+    // Materials added afterwards are not uploaded.
+    void Upload();
+    // Asks for the material's texture to be detailed enough for uvPerPixel, the change of
+    // texture coordinates from one pixel to the next where the shape is closest to the camera.
+    // Negative values, for shapes out of view, are no request.
+    void Request(MaterialRef material, float uvPerPixel);
+    // Once per frame after the requests: moves resident levels towards the requested ones,
+    // within the budget and uploading at most uploadBytesPerFrame unless a single array needs more
+    void Stream();
+    bool Streaming();
+    // Binds the material buffer, and the texture arrays unless they are bindless
+    void Bind();
+    bool Bindless();
+    size_t Count();
+    size_t ArrayCount();
+    // Adds the arrays as "texture array" and the material buffer as "materials"
+    void ReportMemory(MemoryReport &report);
+};
@@ -0,0 +1,176 @@
+#include "Memory.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+    // Initial block sizes, both grow to what they turn out to need
+    const size_t FRAME_ARENA_SIZE = 64 << 10;
+    const size_t SCRATCH_ARENA_SIZE = 1 << 20;
+
+    // Chunk headers take this much, so the memory after them is aligned for anything
+    const size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    // Offset from base + used that is aligned
+    size_t alignedOffset(unsigned char *base, size_t used, size_t alignment) {
+        uintptr_t at = (uintptr_t)base + used;
+        return (size_t)(((at + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (uintptr_t)base);
+    }
+}
+
+LinearArena::LinearArena(size_t size, std::pmr::memory_resource *up)
+    : upstream(up), block(nullptr), capacity(size), chunks(nullptr), used(0), inUse(0), highWater(0), upstreamAllocations(0) {
+    if (capacity > 0) { block = (unsigned char*)upstream->allocate(capacity, alignof(std::max_align_t)); }
+    current = block;
+    currentSize = capacity;
+}
+
+LinearArena::~LinearArena() {
+    freeChunks(nullptr);
+    if (block) { upstream->deallocate(block, capacity, alignof(std::max_align_t)); }
+}
+
+void LinearArena::freeChunks(Chunk *until) {
+    while (chunks != until) {
+        Chunk *next = chunks->next;
+        upstream->deallocate(chunks, HEADER_SIZE + chunks->size, alignof(std::max_align_t));
+        chunks = next;
+    }
+}
+
+void *LinearArena::do_allocate(size_t bytes, size_t alignment) {
+    size_t start = current ? alignedOffset(current, used, alignment) : 0;
+    if (!current || start + bytes > currentSize) {
+        // At least as big as the block, so a run of small allocations does not take a chunk each
+        size_t size = (std::max)(capacity, bytes + alignment);
+        Chunk *chunk = (Chunk*)upstream->allocate(HEADER_SIZE + size, alignof(std::max_align_t));
+        chunk->next = chunks;
+        chunk->size = size;
+        chunks = chunk;
+        current = (unsigned char*)chunk + HEADER_SIZE;
+        currentSize = size;
+        used = 0;
+        upstreamAllocations++;
+        start = alignedOffset(current, 0, alignment);
+    }
+    inUse += start + bytes - used;
+    highWater = (std::max)(highWater, inUse);
+    used = start + bytes;
+    return current + start;
+}
+
+void LinearArena::do_deallocate(void *, size_t, size_t) { }
+
+bool LinearArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept { return this == &other; }
+
+void LinearArena::Reset() {
+    freeChunks(nullptr);
+    if (highWater > capacity) {
+        if (block) { upstream->deallocate(block, capacity, alignof(std::max_align_t)); }
+        capacity = highWater;
+        block = (unsigned char*)upstream->allocate(capacity, alignof(std::max_align_t));
+        upstreamAllocations++;
+    }
+    current = block;
+    currentSize = capacity;
+    used = 0;
+    inUse = 0;
+}
+
+LinearArena::Mark LinearArena::GetMark() { return { chunks, used, inUse }; }
+
+void LinearArena::Rewind(Mark mark) {
+    // Back to empty is a reset, which also grows the block
+    if (mark.inUse == 0) {
+        Reset();
+        return;
+    }
+    freeChunks(mark.chunks);
+    current = chunks ? (unsigned char*)chunks + HEADER_SIZE : block;
+    currentSize = chunks ? chunks->size : capacity;
+    used = mark.used;
+    inUse = mark.inUse;
+}
+
+size_t LinearArena::Capacity() { return capacity; }
+size_t LinearArena::HighWater() { return highWater; }
+size_t LinearArena::UpstreamAllocations() { return upstreamAllocations; }
+
+void LinearArena::ReportMemory(MemoryReport &report, const char *kind) {
+    size_t bytes = capacity;
+    for (Chunk *chunk = chunks; chunk; chunk = chunk->next) { bytes += HEADER_SIZE + chunk->size; }
+    report.Add(kind, bytes, 0);
+}
+
+FixedPool::FixedPool(size_t size, size_t count, std::pmr::memory_resource *up)
+    : upstream(up), blocksPerChunk((std::max)(count, (size_t)1)), freeList(nullptr), chunks(nullptr), chunkCount(0), live(0) {
+    // Every block is aligned for anything and can hold the free list link
+    size_t alignment = alignof(std::max_align_t);
+    blockSize = ((std::max)(size, sizeof(FreeBlock)) + alignment - 1) / alignment * alignment;
+}
+
+FixedPool::~FixedPool() {
+    while (chunks) {
+        Chunk *next = chunks->next;
+        upstream->deallocate(chunks, HEADER_SIZE + blockSize * blocksPerChunk, alignof(std::max_align_t));
+        chunks = next;
+    }
+}
+
+void *FixedPool::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes > blockSize || alignment > alignof(std::max_align_t)) { return upstream->allocate(bytes, alignment); }
+    if (!freeList) {
+        Chunk *chunk = (Chunk*)upstream->allocate(HEADER_SIZE + blockSize * blocksPerChunk, alignof(std::max_align_t));
+        chunk->next = chunks;
+        chunks = chunk;
+        chunkCount++;
+        // Threaded backwards, so blocks are handed out in address order
+        unsigned char *first = (unsigned char*)chunk + HEADER_SIZE;
+        for (size_t i = blocksPerChunk; i-- > 0;) {
+            FreeBlock *free = (FreeBlock*)(first + i * blockSize);
+            free->next = freeList;
+            freeList = free;
+        }
+    }
+    FreeBlock *result = freeList;
+    freeList = result->next;
+    live++;
+    return result;
+}
+
+void FixedPool::do_deallocate(void *p, size_t bytes, size_t alignment) {
+    if (bytes > blockSize || alignment > alignof(std::max_align_t)) {
+        upstream->deallocate(p, bytes, alignment);
+        return;
+    }
+    FreeBlock *free = (FreeBlock*)p;
+    free->next = freeList;
+    freeList = free;
+    live--;
+}
+
+bool FixedPool::do_is_equal(const std::pmr::memory_resource &other) const noexcept { return this == &other; }
+
+size_t FixedPool::Live() { return live; }
+
+void FixedPool::ReportMemory(MemoryReport &report, const char *kind) {
+    report.Add(kind, chunkCount * (HEADER_SIZE + blockSize * blocksPerChunk), 0);
+}
+
+namespace Memory {
+    LinearArena &Frame() {
+        static LinearArena arena(FRAME_ARENA_SIZE);
+        return arena;
+    }
+
+    LinearArena &Scratch() {
+        static LinearArena arena(SCRATCH_ARENA_SIZE);
+        return arena;
+    }
+
+    void BeginFrame() { Frame().Reset(); }
+
+    void ReportMemory(MemoryReport &report) {
+        Frame().ReportMemory(report, "frame arena");
+        Scratch().ReportMemory(report, "scratch arena");
+    }
+}
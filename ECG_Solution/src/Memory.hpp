@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include "MemoryReport.hpp"
+
+// Allocating bumps a pointer through one block, freeing does nothing: Reset frees everything at
+// once, Rewind everything allocated since a Mark. What does not fit in the block goes to the
+// upstream resource in extra chunks. The next Reset grows the block to the most that was ever in
+// use, so work that repeats itself, like a frame, stops allocating after its first run.
+// Not thread safe, each arena belongs to one thread.
+class LinearArena : public std::pmr::memory_resource {
+private:
+    // Header of a chunk from upstream, the memory follows it
+    struct Chunk {
+        Chunk *next;
+        size_t size;
+    };
+
+    std::pmr::memory_resource *upstream;
+    unsigned char *block;
+    size_t capacity;
+    Chunk *chunks;         // the newest first
+    unsigned char *current; // the block or the newest chunk
+    size_t currentSize;
+    size_t used;           // of current
+    size_t inUse;          // handed out from the block and every chunk
+    size_t highWater;
+    size_t upstreamAllocations;
+    void freeChunks(Chunk *until);
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+public:
+    struct Mark {
+        Chunk *chunks;
+        size_t used;
+        size_t inUse;
+    };
+
+    LinearArena(size_t capacity, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+    LinearArena(const LinearArena &) = delete;
+    LinearArena &operator=(const LinearArena &) = delete;
+    ~LinearArena();
+
+    void Reset();
+    Mark GetMark();
+    // Frees everything allocated since the mark. Marks nest like a stack.
+    void Rewind(Mark mark);
+    size_t Capacity();
+    size_t HighWater();
+    // Chunks and block growths, since the arena was created
+    size_t UpstreamAllocations();
+    // Adds the block and the chunks as kind
+    void ReportMemory(MemoryReport &report, const char *kind);
+};
+
+// Frees everything allocated from the arena while it is in scope
+struct ArenaScope {
+private:
+    LinearArena &arena;
+    LinearArena::Mark mark;
+
+public:
+    ArenaScope(LinearArena &a) : arena(a), mark(a.GetMark()) { }
+    ~ArenaScope() { arena.Rewind(mark); }
+};
+
+// Blocks of one size, carved out of chunks of blocksPerChunk. Freed blocks go on a free list and are
+// handed out again, so the pool stops allocating once it has been as full as it gets. Bigger or
+// more aligned requests go to the upstream resource. Chunks are only given back with the pool.
+// Not thread safe.
+class FixedPool : public std::pmr::memory_resource {
+private:
+    struct FreeBlock { FreeBlock *next; };
+    struct Chunk { Chunk *next; };
+
+    std::pmr::memory_resource *upstream;
+    size_t blockSize;
+    size_t blocksPerChunk;
+    FreeBlock *freeList;
+    Chunk *chunks;
+    size_t chunkCount;
+    size_t live;
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+public:
+    FixedPool(size_t blockSize, size_t blocksPerChunk, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+    FixedPool(const FixedPool &) = delete;
+    FixedPool &operator=(const FixedPool &) = delete;
+    ~FixedPool();
+
+    // Blocks handed out and not freed yet
+    size_t Live();
+    // Adds the chunks as kind
+    void ReportMemory(MemoryReport &report, const char *kind);
+};
+
+// The arenas of the render thread
+namespace Memory {
+    // Transient data of the current frame, freed when the next one begins
+    LinearArena &Frame();
+    // Temporaries of loading and generating, freed by an ArenaScope around their use
+    LinearArena &Scratch();
+    // At the start of every frame
+    void BeginFrame();
+    // Adds the frame arena as "frame arena" and the scratch arena as "scratch arena"
+    void ReportMemory(MemoryReport &report);
+}
@@ -0,0 +1,37 @@
+#include "MemoryReport.hpp"
+#include <iomanip>
+
+void MemoryReport::Add(std::string resource, size_t cpuBytes, size_t gpuBytes) {
+    for (Entry &entry : entries) {
+        if (entry.resource == resource) {
+            entry.count++;
+            entry.cpuBytes += cpuBytes;
+            entry.gpuBytes += gpuBytes;
+            return;
+        }
+    }
+    entries.push_back({ resource, 1, cpuBytes, gpuBytes });
+}
+
+size_t MemoryReport::CpuBytes() {
+    size_t bytes = 0;
+    for (Entry &entry : entries) { bytes += entry.cpuBytes; }
+    return bytes;
+}
+
+size_t MemoryReport::GpuBytes() {
+    size_t bytes = 0;
+    for (Entry &entry : entries) { bytes += entry.gpuBytes; }
+    return bytes;
+}
+
+void MemoryReport::Print(std::ostream &out) {
+    const double KB = 1024.0;
+    out << "Memory (count / CPU KB / GPU KB)" << std::endl;
+    for (Entry &entry : entries) {
+        out << "  " << std::left << std::setw(16) << entry.resource << std::right << std::fixed << std::setprecision(1)
+            << std::setw(8) << entry.count << std::setw(12) << entry.cpuBytes / KB << std::setw(12) << entry.gpuBytes / KB << std::endl;
+    }
+    out << "  " << std::left << std::setw(24) << "total" << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << CpuBytes() / KB << std::setw(12) << GpuBytes() / KB << std::endl;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+// What each kind of resource holds in system memory and in GPU memory.
+// GPU bytes are what was handed to the driver, which may pad or compress it.
+class MemoryReport {
+private:
+    struct Entry {
+        std::string resource;
+        size_t count;
+        size_t cpuBytes;
+        size_t gpuBytes;
+    };
+    std::vector<Entry> entries; // in the order the resources were first added
+
+public:
+    // Counts one more of the resource
+    void Add(std::string resource, size_t cpuBytes, size_t gpuBytes);
+    size_t CpuBytes();
+    size_t GpuBytes();
+    void Print(std::ostream &out);
+};
@@ -0,0 +1,158 @@
+#include "MeshFile.hpp"
+#include "Profiler.hpp"
+#include "Log.hpp"
+#include <fstream>
+#include <cstring>
+
+namespace {
+    uint64_t alignUp(uint64_t offset) {
+        return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    }
+
+    // Neighbouring triangles share vertices, so the differences between indices are small
+    void encodeIndices(const uint32_t *indices, uint32_t count, std::vector<unsigned char> &out) {
+        uint32_t previous = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            int32_t delta = (int32_t)(indices[i] - previous);
+            uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+            while (zigzag >= 0x80) {
+                out.push_back((unsigned char)(zigzag | 0x80));
+                zigzag >>= 7;
+            }
+            out.push_back((unsigned char)zigzag);
+            previous = indices[i];
+        }
+    }
+
+    bool decodeIndices(const unsigned char *data, uint64_t size, uint32_t count, uint32_t *out) {
+        const unsigned char *end = data + size;
+        uint32_t previous = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t zigzag = 0;
+            for (int shift = 0; ; shift += 7) {
+                if (data == end || shift > 28) { return false; }
+                unsigned char byte = *data++;
+                zigzag |= (uint32_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) { break; }
+            }
+            int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            previous += (uint32_t)delta;
+            out[i] = previous;
+        }
+        return true;
+    }
+}
+
+bool writeMeshFile(std::filesystem::path path, const float *vertices, uint32_t vertexCount, uint32_t floatsPerVertex,
+                   const uint32_t *indices, uint32_t indexCount, const std::vector<MeshFileLod> &lods, bool compressIndices) {
+    MeshFileHeader header = {};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.flags = compressIndices ? MESH_FILE_COMPRESSED_INDICES : 0;
+    header.vertexStride = floatsPerVertex * sizeof(float);
+    header.vertexCount = vertexCount;
+    header.indexCount = indexCount;
+    header.lodCount = (uint32_t)lods.size();
+
+    // The position is always the first three floats of a vertex
+    for (int axis = 0; axis < 3; axis++) {
+        header.boundsMin[axis] = vertexCount ? vertices[axis] : 0.0f;
+        header.boundsMax[axis] = vertexCount ? vertices[axis] : 0.0f;
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float value = vertices[v * floatsPerVertex + axis];
+            if (value < header.boundsMin[axis]) { header.boundsMin[axis] = value; }
+            if (value > header.boundsMax[axis]) { header.boundsMax[axis] = value; }
+        }
+    }
+
+    std::vector<unsigned char> encoded;
+    if (compressIndices) {
+        encoded.reserve(indexCount * 2);
+        encodeIndices(indices, indexCount, encoded);
+    }
+
+    header.lodOffset = alignUp(sizeof(MeshFileHeader));
+    header.vertexOffset = alignUp(header.lodOffset + lods.size() * sizeof(MeshFileLod));
+    header.indexOffset = alignUp(header.vertexOffset + (uint64_t)vertexCount * header.vertexStride);
+    header.indexBytes = compressIndices ? encoded.size() : (uint64_t)indexCount * sizeof(uint32_t);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) { return false; }
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    auto padTo = [&](uint64_t offset) { out.write(padding, (std::streamsize)(offset - (uint64_t)out.tellp())); };
+
+    out.write((const char*)&header, sizeof(header));
+    padTo(header.lodOffset);
+    out.write((const char*)lods.data(), lods.size() * sizeof(MeshFileLod));
+    padTo(header.vertexOffset);
+    out.write((const char*)vertices, (std::streamsize)vertexCount * header.vertexStride);
+    padTo(header.indexOffset);
+    if (compressIndices) { out.write((const char*)encoded.data(), encoded.size()); }
+    else { out.write((const char*)indices, (std::streamsize)indexCount * sizeof(uint32_t)); }
+    return (bool)out;
+}
+
+MeshFile::MeshFile(VfsFile &&f, std::string_view path) : file(std::move(f)), header(nullptr), valid(false) {
+    PROFILE_ZONE("map mesh");
+    if (!file.IsOpen()) { return; }
+
+    uint64_t size = file.Size();
+    if (size < sizeof(MeshFileHeader)) {
+        Log::Message(LogSeverity::Medium, "Mesh is cut short: ", std::string(path).c_str());
+        return;
+    }
+    header = (const MeshFileHeader*)file.Data();
+    if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION) {
+        Log::Message(LogSeverity::Medium, "Mesh is not of the current version, bake it again: ", std::string(path).c_str());
+        return;
+    }
+    if (header->lodOffset + (uint64_t)header->lodCount * sizeof(MeshFileLod) > size
+        || header->vertexOffset + (uint64_t)header->vertexCount * header->vertexStride > size
+        || header->indexOffset + header->indexBytes > size
+        || header->lodCount == 0) {
+        Log::Message(LogSeverity::Medium, "Mesh is cut short: ", std::string(path).c_str());
+        return;
+    }
+    for (uint32_t i = 0; i < header->lodCount; i++) {
+        const MeshFileLod &lod = Lods()[i];
+        if ((uint64_t)lod.firstIndex + lod.indexCount > header->indexCount
+            || (uint64_t)lod.firstVertex + lod.vertexCount > header->vertexCount) {
+            Log::Message(LogSeverity::Medium, "Mesh has an invalid level of detail: ", std::string(path).c_str());
+            return;
+        }
+    }
+
+    if (header->flags & MESH_FILE_COMPRESSED_INDICES) {
+        PROFILE_ZONE("decode indices");
+        decoded.resize(header->indexCount);
+        if (!decodeIndices(file.Data() + header->indexOffset, header->indexBytes, header->indexCount, decoded.data())) {
+            Log::Message(LogSeverity::Medium, "Mesh has corrupt indices: ", std::string(path).c_str());
+            return;
+        }
+    }
+    else if (header->indexBytes < (uint64_t)header->indexCount * sizeof(uint32_t)) {
+        Log::Message(LogSeverity::Medium, "Mesh is cut short: ", std::string(path).c_str());
+        return;
+    }
+    // The indices go to the GPU as they are, so none may point past the vertices
+    const uint32_t *indices = Indices();
+    for (uint32_t i = 0; i < header->indexCount; i++) {
+        if (indices[i] >= header->vertexCount) {
+            Log::Message(LogSeverity::Medium, "Mesh has an index past its vertices: ", std::string(path).c_str());
+            return;
+        }
+    }
+    valid = true;
+}
+
+bool MeshFile::IsValid() { return valid; }
+const MeshFileHeader &MeshFile::Header() { return *header; }
+const MeshFileLod *MeshFile::Lods() { return (const MeshFileLod*)(file.Data() + header->lodOffset); }
+const void *MeshFile::Vertices() { return file.Data() + header->vertexOffset; }
+
+const uint32_t *MeshFile::Indices() {
+    if (header->flags & MESH_FILE_COMPRESSED_INDICES) { return decoded.data(); }
+    return (const uint32_t*)(file.Data() + header->indexOffset);
+}
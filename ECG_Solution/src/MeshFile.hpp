@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+#include "Vfs.hpp"
+
+// Baked meshes (.mesh), written offline by the MeshBaker and mapped into memory at runtime.
+//
+// Layout, every block aligned to MESH_FILE_ALIGNMENT:
+//   MeshFileHeader
+//   MeshFileLod[lodCount]
+//   vertex block: vertexCount * vertexStride bytes, ready to be uploaded as they are
+//   index block:  indexCount 32 bit indices, or indexBytes of varints if the indices are compressed
+//
+// All levels of detail share the vertex and index blocks. Their indices are absolute.
+#define MESH_FILE_MAGIC 0x4D474345u // "ECGM"
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGNMENT 16
+
+// The indices are stored as zigzag encoded differences to the previous index, as LEB128 varints
+#define MESH_FILE_COMPRESSED_INDICES (1u << 0)
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t vertexStride;  // bytes per vertex
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t reserved;
+    float boundsMin[4];     // w is unused
+    float boundsMax[4];
+    uint64_t lodOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+};
+
+// One level of detail, level 0 being the most detailed
+struct MeshFileLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+};
+
+// Writes a mesh file. Returns false if the file could not be written.
+bool writeMeshFile(std::filesystem::path path, const float *vertices, uint32_t vertexCount, uint32_t floatsPerVertex,
+                   const uint32_t *indices, uint32_t indexCount, const std::vector<MeshFileLod> &lods, bool compressIndices);
+
+// A mesh file mapped into memory. Vertices are read straight from the mapping.
+class MeshFile {
+private:
+    VfsFile file;
+    const MeshFileHeader *header;
+    std::vector<uint32_t> decoded;
+    bool valid;
+
+public:
+    MeshFile(VfsFile &&file, std::string_view name);
+    MeshFile(const MeshFile &) = delete;
+    MeshFile &operator=(const MeshFile &) = delete;
+
+    // False if the file is missing, from another version or cut short
+    bool IsValid();
+    const MeshFileHeader &Header();
+    const MeshFileLod *Lods();
+    const void *Vertices();
+    // Points into the mapping, or at the decoded indices if they are compressed
+    const uint32_t *Indices();
+};
@@ -0,0 +1,521 @@
+#include "MeshImport.hpp"
+#include "Json.hpp"
+#include "Profiler.hpp"
+#include "glm\glm.hpp"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    // Below this many bytes per chunk a thread costs more than it saves
+    const size_t OBJ_MIN_CHUNK = 1 << 20;
+    const int MISSING = INT_MIN;
+
+    /* --------------------------------------------- */
+    // Number parsing
+    /* --------------------------------------------- */
+
+    const char *skipSpace(const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\t')) { p++; }
+        return p;
+    }
+
+    // Returns the end of the number, nullptr if there is none
+    const char *parseFloat(const char *p, const char *end, float &out) {
+        p = skipSpace(p, end);
+        if (p < end && *p == '+') { p++; }
+#if defined(__cpp_lib_to_chars)
+        auto result = std::from_chars(p, end, out);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+        // Standard libraries without floating point from_chars
+        char buffer[64];
+        size_t length = 0;
+        while (p + length < end && length < sizeof(buffer) - 1 && p[length] != '\0' && std::strchr("+-0123456789.eEinfINFaA", p[length])) { length++; }
+        std::memcpy(buffer, p, length);
+        buffer[length] = '\0';
+        char *numberEnd;
+        out = std::strtof(buffer, &numberEnd);
+        return numberEnd == buffer ? nullptr : p + (numberEnd - buffer);
+#endif
+    }
+
+    const char *parseInt(const char *p, const char *end, int &out) {
+        auto result = std::from_chars(p, end, out);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    glm::vec3 faceNormal(const float *a, const float *b, const float *c) {
+        glm::vec3 pa(a[0], a[1], a[2]), pb(b[0], b[1], b[2]), pc(c[0], c[1], c[2]);
+        // Not normalized, so big faces weigh more
+        return glm::cross(pb - pa, pc - pa);
+    }
+
+    /* --------------------------------------------- */
+    // OBJ
+    /* --------------------------------------------- */
+
+    // One corner of a face as written in the file. Negative OBJ indices count back from the
+    // last element of the chunk and are resolved once the element counts of earlier chunks are known.
+    struct ObjCorner {
+        int index[3];          // position, texture coordinate, normal
+        unsigned char relative; // bit i is set if index[i] is relative to the start of the chunk
+    };
+
+    struct ObjChunk {
+        const char *begin;
+        const char *end;
+        std::vector<float> positions;
+        std::vector<float> texCoords;
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners; // three per triangle
+        std::string error;
+    };
+
+    // Parses "v", "v/t", "v//n" or "v/t/n"
+    const char *parseCorner(const char *p, const char *end, ObjChunk &chunk, ObjCorner &corner) {
+        size_t counts[3] = { chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3 };
+        corner.relative = 0;
+        for (int i = 0; i < 3; i++) {
+            corner.index[i] = MISSING;
+            if (i > 0) {
+                if (p == end || *p != '/') { continue; }
+                p++;
+                // "v//n" has no texture coordinate
+                if (i == 1 && p < end && *p == '/') { continue; }
+            }
+            int value;
+            p = parseInt(p, end, value);
+            if (!p || value == 0) { return nullptr; }
+            if (value > 0) {
+                corner.index[i] = value - 1;
+            }
+            else {
+                corner.index[i] = (int)counts[i] + value;
+                corner.relative |= 1 << i;
+            }
+        }
+        return p;
+    }
+
+    void parseObjChunk(ObjChunk &chunk) {
+        PROFILE_ZONE("parse obj chunk");
+        const char *p = chunk.begin;
+        const char *end = chunk.end;
+        std::vector<ObjCorner> polygon;
+
+        while (p < end && chunk.error.empty()) {
+            const char *lineEnd = (const char*)std::memchr(p, '\n', end - p);
+            if (!lineEnd) { lineEnd = end; }
+            const char *line = skipSpace(p, lineEnd);
+            p = lineEnd + 1;
+
+            bool ok = true;
+            if (lineEnd - line >= 2 && line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+                float x, y, z;
+                const char *q = line + 2;
+                ok = (q = parseFloat(q, lineEnd, x)) && (q = parseFloat(q, lineEnd, y)) && (q = parseFloat(q, lineEnd, z));
+                chunk.positions.insert(chunk.positions.end(), { x, y, z });
+            }
+            else if (lineEnd - line >= 3 && line[0] == 'v' && line[1] == 't' && (line[2] == ' ' || line[2] == '\t')) {
+                float u, v = 0.0f;
+                const char *q = parseFloat(line + 3, lineEnd, u);
+                ok = q != nullptr;
+                if (q) { parseFloat(q, lineEnd, v); }
+                // OBJ puts v = 0 at the bottom of the image, the DDS textures have their first row at v = 0
+                chunk.texCoords.insert(chunk.texCoords.end(), { u, 1.0f - v });
+            }
+            else if (lineEnd - line >= 3 && line[0] == 'v' && line[1] == 'n' && (line[2] == ' ' || line[2] == '\t')) {
+                float x, y, z;
+                const char *q = line + 3;
+                ok = (q = parseFloat(q, lineEnd, x)) && (q = parseFloat(q, lineEnd, y)) && (q = parseFloat(q, lineEnd, z));
+                chunk.normals.insert(chunk.normals.end(), { x, y, z });
+            }
+            else if (lineEnd - line >= 2 && line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+                polygon.clear();
+                const char *q = skipSpace(line + 2, lineEnd);
+                while (q < lineEnd && *q != '\r' && *q != '#') {
+                    ObjCorner corner;
+                    q = parseCorner(q, lineEnd, chunk, corner);
+                    if (!q) { ok = false; break; }
+                    polygon.push_back(corner);
+                    q = skipSpace(q, lineEnd);
+                }
+                ok = ok && polygon.size() >= 3;
+                // Polygons become triangle fans
+                for (size_t i = 2; ok && i < polygon.size(); i++) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            }
+            // Everything else (groups, materials, smoothing, lines, comments) does not matter here
+
+            if (!ok) {
+                chunk.error = "can not parse \"" + std::string(line, std::min<size_t>(lineEnd - line, 60)) + "\"";
+            }
+        }
+    }
+
+    // Open addressing from a (position, texture coordinate, normal) triple to the vertex made from it
+    class VertexTable {
+    private:
+        struct Slot {
+            int key[3];
+            unsigned int vertex;
+        };
+        std::vector<Slot> slots;
+        size_t used = 0;
+
+        static size_t hash(const int *key) {
+            uint64_t h = (uint32_t)key[0] * 0x9E3779B97F4A7C15ull;
+            h ^= (uint32_t)key[1] * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+            h ^= (uint32_t)key[2] * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+            return (size_t)(h ^ (h >> 29));
+        }
+
+        void grow() {
+            std::vector<Slot> old = std::move(slots);
+            slots.assign(old.size() * 2, { { MISSING, MISSING, MISSING }, 0 });
+            size_t mask = slots.size() - 1;
+            for (Slot &slot : old) {
+                if (slot.key[0] == MISSING) { continue; }
+                size_t i = hash(slot.key) & mask;
+                while (slots[i].key[0] != MISSING) { i = (i + 1) & mask; }
+                slots[i] = slot;
+            }
+        }
+
+    public:
+        VertexTable(size_t expected) {
+            size_t capacity = 1024;
+            while (capacity < expected * 2) { capacity *= 2; }
+            slots.assign(capacity, { { MISSING, MISSING, MISSING }, 0 });
+        }
+
+        // Returns the vertex of the key, or adds it as nextVertex. added tells which.
+        unsigned int Insert(const int *key, unsigned int nextVertex, bool &added) {
+            if ((used + 1) * 2 > slots.size()) { grow(); }
+            size_t mask = slots.size() - 1;
+            for (size_t i = hash(key) & mask; ; i = (i + 1) & mask) {
+                Slot &slot = slots[i];
+                if (slot.key[0] == MISSING) {
+                    std::memcpy(slot.key, key, sizeof(slot.key));
+                    slot.vertex = nextVertex;
+                    used++;
+                    added = true;
+                    return nextVertex;
+                }
+                if (slot.key[0] == key[0] && slot.key[1] == key[1] && slot.key[2] == key[2]) {
+                    added = false;
+                    return slot.vertex;
+                }
+            }
+        }
+    };
+
+    /* --------------------------------------------- */
+    // glTF
+    /* --------------------------------------------- */
+
+    const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+    const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+    const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+    const int GLTF_FLOAT = 5126;
+    const int GLTF_UNSIGNED_BYTE = 5121;
+    const int GLTF_UNSIGNED_SHORT = 5123;
+    const int GLTF_UNSIGNED_INT = 5125;
+    const int GLTF_TRIANGLES = 4;
+
+    uint32_t read32(const unsigned char *p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    struct GltfAccessor {
+        const unsigned char *data;
+        size_t count;
+        size_t stride;
+        int componentType;
+    };
+
+    int componentCount(const std::string &type) {
+        if (type == "SCALAR") { return 1; }
+        if (type == "VEC2") { return 2; }
+        if (type == "VEC3") { return 3; }
+        if (type == "VEC4") { return 4; }
+        return 0;
+    }
+
+    int componentSize(int componentType) {
+        switch (componentType) {
+            case GLTF_UNSIGNED_BYTE: return 1;
+            case GLTF_UNSIGNED_SHORT: return 2;
+            case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+            default: return 0;
+        }
+    }
+
+    // Finds the data of an accessor in the binary chunk and checks that all of it is there
+    bool gltfAccessor(const JsonValue &gltf, int index, int components, const unsigned char *bin, size_t binSize, GltfAccessor &out, std::string &error) {
+        const JsonValue &accessor = gltf["accessors"][(size_t)index];
+        if (accessor.IsNull()) { error = "missing accessor " + std::to_string(index); return false; }
+        if (!accessor["sparse"].IsNull()) { error = "sparse accessors are not supported"; return false; }
+        if (componentCount(accessor["type"].string) != components) { error = "accessor " + std::to_string(index) + " has the wrong type"; return false; }
+
+        out.componentType = accessor["componentType"].Int(0);
+        out.count = (size_t)accessor["count"].Number(0.0);
+        int elementSize = componentSize(out.componentType) * components;
+        if (elementSize == 0) { error = "accessor " + std::to_string(index) + " has an unknown component type"; return false; }
+
+        const JsonValue &view = gltf["bufferViews"][(size_t)accessor["bufferView"].Int(-1)];
+        if (view.IsNull()) { error = "accessor " + std::to_string(index) + " has no buffer view"; return false; }
+        if (view["buffer"].Int(0) != 0 || !gltf["buffers"][(size_t)0]["uri"].IsNull()) {
+            error = "only the binary chunk of the .glb is supported as buffer";
+            return false;
+        }
+
+        size_t offset = (size_t)view["byteOffset"].Number(0.0) + (size_t)accessor["byteOffset"].Number(0.0);
+        size_t viewEnd = (size_t)view["byteOffset"].Number(0.0) + (size_t)view["byteLength"].Number(0.0);
+        out.stride = (size_t)view["byteStride"].Number(0.0);
+        if (out.stride == 0) { out.stride = elementSize; }
+        if (out.count > 0 && (viewEnd > binSize || offset + (out.count - 1) * out.stride + elementSize > viewEnd)) {
+            error = "accessor " + std::to_string(index) + " lies outside the binary chunk";
+            return false;
+        }
+        out.data = bin + offset;
+        return true;
+    }
+}
+
+bool importObj(const unsigned char *data, size_t size, Geometry &geometry, std::string &error) {
+    PROFILE_ZONE("import obj");
+    const char *text = (const char*)data;
+
+    // Split at line breaks, one chunk per core for big files
+    size_t threads = (std::max)(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = (std::max)((size_t)1, (std::min)(threads, size / OBJ_MIN_CHUNK));
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char *start = text;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char *end = text + size;
+        if (i + 1 < chunkCount) {
+            end = text + size * (i + 1) / chunkCount;
+            const char *newline = (const char*)std::memchr(end, '\n', text + size - end);
+            end = newline ? newline + 1 : text + size;
+        }
+        chunks[i].begin = start;
+        chunks[i].end = (std::max)(start, end);
+        start = chunks[i].end;
+    }
+
+    if (chunkCount == 1) {
+        parseObjChunk(chunks[0]);
+    }
+    else {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < chunkCount; i++) { workers.emplace_back(parseObjChunk, std::ref(chunks[i])); }
+        parseObjChunk(chunks[0]);
+        for (std::thread &worker : workers) { worker.join(); }
+    }
+
+    // Element counts before each chunk, to resolve the indices that count backwards
+    size_t totals[3] = { 0, 0, 0 };
+    size_t cornerCount = 0;
+    std::vector<float> positions, texCoords, normals;
+    for (ObjChunk &chunk : chunks) {
+        if (!chunk.error.empty()) { error = chunk.error; return false; }
+        cornerCount += chunk.corners.size();
+        totals[0] += chunk.positions.size() / 3;
+        totals[1] += chunk.texCoords.size() / 2;
+        totals[2] += chunk.normals.size() / 3;
+    }
+    positions.reserve(totals[0] * 3);
+    texCoords.reserve(totals[1] * 2);
+    normals.reserve(totals[2] * 3);
+
+    std::vector<ObjCorner> corners;
+    corners.reserve(cornerCount);
+    bool missingNormals = false;
+    for (ObjChunk &chunk : chunks) {
+        int bases[3] = { (int)(positions.size() / 3), (int)(texCoords.size() / 2), (int)(normals.size() / 3) };
+        for (ObjCorner corner : chunk.corners) {
+            for (int i = 0; i < 3; i++) {
+                if (corner.relative & (1 << i)) { corner.index[i] += bases[i]; }
+                if (corner.index[i] != MISSING && (corner.index[i] < 0 || (size_t)corner.index[i] >= totals[i])) {
+                    error = "face refers to a missing vertex";
+                    return false;
+                }
+            }
+            if (corner.index[2] == MISSING) { missingNormals = true; }
+            corners.push_back(corner);
+        }
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        chunk = ObjChunk();
+    }
+
+    // Corners without a normal get a smooth one, made from the faces around their position.
+    // Those normals are appended after the ones from the file, one per position.
+    if (missingNormals) {
+        size_t generated = normals.size();
+        normals.resize(generated + positions.size(), 0.0f);
+        for (size_t i = 0; i < corners.size(); i += 3) {
+            glm::vec3 n = faceNormal(&positions[corners[i].index[0] * 3], &positions[corners[i + 1].index[0] * 3], &positions[corners[i + 2].index[0] * 3]);
+            for (size_t c = i; c < i + 3; c++) {
+                if (corners[c].index[2] != MISSING) { continue; }
+                float *normal = &normals[generated + corners[c].index[0] * 3];
+                normal[0] += n.x; normal[1] += n.y; normal[2] += n.z;
+            }
+        }
+        for (size_t i = generated; i < normals.size(); i += 3) {
+            glm::vec3 n(normals[i], normals[i + 1], normals[i + 2]);
+            float length = glm::length(n);
+            if (length > 0.0f) { n /= length; }
+            normals[i] = n.x; normals[i + 1] = n.y; normals[i + 2] = n.z;
+        }
+        for (ObjCorner &corner : corners) {
+            if (corner.index[2] == MISSING) { corner.index[2] = (int)(generated / 3) + corner.index[0]; }
+        }
+    }
+
+    // Merge corners that are the same vertex
+    {
+        PROFILE_ZONE("deduplicate vertices");
+        geometry.vertices.clear();
+        geometry.indices.clear();
+        geometry.indices.reserve(corners.size());
+        geometry.vertices.reserve(corners.size() / 2 * GEOMETRY_FLOATS_PER_VERTEX);
+        VertexTable table(corners.size() / 4);
+        unsigned int vertexCount = 0;
+        for (ObjCorner &corner : corners) {
+            bool added;
+            unsigned int vertex = table.Insert(corner.index, vertexCount, added);
+            geometry.indices.push_back(vertex);
+            if (!added) { continue; }
+
+            vertexCount++;
+            const float *p = &positions[corner.index[0] * 3];
+            const float *n = &normals[corner.index[2] * 3];
+            float u = 0.0f, v = 0.0f;
+            if (corner.index[1] != MISSING) {
+                u = texCoords[corner.index[1] * 2];
+                v = texCoords[corner.index[1] * 2 + 1];
+            }
+            geometry.vertices.insert(geometry.vertices.end(), { p[0], p[1], p[2], n[0], n[1], n[2], u, v });
+        }
+    }
+
+    if (geometry.indices.empty()) { error = "no faces"; return false; }
+    return true;
+}
+
+bool importGlb(const unsigned char *data, size_t size, Geometry &geometry, std::string &error) {
+    PROFILE_ZONE("import glb");
+    if (size < 20 || read32(data) != GLB_MAGIC) { error = "not a binary glTF file"; return false; }
+    if (read32(data + 4) != 2) { error = "only glTF 2.0 is supported"; return false; }
+
+    // The JSON chunk, then optionally the binary chunk
+    size_t jsonLength = read32(data + 12);
+    if (read32(data + 16) != GLB_CHUNK_JSON || 20 + jsonLength > size) { error = "missing JSON chunk"; return false; }
+    std::string_view json((const char*)data + 20, jsonLength);
+    const unsigned char *bin = nullptr;
+    size_t binSize = 0;
+    size_t binHeader = 20 + ((jsonLength + 3) & ~(size_t)3);
+    if (binHeader + 8 <= size && read32(data + binHeader + 4) == GLB_CHUNK_BIN) {
+        binSize = (std::min)((size_t)read32(data + binHeader), size - binHeader - 8);
+        bin = data + binHeader + 8;
+    }
+
+    JsonValue gltf;
+    size_t errorOffset;
+    if (!parseJson(json, gltf, errorOffset)) { error = "invalid JSON at " + std::to_string(errorOffset); return false; }
+
+    geometry.vertices.clear();
+    geometry.indices.clear();
+    const JsonValue &meshes = gltf["meshes"];
+    for (size_t m = 0; m < meshes.Size(); m++) {
+        const JsonValue &primitives = meshes[m]["primitives"];
+        for (size_t p = 0; p < primitives.Size(); p++) {
+            const JsonValue &primitive = primitives[p];
+            if (primitive["mode"].Int(GLTF_TRIANGLES) != GLTF_TRIANGLES) { continue; }
+
+            const JsonValue &attributes = primitive["attributes"];
+            GltfAccessor positions, normals = { nullptr, 0, 0, 0 }, texCoords = { nullptr, 0, 0, 0 }, indices = { nullptr, 0, 0, 0 };
+            if (!gltfAccessor(gltf, attributes["POSITION"].Int(-1), 3, bin, binSize, positions, error)) { return false; }
+            if (!attributes["NORMAL"].IsNull() && !gltfAccessor(gltf, attributes["NORMAL"].Int(-1), 3, bin, binSize, normals, error)) { return false; }
+            if (!attributes["TEXCOORD_0"].IsNull() && !gltfAccessor(gltf, attributes["TEXCOORD_0"].Int(-1), 2, bin, binSize, texCoords, error)) { return false; }
+            if (!primitive["indices"].IsNull() && !gltfAccessor(gltf, primitive["indices"].Int(-1), 1, bin, binSize, indices, error)) { return false; }
+            if (positions.componentType != GLTF_FLOAT || (normals.data && normals.componentType != GLTF_FLOAT) || (texCoords.data && texCoords.componentType != GLTF_FLOAT)) {
+                error = "quantized vertex attributes are not supported";
+                return false;
+            }
+            if ((normals.data && normals.count != positions.count) || (texCoords.data && texCoords.count != positions.count)) {
+                error = "vertex attributes of different lengths";
+                return false;
+            }
+
+            // glTF is indexed already, so the vertices are copied as they are
+            size_t firstVertex = geometry.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX;
+            size_t firstIndex = geometry.indices.size();
+            geometry.vertices.resize(geometry.vertices.size() + positions.count * GEOMETRY_FLOATS_PER_VERTEX, 0.0f);
+            for (size_t i = 0; i < positions.count; i++) {
+                float *vertex = &geometry.vertices[(firstVertex + i) * GEOMETRY_FLOATS_PER_VERTEX];
+                std::memcpy(vertex, positions.data + i * positions.stride, 3 * sizeof(float));
+                if (normals.data) { std::memcpy(vertex + 3, normals.data + i * normals.stride, 3 * sizeof(float)); }
+                // glTF has v = 0 at the top of the image, like the first row of the DDS textures
+                if (texCoords.data) { std::memcpy(vertex + 6, texCoords.data + i * texCoords.stride, 2 * sizeof(float)); }
+            }
+
+            size_t indexCount = indices.data ? indices.count : positions.count;
+            geometry.indices.reserve(firstIndex + indexCount);
+            for (size_t i = 0; i < indexCount; i++) {
+                uint32_t index = (uint32_t)i;
+                if (indices.data) {
+                    const unsigned char *element = indices.data + i * indices.stride;
+                    if (indices.componentType == GLTF_UNSIGNED_BYTE) { index = *element; }
+                    else if (indices.componentType == GLTF_UNSIGNED_SHORT) { uint16_t value; std::memcpy(&value, element, 2); index = value; }
+                    else { index = read32(element); }
+                }
+                if (index >= positions.count) { error = "index outside of its primitive"; return false; }
+                geometry.indices.push_back((unsigned int)(firstVertex + index));
+            }
+            geometry.indices.resize(firstIndex + indexCount / 3 * 3);
+
+            // Smooth normals from the faces if the primitive has none
+            if (!normals.data) {
+                for (size_t i = firstIndex; i < geometry.indices.size(); i += 3) {
+                    float *corner[3];
+                    for (int c = 0; c < 3; c++) { corner[c] = &geometry.vertices[geometry.indices[i + c] * GEOMETRY_FLOATS_PER_VERTEX]; }
+                    glm::vec3 n = faceNormal(corner[0], corner[1], corner[2]);
+                    for (int c = 0; c < 3; c++) { corner[c][3] += n.x; corner[c][4] += n.y; corner[c][5] += n.z; }
+                }
+                for (size_t v = firstVertex; v < geometry.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX; v++) {
+                    float *normal = &geometry.vertices[v * GEOMETRY_FLOATS_PER_VERTEX + 3];
+                    glm::vec3 n(normal[0], normal[1], normal[2]);
+                    float length = glm::length(n);
+                    if (length > 0.0f) { n /= length; }
+                    normal[0] = n.x; normal[1] = n.y; normal[2] = n.z;
+                }
+            }
+        }
+    }
+
+    if (geometry.indices.empty()) { error = "no triangles"; return false; }
+    return true;
+}
+
+bool importMesh(std::string_view extension, const unsigned char *data, size_t size, Geometry &geometry, std::string &error) {
+    if (extension == ".obj") { return importObj(data, size, geometry, error); }
+    if (extension == ".glb") { return importGlb(data, size, geometry, error); }
+    error = "unknown mesh format " + std::string(extension);
+    return false;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "Shapes\Geometry.hpp"
+
+// Imports meshes in the layout of the generated shapes (see Geometry.hpp).
+// The file is parsed where it lies, usually mapped from the pack, without copying it into a string.
+// Vertices that share position, normal and texture coordinates are merged.
+// Missing normals are computed from the faces, missing texture coordinates are 0.
+
+// Wavefront OBJ. Big files are split into chunks at line breaks and parsed on all cores.
+bool importObj(const unsigned char *data, size_t size, Geometry &geometry, std::string &error);
+
+// Binary glTF 2.0. All triangle primitives of all meshes are merged, node transformations are not applied.
+bool importGlb(const unsigned char *data, size_t size, Geometry &geometry, std::string &error);
+
+// Picks the importer by extension (".obj" or ".glb")
+bool importMesh(std::string_view extension, const unsigned char *data, size_t size, Geometry &geometry, std::string &error);
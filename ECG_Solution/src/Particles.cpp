@@ -0,0 +1,124 @@
+#include "Particles.hpp"
+#include "Uniforms.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+namespace {
+    // The compute shader's work group size
+    const unsigned int GROUP_SIZE = 256;
+
+    struct Particle {
+        glm::vec4 position;
+        glm::vec4 velocity;
+    };
+
+    // std430 layout of the state block, see particles.comp
+    struct ParticleState {
+        GLuint alive;
+        GLuint appended;
+        GLuint unused[2];
+        GLuint dispatch[4];
+        GLuint draw[4];
+    };
+}
+
+ParticleSystem::ParticleSystem(std::string computeSource, std::string vertexSource, std::string fragmentSource,
+                               const ParticleSettings &particleSettings, SceneDescription &scene)
+    : simulate(computeSource), finish(insertAfterVersion(computeSource, "#define FINISH\n")),
+      render(insertAfterVersion(vertexSource, "#define MAX_POINT_LIGHTS " + std::to_string(MAX_POINT_LIGHTS) + "\n" + (particleSettings.lit ? "#define LIT\n" : "")), fragmentSource),
+      current(0), colliderCount(0), settings(particleSettings), emitDebt(0.0), seed(0) {
+    maxEmit = (unsigned int)std::ceil(settings.emitRate * MAX_PARTICLE_STEP) + 1;
+
+    size_t bytes = (size_t)settings.count * sizeof(Particle);
+    for (GlBuffer &buffer : particles) {
+        buffer = GlBuffer::Create();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY);
+    }
+
+    ParticleState initial = {};
+    initial.dispatch[0] = (maxEmit + GROUP_SIZE - 1) / GROUP_SIZE;
+    initial.dispatch[1] = initial.dispatch[2] = 1;
+    initial.draw[0] = 4;
+    state = GlBuffer::Create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, state.ID());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ParticleState), &initial, GL_DYNAMIC_COPY);
+
+    std::vector<Collider> shapes;
+    for (ObjectDescription &object : scene.objects) {
+        if (shapes.size() == MAX_PARTICLE_COLLIDERS) { break; }
+        glm::mat4 toWorld = modelMatrix(object.object.transformation);
+        if (object.kind == ShapeKind::Box) { shapes.push_back({ glm::inverse(toWorld), toWorld, glm::vec4(object.size * 0.5f, 0.0f) }); }
+        else if (object.kind == ShapeKind::Sphere) { shapes.push_back({ glm::inverse(toWorld), toWorld, glm::vec4(object.size.x, 0.0f, 0.0f, 1.0f) }); }
+    }
+    colliderCount = (unsigned int)shapes.size();
+    colliders = GlBuffer::Create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, colliders.ID());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (std::max)(shapes.size(), (size_t)1) * sizeof(Collider), shapes.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    vao = GlVertexArray::Create();
+}
+
+void ParticleSystem::Update(float seconds) {
+    if (!simulate.IsReady() || !finish.IsReady()) { return; }
+    seconds = (std::min)(seconds, MAX_PARTICLE_STEP);
+    emitDebt += settings.emitRate * seconds;
+    unsigned int emitCount = (std::min)((unsigned int)emitDebt, maxEmit);
+    // What a step could not emit is not made up for later
+    emitDebt = (std::min)(emitDebt - emitCount, (double)maxEmit);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_STATE_STORAGE_BINDING, state.ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_SOURCE_STORAGE_BINDING, particles[current].ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_DESTINATION_STORAGE_BINDING, particles[1 - current].ID());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_COLLIDER_STORAGE_BINDING, colliders.ID());
+
+    simulate.Use();
+    glUniform1f(0, seconds);
+    glUniform1ui(1, emitCount);
+    glUniform1ui(2, settings.count);
+    glUniform3fv(3, 1, glm::value_ptr(settings.emitter));
+    glUniform1f(4, settings.speed);
+    glUniform1f(5, settings.lifetime);
+    glUniform1ui(6, seed++);
+    glUniform1ui(7, colliderCount);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, state.ID());
+    glDispatchComputeIndirect((GLintptr)offsetof(ParticleState, dispatch));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    finish.Use();
+    glUniform1ui(2, settings.count);
+    glUniform1ui(8, maxEmit);
+    glDispatchCompute(1, 1, 1);
+    // The next step and the draw read what the finish pass wrote, as commands and from storage
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    glUseProgram(0);
+    current = 1 - current;
+}
+
+void ParticleSystem::Draw() {
+    if (!render.IsReady()) { return; }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_SOURCE_STORAGE_BINDING, particles[current].ID());
+    render.Use();
+    glUniform1f(0, settings.size);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(vao.ID());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, state.ID());
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void*)offsetof(ParticleState, draw));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glUseProgram(0);
+}
+
+void ParticleSystem::ReportMemory(MemoryReport &report) {
+    size_t gpuBytes = 2 * (size_t)settings.count * sizeof(Particle) + sizeof(ParticleState) + (std::max)(colliderCount, 1u) * sizeof(Collider);
+    report.Add("particles", sizeof(*this), gpuBytes);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <GL\glew.h>
+#include "glm\matrix.hpp"
+#include "GlHandle.hpp"
+#include "Shader.hpp"
+#include "Settings.hpp"
+#include "MemoryReport.hpp"
+#include "Scene.hpp"
+
+// Spheres and boxes of the scene particles bounce off, the first ones of the scene
+#define MAX_PARTICLE_COLLIDERS 64
+// Steps are at most this long, slower frames slow the particles down
+#define MAX_PARTICLE_STEP 0.05f
+
+// A fountain of particles that lives on the GPU alone (assets/shaders/particles.*).
+//
+// The particles are in one of two storage buffers. Each step a compute shader reads the live ones
+// from it, emits new ones, moves them under gravity, bounces them off the scene's spheres and
+// boxes and appends those still alive to the other buffer, which then holds them. A one invocation
+// pass writes the size of the next step's dispatch and the instance count of the draw, which are
+// both indirect, so the CPU never learns how many particles there are.
+// They are drawn as camera-facing quads blended additively, without writing depth.
+class ParticleSystem {
+private:
+    // std430 layout of one collider, see particles.comp
+    struct Collider {
+        glm::mat4 toLocal;
+        glm::mat4 toWorld;
+        glm::vec4 extent;
+    };
+
+    Shader simulate;
+    Shader finish;
+    Shader render;
+    GlBuffer particles[2];
+    unsigned int current; // the buffer the live particles are in
+    GlBuffer state;
+    GlBuffer colliders;
+    GlVertexArray vao;    // empty, the vertex shader makes the quads
+    unsigned int colliderCount;
+    ParticleSettings settings;
+    unsigned int maxEmit; // per step
+    double emitDebt;      // particles owed to the emit rate
+    unsigned int seed;
+
+public:
+    ParticleSystem(std::string computeSource, std::string vertexSource, std::string fragmentSource,
+                   const ParticleSettings &settings, SceneDescription &scene);
+    ParticleSystem(const ParticleSystem &) = delete;
+    ParticleSystem &operator=(const ParticleSystem &) = delete;
+
+    // Advances the particles by the seconds since the last step
+    void Update(float seconds);
+    // Needs the frame uniforms to be bound
+    void Draw();
+    // Adds the particle, state and collider buffers as "particles"
+    void ReportMemory(MemoryReport &report);
+};
@@ -0,0 +1,136 @@
+#include "Profiler.hpp"
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#define PROFILER_RDTSC 1
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC 1
+#endif
+
+namespace {
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+    uint32_t nextThreadId = 0;
+
+    uint64_t steadyNanoseconds() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Reference point used to convert ticks to microseconds when exporting
+    const uint64_t epochTicks = Profiler::Now();
+    const uint64_t epochNanoseconds = steadyNanoseconds();
+
+    thread_local ProfileThreadBuffer *threadBuffer = nullptr;
+    std::atomic<bool> inStartup(true);
+
+    // Zones nested deeper are not told apart from their parent
+    const uint32_t MAX_OPEN_ZONES = 64;
+    thread_local const char *openZones[MAX_OPEN_ZONES];
+    thread_local uint32_t openZoneCount = 0;
+
+    // Copies event index out of its slot. False if the owner has overwritten it or is writing it,
+    // the export skips those instead of writing torn events.
+    bool readEvent(const ProfileSlot &slot, uint64_t index, ProfileEvent &event) {
+        uint64_t written = 2 * index + 2;
+        if (slot.sequence.load(std::memory_order_acquire) != written) { return false; }
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.start = slot.start.load(std::memory_order_relaxed);
+        event.end = slot.end.load(std::memory_order_relaxed);
+        event.depth = slot.depth.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == written;
+    }
+}
+
+uint64_t Profiler::Now() {
+#ifdef PROFILER_RDTSC
+    return __rdtsc();
+#else
+    return steadyNanoseconds();
+#endif
+}
+
+ProfileThreadBuffer &Profiler::ThreadBuffer() {
+    if (threadBuffer == nullptr) {
+        // Only taken once per thread. The buffers are never freed so zones of finished threads can still be exported.
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<ProfileThreadBuffer>());
+        threadBuffer = buffers.back().get();
+        threadBuffer->threadId = nextThreadId++;
+        threadBuffer->depth = 0;
+        threadBuffer->count.store(0, std::memory_order_relaxed);
+        threadBuffer->startupCount.store(0, std::memory_order_relaxed);
+    }
+    return *threadBuffer;
+}
+
+void Profiler::EnterZone(const char *name) {
+    if (openZoneCount < MAX_OPEN_ZONES) { openZones[openZoneCount] = name; }
+    openZoneCount++;
+}
+
+void Profiler::LeaveZone(const char *name) {
+    if (openZoneCount == 0) { return; }
+    if (openZoneCount > MAX_OPEN_ZONES) {
+        openZoneCount--;
+        return;
+    }
+    uint32_t i = openZoneCount;
+    while (i > 0 && openZones[i - 1] != name) { i--; }
+    if (i == 0) { return; }
+    for (; i < openZoneCount; i++) { openZones[i - 1] = openZones[i]; }
+    openZoneCount--;
+}
+
+const char *Profiler::CurrentZone() {
+    if (openZoneCount == 0) { return nullptr; }
+    return openZones[(std::min)(openZoneCount, MAX_OPEN_ZONES) - 1];
+}
+
+void Profiler::EndStartup() { inStartup.store(false, std::memory_order_relaxed); }
+
+bool Profiler::InStartup() { return inStartup.load(std::memory_order_relaxed); }
+
+bool Profiler::WriteChromeTrace(std::filesystem::path path) {
+    std::ofstream file(path);
+    if (!file) { return false; }
+
+    // Measure how fast the tick counter runs compared to steady_clock
+    double ticksPerMicrosecond = (double)(Now() - epochTicks) * 1000.0 / (double)(steadyNanoseconds() - epochNanoseconds);
+    if (!(ticksPerMicrosecond > 0.0)) { ticksPerMicrosecond = 1000.0; }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (auto &buffer : buffers) {
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t begin = count > PROFILER_EVENTS_PER_THREAD ? count - PROFILER_EVENTS_PER_THREAD : 0;
+
+        file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadId
+             << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << (buffer->threadId == 0 ? "main" : "worker") << " " << buffer->threadId << "\"}}";
+        first = false;
+
+        auto writeEvent = [&](const ProfileEvent &event) {
+            double ts  = (double)(int64_t)(event.start - epochTicks) / ticksPerMicrosecond;
+            double dur = (double)(event.end - event.start) / ticksPerMicrosecond;
+            file << ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+                 << ",\"name\":\"" << event.name << "\",\"ts\":" << std::fixed << ts << ",\"dur\":" << dur << "}";
+        };
+        uint32_t startupCount = buffer->startupCount.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < startupCount; i++) { writeEvent(buffer->startupEvents[i]); }
+        for (uint64_t i = begin; i < count; i++) {
+            ProfileEvent event;
+            if (readEvent(buffer->events[i % PROFILER_EVENTS_PER_THREAD], i, event)) { writeEvent(event); }
+        }
+    }
+    file << "\n]}\n";
+    return (bool)file;
+}
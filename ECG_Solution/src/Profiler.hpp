@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <filesystem>
+
+// Number of zones each thread keeps. Older zones are overwritten once a thread has recorded more.
+#define PROFILER_EVENTS_PER_THREAD (1 << 15)
+// Zones of each thread recorded during startup that are kept apart and never overwritten, so a
+// trace written minutes later still shows how the program started. Later ones go to the ring.
+#define PROFILER_STARTUP_EVENTS_PER_THREAD (1 << 13)
+
+// A finished zone. The name must outlive the profiler, so only pass string literals.
+struct ProfileEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t depth;
+};
+
+// One slot of a thread's ring of zones. Once the ring has wrapped, the owner overwrites slots an
+// exporting thread may be reading, so every slot is a seqlock: the sequence is odd while the owner
+// writes the fields and 2 * (event index + 1) once event index is in it. The fields are relaxed
+// atomics, so a reader racing the owner gets stale values it then throws away, not a data race.
+struct ProfileSlot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> end;
+    std::atomic<uint32_t> depth;
+};
+
+// Zones recorded by one thread. Only the owning thread writes to it, so recording needs no locks;
+// the counts are published with release ordering so an exporting thread sees finished events only.
+// Startup events are written once and never again, so they need no seqlock.
+struct ProfileThreadBuffer {
+    uint32_t threadId;
+    uint32_t depth;
+    std::atomic<uint64_t> count;
+    ProfileSlot events[PROFILER_EVENTS_PER_THREAD];
+    std::atomic<uint32_t> startupCount;
+    ProfileEvent startupEvents[PROFILER_STARTUP_EVENTS_PER_THREAD];
+};
+
+namespace Profiler {
+    // Returns the current time in ticks. Uses the time stamp counter where available,
+    // otherwise steady_clock nanoseconds.
+    uint64_t Now();
+
+    // Buffer of the calling thread, registered on first use
+    ProfileThreadBuffer &ThreadBuffer();
+
+    // Zones open on the calling thread, for attributing work to them (see Allocations.hpp).
+    // Zones may end out of order, leaving removes the innermost one of that name.
+    void EnterZone(const char *name);
+    void LeaveZone(const char *name);
+    // The innermost open zone, null outside of any
+    const char *CurrentZone();
+
+    // Zones of every thread ending from now on go to the rings only
+    void EndStartup();
+    bool InStartup();
+
+    // Writes every recorded zone of every thread as a Chrome trace / Perfetto JSON file.
+    // Returns false if the file could not be written.
+    bool WriteChromeTrace(std::filesystem::path path);
+}
+
+// Records the time from construction to destruction as a zone
+struct ProfileZone {
+private:
+    ProfileThreadBuffer &buffer;
+    const char *name;
+    uint64_t start;
+    bool ended;
+
+public:
+    ProfileZone(const char *zoneName) : buffer(Profiler::ThreadBuffer()), name(zoneName), ended(false) {
+        Profiler::EnterZone(name);
+        buffer.depth++;
+        start = Profiler::Now();
+    }
+
+    ~ProfileZone() { End(); }
+
+    // Ends the zone before the end of the scope
+    void End() {
+        if (ended) { return; }
+        ended = true;
+        uint64_t end = Profiler::Now();
+        buffer.depth--;
+        Profiler::LeaveZone(name);
+        uint32_t startupIndex = buffer.startupCount.load(std::memory_order_relaxed);
+        if (startupIndex < PROFILER_STARTUP_EVENTS_PER_THREAD && Profiler::InStartup()) {
+            buffer.startupEvents[startupIndex] = ProfileEvent{ name, start, end, buffer.depth };
+            buffer.startupCount.store(startupIndex + 1, std::memory_order_release);
+            return;
+        }
+        uint64_t index = buffer.count.load(std::memory_order_relaxed);
+        ProfileSlot &slot = buffer.events[index % PROFILER_EVENTS_PER_THREAD];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        slot.depth.store(buffer.depth, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+    bool Running() { return !ended; }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Profiles the rest of the enclosing scope under the given name
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
@@ -0,0 +1,252 @@
+#include "Scene.hpp"
+#include "Profiler.hpp"
+#include "Uniforms.hpp"
+#include "Shapes\Box.hpp"
+#include "Shapes\Cylinder.hpp"
+#include "Shapes\Sphere.hpp"
+#include "Shapes\MeshShape.hpp"
+#include <chrono>
+#include <random>
+#include <unordered_set>
+#include <iostream>
+#include <cctype>
+#include <cstring>
+
+namespace {
+    std::string lowercase(std::string_view s) {
+        std::string result(s);
+        for (char &c : result) { c = (char)std::tolower((unsigned char)c); }
+        return result;
+    }
+
+    // Whether a lowercased section name is base or base.<digits>
+    bool matchSection(const std::string &section, const char *base) {
+        size_t length = std::strlen(base);
+        if (section.compare(0, length, base) != 0) { return false; }
+        if (section.size() == length) { return true; }
+        if (section[length] != '.' || section.size() == length + 1) { return false; }
+        for (size_t i = length + 1; i < section.size(); i++) {
+            if (!std::isdigit((unsigned char)section[i])) { return false; }
+        }
+        return true;
+    }
+
+    std::vector<std::string> splitList(const std::string &list) {
+        std::vector<std::string> items;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(',', start);
+            if (end == std::string::npos) { end = list.size(); }
+            std::string item = list.substr(start, end - start);
+            item.erase(0, item.find_first_not_of(" \t"));
+            item.erase(item.find_last_not_of(" \t") + 1);
+            if (!item.empty()) { items.push_back(item); }
+            start = end + 1;
+        }
+        return items;
+    }
+
+    void bindPointLight(ConfigSchema &schema, std::string section, PointLight &light) {
+        schema.BindColor(section, light.color, 50.0f)
+              .BindXYZ(section, "trans", light.position, 50.0f)
+              .Bind(section, "attenuationQuad", light.attenuation.x, 50.0f)
+              .Bind(section, "attenuationLin", light.attenuation.y, 50.0f)
+              .Bind(section, "attenuationConst", light.attenuation.z, 50.0f);
+    }
+
+    void bindShape(ConfigSchema &schema, std::string section, ObjectDescription &description) {
+        switch (description.kind) {
+            case ShapeKind::Box:
+                schema.Bind(section, "width", description.size.x, 50.0f)
+                      .Bind(section, "height", description.size.y, 50.0f)
+                      .Bind(section, "depth", description.size.z, 50.0f);
+                break;
+            case ShapeKind::Cylinder:
+                schema.Bind(section, "height", description.size.x, 50.0f)
+                      .Bind(section, "radius", description.size.y, 50.0f)
+                      .Bind(section, "sides", description.segments[0], 50);
+                break;
+            case ShapeKind::Sphere:
+                schema.Bind(section, "longSegments", description.segments[0], 50)
+                      .Bind(section, "latSegments", description.segments[1], 50)
+                      .Bind(section, "radius", description.size.x, 50.0f);
+                break;
+            case ShapeKind::Mesh:
+                schema.Bind(section, "file", description.file, "");
+                break;
+        }
+    }
+
+    // Appends the objects and lights of the [stress] section. The same seed gives the same scene.
+    void generateStress(SceneDescription &scene) {
+        StressSettings &stress = scene.stress;
+        std::mt19937 random(stress.seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_real_distribution<float> position(-stress.extent, stress.extent);
+        auto between = [&](float low, float high) { return low + (high - low) * unit(random); };
+
+        std::vector<std::string> textures = splitList(stress.textures);
+        const int alphas[] = { 2, 4, 8, 16, 32 };
+
+        scene.objects.reserve(scene.objects.size() + stress.objects);
+        for (unsigned int i = 0; i < stress.objects; i++) {
+            ObjectDescription description;
+            description.kind = (ShapeKind)(random() % 3);
+            description.size = glm::vec3(between(0.2f, 1.0f), between(0.2f, 1.0f), between(0.2f, 1.0f));
+            description.segments[0] = 16;
+            description.segments[1] = 8;
+            if (description.kind == ShapeKind::Cylinder) { description.size.y *= 0.5f; }
+            if (description.kind == ShapeKind::Sphere)   { description.size.x *= 0.5f; }
+
+            ObjectSettings &object = description.object;
+            object.transformation.translation = glm::vec3(position(random), position(random), position(random));
+            object.transformation.rotation = glm::vec3(unit(random), unit(random), unit(random));
+            object.transformation.scaling = glm::vec3(1.0f);
+            object.surface.ka = 0.1f;
+            object.surface.kd = between(0.4f, 0.9f);
+            object.surface.ks = between(0.0f, 0.5f);
+            object.surface.alpha = alphas[random() % 5];
+            object.color = glm::vec3(unit(random), unit(random), unit(random));
+            size_t texture = random() % (textures.size() + 1);
+            object.texture = texture < textures.size() ? textures[texture] : "";
+            scene.objects.push_back(description);
+        }
+
+        for (unsigned int i = 0; i < stress.lights; i++) {
+            PointLight light;
+            light.color = glm::vec3(between(0.2f, 1.0f), between(0.2f, 1.0f), between(0.2f, 1.0f));
+            light.position = glm::vec3(position(random), position(random), position(random));
+            light.attenuation = glm::vec3(0.1f, 0.4f, 1.0f);
+            scene.lights.pointLights.push_back(light);
+        }
+    }
+}
+
+ConfigReport describeScene(ConfigFile &file, SceneDescription &scene) {
+    PROFILE_ZONE("describe scene");
+
+    // Sort the sections into lights and objects first, so the vectors are not resized
+    // after their elements have been bound to the schema
+    std::vector<std::string> lightSections;
+    std::vector<std::string> objectSections;
+    std::vector<ShapeKind> objectKinds;
+    std::unordered_set<std::string> seen;
+    for (std::string_view name : file.Sections()) {
+        std::string section = lowercase(name);
+        if (!seen.insert(section).second) { continue; }
+
+        if (matchSection(section, "pointlight"))    { lightSections.push_back(std::string(name)); }
+        else if (matchSection(section, "box"))      { objectSections.push_back(std::string(name)); objectKinds.push_back(ShapeKind::Box); }
+        else if (matchSection(section, "cylinder")) { objectSections.push_back(std::string(name)); objectKinds.push_back(ShapeKind::Cylinder); }
+        else if (matchSection(section, "sphere"))   { objectSections.push_back(std::string(name)); objectKinds.push_back(ShapeKind::Sphere); }
+        else if (matchSection(section, "mesh"))     { objectSections.push_back(std::string(name)); objectKinds.push_back(ShapeKind::Mesh); }
+    }
+
+    scene.lights.pointLights.resize(lightSections.size());
+    scene.objects.resize(objectSections.size());
+    std::vector<std::string> illuminations(objectSections.size());
+
+    ConfigSchema schema;
+    schema.BindColor("directionalLight", scene.lights.dirLight.color, 50.0f)
+          .BindXYZ("directionalLight", "dir", scene.lights.dirLight.direction, 50.0f)
+
+          .Bind("stress", "objects", scene.stress.objects, 0, false)
+          .Bind("stress", "lights", scene.stress.lights, 0, false)
+          .Bind("stress", "seed", scene.stress.seed, 1, false)
+          .Bind("stress", "extent", scene.stress.extent, 10.0f, false)
+          .Bind("stress", "textures", scene.stress.textures, "", false);
+
+    for (size_t i = 0; i < lightSections.size(); i++) {
+        bindPointLight(schema, lightSections[i], scene.lights.pointLights[i]);
+    }
+    for (size_t i = 0; i < objectSections.size(); i++) {
+        ObjectDescription &description = scene.objects[i];
+        description.kind = objectKinds[i];
+        description.size = glm::vec3(0.0f);
+        description.segments[0] = description.segments[1] = 0;
+        bindShape(schema, objectSections[i], description);
+        bindObject(schema, objectSections[i], description.object, illuminations[i]);
+    }
+
+    ConfigReport report = schema.Apply(file);
+    for (size_t i = 0; i < objectSections.size(); i++) {
+        scene.objects[i].object.surface.illumination = parseIllumination(illuminations[i]);
+    }
+
+    generateStress(scene);
+
+    if (scene.lights.pointLights.size() > MAX_POINT_LIGHTS) {
+        std::cout << "Scene has " << scene.lights.pointLights.size() << " point lights, only the first "
+                  << MAX_POINT_LIGHTS << " are used" << std::endl;
+        scene.lights.pointLights.resize(MAX_POINT_LIGHTS);
+    }
+    return report;
+}
+
+std::unique_ptr<Shape> buildShape(ObjectDescription &d, MaterialRef material, Vfs &vfs, std::string meshDirectory) {
+    ObjectSettings &o = d.object;
+    switch (d.kind) {
+        case ShapeKind::Box:
+            return std::make_unique<Box>(d.size.x, d.size.y, d.size.z, o.surface, o.transformation, o.color, material);
+        case ShapeKind::Cylinder:
+            return std::make_unique<Cylinder>(d.size.x, d.size.y, d.segments[0], o.surface, o.transformation, o.color, material);
+        case ShapeKind::Sphere:
+            return std::make_unique<Sphere>(d.segments[0], d.segments[1], d.size.x, o.surface, o.transformation, o.color, material);
+        case ShapeKind::Mesh:
+            return std::make_unique<MeshShape>(vfs, meshDirectory + "/" + d.file, o.surface, o.transformation, o.color, material);
+    }
+    return nullptr;
+}
+
+std::vector<std::unique_ptr<Shape>> buildScene(SceneDescription &scene, MaterialTable &materials, Vfs &vfs, std::string meshDirectory) {
+    PROFILE_ZONE("build scene");
+    std::vector<std::unique_ptr<Shape>> shapes;
+    shapes.reserve(scene.objects.size());
+
+    for (ObjectDescription &d : scene.objects) {
+        ObjectSettings &o = d.object;
+        shapes.push_back(buildShape(d, materials.Add(o.surface, o.color, o.texture), vfs, meshDirectory));
+    }
+    return shapes;
+}
+
+SceneLoader::SceneLoader(SceneDescription &s, MaterialTable &m, Vfs &v, std::string directory)
+    : scene(s), materials(m), vfs(v), meshDirectory(directory), built(0), texturesLoaded(false), texturesUploaded(false) {
+    refs.reserve(scene.objects.size());
+    for (ObjectDescription &d : scene.objects) {
+        ObjectSettings &o = d.object;
+        refs.push_back(materials.AddDeferred(o.surface, o.color, o.texture));
+    }
+    materials.Upload();
+    worker = std::thread([this]() {
+        materials.LoadDeferred();
+        texturesLoaded.store(true, std::memory_order_release);
+    });
+}
+
+SceneLoader::~SceneLoader() {
+    if (worker.joinable()) { worker.join(); }
+}
+
+void SceneLoader::Update(std::vector<std::unique_ptr<Shape>> &shapes, float budgetMs) {
+    if (Done()) { return; }
+    PROFILE_ZONE("load scene");
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+    // Refs as of now, so shapes built after the upload are textured from the start
+    while (built < scene.objects.size()) {
+        shapes.push_back(buildShape(scene.objects[built], materials.Ref(refs[built].index), vfs, meshDirectory));
+        built++;
+        if (elapsedMs() >= budgetMs) { break; }
+    }
+
+    if (!texturesUploaded && texturesLoaded.load(std::memory_order_acquire)) {
+        worker.join();
+        materials.UploadDeferred();
+        for (std::unique_ptr<Shape> &shape : shapes) { shape->SetMaterial(materials.Ref(shape->Material().index)); }
+        texturesUploaded = true;
+    }
+}
+
+bool SceneLoader::Done() { return texturesUploaded && built == scene.objects.size(); }
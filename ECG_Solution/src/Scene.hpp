@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "glm\matrix.hpp"
+#include "Config.hpp"
+#include "Settings.hpp"
+#include "Lights.hpp"
+#include "Materials.hpp"
+#include "Vfs.hpp"
+#include "Shapes\Shape.hpp"
+
+enum class ShapeKind { Box, Cylinder, Sphere, Mesh };
+
+// Everything needed to generate one shape
+struct ObjectDescription {
+    ShapeKind kind;
+    glm::vec3 size;           // box: width, height, depth. cylinder: height, radius. sphere: radius
+    unsigned int segments[2]; // cylinder: sides. sphere: long and lat segments
+    std::string file;         // mesh: the baked mesh, relative to the mesh directory
+    ObjectSettings object;
+};
+
+// Procedurally generated objects and point lights, to test how things scale
+struct StressSettings {
+    unsigned int objects;
+    unsigned int lights;
+    unsigned int seed;
+    float extent;             // everything is placed in a cube from -extent to extent
+    std::string textures;     // comma separated, objects pick one of them or none
+};
+
+struct SceneDescription {
+    Lights lights;
+    StressSettings stress;
+    std::vector<ObjectDescription> objects;
+};
+
+// Reads the lights and every object section of the file and adds the stress objects.
+// Object sections are named after their kind, optionally followed by an index:
+// [box], [cylinder.2], [sphere.0042], [mesh.3]. Point lights work the same way: [pointLight], [pointLight.7].
+ConfigReport describeScene(ConfigFile &file, SceneDescription &scene);
+
+// Generates the shape of one object, with a material already added for it
+std::unique_ptr<Shape> buildShape(ObjectDescription &object, MaterialRef material, Vfs &vfs, std::string meshDirectory);
+
+// Generates the shapes of a scene and adds their materials. Textures are loaded once, however many shapes use them.
+// Meshes are loaded from meshDirectory, relative to the asset directory of the vfs.
+std::vector<std::unique_ptr<Shape>> buildScene(SceneDescription &scene, MaterialTable &materials, Vfs &vfs, std::string meshDirectory);
+
+// Builds a scene over several frames, so the first one is drawn right away.
+// Every material is there from the start, without its texture: shapes with a texture still
+// loading are placeholders (see MaterialRef) drawn untextured in their color. A worker thread loads
+// the textures meanwhile. Shapes need the GL context for their buffers, so they are built on the
+// render thread, as many per frame as fit in the budget.
+class SceneLoader {
+private:
+    SceneDescription &scene;
+    MaterialTable &materials;
+    Vfs &vfs;
+    std::string meshDirectory;
+    std::vector<MaterialRef> refs; // of each object
+    size_t built;
+    std::thread worker;
+    std::atomic<bool> texturesLoaded;
+    bool texturesUploaded;
+
+public:
+    // Adds the materials and uploads them, then starts loading the textures. The table, which
+    // must have no other textures, belongs to the loader until Done; its TextureCache too.
+    SceneLoader(SceneDescription &scene, MaterialTable &materials, Vfs &vfs, std::string meshDirectory);
+    SceneLoader(const SceneLoader &) = delete;
+    SceneLoader &operator=(const SceneLoader &) = delete;
+    ~SceneLoader();
+    // Once per frame: appends the shapes built within budgetMs, at least one, and uploads the
+    // textures once they are loaded, turning the placeholders into textured shapes
+    void Update(std::vector<std::unique_ptr<Shape>> &shapes, float budgetMs);
+    bool Done();
+};
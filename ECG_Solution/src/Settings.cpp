@@ -0,0 +1,87 @@
+#include "Settings.hpp"
+#include "Profiler.hpp"
+
+Illumination parseIllumination(std::string name) {
+    return name == "gouraud" ? Illumination::Gouraud : Illumination::Phong;
+}
+
+void bindObject(ConfigSchema &schema, std::string section, ObjectSettings &object, std::string &illumination) {
+    schema.BindXYZ(section, "trans", object.transformation.translation, 50.0f)
+          .BindXYZ(section, "rot", object.transformation.rotation, 50.0f)
+          .BindXYZ(section, "scale", object.transformation.scaling, 50.0f)
+          .BindColor(section, object.color, 1.0f, false)
+          .Bind(section, "ka", object.surface.ka, 10.0f)
+          .Bind(section, "kd", object.surface.kd, 10.0f)
+          .Bind(section, "ks", object.surface.ks, 10.0f)
+          .Bind(section, "alpha", object.surface.alpha, 2)
+          .Bind(section, "illumination", illumination, "phong", false)
+          .Bind(section, "texture", object.texture, "", false);
+}
+
+ConfigReport loadSettings(ConfigFile &file, std::filesystem::path path, Settings &s) {
+    PROFILE_ZONE("read settings");
+    ConfigSchema schema;
+    schema.Bind("window", "width", s.window.width, 80)
+          .Bind("window", "height", s.window.height, 80)
+          .Bind("window", "refresh_rate", s.window.refreshRate, 60, false)
+          .Bind("window", "fullscreen", s.window.fullscreen, false, false)
+          .Bind("window", "title", s.window.title, "Title not loaded")
+
+          .Bind("camera", "fov", s.camera.fov, 360.0f)
+          .Bind("camera", "near", s.camera.zNear, 0.5f)
+          .Bind("camera", "far", s.camera.zFar, 50.0f)
+
+          .Bind("profiling", "traceFile", s.profiling.traceFile, "trace.json", false)
+          .Bind("profiling", "traceOnExit", s.profiling.traceOnExit, false, false)
+          .Bind("profiling", "forbidFrameAllocations", s.profiling.forbidFrameAllocations, false, false)
+          .Bind("profiling", "allocationWarmupFrames", s.profiling.allocationWarmupFrames, 10, false)
+
+          .Bind("logging", "minSeverity", s.logging.minSeverity, "low", false)
+          .Bind("logging", "perSecond", s.logging.perSecond, 5, false)
+          .Bind("logging", "synchronous", s.logging.synchronous, false, false)
+
+          .Bind("shading", "gouraudDistance", s.shading.gouraudDistance, 0.0f, false)
+          .Bind("shading", "forceGouraud", s.shading.forceGouraud, false, false)
+          .Bind("shading", "lodDistance", s.shading.lodDistance, 0.0f, false)
+          .Bind("shading", "bindless", s.shading.bindless, true, false)
+          .Bind("shading", "depthPrePass", s.shading.depthPrePass, false, false)
+
+          .Bind("streaming", "bytesPerFrame", s.streaming.bytesPerFrame, 1 << 20, false)
+          .Bind("streaming", "textureBudgetMB", s.streaming.textureBudgetMB, 0, false)
+          .Bind("streaming", "textureBytesPerFrame", s.streaming.textureBytesPerFrame, 8 << 20, false)
+
+          .Bind("capture", "file", s.capture.file, "capture.gltrace", false)
+          .Bind("capture", "firstFrame", s.capture.firstFrame, 100, false)
+          .Bind("capture", "frameCount", s.capture.frameCount, 0, false)
+
+          .Bind("startup", "progressive", s.startup.progressive, true, false)
+          .Bind("startup", "loadBudgetMs", s.startup.loadBudgetMs, 8.0f, false)
+
+          .Bind("culling", "frustum", s.culling.frustum, true, false)
+          .Bind("culling", "occlusion", s.culling.occlusion, false, false)
+          .Bind("culling", "occlusionMaxAge", s.culling.occlusionMaxAge, 4, false)
+          .Bind("culling", "gpu", s.culling.gpu, false, false)
+
+          .Bind("particles", "count", s.particles.count, 0, false)
+          .Bind("particles", "emitRate", s.particles.emitRate, 20000.0f, false)
+          .Bind("particles", "lifetime", s.particles.lifetime, 4.0f, false)
+          .Bind("particles", "emitX", s.particles.emitter.x, 0.0f, false)
+          .Bind("particles", "emitY", s.particles.emitter.y, 2.0f, false)
+          .Bind("particles", "emitZ", s.particles.emitter.z, 0.0f, false)
+          .Bind("particles", "speed", s.particles.speed, 6.0f, false)
+          .Bind("particles", "size", s.particles.size, 0.02f, false)
+          .Bind("particles", "lit", s.particles.lit, true, false)
+
+          .Bind("environment", "enabled", s.environment.enabled, true, false)
+          .Bind("environment", "diffuse", s.environment.diffuse, 1.0f, false)
+          .Bind("environment", "specular", s.environment.specular, 0.5f, false);
+
+    ConfigReport report = schema.Apply(file);
+    if (file.ParseError() == -1) {
+        report.missing.insert(report.missing.begin(), path.string());
+    }
+    else if (file.ParseError() > 0) {
+        report.invalid.insert(report.invalid.begin(), path.string() + ":" + std::to_string(file.ParseError()));
+    }
+    return report;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include "glm\matrix.hpp"
+#include "Config.hpp"
+#include "Shapes\Shape.hpp"
+
+struct WindowSettings {
+    int width;
+    int height;
+    int refreshRate;
+    bool fullscreen;
+    std::string title;
+};
+
+struct CameraSettings {
+    float fov;
+    float zNear;
+    float zFar;
+};
+
+struct ProfilingSettings {
+    std::string traceFile;
+    bool traceOnExit;
+    bool forbidFrameAllocations;      // abort on a heap allocation in a steady frame, see Allocations.hpp
+    unsigned int allocationWarmupFrames; // frames after loading before frames count as steady
+};
+
+// What the log prints, see Log.hpp. The GL debug output is only on in Debug builds.
+struct LoggingSettings {
+    std::string minSeverity;  // notification, low, medium or high
+    unsigned int perSecond;   // messages of one ID printed a second, 0 prints them all
+    bool synchronous;         // GL calls its callback on the thread that caused the message
+};
+
+struct ShadingSettings {
+    float gouraudDistance; // objects further away are lit per vertex, 0 turns it off
+    bool forceGouraud;
+    float lodDistance;     // shapes drop a level of detail every lodDistance, 0 turns it off
+    bool bindless;         // use bindless textures if the driver has them
+    bool depthPrePass;     // lay down depth first, then shade only the visible fragments
+};
+
+// Frames firstFrame to firstFrame + frameCount - 1 are recorded for GlReplay, see GlCapture.hpp
+struct CaptureSettings {
+    std::string file;
+    unsigned int firstFrame;
+    unsigned int frameCount; // 0 records nothing
+};
+
+// Progressive startup draws the first frame before the scene is loaded, see SceneLoader
+struct StartupSettings {
+    bool progressive;
+    float loadBudgetMs; // time per frame spent building shapes while loading
+};
+
+// Which shapes are skipped before drawing, see Culler
+struct CullingSettings {
+    bool frustum;
+    bool occlusion;
+    unsigned int occlusionMaxAge; // frames a depth pyramid is used for
+    bool gpu;                     // cull and draw with compute and indirect draws, see GpuCuller
+};
+
+// A fountain simulated and drawn on the GPU, see ParticleSystem
+struct ParticleSettings {
+    unsigned int count;   // at most this many live at once, 0 turns them off
+    float emitRate;       // particles per second
+    float lifetime;       // seconds, each particle lives between half of it and all of it
+    glm::vec3 emitter;
+    float speed;
+    float size;           // half the side of a quad, in world units
+    bool lit;             // by the point lights
+};
+
+// Image based lighting from textures/cubemap, see EnvironmentMap
+struct EnvironmentSettings {
+    bool enabled;
+    float diffuse;  // strength of the irradiance, which takes over the ambient part from the directional light
+    float specular; // strength of the reflections
+};
+
+struct StreamingSettings {
+    unsigned int bytesPerFrame;
+    unsigned int textureBudgetMB;      // GPU memory for material textures, 0 keeps every level resident
+    unsigned int textureBytesPerFrame; // texture levels uploaded per frame while streaming
+};
+
+// What every kind of object has
+struct ObjectSettings {
+    Transformation transformation;
+    Surface surface;
+    glm::vec3 color;
+    std::string texture;
+};
+
+// Everything in settings.ini except the lights and objects, see Scene.hpp
+struct Settings {
+    WindowSettings window;
+    CameraSettings camera;
+    ProfilingSettings profiling;
+    LoggingSettings logging;
+    ShadingSettings shading;
+    StreamingSettings streaming;
+    CaptureSettings capture;
+    StartupSettings startup;
+    CullingSettings culling;
+    ParticleSettings particles;
+    EnvironmentSettings environment;
+};
+
+// Binds the keys every object section has to the fields of the object
+void bindObject(ConfigSchema &schema, std::string section, ObjectSettings &object, std::string &illumination);
+Illumination parseIllumination(std::string name);
+
+// Fills the settings from the file. Keys that are missing or invalid get their default.
+ConfigReport loadSettings(ConfigFile &file, std::filesystem::path path, Settings &settings);
@@ -4,119 +4,145 @@
 #include "glm\matrix.hpp"
 #include "glm/ext.hpp"
 #include <string>
+#include <iostream>
+#include "Profiler.hpp"
+#include "Log.hpp"
+
+// Prints the info log of a shader or program that failed to build
+static void printInfoLog(unsigned int id, bool isProgram) {
+    char log[1024];
+    if (isProgram) { glGetProgramInfoLog(id, sizeof(log), NULL, log); }
+    else { glGetShaderInfoLog(id, sizeof(log), NULL, log); }
+    Log::Message(LogSeverity::High, "Shader build failed: ", log);
+}
 
-Shader::Shader(std::string vertexShaderString, std::string fragmentShaderString, Shape &shape, Lights lights) {
-    const char *vertexShaderSource   = (const GLchar *)vertexShaderString.c_str();
-    const char *fragmentShaderSource = (const GLchar *)fragmentShaderString.c_str();
+std::string insertAfterVersion(const std::string &source, const std::string &lines) {
+    size_t versionEnd = source.find('\n', source.find("#version"));
+    versionEnd = versionEnd == std::string::npos ? source.size() : versionEnd + 1;
+    return source.substr(0, versionEnd) + lines + "#line 2\n" + source.substr(versionEnd);
+}
 
-    // get previously bound shader to restore later
-    GLint prevId;
-    glGetIntegerv(GL_CURRENT_PROGRAM,&prevId);
+Shader::Shader(std::string vertexShaderString, std::string fragmentShaderString)
+    : stageCount(0), status(Status::Pending), fallback(nullptr) {
+    PROFILE_ZONE("queue shader");
+    addStage(GL_VERTEX_SHADER, vertexShaderString);
+    addStage(GL_FRAGMENT_SHADER, fragmentShaderString);
+
+    // Build the shader program.
+    // Nothing is queried here, so the driver is free to do all of this later or on another thread.
+    program = GlProgram::Create();
+    for (unsigned int i = 0; i < stageCount; i++) { glAttachShader(program.ID(), stages[i]); }
+    glLinkProgram(program.ID());
+}
 
-    // Create the vertex shader
-    unsigned int vertexShader;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Create the fragment shader
-    unsigned int fragmentShader;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    
-    // Build the shader program
-    shaderID = glCreateProgram();
-    glAttachShader(shaderID, vertexShader);
-    glAttachShader(shaderID, fragmentShader);
-    glLinkProgram(shaderID);
-    
-    // The shaders have been linked and can now be deleted
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    // get the transformations from the shape
-    Transformation trans = shape.GetTransformation();
-
-    // Build the model matrix from the arguments
-    glm::mat4 translate = glm::translate(glm::mat4(1.0f), trans.translation);
-    glm::mat4 rotationX = glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * trans.rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-    glm::mat4 rotationY = glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * trans.rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 rotationZ = glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * trans.rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::mat4 rotation = rotationZ * rotationY * rotationX;
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), trans.scaling);
-	glm::mat4 model = translate * rotation * scale;
-
-    // Separate the two lights
-    DirectionLight &dirLight = lights.dirLight;
-    PointLight &pointLight   = lights.pointLight;
-
-    glUseProgram(shaderID);
-
-    // Set uniforms related to translating between spaces
-    viewProjLocation  = glGetUniformLocation(shaderID, "viewProj");
-    cameraPosLocation = glGetUniformLocation(shaderID, "cameraPos");
-	int modelLocation = glGetUniformLocation(shaderID, "model");
-	glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
-
-    // Set object uniforms
-	int colorLocation = glGetUniformLocation(shaderID, "color");
-    int kaLocation    = glGetUniformLocation(shaderID, "ka");
-    int kdLocation    = glGetUniformLocation(shaderID, "kd");
-    int ksLocation    = glGetUniformLocation(shaderID, "ks");
-    int alphaLocation = glGetUniformLocation(shaderID, "alpha");
-	glUniform3fv(colorLocation, 1, glm::value_ptr(shape.Color()));
-    glUniform1f(kaLocation, shape.GetSurface().ka);
-    glUniform1f(kdLocation, shape.GetSurface().kd);
-    glUniform1f(ksLocation, shape.GetSurface().ks);
-    glUniform1i(alphaLocation, shape.GetSurface().alpha);
-
-
-    // Set the directional light uniforms
-	int dirLightColorLocation = glGetUniformLocation(shaderID, "dirLightColor");
-	int dirLightDirLocation   = glGetUniformLocation(shaderID, "dirLightDir");
-	glUniform3fv(dirLightColorLocation, 1, glm::value_ptr(dirLight.color));
-	glUniform3fv(dirLightDirLocation, 1, glm::value_ptr(dirLight.direction));
-
-    // Set the point light uniforms 
-	int pointLightColorLocation = glGetUniformLocation(shaderID, "pointLightColor");
-	int pointLightPosLocation   = glGetUniformLocation(shaderID, "pointLightPos");
-	int attenuationLocation     = glGetUniformLocation(shaderID, "attenuation");
-	glUniform3fv(pointLightColorLocation, 1, glm::value_ptr(pointLight.color));
-	glUniform3fv(pointLightPosLocation, 1, glm::value_ptr(pointLight.position));
-	glUniform3fv(attenuationLocation, 1, glm::value_ptr(pointLight.attenuation));
-
-    // restore previously bound shader
-    glUseProgram(prevId);
+Shader::Shader(std::string computeShaderString)
+    : stageCount(0), status(Status::Pending), fallback(nullptr) {
+    PROFILE_ZONE("queue shader");
+    addStage(GL_COMPUTE_SHADER, computeShaderString);
+    program = GlProgram::Create();
+    glAttachShader(program.ID(), stages[0]);
+    glLinkProgram(program.ID());
 }
 
-unsigned int Shader::ID() { return shaderID; }
-int Shader::ViewProjLocation() { return viewProjLocation; }
-int Shader::CameraPosLocation() { return cameraPosLocation; }
+Shader::~Shader() {
+    // A build that was never finished still owns its shaders
+    if (status == Status::Pending) {
+        for (unsigned int i = 0; i < stageCount; i++) { glDeleteShader(stages[i]); }
+    }
+}
 
+void Shader::addStage(GLenum type, const std::string &source) {
+    const char *text = (const GLchar *)source.c_str();
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &text, NULL);
+    glCompileShader(shader);
+    stages[stageCount++] = shader;
+}
 
+void Shader::EnableParallelCompile() {
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+}
 
-BindShader::BindShader(Shader &shader, glm::mat4 viewProjMatrix) {
-    // get previously bound shader to restore later
-    glGetIntegerv(GL_CURRENT_PROGRAM,&prevId);
+void Shader::SetFallback(Shader &f) { fallback = &f; }
+
+bool Shader::IsReady() {
+    if (status == Status::Pending && GLEW_KHR_parallel_shader_compile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program.ID(), GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed) { return false; }
+    }
+    if (status == Status::Pending) { finish(); }
+    return status == Status::Ready;
+}
 
-    // bind new shader
-    glUseProgram(shader.ID());
-    glUniformMatrix4fv(shader.ViewProjLocation(), 1, GL_FALSE, glm::value_ptr(viewProjMatrix));
+bool Shader::IsSettled() {
+    IsReady();
+    return status != Status::Pending;
 }
 
-BindShader::BindShader(Shader &shader, Camera &camera) {
+void Shader::Wait() {
+    if (status == Status::Pending) { finish(); }
+}
+
+// Checks the result of the build. Blocks if the driver has not finished yet.
+void Shader::finish() {
+    PROFILE_ZONE("finish shader");
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program.ID(), GL_LINK_STATUS, &linked);
+    if (!linked) {
+        for (unsigned int i = 0; i < stageCount; i++) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(stages[i], GL_COMPILE_STATUS, &compiled);
+            if (!compiled) { printInfoLog(stages[i], false); }
+        }
+        printInfoLog(program.ID(), true);
+        status = Status::Failed;
+    }
+    else {
+        status = Status::Ready;
+    }
+
+    // The shaders have been linked and can now be deleted
+    for (unsigned int i = 0; i < stageCount; i++) {
+        glDetachShader(program.ID(), stages[i]);
+        glDeleteShader(stages[i]);
+    }
+}
+
+unsigned int Shader::ID() { return program.ID(); }
+
+size_t Shader::BinarySize() {
+    if (status != Status::Ready) { return 0; }
+    GLint length = 0;
+    glGetProgramiv(program.ID(), GL_PROGRAM_BINARY_LENGTH, &length);
+    return (size_t)length;
+}
+Shader *Shader::Fallback() { return fallback; }
+
+void Shader::Use() {
+    // bind this shader, or a cheap stand-in in the object's color while it is still being built
+    if (IsReady()) {
+        glUseProgram(program.ID());
+    }
+    else if (fallback && fallback->IsReady()) {
+        glUseProgram(fallback->ID());
+    }
+    else {
+        glUseProgram(0);
+    }
+}
+
+
+
+BindShader::BindShader(Shader &shader) {
     // get previously bound shader to restore later
     glGetIntegerv(GL_CURRENT_PROGRAM,&prevId);
-
-    // bind new shader
-    glUseProgram(shader.ID());
-    glUniformMatrix4fv(shader.ViewProjLocation(), 1, GL_FALSE, glm::value_ptr(camera.ViewProjMatrix()));
-    glUniform4fv(shader.CameraPosLocation(), 1, glm::value_ptr(camera.ViewPosMatrix()));
+    shader.Use();
 }
 
 // Restore previously used program when binding goes out of scope
 BindShader::~BindShader() {
     glUseProgram(prevId);
 }
-
@@ -5,31 +5,64 @@
 #include <GLFW/glfw3.h>
 #include "glm\matrix.hpp"
 #include "glm/ext.hpp"
-#include "Camera.hpp"
-#include "Shapes\Shape.hpp"
-#include "Lights.hpp"
+#include "GlHandle.hpp"
 
+// A shader program that is built in the background.
+// The constructor only queues the compile and link. Nothing waits for the driver
+// until IsReady() is asked, which with GL_KHR_parallel_shader_compile does not block either.
+// Programs have no uniforms of their own; the camera, lights and everything about the
+// object come from the frame and object uniform blocks (see Uniforms.hpp)
 class Shader {
 private:
-    unsigned int shaderID;
-    int viewProjLocation;
-    int cameraPosLocation;
+    enum class Status { Pending, Ready, Failed };
+
+    GlProgram program;
+    unsigned int stages[2]; // deleted once the program is built
+    unsigned int stageCount;
+    Status status;
+    Shader *fallback;
+    void addStage(GLenum type, const std::string &source);
+    void finish();
+
 public:
-    // TODO move rest of shape-related parameters into the Shape
-    Shader(std::string vertexShaderString, std::string fragmentShaderString, Shape &shape, Lights lights);
+    Shader(std::string vertexShaderString, std::string fragmentShaderString);
+    // A compute program, dispatched with glDispatchCompute after Use
+    explicit Shader(std::string computeShaderString);
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    ~Shader();
+
+    // Lets the driver compile on as many threads as it likes, if it supports it
+    static void EnableParallelCompile();
+
+    // Used while this program is not ready
+    void SetFallback(Shader &fallback);
+    // Polls the program without blocking if the driver supports it
+    bool IsReady();
+    // Whether the build is over, built or failed, polled like IsReady
+    bool IsSettled();
+    // Blocks until the program is built
+    void Wait();
     unsigned int ID();
-    int ViewProjLocation();
-    int CameraPosLocation();
+    // Size of the linked program as the driver would save it, 0 while it is not ready
+    size_t BinarySize();
+    Shader *Fallback();
+    // Binds the program, or its fallback while it is not ready, and leaves it bound
+    void Use();
 };
 
+// Inserts lines, e.g. #defines, right after the #version line of a shader source.
+// Line numbers after them are reset to match the original source.
+std::string insertAfterVersion(const std::string &source, const std::string &lines);
+
 // This struct exists to make sure that the previously bound
-// shader is restored when this binding goes out of scope
+// shader is restored when this binding goes out of scope.
+// If the shader is not ready yet its fallback is bound instead.
 struct BindShader {
 private:
     GLint prevId;
 
 public:
-    BindShader(Shader &shader, Camera &camera);
-    BindShader(Shader &shader, glm::mat4 viewProjMatrix);
+    BindShader(Shader &shader);
     ~BindShader();
 };
@@ -0,0 +1,66 @@
+#include "ShaderCache.hpp"
+#include "Uniforms.hpp"
+#include <string>
+
+ShaderCache::ShaderCache(std::string vertexShaderString, std::string fragmentShaderString, std::string commonString)
+    : vertexSource(vertexShaderString), fragmentSource(fragmentShaderString), commonSource(commonString) { }
+
+// Inserts the feature #defines and the common source right after the #version line
+std::string ShaderCache::inject(const std::string &source, unsigned int features) {
+    size_t versionEnd = source.find('\n', source.find("#version"));
+    versionEnd = versionEnd == std::string::npos ? source.size() : versionEnd + 1;
+
+    // Extensions have to come before any code, so this goes first
+    std::string defines = (features & SHADER_BINDLESS) ? "#extension GL_ARB_bindless_texture : require\n#define BINDLESS\n" : "";
+    defines += "#define MAX_POINT_LIGHTS " + std::to_string(MAX_POINT_LIGHTS) + "\n";
+    defines += "#define MAX_TEXTURE_ARRAYS " + std::to_string(MAX_TEXTURE_ARRAYS) + "\n";
+    defines += "#define ENVIRONMENT_TEXTURE_UNIT " + std::to_string(ENVIRONMENT_TEXTURE_UNIT) + "\n";
+    if (features & SHADER_GOURAUD)     { defines += "#define GOURAUD\n"; }
+    if (features & SHADER_DIR_LIGHT)   { defines += "#define DIR_LIGHT\n"; }
+    if (features & SHADER_POINT_LIGHT) { defines += "#define POINT_LIGHT\n"; }
+    if (features & SHADER_TEXTURED)    { defines += "#define TEXTURED\n"; }
+    if (features & SHADER_INDIRECT)    { defines += "#define INDIRECT\n"; }
+
+    // Reset the line numbers so compile errors point at the right line of the original file
+    return source.substr(0, versionEnd) + defines + commonSource + "\n#line 2\n" + source.substr(versionEnd);
+}
+
+Shader *ShaderCache::fallbackFor(unsigned int features) {
+    for (auto it = fallbacks.rbegin(); it != fallbacks.rend(); ++it) {
+        if ((features & it->first) == it->first) { return it->second; }
+    }
+    return nullptr;
+}
+
+void ShaderCache::SetFallback(Shader &f) { SetFallback(f, 0); }
+
+void ShaderCache::SetFallback(Shader &f, unsigned int features) {
+    fallbacks.emplace_back(features, &f);
+    for (auto &variant : variants) {
+        if ((variant.first & features) == features) { variant.second->SetFallback(f); }
+    }
+}
+
+Shader &ShaderCache::Get(unsigned int features) {
+    auto it = variants.find(features);
+    if (it != variants.end()) { return *it->second; }
+
+    std::unique_ptr<Shader> shader = std::make_unique<Shader>(inject(vertexSource, features), inject(fragmentSource, features));
+    if (Shader *fallback = fallbackFor(features)) { shader->SetFallback(*fallback); }
+    Shader &result = *shader;
+    variants.emplace(features, std::move(shader));
+    return result;
+}
+
+bool ShaderCache::AllSettled() {
+    bool settled = true;
+    for (auto &variant : variants) { settled = variant.second->IsSettled() && settled; }
+    return settled;
+}
+
+size_t ShaderCache::Size() { return variants.size(); }
+
+void ShaderCache::ReportMemory(MemoryReport &report) {
+    report.Add("shader sources", vertexSource.capacity() + fragmentSource.capacity() + commonSource.capacity(), 0);
+    for (auto &variant : variants) { report.Add("shader", sizeof(Shader), variant.second->BinarySize()); }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Shader.hpp"
+#include "MemoryReport.hpp"
+
+// Features a variant of the lit shaders is compiled with. Each is injected as a #define.
+#define SHADER_GOURAUD     (1 << 0) // light per vertex instead of per fragment
+#define SHADER_DIR_LIGHT   (1 << 1)
+#define SHADER_POINT_LIGHT (1 << 2)
+#define SHADER_TEXTURED    (1 << 3) // sample the material's texture instead of using its color
+#define SHADER_BINDLESS    (1 << 4) // material textures are bindless handles instead of bound arrays
+#define SHADER_INDIRECT    (1 << 5) // objects come from the object buffer by instance, for GPU-driven draws
+
+// Builds variants of one vertex/fragment shader pair on demand and keeps them by feature mask.
+// The common source (declarations and lighting functions) is inserted into both stages.
+class ShaderCache {
+private:
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::string commonSource;
+    std::unordered_map<unsigned int, std::unique_ptr<Shader>> variants;
+    std::vector<std::pair<unsigned int, Shader*>> fallbacks; // by the features they stand in for
+    Shader *fallbackFor(unsigned int features);
+    std::string inject(const std::string &source, unsigned int features);
+
+public:
+    ShaderCache(std::string vertexShaderString, std::string fragmentShaderString, std::string commonString);
+    // Used by every variant while it is still being built
+    void SetFallback(Shader &fallback);
+    // Used instead by the variants that have all of the features, the last one set wins
+    void SetFallback(Shader &fallback, unsigned int features);
+    // Returns the variant for the feature mask. The first request queues its build.
+    Shader &Get(unsigned int features);
+    // Whether every variant requested so far is built or failed to, without blocking on the ones that are not
+    bool AllSettled();
+    size_t Size();
+    // Adds every variant as a "shader" and the sources as "shader sources"
+    void ReportMemory(MemoryReport &report);
+};
@@ -4,7 +4,7 @@
 
 class Cylinder : public Shape {
 public:
-    Cylinder(float height, float radius, unsigned int sides, Surface srfc, Transformation trans, glm::vec3 col, fs::path texturePath);
+    Cylinder(float height, float radius, unsigned int sides, Surface srfc, Transformation trans, glm::vec3 col, MaterialRef material);
     ~Cylinder();
 };
 
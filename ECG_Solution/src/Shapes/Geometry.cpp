@@ -0,0 +1,285 @@
+#include "Geometry.hpp"
+#include "glm\matrix.hpp"
+#include "glm/ext.hpp"
+#include <glm/gtc/constants.hpp>
+#include <cmath>
+
+Geometry boxGeometry(float width, float height, float depth, std::pmr::memory_resource *memory) {
+    Geometry g(memory);
+    // The corners of the box
+    float vs[] = {
+         // x-axis normals
+         -width / 2,  height / 2, depth / 2,    // top left front
+         -1.0, 0.0, 0.0,
+         1.0, 1.0,
+         -width / 2,  -height / 2, depth / 2,   // bottom left front
+         -1.0, 0.0, 0.0,
+         1.0, 0.0,
+         width / 2,  height / 2, depth / 2,     // top right front
+         1.0, 0.0, 0.0,
+         0.0, 1.0,
+         width / 2,  -height / 2, depth / 2,    // bottom right front
+         1.0, 0.0, 0.0,
+         0.0, 0.0,
+         width / 2,  height / 2, -depth / 2,    // top right back
+         1.0, 0.0, 0.0,
+         1.0, 1.0,
+         width / 2,  -height / 2, -depth / 2,   // bottom right back
+         1.0, 0.0, 0.0,
+         1.0, 0.0,
+         -width / 2,  height / 2, -depth / 2,   // top left back
+         -1.0, 0.0, 0.0,
+         0.0, 1.0,
+         -width / 2,  -height / 2, -depth / 2,  // bottom left back
+         -1.0, 0.0, 0.0,
+         0.0, 0.0,
+
+        // y-axis normals
+         -width / 2,  height / 2, depth / 2,    // top left front
+         0.0, 1.0, 0.0,
+         0.0, 0.0,
+         -width / 2,  -height / 2, depth / 2,   // bottom left front
+         0.0, -1.0, 0.0,
+         0.0, 1.0,
+         width / 2,  height / 2, depth / 2,     // top right front
+         0.0, 1.0, 0.0,
+         1.0, 0.0,
+         width / 2,  -height / 2, depth / 2,    // bottom right front
+         0.0, -1.0, 0.0,
+         1.0, 1.0,
+         width / 2,  height / 2, -depth / 2,    // top right back
+         0.0, 1.0, 0.0,
+         1.0, 1.0,
+         width / 2,  -height / 2, -depth / 2,   // bottom right back
+         0.0, -1.0, 0.0,
+         1.0, 0.0,
+         -width / 2,  height / 2, -depth / 2,   // top left back
+         0.0, 1.0, 0.0,
+         0.0, 1.0,
+         -width / 2,  -height / 2, -depth / 2,  // bottom left back
+         0.0, -1.0, 0.0,
+         0.0, 0.0,
+
+         // z-axis normals
+         -width / 2,  height / 2, depth / 2,    // top left front
+         0.0, 0.0, 1.0,
+         0.0, 1.0,
+         -width / 2,  -height / 2, depth / 2,   // bottom left front
+         0.0, 0.0, 1.0,
+         0.0, 0.0,
+         width / 2,  height / 2, depth / 2,     // top right front
+         0.0, 0.0, 1.0,
+         1.0, 1.0,
+         width / 2,  -height / 2, depth / 2,    // bottom right front
+         0.0, 0.0, 1.0,
+         1.0, 0.0,
+         width / 2,  height / 2, -depth / 2,    // top right back
+         0.0, 0.0, -1.0,
+         1.0, 0.0,
+         width / 2,  -height / 2, -depth / 2,   // bottom right back
+         0.0, 0.0, -1.0,
+         1.0, 1.0,
+         -width / 2,  height / 2, -depth / 2,   // top left back
+         0.0, 0.0, -1.0,
+         0.0, 0.0,
+         -width / 2,  -height / 2, -depth / 2,  // bottom left back
+         0.0, 0.0, -1.0,
+         0.0, 1.0,
+
+    };
+
+    // The sides of the box as triangles
+    unsigned int is[] = {
+        16, 17, 18,   // front
+        19, 18, 17,
+        2, 3, 4,   // right
+        5, 4, 3,
+        20, 21, 22,   // back
+        23, 22, 21,
+        6, 7, 0,   // left
+        1, 0, 7,
+        8, 10, 14,   // top
+        12, 14, 10,
+        9, 15, 11,   // bottom
+        13, 11, 15
+    };
+    
+    // Add corners and triangles to the shape.
+    // It is done this way because the vertices and faces are generated dynamically for other shapes
+    g.vertices.assign(vs, std::end(vs));
+    g.indices.assign(is, std::end(is));
+    return g;
+}
+
+Geometry cylinderGeometry(float height, float radius, unsigned int sides, std::pmr::memory_resource *memory) {
+    Geometry g(memory);
+    // top and bottom middle vertices + normals
+    float vs[] = 
+    {
+        0.0f, height/2.0f, 0.0f,
+        0.0f, 1.0f, 0.0f,
+        0.5f, 0.5f,
+        0.0f, -height/2.0f, 0.0f,
+        0.0f, -1.0f, 0.0f,
+        0.5f, 0.5f
+    };
+
+
+    // Reserve everything up front, so the push_backs below never reallocate
+    g.vertices.reserve(((size_t)sides * 4 + 2) * 8);
+    g.indices.reserve((size_t)sides * 12);
+    g.vertices.assign(vs, std::end(vs));
+
+    // Add vertices and surfaces to the shape
+    for (unsigned int i = 0; i < sides; i++) {
+        float radians = (float)glm::radians((float)i * (360.0 / (float)sides));
+        float xUnit = glm::sin(radians);
+        float zUnit = glm::cos(radians);
+
+        float x = xUnit * radius;
+        float z = zUnit * radius;
+
+        // top vertex, top normal
+        g.vertices.push_back(x); 
+        g.vertices.push_back(height / 2.0f);
+        g.vertices.push_back(z);
+
+        g.vertices.push_back(0.0f); 
+        g.vertices.push_back(1.0f);
+        g.vertices.push_back(0.0f);
+
+        g.vertices.push_back((xUnit + 1.0f) / 2.0f);
+        g.vertices.push_back((zUnit + 1.0f) / 2.0f);
+
+        // bottom vertex, bottom normal
+        g.vertices.push_back(x); 
+        g.vertices.push_back(-height / 2.0f);
+        g.vertices.push_back(z);
+
+        g.vertices.push_back(0.0f); 
+        g.vertices.push_back(-1.0f);
+        g.vertices.push_back(0.0f);
+
+        g.vertices.push_back((xUnit + 1.0f) / 2.0f);
+        g.vertices.push_back((zUnit + 1.0f) / 2.0f);
+
+        // top vertex, side normal
+        g.vertices.push_back(x); 
+        g.vertices.push_back(height / 2.0f);
+        g.vertices.push_back(z);
+
+        g.vertices.push_back(x); 
+        g.vertices.push_back(0.0f);
+        g.vertices.push_back(z);
+
+        g.vertices.push_back(std::fmodf ((((float)i / (float)sides) + 0.5f), 1.0f));
+        //g.vertices.push_back(-(float)i / (float)sides);
+        g.vertices.push_back(1.0f);
+        
+        // bottom vertex, side normal
+        g.vertices.push_back(x); 
+        g.vertices.push_back(-height / 2.0f);
+        g.vertices.push_back(z);
+
+        g.vertices.push_back(x); 
+        g.vertices.push_back(0.0f);
+        g.vertices.push_back(z);
+
+        g.vertices.push_back(std::fmodf ((((float)i / (float)sides) + 0.5f), 1.0f));
+        g.vertices.push_back(0.0f);
+
+
+        // top surface
+        g.indices.push_back(0);
+        g.indices.push_back(4 * i + 2);
+        g.indices.push_back(((4 * (i + 1)) % (4 * sides)) + 2);
+
+        // bottom surface
+        g.indices.push_back(1);
+        g.indices.push_back((4 * (i+1) + 1) % (4 * sides) + 2);
+        g.indices.push_back((4 * i + 1) % (4 * sides) + 2);
+
+        // side triangle 1
+        g.indices.push_back(4 * i + 4);
+        g.indices.push_back((4 * i + 5));
+        g.indices.push_back(((4 * (i+1) + 2) % (4* sides)) + 2);
+
+        // side triangle 2
+        g.indices.push_back((4 * (i+1) + 3) % (4 * sides) + 2);
+        g.indices.push_back(((4 * (i+1) + 2) % (4* sides)) + 2);
+        g.indices.push_back((4 * i + 5));
+
+    }
+    return g;
+}
+
+Geometry sphereGeometry(unsigned int longSegments, unsigned int latSegments, float radius, std::pmr::memory_resource *memory) {
+    Geometry g(memory);
+    // Top and bottom vertex are special cases
+    float vs[] = {
+        0.0, radius, 0.0, 
+        0.0, radius, 0.0, 
+        0.5, 1.0,
+        0.0, -radius, 0.0,
+        0.0, -radius, 0.0,
+        0.5, 0.0
+    };
+
+    // Reserve everything up front, so the push_backs below never reallocate
+    g.vertices.reserve(((size_t)longSegments * (latSegments - 1) + 2) * 8);
+    g.indices.reserve((size_t)longSegments * latSegments * 6);
+    g.vertices.assign(vs, std::end(vs));
+
+    // Populate the vertex vector with vertices
+    for (unsigned int j = 1; j < latSegments; j++) {
+        float polar = j * glm::pi<float>() / latSegments;
+        for (unsigned int i = 0; i < longSegments; i++) {
+            float azimuth = i * 2 * glm::pi<float>() / longSegments;
+
+            float x = radius * glm::sin(polar) * glm::cos(azimuth);
+            float y = radius * glm::cos(polar);
+            float z = radius * glm::sin(polar) * glm::sin(azimuth);
+
+            // position
+            g.vertices.push_back(x);
+            g.vertices.push_back(y);
+            g.vertices.push_back(z);
+
+            // normal
+            g.vertices.push_back(x);
+            g.vertices.push_back(y);
+            g.vertices.push_back(z);
+
+            g.vertices.push_back(std::fmodf((((float)i / (float)longSegments)  + 0.25f), 1.0f));
+            g.vertices.push_back((float)j / (float)latSegments);
+        }
+    }
+    
+    // Populate the index vector with the faces that doesn't use the top or bottom vertex.
+    for (unsigned int j = 0; j < latSegments - 2; j++) {
+        for (unsigned int i = 0; i < longSegments; i++) {
+            g.indices.push_back(i + j * longSegments + 2);
+            g.indices.push_back(((i + 1) % longSegments) + j * longSegments + 2);
+            g.indices.push_back(i + longSegments + j * longSegments + 2);
+
+            g.indices.push_back(((i + 1) % longSegments) + longSegments + j * longSegments + 2);
+            g.indices.push_back(i + longSegments + j * longSegments + 2);
+            g.indices.push_back(((i + 1) % longSegments) + j * longSegments + 2);
+        }
+    }
+
+    // Add the top faces to the index vector
+    for (unsigned int i = 0; i < longSegments; ++i) {
+        g.indices.push_back(0);
+        g.indices.push_back(((i + 1) % longSegments) + 2);
+        g.indices.push_back(i+2);
+    }
+
+    // Add the bottom faces to the index vector
+    for (unsigned int i = 0; i < longSegments; ++i) {
+        g.indices.push_back(1);
+        g.indices.push_back(i+2+(longSegments * (latSegments - 2)));
+        g.indices.push_back(((i + 1) % longSegments) + 2 + longSegments * (latSegments - 2));
+    }
+    return g;
+}
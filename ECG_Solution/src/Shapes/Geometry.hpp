@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include <memory_resource>
+
+// Vertices are interleaved as position, normal and texture coordinates
+#define GEOMETRY_FLOATS_PER_VERTEX 8
+
+// The triangles of a shape, before they are uploaded or baked.
+// Nothing here touches OpenGL, so the mesh baker can generate shapes too.
+// Geometry that is only around until its upload can come from a scratch arena (see Memory.hpp).
+struct Geometry {
+    std::pmr::vector<float> vertices;
+    std::pmr::vector<unsigned int> indices;
+    Geometry(std::pmr::memory_resource *memory = std::pmr::get_default_resource()) : vertices(memory), indices(memory) { }
+};
+
+Geometry boxGeometry(float width, float height, float depth, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+Geometry cylinderGeometry(float height, float radius, unsigned int sides, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+Geometry sphereGeometry(unsigned int longSegments, unsigned int latSegments, float radius, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
@@ -0,0 +1,50 @@
+#include "MeshShape.hpp"
+#include "Geometry.hpp"
+#include "../MeshFile.hpp"
+#include "../MeshImport.hpp"
+#include "../Profiler.hpp"
+#include "../Memory.hpp"
+#include "../Log.hpp"
+
+MeshShape::MeshShape(Vfs &vfs, std::string path, Surface srfc, Transformation trans, glm::vec3 col, MaterialRef material) : Shape::Shape(material) {
+    PROFILE_ZONE("load mesh");
+    surface = srfc;
+    color = col;
+    transformation = trans;
+
+    // Source formats are imported on the fly, with a single level of detail
+    std::string name = packName(path);
+    std::string_view extension = std::string_view(name).substr((std::min)(name.size(), name.rfind('.')));
+    if (extension == ".obj" || extension == ".glb") {
+        VfsFile file = vfs.Open(path);
+        if (!file.IsOpen()) { return; }
+        ArenaScope scratch(Memory::Scratch());
+        Geometry geometry(&Memory::Scratch());
+        std::string error;
+        if (!importMesh(extension, file.Data(), file.Size(), geometry, error)) {
+            Log::Message(LogSeverity::Medium, "Can not import mesh: ", (path + ": " + error).c_str());
+            return;
+        }
+        initVAO(geometry);
+        return;
+    }
+
+    MeshFile mesh(vfs.Open(path), path);
+    if (!mesh.IsValid()) { return; }
+    const MeshFileHeader &header = mesh.Header();
+    if (header.vertexStride != GEOMETRY_FLOATS_PER_VERTEX * sizeof(float)) {
+        Log::Message(LogSeverity::Medium, "Mesh has vertices of the wrong size: ", (path + " has " + std::to_string(header.vertexStride) + " byte vertices, expected "
+                     + std::to_string(GEOMETRY_FLOATS_PER_VERTEX * sizeof(float))).c_str());
+        return;
+    }
+
+    upload((const float*)mesh.Vertices(), header.vertexCount, mesh.Indices(), header.indexCount);
+    boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    lods.reserve(header.lodCount);
+    for (unsigned int i = 0; i < header.lodCount; i++) {
+        lods.push_back({ mesh.Lods()[i].firstIndex, mesh.Lods()[i].indexCount });
+    }
+}
+
+MeshShape::~MeshShape() { }
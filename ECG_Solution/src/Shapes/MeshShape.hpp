@@ -0,0 +1,13 @@
+#pragma once
+#include "Shape.hpp"
+#include "../Vfs.hpp"
+
+// A shape whose triangles were baked into a mesh file by the MeshBaker (see MeshFile.hpp).
+// The vertices are uploaded straight from the mapped file and all its levels of detail are kept.
+// OBJ and binary glTF files are imported instead (see MeshImport.hpp), which is slower and has no levels of detail.
+class MeshShape : public Shape {
+public:
+    // The path is relative to the asset directory of the vfs
+    MeshShape(Vfs &vfs, std::string path, Surface srfc, Transformation trans, glm::vec3 col, MaterialRef material);
+    ~MeshShape();
+};
@@ -1,26 +1,124 @@
 #include "Shape.hpp"
 #include <GL\glew.h>
 #include <GLFW/glfw3.h>
+#include "../Profiler.hpp"
+#include "../Uniforms.hpp"
+#include "../ShaderCache.hpp"
+#include "../GlCapture.hpp"
+#include "../Memory.hpp"
+#include "Geometry.hpp"
+#include "Box.hpp"
+#include "Cylinder.hpp"
+#include "Sphere.hpp"
+#include "MeshShape.hpp"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 //#include "../Utils.h"
 namespace fs = std::filesystem;
 
-Shape::Shape(fs::path texturePath) : image(loadDDS(texturePath.string().c_str())) { }
+namespace {
+    bool positionStreams = false;
 
-void Shape::initVAO() {
-    unsigned int VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO); // Check for errors.
-    glGenBuffers(1, &EBO);
+    // Blocks fit the biggest kind of shape
+    FixedPool &shapePool() {
+        static FixedPool pool((std::max)({ sizeof(Box), sizeof(Cylinder), sizeof(Sphere), sizeof(MeshShape) }), 256);
+        return pool;
+    }
+}
+
+void *Shape::operator new(size_t size) { return shapePool().allocate(size); }
+void Shape::operator delete(void *p, size_t size) { shapePool().deallocate(p, size); }
+void Shape::ReportPoolMemory(MemoryReport &report) { shapePool().ReportMemory(report, "shape pool"); }
+void Shape::UsePositionStreams(bool use) { positionStreams = use; }
+
+Shape::Shape(MaterialRef mat) : vertexCount(0), indexCount(0), gpuBytes(0), uvDensity(0.0f), material(mat), lod(0), boundsMin(0.0f), boundsMax(0.0f) {
+    objectUniforms = { nullptr, 0, 0, 0 };
+}
+
+// Build the model matrix from the transformation
+glm::mat4 modelMatrix(const Transformation &transformation) {
+    glm::mat4 translate = glm::translate(glm::mat4(1.0f), transformation.translation);
+    glm::mat4 rotationX = glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * transformation.rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
+    glm::mat4 rotationY = glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * transformation.rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 rotationZ = glm::rotate(glm::mat4(1.0f), glm::radians(360.0f * transformation.rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 rotation = rotationZ * rotationY * rotationX;
+    glm::mat4 scale = glm::scale(glm::mat4(1.0f), transformation.scaling);
+    return translate * rotation * scale;
+}
+
+glm::mat4 Shape::ModelMatrix() {
+    return modelMatrix(transformation);
+}
+
+unsigned int Shape::Features() {
+    unsigned int features = 0;
+    if (surface.illumination == Illumination::Gouraud) { features |= SHADER_GOURAUD; }
+    if (material.textured) { features |= SHADER_TEXTURED; }
+    return features;
+}
+
+void Shape::StreamUniforms(UploadRing &ring) {
+    ObjectUniforms uniforms;
+    uniforms.model = ModelMatrix();
+    // Computed once here instead of once per vertex in the shader
+    uniforms.normalMatrix = glm::transpose(glm::inverse(uniforms.model));
+    uniforms.material = glm::uvec4(material.index, 0, 0, 0);
+
+    objectUniforms = ring.AllocateUniform(sizeof(ObjectUniforms));
+    if (objectUniforms.data) {
+        std::memcpy(objectUniforms.data, &uniforms, sizeof(ObjectUniforms));
+    }
+}
+
+void Shape::initVAO(const Geometry &geometry) {
+    const std::pmr::vector<float> &vertices = geometry.vertices;
+    if (!vertices.empty()) {
+        boundsMin = boundsMax = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    }
+    for (size_t i = 0; i < vertices.size(); i += GEOMETRY_FLOATS_PER_VERTEX) {
+        glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    upload(vertices.data(), vertices.size() / GEOMETRY_FLOATS_PER_VERTEX, geometry.indices.data(), geometry.indices.size());
+    lods = { { 0, (unsigned int)geometry.indices.size() } };
+}
+
+void Shape::upload(const float *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount) {
+    PROFILE_ZONE("upload mesh");
+    vao = GlVertexArray::Create();
+    vertexBuffer = GlBuffer::Create();
+    indexBuffer = GlBuffer::Create();
+    size_t vertexBytes = vertexCount * GEOMETRY_FLOATS_PER_VERTEX * sizeof(float);
+    size_t indexBytes = indexCount * sizeof(unsigned int);
+    this->vertexCount = (unsigned int)vertexCount;
+    this->indexCount = (unsigned int)indexCount;
+    gpuBytes = vertexBytes + indexBytes;
+
+    // Ratio of the texture area to the surface area
+    double uvArea = 0.0, surfaceArea = 0.0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        if (indexData[i] >= vertexCount || indexData[i + 1] >= vertexCount || indexData[i + 2] >= vertexCount) { continue; }
+        const float *v0 = vertexData + (size_t)indexData[i] * GEOMETRY_FLOATS_PER_VERTEX;
+        const float *v1 = vertexData + (size_t)indexData[i + 1] * GEOMETRY_FLOATS_PER_VERTEX;
+        const float *v2 = vertexData + (size_t)indexData[i + 2] * GEOMETRY_FLOATS_PER_VERTEX;
+        glm::vec3 e1 = glm::vec3(v1[0], v1[1], v1[2]) - glm::vec3(v0[0], v0[1], v0[2]);
+        glm::vec3 e2 = glm::vec3(v2[0], v2[1], v2[2]) - glm::vec3(v0[0], v0[1], v0[2]);
+        surfaceArea += glm::length(glm::cross(e1, e2));
+        uvArea += std::abs((v1[6] - v0[6]) * (v2[7] - v0[7]) - (v2[6] - v0[6]) * (v1[7] - v0[7]));
+    }
+    uvDensity = surfaceArea > 0.0 ? (float)std::sqrt(uvArea / surfaceArea) : 0.0f;
 
     // ..:: Initialization code :: ..
     // 1. bind Vertex Array Object
-    glBindVertexArray(VAO);
+    glBindVertexArray(vao.ID());
     // 2. copy our vertices array into a vertex buffer for OpenGL to use
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.ID());
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
     // 3. copy our index array into an element buffer for OpenGL to use
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ID());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
     // 4. then set the vertex attributes pointers
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(0 * sizeof(float)));
     glEnableVertexAttribArray(0);
@@ -28,27 +126,90 @@ void Shape::initVAO() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);  
+    glBindVertexArray(0);
 
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    if (image.data) {
-        glCompressedTexImage2D(GL_TEXTURE_2D, 0, image.format, image.width, image.height, 0, image.size, image.data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    if (positionStreams) {
+        ArenaScope scratch(Memory::Scratch());
+        std::pmr::vector<float> positions(vertexCount * 3, &Memory::Scratch());
+        for (size_t i = 0; i < vertexCount; i++) {
+            std::memcpy(&positions[i * 3], vertexData + i * GEOMETRY_FLOATS_PER_VERTEX, 3 * sizeof(float));
+        }
+        positionVao = GlVertexArray::Create();
+        positionBuffer = GlBuffer::Create();
+        glBindVertexArray(positionVao.ID());
+        glBindBuffer(GL_ARRAY_BUFFER, positionBuffer.ID());
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ID());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        gpuBytes += positions.size() * sizeof(float);
     }
-
 }
 
 void Shape::Draw() {
     glPointSize(5.0f); // tmp line, remove
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glBindVertexArray(VAO);
-    //glDrawArrays(GL_POINTS, 0, vertices.size());
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    if (objectUniforms.data) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORM_BINDING, objectUniforms.buffer, objectUniforms.offset, objectUniforms.size);
+    }
+    glBindVertexArray(vao.ID());
+    if (lod < lods.size()) {
+        glDrawElements(GL_TRIANGLES, lods[lod].indexCount, GL_UNSIGNED_INT, (void*)(lods[lod].firstIndex * sizeof(unsigned int)));
+    }
     glBindVertexArray(0); // find previous bound and restore it.
 }
 
+void Shape::DrawDepth() {
+    if (objectUniforms.data) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORM_BINDING, objectUniforms.buffer, objectUniforms.offset, objectUniforms.size);
+    }
+    glBindVertexArray(positionVao.ID() ? positionVao.ID() : vao.ID());
+    if (lod < lods.size()) {
+        glDrawElements(GL_TRIANGLES, lods[lod].indexCount, GL_UNSIGNED_INT, (void*)(lods[lod].firstIndex * sizeof(unsigned int)));
+    }
+    glBindVertexArray(0);
+}
+
+unsigned int Shape::LodCount() { return (unsigned int)lods.size(); }
+const std::vector<MeshLod> &Shape::Lods() { return lods; }
+ShapeBuffers Shape::Buffers() { return { vertexBuffer.ID(), indexBuffer.ID(), vertexCount, indexCount }; }
+
+void Shape::SelectLod(float distance, float lodDistance) {
+    lod = 0;
+    if (lodDistance > 0.0f && lods.size() > 1) {
+        lod = (std::min)((unsigned int)(distance / lodDistance), (unsigned int)lods.size() - 1);
+    }
+}
+
+void Shape::ReportMemory(MemoryReport &report) {
+    report.Add("mesh", sizeof(*this) + lods.capacity() * sizeof(MeshLod), gpuBytes);
+}
+
+float Shape::UvPerPixel(const glm::mat4 &viewProj, float viewportHeight) {
+    glm::vec3 scaling = glm::abs(transformation.scaling);
+    float scale = (std::max)({ scaling.x, scaling.y, scaling.z });
+    float radius = 0.5f * glm::length(boundsMax - boundsMin) * scale;
+    glm::vec4 center = viewProj * ModelMatrix() * glm::vec4(0.5f * (boundsMin + boundsMax), 1.0f);
+
+    // The rows of viewProj are scaled rows of the view rotation, their lengths are the projection's scales
+    float scaleX = glm::length(glm::vec3(viewProj[0][0], viewProj[1][0], viewProj[2][0]));
+    float scaleY = glm::length(glm::vec3(viewProj[0][1], viewProj[1][1], viewProj[2][1]));
+    if (center.w < -radius || std::abs(center.x) > center.w + radius * scaleX || std::abs(center.y) > center.w + radius * scaleY) {
+        return -1.0f;
+    }
+
+    // Pixels per world unit at the closest point of the bounding sphere
+    float distance = (std::max)(center.w - radius, 0.001f);
+    float pixelsPerUnit = scaleY * 0.5f * viewportHeight / distance;
+    return uvDensity / (std::max)(scale, 0.0001f) / pixelsPerUnit;
+}
+
+MaterialRef Shape::Material() { return material; }
+void Shape::SetMaterial(MaterialRef m) { material = m; }
+
+glm::vec3 Shape::BoundsMin() { return boundsMin; }
+glm::vec3 Shape::BoundsMax() { return boundsMax; }
+
 Surface &Shape::GetSurface() { return surface; }
 Transformation &Shape::GetTransformation() { return transformation; }
 glm::vec3 Shape::Color() { return color; }
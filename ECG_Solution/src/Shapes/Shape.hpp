@@ -4,15 +4,23 @@
 #include "glm/ext.hpp"
 #include <vector>
 #include "../Utils.h"
+#include "../UploadRing.hpp"
+#include "../GlHandle.hpp"
+#include "../MemoryReport.hpp"
+#include "Geometry.hpp"
 #include <filesystem>
 namespace fs = std::filesystem;
 
+// Where the lighting of a surface is evaluated
+enum class Illumination { Phong, Gouraud };
+
 // Describes the lighting properties of a surface
 struct Surface {
     float ka;
     float kd;
     float ks;
     int alpha;
+    Illumination illumination = Illumination::Phong;
 };
 
 // Describes a transformation into world space
@@ -22,21 +30,96 @@ struct Transformation {
     glm::vec3 scaling;
 };
 
+// The model matrix of a transformation: scale, then rotate about X, Y and Z, then translate
+glm::mat4 modelMatrix(const Transformation &transformation);
+
+// A range of the index buffer. Level 0 is the most detailed.
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+// The GL buffers of a shape's geometry, for copying it into shared buffers (see GpuCuller)
+struct ShapeBuffers {
+    unsigned int vertexBuffer; // interleaved, see Geometry.hpp
+    unsigned int indexBuffer;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+};
+
+// A material of the scene's MaterialTable (see Materials.hpp)
+struct MaterialRef {
+    unsigned int index;
+    bool textured;
+    bool placeholder; // the texture is still loading, the shape is drawn untextured in its color until then
+};
+
 class Shape
 {
 protected:
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    unsigned int VAO, texture;
-    void initVAO();
+    // Only the GL buffers are kept, the vertices and indices are dropped once uploaded
+    GlVertexArray vao;
+    GlBuffer vertexBuffer;
+    GlBuffer indexBuffer;
+    // Tightly packed positions sharing the index buffer, for the depth pre-pass. Empty unless enabled.
+    GlVertexArray positionVao;
+    GlBuffer positionBuffer;
+    unsigned int vertexCount, indexCount;
+    size_t gpuBytes;
+    float uvDensity; // texture coordinate units per object space unit, on average over the surface
+    MaterialRef material;
+    std::vector<MeshLod> lods;
+    unsigned int lod;
+    glm::vec3 boundsMin, boundsMax;
+    // Uploads the geometry with a single level of detail and keeps its bounds
+    void initVAO(const Geometry &geometry);
+    // Uploads interleaved vertices (see Geometry.hpp) from anywhere, e.g. a mapped mesh file.
+    // Leaves the bounds and levels of detail to the caller.
+    void upload(const float *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount);
     Surface surface;
     glm::vec3 color;
     Transformation transformation;
-    DDSImage image;
+    UploadAllocation objectUniforms;
 
 public:
-    Shape(fs::path texturePath);
+    // The material, and its texture, are shared with other shapes and not owned
+    Shape(MaterialRef material);
+    // Scenes keep their shapes behind pointers to Shape
+    virtual ~Shape() { }
+    // Shapes of every kind come from one pool, so a scene of thousands does not allocate them one by one.
+    // They are created and destroyed on the render thread only.
+    static void *operator new(size_t size);
+    static void operator delete(void *p, size_t size);
+    // Adds the pool as "shape pool"
+    static void ReportPoolMemory(MemoryReport &report);
+    glm::mat4 ModelMatrix();
+    // The shader features (see ShaderCache.hpp) this shape needs
+    unsigned int Features();
+    // Writes this frame's object uniforms to the ring. Must be done before Draw.
+    // Draw needs the material buffer and textures to be bound, see MaterialTable::Bind.
+    void StreamUniforms(UploadRing &ring);
     void Draw();
+    // Draws the selected level of detail from the position-only stream, for a depth pre-pass.
+    // Shapes without one draw from the interleaved vertices.
+    void DrawDepth();
+    // Shapes uploaded from now on get a position-only vertex stream next to the interleaved one
+    static void UsePositionStreams(bool use);
+    unsigned int LodCount();
+    const std::vector<MeshLod> &Lods();
+    ShapeBuffers Buffers();
+    // Picks a coarser level of detail for every lodDistance the shape is away, 0 always picks level 0
+    void SelectLod(float distance, float lodDistance);
+    // How far the texture coordinates move from one pixel to the next where the shape is closest
+    // to the camera, for texture streaming. Negative if the shape is out of view.
+    float UvPerPixel(const glm::mat4 &viewProj, float viewportHeight);
+    MaterialRef Material();
+    // For materials that change once their texture is in, see SceneLoader
+    void SetMaterial(MaterialRef material);
+    // Axis aligned bounds in object space
+    glm::vec3 BoundsMin();
+    glm::vec3 BoundsMax();
+    // Adds the shape's buffers and bookkeeping as a "mesh"
+    void ReportMemory(MemoryReport &report);
     Surface &GetSurface();
     glm::vec3 Color();
     Transformation &GetTransformation();
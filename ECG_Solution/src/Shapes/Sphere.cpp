@@ -1,4 +1,7 @@
 #include "Sphere.hpp"
+#include "../Profiler.hpp"
+#include "../Memory.hpp"
+#include "Geometry.hpp"
 #include "glm\matrix.hpp"
 #include "glm/ext.hpp"
 #include <vector>
@@ -7,77 +10,15 @@
 
 
 
-Sphere::Sphere(unsigned int longSegments, unsigned int latSegments, float radius, Surface srfc, Transformation trans, glm::vec3 col, fs::path texturePath) : Shape::Shape(texturePath) {
+Sphere::Sphere(unsigned int longSegments, unsigned int latSegments, float radius, Surface srfc, Transformation trans, glm::vec3 col, MaterialRef material) : Shape::Shape(material) {
+    PROFILE_ZONE("generate sphere");
     surface = srfc;
     color = col;
     transformation = trans;
-    // Top and bottom vertex are special cases
-    float vs[] = {
-        0.0, radius, 0.0, 
-        0.0, radius, 0.0, 
-        0.5, 1.0,
-        0.0, -radius, 0.0,
-        0.0, -radius, 0.0,
-        0.5, 0.0
-    };
 
-    // initialize vectors. Might be changed to arrays at some point.
-    vertices = std::vector<float>(vs, std::end(vs));
-    indices = std::vector<unsigned int>((std::vector<unsigned int>::size_type) 0);
-
-    // Populate the vertex vector with vertices
-    for (unsigned int j = 1; j < latSegments; j++) {
-        float polar = j * glm::pi<float>() / latSegments;
-        for (unsigned int i = 0; i < longSegments; i++) {
-            float azimuth = i * 2 * glm::pi<float>() / longSegments;
-
-            float x = radius * glm::sin(polar) * glm::cos(azimuth);
-            float y = radius * glm::cos(polar);
-            float z = radius * glm::sin(polar) * glm::sin(azimuth);
-
-            // position
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-
-            // normal
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-
-            vertices.push_back(std::fmodf((((float)i / (float)longSegments)  + 0.25f), 1.0f));
-            vertices.push_back((float)j / (float)latSegments);
-        }
-    }
-    
-    // Populate the index vector with the faces that doesn't use the top or bottom vertex.
-    for (unsigned int j = 0; j < latSegments - 2; j++) {
-        for (unsigned int i = 0; i < longSegments; i++) {
-            indices.push_back(i + j * longSegments + 2);
-            indices.push_back(((i + 1) % longSegments) + j * longSegments + 2);
-            indices.push_back(i + longSegments + j * longSegments + 2);
-
-            indices.push_back(((i + 1) % longSegments) + longSegments + j * longSegments + 2);
-            indices.push_back(i + longSegments + j * longSegments + 2);
-            indices.push_back(((i + 1) % longSegments) + j * longSegments + 2);
-        }
-    }
-
-    // Add the top faces to the index vector
-    for (unsigned int i = 0; i < longSegments; ++i) {
-        indices.push_back(0);
-        indices.push_back(((i + 1) % longSegments) + 2);
-        indices.push_back(i+2);
-    }
-
-    // Add the bottom faces to the index vector
-    for (unsigned int i = 0; i < longSegments; ++i) {
-        indices.push_back(1);
-        indices.push_back(i+2+(longSegments * (latSegments - 2)));
-        indices.push_back(((i + 1) % longSegments) + 2 + longSegments * (latSegments - 2));
-    }
-
-    initVAO();
+    // The generated geometry is only needed until it is uploaded
+    ArenaScope scratch(Memory::Scratch());
+    initVAO(sphereGeometry(longSegments, latSegments, radius, &Memory::Scratch()));
 }
 
 Sphere::~Sphere()
@@ -4,7 +4,7 @@
 
 class Sphere : public Shape {
 public:
-    Sphere(unsigned int longSegments, unsigned int latSegments, float radius, Surface srfc, Transformation trans, glm::vec3 col, fs::path texturePath);
+    Sphere(unsigned int longSegments, unsigned int latSegments, float radius, Surface srfc, Transformation trans, glm::vec3 col, MaterialRef material);
     ~Sphere();
 };
 
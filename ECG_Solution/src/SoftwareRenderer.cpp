@@ -0,0 +1,601 @@
+#include "SoftwareRenderer.hpp"
+#include "BlockCompress.hpp"
+#include "MeshFile.hpp"
+#include "MeshImport.hpp"
+#include "Profiler.hpp"
+#include "Uniforms.hpp"
+#include "Log.hpp"
+#include "glm/ext.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE2
+#endif
+
+namespace {
+    typedef SoftwareRenderer::TransformedVertex Vertex;
+
+    // Marks bin entries that point at a clipped triangle instead of one of the object
+    const uint32_t CLIPPED_TRIANGLE = 0x80000000u;
+    // Triangles reaching further than this many w outside the screen are clipped, so the
+    // screen coordinates stay small enough for exact edge functions
+    const float GUARD_BAND = 16.0f;
+
+    // Runs work(thread) on threadCount threads, one of them the caller's
+    template <typename Work>
+    void runParallel(unsigned int threadCount, Work work) {
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < threadCount; i++) { workers.emplace_back(work, i); }
+        work(0u);
+        for (std::thread &worker : workers) { worker.join(); }
+    }
+
+    // The lights of lighting.glsl, with the switched off ones left out like the shader variants do
+    struct Lighting {
+        bool dirLight;
+        glm::vec3 dirColor;
+        glm::vec3 dirDirection;
+        const std::vector<PointLight> *pointLights;
+        glm::vec3 cameraPos;
+    };
+
+    // shade() of lighting.glsl
+    void shade(const Surface &surface, glm::vec3 nNorm, glm::vec3 fragPos, const Lighting &lighting, glm::vec3 &diffuse, glm::vec3 &specular) {
+        float alpha = (float)surface.alpha;
+        glm::vec3 viewDir = glm::normalize(lighting.cameraPos - fragPos);
+        diffuse = glm::vec3(0.0f);
+        specular = glm::vec3(0.0f);
+
+        if (lighting.dirLight) {
+            glm::vec3 direction = glm::normalize(lighting.dirDirection);
+            float dirDiff = (std::max)(glm::dot(nNorm, -direction), 0.0f);
+            float dirSpec = std::pow((std::max)(glm::dot(viewDir, glm::reflect(direction, nNorm)), 0.0f), alpha);
+            diffuse += (surface.ka + surface.kd * dirDiff) * lighting.dirColor;
+            specular += surface.ks * dirSpec * lighting.dirColor;
+        }
+
+        for (const PointLight &light : *lighting.pointLights) {
+            glm::vec3 pointLightDir = fragPos - light.position;
+            float d = glm::length(pointLightDir);
+            float att = 1.0f / (light.attenuation.z + d * light.attenuation.y + d * d * light.attenuation.x);
+            glm::vec3 direction = glm::normalize(pointLightDir);
+            float pointDiff = (std::max)(glm::dot(nNorm, -direction), 0.0f);
+            float pointSpec = std::pow((std::max)(glm::dot(viewDir, glm::reflect(direction, nNorm)), 0.0f), alpha);
+            diffuse += att * surface.kd * pointDiff * light.color;
+            specular += att * surface.ks * pointSpec * light.color;
+        }
+    }
+
+    // Bilinear filtering of one level with GL_REPEAT. The first row is at t = 0, like the uploaded DDS rows.
+    glm::vec4 sampleBilinear(const Image &level, float u, float v) {
+        float x = u * level.width - 0.5f, y = v * level.height - 0.5f;
+        float x0f = std::floor(x), y0f = std::floor(y);
+        float fx = x - x0f, fy = y - y0f;
+        int w = (int)level.width, h = (int)level.height;
+        int x0 = ((int)x0f % w + w) % w, y0 = ((int)y0f % h + h) % h;
+        int x1 = x0 + 1 == w ? 0 : x0 + 1, y1 = y0 + 1 == h ? 0 : y0 + 1;
+        const unsigned char *p00 = &level.pixels[((size_t)y0 * w + x0) * 4];
+        const unsigned char *p01 = &level.pixels[((size_t)y0 * w + x1) * 4];
+        const unsigned char *p10 = &level.pixels[((size_t)y1 * w + x0) * 4];
+        const unsigned char *p11 = &level.pixels[((size_t)y1 * w + x1) * 4];
+        glm::vec4 color;
+        for (int c = 0; c < 4; c++) {
+            float top = p00[c] + (p01[c] - p00[c]) * fx;
+            float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+            color[c] = (top + (bottom - top) * fy) * (1.0f / 255.0f);
+        }
+        return color;
+    }
+
+    // GL_LINEAR_MIPMAP_LINEAR
+    glm::vec4 sampleTrilinear(const SoftwareTexture &texture, float u, float v, float lod) {
+        float last = (float)(texture.levels.size() - 1);
+        lod = (std::min)((std::max)(lod, 0.0f), last);
+        size_t level = (size_t)lod;
+        float blend = lod - (float)level;
+        glm::vec4 color = sampleBilinear(texture.levels[level], u, v);
+        if (blend > 0.0f) { color += (sampleBilinear(texture.levels[level + 1], u, v) - color) * blend; }
+        return color;
+    }
+
+    uint32_t packColor(glm::vec3 color) {
+        color = glm::clamp(color, 0.0f, 1.0f);
+        uint32_t r = (uint32_t)(color.r * 255.0f + 0.5f);
+        uint32_t g = (uint32_t)(color.g * 255.0f + 0.5f);
+        uint32_t b = (uint32_t)(color.b * 255.0f + 0.5f);
+        return r | (g << 8) | (b << 16) | 0xFF000000u;
+    }
+
+    // Window coordinates with the first row at the top, and the depth GL would write
+    glm::vec3 project(const glm::vec4 &clip, float width, float height) {
+        float invW = 1.0f / clip.w;
+        return glm::vec3((clip.x * invW * 0.5f + 0.5f) * width, (0.5f - clip.y * invW * 0.5f) * height, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Signed area in window coordinates. Since y points down, GL's counter clockwise
+    // front faces are negative here.
+    float windowArea(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2) {
+        return (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+    }
+
+    Vertex lerp(const Vertex &a, const Vertex &b, float t) {
+        Vertex v;
+        v.clip = a.clip + (b.clip - a.clip) * t;
+        for (int i = 0; i < 8; i++) { v.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t; }
+        return v;
+    }
+
+    // Distance to the near plane and the guard band, positive inside
+    float planeDistance(const glm::vec4 &clip, int plane) {
+        switch (plane) {
+            case 0:  return clip.z + clip.w;
+            case 1:  return GUARD_BAND * clip.w - clip.x;
+            case 2:  return GUARD_BAND * clip.w + clip.x;
+            case 3:  return GUARD_BAND * clip.w - clip.y;
+            default: return GUARD_BAND * clip.w + clip.y;
+        }
+    }
+
+    // Sutherland-Hodgman against the planes of planeDistance. Returns the vertex count of the polygon.
+    int clipPolygon(Vertex *polygon, int count, unsigned int planes) {
+        Vertex scratch[9];
+        for (int plane = 0; plane < 5 && count > 0; plane++) {
+            if (!(planes & (1u << plane))) { continue; }
+            int out = 0;
+            for (int i = 0; i < count; i++) {
+                const Vertex &a = polygon[i];
+                const Vertex &b = polygon[(i + 1) % count];
+                float da = planeDistance(a.clip, plane), db = planeDistance(b.clip, plane);
+                if (da >= 0.0f) { scratch[out++] = a; }
+                if ((da >= 0.0f) != (db >= 0.0f)) { scratch[out++] = lerp(a, b, da / (da - db)); }
+            }
+            std::copy(scratch, scratch + out, polygon);
+            count = out;
+        }
+        return count;
+    }
+
+    // Everything the tile loop needs of one triangle
+    struct RasterTriangle {
+        float a[3], b[3], c[3]; // edge functions, positive inside, edge i is opposite vertex i
+        bool owns[3];           // top-left rule: pixel centers exactly on the edge belong to the triangle
+        float invArea;
+        float depth[3];
+        float invW[3];
+        float attributes[3][8]; // divided by w, for perspective correct interpolation
+        float dWdx, dWdy, dUdx, dUdy, dVdx, dVdy;
+        int minX, minY, maxX, maxY;
+    };
+
+    bool setupTriangle(const Vertex *v[3], float width, float height, bool backfaceCulling, RasterTriangle &t) {
+        glm::vec3 p[3];
+        for (int i = 0; i < 3; i++) { p[i] = project(v[i]->clip, width, height); }
+        float area = windowArea(p[0], p[1], p[2]);
+        if (area == 0.0f || (backfaceCulling && area > 0.0f)) { return false; }
+
+        for (int i = 0; i < 3; i++) {
+            glm::vec3 &p1 = p[(i + 1) % 3], &p2 = p[(i + 2) % 3];
+            t.a[i] = p1.y - p2.y;
+            t.b[i] = p2.x - p1.x;
+            t.c[i] = p1.x * p2.y - p2.x * p1.y;
+        }
+        float edgeArea = t.a[0] * p[0].x + t.b[0] * p[0].y + t.c[0];
+        if (edgeArea == 0.0f) { return false; }
+        if (edgeArea < 0.0f) {
+            for (int i = 0; i < 3; i++) { t.a[i] = -t.a[i]; t.b[i] = -t.b[i]; t.c[i] = -t.c[i]; }
+            edgeArea = -edgeArea;
+        }
+        t.invArea = 1.0f / edgeArea;
+
+        t.dWdx = t.dWdy = t.dUdx = t.dUdy = t.dVdx = t.dVdy = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            t.owns[i] = t.a[i] > 0.0f || (t.a[i] == 0.0f && t.b[i] > 0.0f);
+            t.depth[i] = p[i].z;
+            t.invW[i] = 1.0f / v[i]->clip.w;
+            for (int k = 0; k < 8; k++) { t.attributes[i][k] = v[i]->attributes[k] * t.invW[i]; }
+            float dx = t.a[i] * t.invArea, dy = t.b[i] * t.invArea;
+            t.dWdx += dx * t.invW[i];          t.dWdy += dy * t.invW[i];
+            t.dUdx += dx * t.attributes[i][6]; t.dUdy += dy * t.attributes[i][6];
+            t.dVdx += dx * t.attributes[i][7]; t.dVdy += dy * t.attributes[i][7];
+        }
+
+        float minX = (std::min)({ p[0].x, p[1].x, p[2].x }), maxX = (std::max)({ p[0].x, p[1].x, p[2].x });
+        float minY = (std::min)({ p[0].y, p[1].y, p[2].y }), maxY = (std::max)({ p[0].y, p[1].y, p[2].y });
+        t.minX = (int)std::floor((std::max)(minX, 0.0f));
+        t.minY = (int)std::floor((std::max)(minY, 0.0f));
+        t.maxX = (int)std::ceil((std::min)(maxX, width));
+        t.maxY = (int)std::ceil((std::min)(maxY, height));
+        return t.minX < t.maxX && t.minY < t.maxY;
+    }
+
+    struct ShadeContext {
+        const SoftwareObject *object;
+        const SoftwareTexture *texture;
+        const Lighting *lighting;
+    };
+
+    // The fragment shader for one covered pixel. e are the edge functions at its center.
+    uint32_t shadePixel(const RasterTriangle &t, const ShadeContext &context, const float e[3]) {
+        float l[3] = { e[0] * t.invArea, e[1] * t.invArea, e[2] * t.invArea };
+        float invW = l[0] * t.invW[0] + l[1] * t.invW[1] + l[2] * t.invW[2];
+        float w = 1.0f / invW;
+        float attributes[8];
+        for (int k = 0; k < 8; k++) {
+            attributes[k] = (l[0] * t.attributes[0][k] + l[1] * t.attributes[1][k] + l[2] * t.attributes[2][k]) * w;
+        }
+
+        const SoftwareObject &object = *context.object;
+        glm::vec3 surfaceColor = object.color;
+        if (context.texture) {
+            // Texture coordinate derivatives of the perspective divide, for the mip level
+            const Image &base = context.texture->levels[0];
+            float w2 = w * w;
+            float U = attributes[6] * invW, V = attributes[7] * invW;
+            float dudx = (t.dUdx * invW - U * t.dWdx) * w2 * base.width;
+            float dvdx = (t.dVdx * invW - V * t.dWdx) * w2 * base.height;
+            float dudy = (t.dUdy * invW - U * t.dWdy) * w2 * base.width;
+            float dvdy = (t.dVdy * invW - V * t.dWdy) * w2 * base.height;
+            float rho = (std::max)(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+            float lod = rho > 0.0f ? 0.5f * std::log2(rho) : 0.0f;
+            surfaceColor = glm::vec3(sampleTrilinear(*context.texture, attributes[6], attributes[7], lod));
+        }
+
+        glm::vec3 diffuse, specular;
+        if (object.surface.illumination == Illumination::Gouraud) {
+            diffuse = glm::vec3(attributes[0], attributes[1], attributes[2]);
+            specular = glm::vec3(attributes[3], attributes[4], attributes[5]);
+        }
+        else {
+            glm::vec3 norm = glm::normalize(glm::vec3(attributes[3], attributes[4], attributes[5]));
+            shade(object.surface, norm, glm::vec3(attributes[0], attributes[1], attributes[2]), *context.lighting, diffuse, specular);
+        }
+        // The specular component is not multiplied by the surface color
+        return packColor(specular + diffuse * surfaceColor);
+    }
+
+    // Rasterizes the part of the triangle inside the tile [x0, x1) x [y0, y1).
+    // x0 and x1 are multiples of four, so the 4 pixel groups are aligned to the rows.
+    void rasterize(const RasterTriangle &t, const ShadeContext &context, int x0, int y0, int x1, int y1,
+                   unsigned int stride, uint32_t *color, float *depth) {
+        int minX = (std::max)(t.minX, x0) & ~3, maxX = (std::min)(t.maxX, x1);
+        int minY = (std::max)(t.minY, y0), maxY = (std::min)(t.maxY, y1);
+
+#if defined(SOFTWARE_RENDERER_SSE2)
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        __m128 a[3], d[3];
+        for (int i = 0; i < 3; i++) { a[i] = _mm_set1_ps(t.a[i]); d[i] = _mm_set1_ps(t.depth[i]); }
+        __m128 invArea = _mm_set1_ps(t.invArea);
+#endif
+
+        for (int y = minY; y < maxY; y++) {
+            float py = (float)y + 0.5f;
+            float row[3];
+            for (int i = 0; i < 3; i++) { row[i] = t.b[i] * py + t.c[i]; }
+            size_t rowStart = (size_t)y * stride;
+
+            for (int x = minX; x < maxX; x += 4) {
+                float e[3][4];
+                int mask = 0;
+                float z[4];
+#if defined(SOFTWARE_RENDERER_SSE2)
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                __m128 edge[3];
+                for (int i = 0; i < 3; i++) {
+                    edge[i] = _mm_add_ps(_mm_mul_ps(a[i], px), _mm_set1_ps(row[i]));
+                    inside = _mm_and_ps(inside, t.owns[i] ? _mm_cmpge_ps(edge[i], zero) : _mm_cmpgt_ps(edge[i], zero));
+                }
+                if (_mm_movemask_ps(inside) == 0) { continue; }
+                __m128 zs = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge[0], d[0]), _mm_mul_ps(edge[1], d[1])), _mm_mul_ps(edge[2], d[2])), invArea);
+                __m128 stored = _mm_loadu_ps(depth + rowStart + x);
+                inside = _mm_and_ps(inside, _mm_cmplt_ps(zs, stored));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(zs, zero), _mm_cmple_ps(zs, one)));
+                mask = _mm_movemask_ps(inside);
+                if (mask == 0) { continue; }
+                for (int i = 0; i < 3; i++) { _mm_storeu_ps(e[i], edge[i]); }
+                _mm_storeu_ps(z, zs);
+#else
+                for (int lane = 0; lane < 4; lane++) {
+                    float px = (float)(x + lane) + 0.5f;
+                    bool inside = true;
+                    for (int i = 0; i < 3; i++) {
+                        e[i][lane] = t.a[i] * px + row[i];
+                        inside = inside && (t.owns[i] ? e[i][lane] >= 0.0f : e[i][lane] > 0.0f);
+                    }
+                    if (!inside) { continue; }
+                    z[lane] = (e[0][lane] * t.depth[0] + e[1][lane] * t.depth[1] + e[2][lane] * t.depth[2]) * t.invArea;
+                    if (z[lane] < depth[rowStart + x + lane] && z[lane] >= 0.0f && z[lane] <= 1.0f) { mask |= 1 << lane; }
+                }
+                if (mask == 0) { continue; }
+#endif
+                for (int lane = 0; lane < 4; lane++) {
+                    if (!(mask & (1 << lane))) { continue; }
+                    float pixelEdges[3] = { e[0][lane], e[1][lane], e[2][lane] };
+                    depth[rowStart + x + lane] = z[lane];
+                    color[rowStart + x + lane] = shadePixel(t, context, pixelEdges);
+                }
+            }
+        }
+    }
+
+    // A triangle or a polygon from clipping, checked and binned into every tile its bounds touch
+    void binTriangle(const Vertex *v[3], uint32_t triangle, uint32_t object, float width, float height, bool backfaceCulling,
+                     unsigned int tilesX, unsigned int tilesY, SoftwareRenderer::ThreadBins &bins) {
+        glm::vec3 p[3];
+        for (int i = 0; i < 3; i++) { p[i] = project(v[i]->clip, width, height); }
+        float area = windowArea(p[0], p[1], p[2]);
+        if (area == 0.0f || (backfaceCulling && area > 0.0f)) { return; }
+
+        float minX = (std::max)((std::min)({ p[0].x, p[1].x, p[2].x }), 0.0f);
+        float maxX = (std::min)((std::max)({ p[0].x, p[1].x, p[2].x }), width - 1.0f);
+        float minY = (std::max)((std::min)({ p[0].y, p[1].y, p[2].y }), 0.0f);
+        float maxY = (std::min)((std::max)({ p[0].y, p[1].y, p[2].y }), height - 1.0f);
+        if (minX > maxX || minY > maxY) { return; }
+        unsigned int tx0 = (unsigned int)minX / SOFTWARE_TILE_SIZE, tx1 = (std::min)((unsigned int)maxX / SOFTWARE_TILE_SIZE, tilesX - 1);
+        unsigned int ty0 = (unsigned int)minY / SOFTWARE_TILE_SIZE, ty1 = (std::min)((unsigned int)maxY / SOFTWARE_TILE_SIZE, tilesY - 1);
+        for (unsigned int ty = ty0; ty <= ty1; ty++) {
+            for (unsigned int tx = tx0; tx <= tx1; tx++) {
+                bins.tiles[ty * tilesX + tx].push_back({ triangle, object });
+            }
+        }
+    }
+
+    // Copies the most detailed level of a baked mesh, or imports a source mesh
+    bool loadMesh(Vfs &vfs, std::string path, Geometry &geometry) {
+        std::string name = packName(path);
+        std::string_view extension = std::string_view(name).substr((std::min)(name.size(), name.rfind('.')));
+        if (extension == ".obj" || extension == ".glb") {
+            VfsFile file = vfs.Open(path);
+            if (!file.IsOpen()) { return false; }
+            std::string error;
+            if (!importMesh(extension, file.Data(), file.Size(), geometry, error)) {
+                Log::Message(LogSeverity::Medium, "Can not import mesh: ", (path + ": " + error).c_str());
+                return false;
+            }
+            return true;
+        }
+
+        MeshFile mesh(vfs.Open(path), path);
+        if (!mesh.IsValid() || mesh.Header().lodCount == 0) { return false; }
+        if (mesh.Header().vertexStride != GEOMETRY_FLOATS_PER_VERTEX * sizeof(float)) {
+            Log::Message(LogSeverity::Medium, "Mesh has vertices of the wrong size: ", (path + " has " + std::to_string(mesh.Header().vertexStride) + " byte vertices, expected "
+                         + std::to_string(GEOMETRY_FLOATS_PER_VERTEX * sizeof(float))).c_str());
+            return false;
+        }
+        const MeshFileLod &lod = mesh.Lods()[0];
+        const float *vertices = (const float*)mesh.Vertices() + (size_t)lod.firstVertex * GEOMETRY_FLOATS_PER_VERTEX;
+        geometry.vertices.assign(vertices, vertices + (size_t)lod.vertexCount * GEOMETRY_FLOATS_PER_VERTEX);
+        geometry.indices.reserve(lod.indexCount);
+        const uint32_t *indices = mesh.Indices() + lod.firstIndex;
+        for (uint32_t i = 0; i + 2 < lod.indexCount; i += 3) {
+            // Indices are absolute in the file, triangles reaching outside the level are dropped
+            if (indices[i] - lod.firstVertex >= lod.vertexCount || indices[i + 1] - lod.firstVertex >= lod.vertexCount ||
+                indices[i + 2] - lod.firstVertex >= lod.vertexCount) { continue; }
+            for (int k = 0; k < 3; k++) { geometry.indices.push_back(indices[i + k] - lod.firstVertex); }
+        }
+        return true;
+    }
+}
+
+SoftwareScene buildSoftwareScene(SceneDescription &scene, TextureCache &textures, Vfs &vfs, std::string meshDirectory) {
+    PROFILE_ZONE("build software scene");
+    SoftwareScene software;
+    software.lights = scene.lights;
+    software.objects.reserve(scene.objects.size());
+    std::unordered_map<TextureData*, int> decoded;
+
+    for (ObjectDescription &d : scene.objects) {
+        ObjectSettings &o = d.object;
+        SoftwareObject object;
+        switch (d.kind) {
+            case ShapeKind::Box:      object.geometry = boxGeometry(d.size.x, d.size.y, d.size.z); break;
+            case ShapeKind::Cylinder: object.geometry = cylinderGeometry(d.size.x, d.size.y, d.segments[0]); break;
+            case ShapeKind::Sphere:   object.geometry = sphereGeometry(d.segments[0], d.segments[1], d.size.x); break;
+            case ShapeKind::Mesh:     loadMesh(vfs, meshDirectory + "/" + d.file, object.geometry); break;
+        }
+        object.model = modelMatrix(o.transformation);
+        object.normalMatrix = glm::transpose(glm::inverse(object.model));
+        object.color = o.color;
+        object.surface = o.surface;
+        object.texture = -1;
+
+        TextureData *data = textures.Get(o.texture);
+        if (data) {
+            auto it = decoded.find(data);
+            if (it == decoded.end()) {
+                SoftwareTexture texture;
+                for (DdsLevel &level : data->dds.levels) { texture.levels.push_back(decodeDDSLevel(data->dds.format, level)); }
+                // Files without a mip chain get one generated, like on the GPU
+                if (texture.levels.size() == 1) {
+                    while (texture.levels.back().width > 1 || texture.levels.back().height > 1) {
+                        texture.levels.push_back(halveImage(texture.levels.back()));
+                    }
+                }
+                software.textures.push_back(std::move(texture));
+                it = decoded.emplace(data, (int)software.textures.size() - 1).first;
+            }
+            object.texture = it->second;
+        }
+        software.objects.push_back(std::move(object));
+    }
+    return software;
+}
+
+SoftwareRenderer::SoftwareRenderer(unsigned int w, unsigned int h, unsigned int threads) : width(w), height(h), triangleCount(0) {
+    // Rows are padded to whole 4 pixel groups
+    stride = (width + 3) & ~3u;
+    tilesX = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    tilesY = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    threadCount = threads ? threads : (std::max)(1u, std::thread::hardware_concurrency());
+    color.resize((size_t)stride * height);
+    depth.resize((size_t)stride * height);
+    bins.resize(threadCount);
+    for (ThreadBins &thread : bins) { thread.tiles.resize((size_t)tilesX * tilesY); }
+}
+
+void SoftwareRenderer::Render(const SoftwareScene &scene, const glm::mat4 &viewProj, glm::vec3 cameraPos, bool backfaceCulling) {
+    PROFILE_ZONE("software render");
+    std::fill(color.begin(), color.end(), 0xFFFFFFFFu);
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    triangleCount = 0;
+
+    Lighting lighting;
+    lighting.dirLight = scene.lights.dirLight.color != glm::vec3(0.0f);
+    lighting.dirColor = scene.lights.dirLight.color;
+    lighting.dirDirection = scene.lights.dirLight.direction;
+    lighting.pointLights = &scene.lights.pointLights;
+    lighting.cameraPos = cameraPos;
+
+    float w = (float)width, h = (float)height;
+    vertexBase.resize(scene.objects.size());
+
+    for (size_t first = 0; first < scene.objects.size(); ) {
+        // Take objects until the batch is full, at least one
+        size_t last = first;
+        size_t vertexCount = 0;
+        std::vector<size_t> firstTriangle;
+        size_t batchTriangles = 0;
+        do {
+            vertexBase[last] = vertexCount;
+            firstTriangle.push_back(batchTriangles);
+            vertexCount += scene.objects[last].geometry.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX;
+            batchTriangles += scene.objects[last].geometry.indices.size() / 3;
+            last++;
+        } while (last < scene.objects.size() && vertexCount < SOFTWARE_BATCH_VERTICES);
+        triangleCount += batchTriangles;
+        transformed.resize(vertexCount);
+
+        // Vertex shader, every thread takes an equal share of the batch's vertices
+        {
+            PROFILE_ZONE("transform");
+            runParallel(threadCount, [&](unsigned int thread) {
+                size_t begin = vertexCount * thread / threadCount, end = vertexCount * (thread + 1) / threadCount;
+                size_t o = first;
+                for (size_t v = begin; v < end; v++) {
+                    while (o + 1 < last && vertexBase[o + 1] <= v) { o++; }
+                    const SoftwareObject &object = scene.objects[o];
+                    const float *in = &object.geometry.vertices[(v - vertexBase[o]) * GEOMETRY_FLOATS_PER_VERTEX];
+                    glm::vec4 world = object.model * glm::vec4(in[0], in[1], in[2], 1.0f);
+                    glm::vec3 normal = glm::mat3(object.normalMatrix) * glm::vec3(in[3], in[4], in[5]);
+                    Vertex &out = transformed[v];
+                    out.clip = viewProj * world;
+                    if (object.surface.illumination == Illumination::Gouraud) {
+                        // Lit per vertex, the attributes carry diffuse and specular instead
+                        glm::vec3 diffuse, specular;
+                        shade(object.surface, glm::normalize(normal), glm::vec3(world), lighting, diffuse, specular);
+                        std::memcpy(out.attributes, &diffuse[0], sizeof(float) * 3);
+                        std::memcpy(out.attributes + 3, &specular[0], sizeof(float) * 3);
+                    }
+                    else {
+                        std::memcpy(out.attributes, &world[0], sizeof(float) * 3);
+                        std::memcpy(out.attributes + 3, &normal[0], sizeof(float) * 3);
+                    }
+                    out.attributes[6] = in[6];
+                    out.attributes[7] = in[7];
+                }
+            });
+        }
+
+        // Clip, cull and bin. Every thread takes a contiguous range of triangles, so going through
+        // the threads' bins in order keeps the triangles in submission order.
+        {
+            PROFILE_ZONE("bin");
+            runParallel(threadCount, [&](unsigned int thread) {
+                ThreadBins &threadBins = bins[thread];
+                size_t begin = batchTriangles * thread / threadCount, end = batchTriangles * (thread + 1) / threadCount;
+                size_t o = first;
+                for (size_t triangle = begin; triangle < end; triangle++) {
+                    while (o + 1 < last && firstTriangle[o + 1 - first] <= triangle) { o++; }
+                    const SoftwareObject &object = scene.objects[o];
+                    uint32_t local = (uint32_t)(triangle - firstTriangle[o - first]);
+                    const unsigned int *index = &object.geometry.indices[(size_t)local * 3];
+                    const Vertex *v[3] = { &transformed[vertexBase[o] + index[0]], &transformed[vertexBase[o] + index[1]], &transformed[vertexBase[o] + index[2]] };
+
+                    // Outside the same frustum plane
+                    unsigned int outsideAll = 0x3F, crossed = 0;
+                    for (int i = 0; i < 3; i++) {
+                        const glm::vec4 &c = v[i]->clip;
+                        unsigned int outside = (c.x < -c.w ? 1 : 0) | (c.x > c.w ? 2 : 0) | (c.y < -c.w ? 4 : 0) |
+                                               (c.y > c.w ? 8 : 0) | (c.z < -c.w ? 16 : 0) | (c.z > c.w ? 32 : 0);
+                        outsideAll &= outside;
+                        for (int plane = 0; plane < 5; plane++) {
+                            if (planeDistance(c, plane) < 0.0f) { crossed |= 1u << plane; }
+                        }
+                    }
+                    if (outsideAll) { continue; }
+
+                    if (!crossed) {
+                        binTriangle(v, local, (uint32_t)o, w, h, backfaceCulling, tilesX, tilesY, threadBins);
+                        continue;
+                    }
+                    Vertex polygon[9] = { *v[0], *v[1], *v[2] };
+                    int count = clipPolygon(polygon, 3, crossed);
+                    for (int i = 1; i + 1 < count; i++) {
+                        uint32_t clipped = CLIPPED_TRIANGLE | (uint32_t)(threadBins.clipped.size() / 3);
+                        threadBins.clipped.push_back(polygon[0]);
+                        threadBins.clipped.push_back(polygon[i]);
+                        threadBins.clipped.push_back(polygon[i + 1]);
+                        const Vertex *fan[3] = { &threadBins.clipped[threadBins.clipped.size() - 3], &threadBins.clipped[threadBins.clipped.size() - 2], &threadBins.clipped.back() };
+                        binTriangle(fan, clipped, (uint32_t)o, w, h, backfaceCulling, tilesX, tilesY, threadBins);
+                    }
+                }
+            });
+        }
+
+        // Rasterize and shade, a tile at a time
+        {
+            PROFILE_ZONE("rasterize");
+            std::atomic<unsigned int> nextTile(0);
+            runParallel(threadCount, [&](unsigned int) {
+                for (unsigned int tile = nextTile++; tile < tilesX * tilesY; tile = nextTile++) {
+                    int x0 = (int)((tile % tilesX) * SOFTWARE_TILE_SIZE), y0 = (int)((tile / tilesX) * SOFTWARE_TILE_SIZE);
+                    int x1 = (std::min)(x0 + SOFTWARE_TILE_SIZE, (int)stride), y1 = (std::min)(y0 + SOFTWARE_TILE_SIZE, (int)height);
+                    for (ThreadBins &threadBins : bins) {
+                        for (BinEntry &entry : threadBins.tiles[tile]) {
+                            const SoftwareObject &object = scene.objects[entry.object];
+                            const Vertex *v[3];
+                            if (entry.triangle & CLIPPED_TRIANGLE) {
+                                const Vertex *clipped = &threadBins.clipped[(size_t)(entry.triangle & ~CLIPPED_TRIANGLE) * 3];
+                                v[0] = clipped; v[1] = clipped + 1; v[2] = clipped + 2;
+                            }
+                            else {
+                                const unsigned int *index = &object.geometry.indices[(size_t)entry.triangle * 3];
+                                for (int i = 0; i < 3; i++) { v[i] = &transformed[vertexBase[entry.object] + index[i]]; }
+                            }
+                            RasterTriangle triangle;
+                            if (!setupTriangle(v, w, h, backfaceCulling, triangle)) { continue; }
+                            ShadeContext context = { &object, object.texture >= 0 ? &scene.textures[object.texture] : nullptr, &lighting };
+                            rasterize(triangle, context, x0, y0, x1, y1, stride, color.data(), depth.data());
+                        }
+                    }
+                }
+            });
+        }
+
+        for (ThreadBins &threadBins : bins) {
+            for (std::vector<BinEntry> &tile : threadBins.tiles) { tile.clear(); }
+            threadBins.clipped.clear();
+        }
+        first = last;
+    }
+}
+
+Image SoftwareRenderer::Frame() {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    for (unsigned int y = 0; y < height; y++) {
+        std::memcpy(&image.pixels[(size_t)y * width * 4], &color[(size_t)y * stride], (size_t)width * 4);
+    }
+    return image;
+}
+
+size_t SoftwareRenderer::TriangleCount() { return triangleCount; }
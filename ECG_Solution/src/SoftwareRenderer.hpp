@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "glm\matrix.hpp"
+#include "Image.hpp"
+#include "Lights.hpp"
+#include "Scene.hpp"
+#include "Textures.hpp"
+#include "Vfs.hpp"
+#include "Shapes\Geometry.hpp"
+
+// Square tiles the screen is binned into. Each tile is rasterized by one thread at a time.
+#define SOFTWARE_TILE_SIZE 64
+// Objects are transformed and binned in batches of about this many vertices, to bound the memory
+#define SOFTWARE_BATCH_VERTICES (1 << 20)
+
+// A DXT texture decoded to RGBA8, with a full mip chain like the GL textures get
+struct SoftwareTexture {
+    std::vector<Image> levels;
+};
+
+// One shape of the scene, in object space
+struct SoftwareObject {
+    Geometry geometry;
+    glm::mat4 model;
+    glm::mat4 normalMatrix;
+    glm::vec3 color;
+    Surface surface;
+    int texture; // index into SoftwareScene::textures, -1 if untextured
+};
+
+struct SoftwareScene {
+    std::vector<SoftwareObject> objects;
+    std::vector<SoftwareTexture> textures;
+    Lights lights;
+};
+
+// Builds the scene without touching OpenGL. Shapes are generated, or loaded from the most
+// detailed level of their mesh file, and textures are decoded from their DXT blocks.
+SoftwareScene buildSoftwareScene(SceneDescription &scene, TextureCache &textures, Vfs &vfs, std::string meshDirectory);
+
+// Renders a SoftwareScene on the CPU, the way the GL path renders the same scene with per
+// fragment Phong lighting, trilinear texture filtering and a GL_LESS depth test.
+// Triangles are transformed and binned into screen tiles on all threads, then the tiles are
+// rasterized in parallel with SSE2 edge functions four pixels at a time.
+// Every pixel sees its triangles in scene order, so the result does not depend on the thread count.
+class SoftwareRenderer {
+public:
+    struct TransformedVertex {
+        glm::vec4 clip;
+        float attributes[8]; // world position, world normal, texture coordinates
+    };
+    struct BinEntry {
+        uint32_t triangle;   // in the batch, or in the thread's clipped triangles if the high bit is set
+        uint32_t object;
+    };
+    struct ThreadBins {
+        std::vector<std::vector<BinEntry>> tiles;
+        std::vector<TransformedVertex> clipped; // three per triangle cut by the near plane
+    };
+
+private:
+    unsigned int width, height, stride;
+    unsigned int tilesX, tilesY;
+    unsigned int threadCount;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+    std::vector<TransformedVertex> transformed;
+    std::vector<size_t> vertexBase; // first vertex of each object of the batch in transformed
+    std::vector<ThreadBins> bins;
+    size_t triangleCount;
+
+public:
+    // 0 threads uses every core
+    SoftwareRenderer(unsigned int width, unsigned int height, unsigned int threads = 0);
+    // Back faces are the clockwise ones, like GL's default
+    void Render(const SoftwareScene &scene, const glm::mat4 &viewProj, glm::vec3 cameraPos, bool backfaceCulling);
+    // The last frame, first row at the top
+    Image Frame();
+    // Triangles submitted in the last frame
+    size_t TriangleCount();
+};
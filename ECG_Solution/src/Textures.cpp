@@ -0,0 +1,113 @@
+#include "Textures.hpp"
+#include "Image.hpp"
+#include "BlockCompress.hpp"
+#include "Profiler.hpp"
+#include "Log.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    // Marks a DDS file as compressed from a source image, in the application bytes of its header.
+    // Bump the version when the encoder changes, so old caches are compressed again.
+    const char CACHE_MAGIC[4] = { 'E', 'C', 'G', 'T' };
+    const uint32_t CACHE_VERSION = 1;
+
+    struct CacheStamp {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+    };
+    static_assert(sizeof(CacheStamp) <= DDS_USER_SIZE, "The cache stamp must fit into the DDS header");
+
+    CacheStamp stampOf(const unsigned char *source, size_t size) {
+        CacheStamp stamp;
+        std::memcpy(stamp.magic, CACHE_MAGIC, 4);
+        stamp.version = CACHE_VERSION;
+        stamp.sourceHash = hashAsset(source, size);
+        stamp.sourceSize = size;
+        return stamp;
+    }
+
+    std::string extensionOf(const std::string &name) {
+        std::string lower = packName(name);
+        size_t dot = lower.rfind('.');
+        return dot == std::string::npos ? "" : lower.substr(dot);
+    }
+}
+
+TextureCache::TextureCache(Vfs &v, std::string dir) : vfs(v), directory(dir) { }
+
+TextureData *TextureCache::Get(std::string name) {
+    if (name.empty()) { return nullptr; }
+    auto it = textures.find(name);
+    if (it != textures.end()) { return it->second.get(); }
+
+    PROFILE_ZONE("load texture");
+    std::unique_ptr<TextureData> texture;
+    std::string extension = extensionOf(name);
+    if (extension == ".png" || extension == ".tga") {
+        texture = importTexture(name);
+    }
+    else {
+        // The levels point into the file, which is usually mapped from the pack, so nothing is copied before the upload
+        texture = std::make_unique<TextureData>();
+        texture->file = vfs.Open(directory + "/" + name);
+        if (!parseDDS(texture->file.Data(), texture->file.Size(), texture->dds)) {
+            if (texture->file.IsOpen()) {
+                Log::Message(LogSeverity::Medium, "Texture is not a DXT1/3/5 compressed DDS file: ", name.c_str());
+            }
+            texture.reset();
+        }
+    }
+    TextureData *result = texture.get();
+    textures[name] = std::move(texture);
+    return result;
+}
+
+void TextureCache::Clear() { textures.clear(); }
+
+void TextureCache::ReportMemory(MemoryReport &report) {
+    for (auto &texture : textures) {
+        TextureData &data = *texture.second;
+        report.Add("loaded texture", sizeof(TextureData) + data.file.Size() + data.compressed.capacity(), 0);
+    }
+}
+
+std::unique_ptr<TextureData> TextureCache::importTexture(std::string name) {
+    std::string path = directory + "/" + name;
+    std::string cachePath = path + ".dds";
+    VfsFile source = vfs.Open(path);
+    if (!source.IsOpen()) { return nullptr; }
+    CacheStamp stamp = stampOf(source.Data(), source.Size());
+
+    std::unique_ptr<TextureData> texture = std::make_unique<TextureData>();
+    if (vfs.Exists(cachePath)) {
+        texture->file = vfs.Open(cachePath);
+        VfsFile &cached = texture->file;
+        if (cached.Size() >= DDS_DATA_OFFSET && std::memcmp(cached.Data() + DDS_USER_OFFSET, &stamp, sizeof(stamp)) == 0
+            && parseDDS(cached.Data(), cached.Size(), texture->dds)) {
+            return texture;
+        }
+        texture->file = VfsFile();
+    }
+
+    Image image;
+    std::string error;
+    if (!decodeImage(extensionOf(name), source.Data(), source.Size(), image, error)) {
+        Log::Message(LogSeverity::Medium, "Can not decode texture: ", (name + ": " + error).c_str());
+        return nullptr;
+    }
+    texture->compressed = compressToDDS(image);
+    std::memcpy(texture->compressed.data() + DDS_USER_OFFSET, &stamp, sizeof(stamp));
+
+    // A failed write only costs the next start another compression
+    std::ofstream cache(vfs.LoosePath(cachePath), std::ios::binary);
+    if (!cache.write((const char*)texture->compressed.data(), (std::streamsize)texture->compressed.size())) {
+        Log::Message(LogSeverity::Low, "Could not cache texture: ", (name + " as " + cachePath).c_str());
+    }
+
+    parseDDS(texture->compressed.data(), texture->compressed.size(), texture->dds);
+    return texture;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include "Vfs.hpp"
+#include "Dds.hpp"
+#include "MemoryReport.hpp"
+
+// A compressed texture, loaded but not uploaded yet.
+// The levels point into the file, or into the compressed data for imported images.
+struct TextureData {
+    VfsFile file;
+    std::vector<unsigned char> compressed;
+    DdsTexture dds;
+};
+
+// Loads every texture once, no matter how many shapes use it. The upload is left to the
+// MaterialTable (see Materials.hpp), which packs textures of the same size into arrays.
+// DXT compressed .dds files are used as they are. PNG and TGA files are block compressed
+// on the CPU (see BlockCompress.hpp) and cached as name.png.dds next to the source, so later
+// starts take the DDS path. A cache whose source has changed since is compressed again.
+class TextureCache {
+private:
+    Vfs &vfs;
+    std::string directory;
+    std::unordered_map<std::string, std::unique_ptr<TextureData>> textures;
+    std::unique_ptr<TextureData> importTexture(std::string name);
+
+public:
+    // The directory is relative to the asset directory of the vfs
+    TextureCache(Vfs &vfs, std::string directory);
+    // Returns a file in the texture directory, nullptr if the name is empty or it could not be loaded
+    TextureData *Get(std::string name);
+    // Drops the loaded data, once it has been uploaded
+    void Clear();
+    // Adds every loaded texture as "loaded texture", mapped files included
+    void ReportMemory(MemoryReport &report);
+};
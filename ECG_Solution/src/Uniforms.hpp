@@ -0,0 +1,66 @@
+#pragma once
+
+#include "glm\matrix.hpp"
+#include "glm/ext.hpp"
+
+// Binding points and std140 layouts of the uniform blocks shared by the shaders.
+// Their contents are written to the upload ring every frame.
+#define FRAME_UNIFORM_BINDING 0
+#define OBJECT_UNIFORM_BINDING 1
+// Binding point of the std430 material buffer (see Materials.hpp)
+#define MATERIAL_STORAGE_BINDING 0
+// Binding point of the std430 object buffer GPU-driven draws read ObjectUniforms from (see GpuCulling.hpp)
+#define OBJECT_STORAGE_BINDING 1
+// Binding points of the std430 buffers of cull.comp and particles.comp. GL 4.3 only promises eight,
+// so the particles write and collide through two of the culler's. Both bind all of their buffers
+// before every dispatch and draw that reads them.
+#define CULL_STORAGE_BINDING 2
+#define COMMAND_STORAGE_BINDING 3
+#define COUNT_STORAGE_BINDING 4
+#define BUCKET_STORAGE_BINDING 5
+#define PARTICLE_STATE_STORAGE_BINDING 6
+#define PARTICLE_SOURCE_STORAGE_BINDING 7
+#define PARTICLE_DESTINATION_STORAGE_BINDING COUNT_STORAGE_BINDING
+#define PARTICLE_COLLIDER_STORAGE_BINDING BUCKET_STORAGE_BINDING
+
+// Size of the point light array in the frame block. Injected into the shaders as a #define.
+#define MAX_POINT_LIGHTS 16
+// Texture arrays bound to units 0 and up when there are no bindless textures. Injected like MAX_POINT_LIGHTS.
+#define MAX_TEXTURE_ARRAYS 8
+// Unit the prefiltered environment cubemap is bound to, after the texture arrays (see Environment.hpp).
+// Injected like MAX_POINT_LIGHTS.
+#define ENVIRONMENT_TEXTURE_UNIT MAX_TEXTURE_ARRAYS
+// MaterialData::texture.x of untextured materials
+#define NO_TEXTURE_ARRAY 0xFFFFFFFFu
+
+struct PointLightUniforms {
+    glm::vec4 color;
+    glm::vec4 position;
+    glm::vec4 attenuation; // quadratic, linear, constant
+};
+
+// Everything that is the same for all objects in a frame
+struct FrameUniforms {
+    glm::mat4 viewProj;
+    glm::vec4 cameraPos;
+    glm::vec4 dirLightColor;
+    glm::vec4 dirLightDir;
+    glm::ivec4 pointLightCount; // only x is used
+    PointLightUniforms pointLights[MAX_POINT_LIGHTS];
+    glm::vec4 irradiance[9];    // SH9 of the environment's irradiance, see EnvironmentMap
+    glm::vec4 environment;      // diffuse and specular strength, last level of the cubemap; no environment while 0
+};
+
+// Everything that is specific to one object
+struct ObjectUniforms {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;
+    glm::uvec4 material; // index into the material buffer, only x is used
+};
+
+// One entry of the material buffer
+struct MaterialData {
+    glm::vec4 color;
+    glm::vec4 surface;   // ka, kd, ks, alpha
+    glm::uvec4 texture;  // array, layer, and the bindless handle of the array as low and high bits
+};
@@ -0,0 +1,100 @@
+#include "UploadRing.hpp"
+#include <GL\glew.h>
+#include "Log.hpp"
+#include <cstdio>
+
+UploadRing::UploadRing(size_t bytesPerFrame, bool allowPersistent) : mapped(nullptr), offset(0), flushed(0), region(0),
+                                                                    failedAllocations(0), failedBytes(0) {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+    // Keep every region aligned for any kind of binding
+    size_t alignment = (size_t)(uniformAlignment > storageAlignment ? uniformAlignment : storageAlignment);
+    regionSize = (bytesPerFrame + alignment - 1) / alignment * alignment;
+    size_t totalSize = regionSize * UPLOAD_RING_FRAMES;
+
+    for (unsigned int i = 0; i < UPLOAD_RING_FRAMES; i++) { fences[i] = nullptr; }
+
+    buffer = GlBuffer::Create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.ID());
+    persistent = allowPersistent && GLEW_ARB_buffer_storage != 0;
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+        persistent = mapped != nullptr;
+    }
+    if (!persistent) {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+        staging.resize(totalSize);
+        mapped = staging.data();
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+UploadRing::~UploadRing() {
+    for (unsigned int i = 0; i < UPLOAD_RING_FRAMES; i++) {
+        if (fences[i]) { glDeleteSync(fences[i]); }
+    }
+}
+
+void UploadRing::BeginFrame() {
+    region = (region + 1) % UPLOAD_RING_FRAMES;
+    offset = 0;
+    flushed = 0;
+
+    // The fence has almost always signalled already, as it was set UPLOAD_RING_FRAMES frames ago
+    if (fences[region]) {
+        GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = nullptr;
+    }
+}
+
+void UploadRing::EndFrame() {
+    Flush();
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // One message a frame however many allocations failed, formatted on the stack as frames must not allocate
+    if (failedAllocations > 0) {
+        char detail[160];
+        std::snprintf(detail, sizeof(detail), "%u allocations of %zu bytes did not fit into %zu bytes this frame, raise [streaming] bytesPerFrame",
+                      failedAllocations, failedBytes, regionSize);
+        Log::Message(LogSeverity::Medium, "Upload ring out of space: ", detail);
+        failedAllocations = 0;
+        failedBytes = 0;
+    }
+}
+
+UploadAllocation UploadRing::Allocate(size_t size, size_t alignment) {
+    size_t start = (offset + alignment - 1) / alignment * alignment;
+    if (start + size > regionSize) {
+        failedAllocations++;
+        failedBytes += size;
+        return { nullptr, buffer.ID(), 0, 0 };
+    }
+    offset = start + size;
+    GLintptr bufferOffset = (GLintptr)(region * regionSize + start);
+    return { mapped + bufferOffset, buffer.ID(), bufferOffset, (GLsizeiptr)size };
+}
+
+UploadAllocation UploadRing::AllocateUniform(size_t size) { return Allocate(size, (size_t)uniformAlignment); }
+UploadAllocation UploadRing::AllocateStorage(size_t size) { return Allocate(size, (size_t)storageAlignment); }
+
+void UploadRing::Flush() {
+    if (persistent || flushed == offset) { return; }
+    GLintptr start = (GLintptr)(region * regionSize + flushed);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.ID());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, start, offset - flushed, mapped + start);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    flushed = offset;
+}
+
+GLuint UploadRing::Buffer() { return buffer.ID(); }
+
+void UploadRing::ReportMemory(MemoryReport &report) {
+    report.Add("upload ring", staging.capacity(), regionSize * UPLOAD_RING_FRAMES);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <GL\glew.h>
+#include "GlHandle.hpp"
+#include "MemoryReport.hpp"
+
+// Number of frames the CPU may be ahead of the GPU. Each gets its own region of the ring.
+#define UPLOAD_RING_FRAMES 3
+
+// A piece of the ring. Write to data, then bind buffer at offset.
+struct UploadAllocation {
+    void *data;
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+// Linear allocator for data that changes every frame (transforms, instance data, lights).
+// The buffer is persistently and coherently mapped and split into one region per frame in flight.
+// A fence guards each region, so the CPU only waits if it gets UPLOAD_RING_FRAMES frames ahead.
+// Without ARB_buffer_storage the allocations are staged in memory and uploaded by Flush().
+class UploadRing {
+private:
+    GlBuffer buffer;
+    unsigned char *mapped;
+    std::vector<unsigned char> staging;
+    bool persistent;
+    size_t regionSize;
+    size_t offset;
+    size_t flushed;
+    unsigned int region;
+    GLsync fences[UPLOAD_RING_FRAMES];
+    GLint uniformAlignment;
+    GLint storageAlignment;
+    unsigned int failedAllocations; // this frame, reported once by EndFrame
+    size_t failedBytes;
+
+public:
+    // Without allowPersistent the ring always stages, e.g. so a GL capture sees the data go up
+    UploadRing(size_t bytesPerFrame, bool allowPersistent = true);
+    UploadRing(const UploadRing &) = delete;
+    UploadRing &operator=(const UploadRing &) = delete;
+    ~UploadRing();
+
+    // Moves on to the next region, waiting for the GPU to finish with it if necessary
+    void BeginFrame();
+    // Fences the region of this frame and logs the allocations that did not fit, if any
+    void EndFrame();
+    // Returns an allocation with data == nullptr if the region is full
+    UploadAllocation Allocate(size_t size, size_t alignment);
+    // Allocations that may be bound with glBindBufferRange as uniform or shader storage buffers
+    UploadAllocation AllocateUniform(size_t size);
+    UploadAllocation AllocateStorage(size_t size);
+    // Makes everything allocated so far visible to the GPU. Only does work without persistent mapping.
+    void Flush();
+    GLuint Buffer();
+    // Adds the ring as "upload ring", the staging copy counts as CPU memory
+    void ReportMemory(MemoryReport &report);
+};
@@ -0,0 +1,136 @@
+#include "Vfs.hpp"
+#include "Lz4.hpp"
+#include "Profiler.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+std::string packName(std::string_view path) {
+    std::string name(path);
+    for (char &c : name) {
+        c = c == '\\' ? '/' : (char)std::tolower((unsigned char)c);
+    }
+    return name;
+}
+
+uint64_t hashAsset(const unsigned char *data, size_t size, uint64_t hash) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < size; i++) { hash = (hash ^ data[i]) * 1099511628211ull; }
+    return hash;
+}
+
+VfsFile::VfsFile() : data(nullptr), size(0) { }
+VfsFile::VfsFile(const unsigned char *d, size_t s) : data(d), size(s) { }
+
+VfsFile::VfsFile(std::unique_ptr<MappedFile> file) : data(nullptr), size(0), mapped(std::move(file)) {
+    if (mapped->IsOpen()) {
+        data = mapped->Data();
+        size = mapped->Size();
+    }
+}
+
+VfsFile::VfsFile(std::vector<unsigned char> &&d) : decompressed(std::move(d)) {
+    data = decompressed.data();
+    size = decompressed.size();
+}
+
+bool VfsFile::IsOpen() { return data != nullptr; }
+const unsigned char *VfsFile::Data() { return data; }
+size_t VfsFile::Size() { return size; }
+std::string_view VfsFile::Text() { return std::string_view((const char*)data, size); }
+
+namespace {
+    // Whether [offset, offset + size) lies within total bytes, without the sum overflowing
+    bool fits(uint64_t offset, uint64_t size, uint64_t total) {
+        return offset <= total && size <= total - offset;
+    }
+
+    // Whether the entry's name and data lie within the pack, and raw data is as big as it says
+    bool validEntry(const PackEntry &entry, const PackHeader &header, uint64_t packSize) {
+        if (!fits(entry.nameOffset, entry.nameLength, header.namesSize)) { return false; }
+        if (!fits(entry.offset, entry.storedSize, packSize)) { return false; }
+        if (entry.codec == PACK_CODEC_RAW) { return entry.size == entry.storedSize; }
+        return entry.codec == PACK_CODEC_LZ4;
+    }
+}
+
+Vfs::Vfs(std::filesystem::path r, std::filesystem::path packPath) : root(r), pack(packPath), header(nullptr), entries(nullptr), names(nullptr) {
+    if (!pack.IsOpen()) { return; }
+
+    const PackHeader *candidate = (const PackHeader*)pack.Data();
+    if (pack.Size() < sizeof(PackHeader) || candidate->magic != PACK_MAGIC || candidate->version != PACK_VERSION
+        || !fits(candidate->entriesOffset, (uint64_t)candidate->entryCount * sizeof(PackEntry), pack.Size())
+        || !fits(candidate->namesOffset, candidate->namesSize, pack.Size())) {
+        Log::Message(LogSeverity::Medium, "Ignoring a pack of another version: ", (packPath.string() + ", expected version " + std::to_string(PACK_VERSION)).c_str());
+        return;
+    }
+    // Checked once here, so lookups and opens can trust every entry
+    const PackEntry *candidateEntries = (const PackEntry*)(pack.Data() + candidate->entriesOffset);
+    for (uint32_t i = 0; i < candidate->entryCount; i++) {
+        if (!validEntry(candidateEntries[i], *candidate, pack.Size())) {
+            Log::Message(LogSeverity::Medium, "Ignoring a pack with an entry outside of it: ", (packPath.string() + ", entry " + std::to_string(i)).c_str());
+            return;
+        }
+    }
+    header = candidate;
+    entries = candidateEntries;
+    names = (const char*)(pack.Data() + header->namesOffset);
+}
+
+bool Vfs::HasPack() { return header != nullptr; }
+
+// Binary search over the sorted index
+const PackEntry *Vfs::find(std::string_view name) {
+    if (!header) { return nullptr; }
+    const PackEntry *end = entries + header->entryCount;
+    auto nameOf = [&](const PackEntry &entry) { return std::string_view(names + entry.nameOffset, entry.nameLength); };
+    const PackEntry *entry = std::lower_bound(entries, end, name, [&](const PackEntry &e, std::string_view n) { return nameOf(e) < n; });
+    if (entry == end || nameOf(*entry) != name) { return nullptr; }
+    return entry;
+}
+
+VfsFile Vfs::Open(std::string_view path) {
+    PROFILE_ZONE("open asset");
+    const PackEntry *entry = find(packName(path));
+    if (entry) {
+        const unsigned char *stored = pack.Data() + entry->offset;
+        if (entry->codec == PACK_CODEC_RAW) {
+            return VfsFile(stored, (size_t)entry->size);
+        }
+        if (entry->codec == PACK_CODEC_LZ4) {
+            PROFILE_ZONE("decompress asset");
+            std::vector<unsigned char> contents((size_t)entry->size);
+            if (lz4Decompress(stored, (size_t)entry->storedSize, contents.data(), contents.size())) {
+                return VfsFile(std::move(contents));
+            }
+        }
+        Log::Message(LogSeverity::Medium, "Asset in the pack is corrupt: ", std::string(path).c_str());
+        return VfsFile();
+    }
+
+    // Not packed, or no pack: read the loose file
+    VfsFile file(std::make_unique<MappedFile>(LoosePath(path)));
+    if (!file.IsOpen()) {
+        Log::Message(LogSeverity::Medium, "Could not open asset: ", std::string(path).c_str());
+    }
+    return file;
+}
+
+std::string Vfs::ReadText(std::string_view path) {
+    return std::string(Open(path).Text());
+}
+
+bool Vfs::Exists(std::string_view path) {
+    std::error_code error;
+    return find(packName(path)) != nullptr || std::filesystem::is_regular_file(LoosePath(path), error);
+}
+
+std::filesystem::path Vfs::LoosePath(std::string_view path) {
+    return root / std::filesystem::path(path);
+}
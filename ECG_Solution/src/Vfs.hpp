@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <filesystem>
+#include "MappedFile.hpp"
+#include "AssetPack.hpp"
+
+// The contents of one asset, wherever it came from.
+// Raw pack entries and loose files are mapped, compressed pack entries are decompressed into memory.
+class VfsFile {
+private:
+    const unsigned char *data;
+    size_t size;
+    std::unique_ptr<MappedFile> mapped;
+    std::vector<unsigned char> decompressed;
+
+public:
+    VfsFile();
+    VfsFile(const unsigned char *data, size_t size);
+    VfsFile(std::unique_ptr<MappedFile> file);
+    VfsFile(std::vector<unsigned char> &&decompressed);
+
+    // False if the asset does not exist or could not be read
+    bool IsOpen();
+    const unsigned char *Data();
+    size_t Size();
+    std::string_view Text();
+};
+
+// Serves assets from the pack if there is one, and from loose files in the asset directory otherwise.
+// Assets that are not in the pack fall back to loose files too, so new assets work without repacking.
+class Vfs {
+private:
+    std::filesystem::path root;
+    MappedFile pack;
+    const PackHeader *header;
+    const PackEntry *entries;
+    const char *names;
+    const PackEntry *find(std::string_view name);
+
+public:
+    Vfs(std::filesystem::path root, std::filesystem::path packPath);
+    Vfs(const Vfs &) = delete;
+    Vfs &operator=(const Vfs &) = delete;
+
+    bool HasPack();
+    // Paths are relative to the asset directory, e.g. "shaders/lighting.glsl"
+    VfsFile Open(std::string_view path);
+    // The whole file as text, empty if it could not be read
+    std::string ReadText(std::string_view path);
+    // Whether Open would find the asset, without complaining if it would not
+    bool Exists(std::string_view path);
+    // Where the loose file of an asset is, for tools and caches that write assets
+    std::filesystem::path LoosePath(std::string_view path);
+};
+
+// The name of an asset in the pack: lower case, with forward slashes
+std::string packName(std::string_view path);
+
+// FNV-1a of an asset's bytes, eight at a time, for caches that are made from it.
+// Pass the hash of one asset on to hash several in a row.
+uint64_t hashAsset(const unsigned char *data, size_t size, uint64_t hash = 14695981039346656037ull);
@@ -2,10 +2,16 @@
 
 #include "Camera.hpp"
 #include "Cursor.hpp"
+#include "GpuProfiler.hpp"
+#include <filesystem>
 
 // To be set as WindowUserPointer or whatever it's called
-// so camera and cursor can be passed to the callbacks
+// so camera, cursor and profilers can be passed to the callbacks
 struct WindowInfo {
     Camera camera;
     Cursor cursor;
+    GpuProfiler gpuProfiler;
+    std::filesystem::path traceFile;
+    bool captureFrame; // set by F5, the render loop writes the GL and the software frame
+    bool printMemory;  // set by F6, the render loop prints the memory report
 };
@@ -3,17 +3,15 @@
 #include <filesystem>
 #include <iostream>
 #include <fstream>
+#include "Profiler.hpp"
 
-// Reads a file and returns as string
-// No considerations taken for efficiency
+// Reads a whole file in one go and returns it as string
 std::string readFile(std::filesystem::path p) {
-    std::ifstream file(p);
-    std::string str;
-    std::string tmp;
-    while (std::getline(file, tmp))
-    {
-        str += tmp;
-        str.push_back('\n');
-    }
+    PROFILE_ZONE("readFile");
+    std::ifstream file(p, std::ios::binary | std::ios::ate);
+    if (!file) { return ""; }
+    std::string str((size_t)file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&str[0], str.size());
     return str;
 }
@@ -0,0 +1,728 @@
+// Plays a GL trace written by the capture (see GlCapture.hpp and GlTrace.hpp) in a hidden window,
+// as fast as it goes, and reports how long the frames took. The same trace gives the same frames
+// on every run, without the window, input and asset loading of the program in the way.
+//
+// GlReplay <trace> [--loops n] [--frame out.tga]
+//
+// The frames are played n times (default 10). The first pass warms up the driver and is not counted.
+// --frame writes the last frame of the last pass, to check the replay draws what the program drew.
+
+#include <GL\glew.h>
+#include <GLFW\glfw3.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include "GlTrace.hpp"
+#include "Image.hpp"
+
+static void printUsage() {
+    std::cout << "GlReplay <trace> [--loops n] [--frame out.tga]" << std::endl;
+}
+
+// Names the program got, to the names the replay got for the same objects
+struct NameMap {
+    std::unordered_map<GLuint, GLuint> names;
+
+    GLuint Get(GLuint captured) {
+        auto found = names.find(captured);
+        return found == names.end() ? 0 : found->second;
+    }
+    void Set(GLuint captured, GLuint name) { names[captured] = name; }
+    // The replay's name, 0 if it had none
+    GLuint Remove(GLuint captured) {
+        GLuint name = Get(captured);
+        names.erase(captured);
+        return name;
+    }
+};
+
+struct Replay {
+    NameMap buffers, textures, vertexArrays, shaders, programs, queries;
+    std::unordered_map<uint64_t, GLsync> syncs;
+    size_t unsupported = 0;
+};
+
+static GLuint compileProgram(const std::vector<std::pair<GLenum, std::string>> &sources) {
+    GLuint program = glCreateProgram();
+    std::vector<GLuint> shaders;
+    for (auto &source : sources) {
+        GLuint shader = glCreateShader(source.first);
+        const GLchar *text = source.second.c_str();
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        shaders.push_back(shader);
+    }
+    if (!sources.empty()) {
+        glLinkProgram(program);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            GLint length = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+            std::string log((size_t)(std::max)(length, 1), '\0');
+            glGetProgramInfoLog(program, length, nullptr, &log[0]);
+            std::cout << "Program " << program << " does not link: " << log << std::endl;
+        }
+    }
+    for (GLuint shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    return program;
+}
+
+static void replayTexture(GlTraceReader &in, Replay &replay) {
+    GLuint captured = in.Get<GLuint>();
+    GLenum target = in.Get<uint32_t>();
+    GLenum internalFormat = in.Get<uint32_t>();
+    GLsizei levels = (GLsizei)in.Get<uint32_t>();
+    GLsizei width = (GLsizei)in.Get<uint32_t>();
+    GLsizei height = (GLsizei)in.Get<uint32_t>();
+    GLsizei depth = (GLsizei)in.Get<uint32_t>();
+    GLint parameters[4];
+    for (GLint &parameter : parameters) { parameter = (GLint)in.Get<uint32_t>(); }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    replay.textures.Set(captured, texture);
+    glBindTexture(target, texture);
+    if (target == GL_TEXTURE_2D_ARRAY) { glTexStorage3D(target, levels, internalFormat, width, height, depth); }
+    else { glTexStorage2D(target, levels, internalFormat, width, height); }
+
+    int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    for (GLsizei level = 0; level < levels; level++) {
+        GLsizei w = (std::max)(1, width >> level);
+        GLsizei h = (std::max)(1, height >> level);
+        for (int face = 0; face < faces; face++) {
+            GLenum imageTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            bool compressed = in.Get<uint8_t>() != 0;
+            GLenum format = in.Get<uint32_t>();
+            GLenum type = in.Get<uint32_t>();
+            size_t size;
+            const unsigned char *data = in.GetBytes(size);
+            if (!data) { continue; }
+            if (target == GL_TEXTURE_2D_ARRAY) {
+                if (compressed) { glCompressedTexSubImage3D(imageTarget, level, 0, 0, 0, w, h, depth, internalFormat, (GLsizei)size, data); }
+                else { glTexSubImage3D(imageTarget, level, 0, 0, 0, w, h, depth, format, type, data); }
+            }
+            else {
+                if (compressed) { glCompressedTexSubImage2D(imageTarget, level, 0, 0, w, h, internalFormat, (GLsizei)size, data); }
+                else { glTexSubImage2D(imageTarget, level, 0, 0, w, h, format, type, data); }
+            }
+        }
+    }
+    GLenum names[4] = { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T };
+    for (int i = 0; i < 4; i++) { glTexParameteri(target, names[i], parameters[i]); }
+}
+
+static void generate(GlTraceReader &in, NameMap &map, void (GLAPIENTRY *gen)(GLsizei, GLuint*)) {
+    uint32_t n = in.Get<uint32_t>();
+    for (uint32_t i = 0; i < n; i++) {
+        GLuint name;
+        gen(1, &name);
+        map.Set(in.Get<GLuint>(), name);
+    }
+}
+
+static void destroy(GlTraceReader &in, NameMap &map, void (GLAPIENTRY *del)(GLsizei, const GLuint*)) {
+    uint32_t n = in.Get<uint32_t>();
+    for (uint32_t i = 0; i < n; i++) {
+        GLuint name = map.Remove(in.Get<GLuint>());
+        if (name) { del(1, &name); }
+    }
+}
+
+// Most floats a uniform array call of the trace sets, the rest are left out
+#define UNIFORM_FLOATS 64
+
+// Copies the floats of a uniform array call out of its record, which keeps them unaligned.
+// Returns how many values of perValue floats there are.
+static GLsizei copyFloats(const unsigned char *data, size_t size, float *values, size_t perValue) {
+    size_t count = (std::min)(size / sizeof(float), (size_t)UNIFORM_FLOATS) / perValue;
+    if (data) { std::memcpy(values, data, count * perValue * sizeof(float)); }
+    return (GLsizei)count;
+}
+
+// Plays one call. The payloads are laid out as GlCapture writes them.
+static void execute(const GlTraceRecord &record, Replay &replay) {
+    GlTraceReader in(record);
+    size_t size;
+    switch (record.op) {
+        case GlTraceOp::FrameBegin:
+        case GlTraceOp::FrameEnd:
+            break;
+
+        case GlTraceOp::SnapshotBuffer: {
+            GLuint captured = in.Get<GLuint>();
+            GLenum usage = in.Get<uint32_t>();
+            GLsizeiptr bufferSize = (GLsizeiptr)in.Get<uint64_t>();
+            const unsigned char *data = in.GetBytes(size);
+            GLuint buffer;
+            glGenBuffers(1, &buffer);
+            replay.buffers.Set(captured, buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, bufferSize, (GLsizeiptr)size == bufferSize ? data : nullptr, usage);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            break;
+        }
+        case GlTraceOp::SnapshotTexture:
+            replayTexture(in, replay);
+            break;
+        case GlTraceOp::SnapshotProgram: {
+            GLuint captured = in.Get<GLuint>();
+            std::vector<std::pair<GLenum, std::string>> sources(in.Get<uint32_t>());
+            for (auto &source : sources) {
+                source.first = in.Get<uint32_t>();
+                source.second = in.GetString();
+            }
+            replay.programs.Set(captured, compileProgram(sources));
+            break;
+        }
+        case GlTraceOp::SnapshotVertexArray: {
+            GLuint vertexArray;
+            glGenVertexArrays(1, &vertexArray);
+            replay.vertexArrays.Set(in.Get<GLuint>(), vertexArray);
+            glBindVertexArray(vertexArray);
+            break;
+        }
+
+        case GlTraceOp::GenBuffers: generate(in, replay.buffers, glGenBuffers); break;
+        case GlTraceOp::DeleteBuffers: destroy(in, replay.buffers, glDeleteBuffers); break;
+        case GlTraceOp::BindBuffer: {
+            GLenum target = in.Get<uint32_t>();
+            glBindBuffer(target, replay.buffers.Get(in.Get<GLuint>()));
+            break;
+        }
+        case GlTraceOp::BufferData: {
+            GLenum target = (GLenum)in.Get<uint64_t>();
+            GLsizeiptr bufferSize = (GLsizeiptr)in.Get<uint64_t>();
+            GLenum usage = (GLenum)in.Get<uint64_t>();
+            glBufferData(target, bufferSize, in.GetBytes(size), usage);
+            break;
+        }
+        case GlTraceOp::BufferSubData: {
+            GLenum target = (GLenum)in.Get<uint64_t>();
+            GLintptr offset = (GLintptr)in.Get<uint64_t>();
+            const unsigned char *data = in.GetBytes(size);
+            glBufferSubData(target, offset, (GLsizeiptr)size, data);
+            break;
+        }
+        case GlTraceOp::BufferStorage: {
+            // Mutable storage does for everything the replay does with it, it never maps buffers
+            GLenum target = (GLenum)in.Get<uint64_t>();
+            GLsizeiptr bufferSize = (GLsizeiptr)in.Get<uint64_t>();
+            in.Get<uint64_t>();
+            glBufferData(target, bufferSize, in.GetBytes(size), GL_DYNAMIC_DRAW);
+            break;
+        }
+        case GlTraceOp::CopyBufferSubData: {
+            GLenum readTarget = in.Get<uint32_t>();
+            GLenum writeTarget = in.Get<uint32_t>();
+            GLintptr readOffset = (GLintptr)in.Get<int64_t>();
+            GLintptr writeOffset = (GLintptr)in.Get<int64_t>();
+            glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, (GLsizeiptr)in.Get<int64_t>());
+            break;
+        }
+        case GlTraceOp::ClearBufferData: {
+            GLenum target = (GLenum)in.Get<uint64_t>();
+            GLenum internalFormat = (GLenum)in.Get<uint64_t>();
+            GLenum format = (GLenum)in.Get<uint64_t>();
+            GLenum type = (GLenum)in.Get<uint64_t>();
+            glClearBufferData(target, internalFormat, format, type, in.GetBytes(size));
+            break;
+        }
+        case GlTraceOp::MapBufferRange: {
+            // Mapped and unmapped again only for what it costs, nothing is read or written through it
+            GLenum target = in.Get<uint32_t>();
+            GLintptr offset = (GLintptr)in.Get<int64_t>();
+            GLsizeiptr length = (GLsizeiptr)in.Get<int64_t>();
+            glMapBufferRange(target, offset, length, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::UnmapBuffer: glUnmapBuffer(in.Get<uint32_t>()); break;
+        case GlTraceOp::BindBufferBase: {
+            GLenum target = in.Get<uint32_t>();
+            GLuint index = in.Get<uint32_t>();
+            glBindBufferBase(target, index, replay.buffers.Get(in.Get<GLuint>()));
+            break;
+        }
+        case GlTraceOp::BindBufferRange: {
+            GLenum target = in.Get<uint32_t>();
+            GLuint index = in.Get<uint32_t>();
+            GLuint buffer = replay.buffers.Get(in.Get<GLuint>());
+            GLintptr offset = (GLintptr)in.Get<int64_t>();
+            GLsizeiptr rangeSize = (GLsizeiptr)in.Get<int64_t>();
+            glBindBufferRange(target, index, buffer, offset, rangeSize);
+            break;
+        }
+
+        case GlTraceOp::GenVertexArrays: generate(in, replay.vertexArrays, glGenVertexArrays); break;
+        case GlTraceOp::DeleteVertexArrays: destroy(in, replay.vertexArrays, glDeleteVertexArrays); break;
+        case GlTraceOp::BindVertexArray: glBindVertexArray(replay.vertexArrays.Get(in.Get<GLuint>())); break;
+        case GlTraceOp::VertexAttribPointer: {
+            GLuint index = in.Get<uint32_t>();
+            GLint components = in.Get<int32_t>();
+            GLenum type = in.Get<uint32_t>();
+            GLboolean normalized = in.Get<uint8_t>();
+            GLsizei stride = in.Get<int32_t>();
+            glVertexAttribPointer(index, components, type, normalized, stride, (const void*)(intptr_t)in.Get<int64_t>());
+            break;
+        }
+        case GlTraceOp::VertexAttribIPointer: {
+            GLuint index = in.Get<uint32_t>();
+            GLint components = in.Get<int32_t>();
+            GLenum type = in.Get<uint32_t>();
+            GLsizei stride = in.Get<int32_t>();
+            glVertexAttribIPointer(index, components, type, stride, (const void*)(intptr_t)in.Get<int64_t>());
+            break;
+        }
+        case GlTraceOp::VertexAttribDivisor: {
+            GLuint index = in.Get<uint32_t>();
+            glVertexAttribDivisor(index, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::EnableVertexAttribArray: glEnableVertexAttribArray(in.Get<uint32_t>()); break;
+
+        case GlTraceOp::CreateShader: {
+            GLenum type = in.Get<uint32_t>();
+            replay.shaders.Set(in.Get<GLuint>(), glCreateShader(type));
+            break;
+        }
+        case GlTraceOp::ShaderSource: {
+            GLuint shader = replay.shaders.Get(in.Get<GLuint>());
+            std::string source = in.GetString();
+            const GLchar *text = source.c_str();
+            glShaderSource(shader, 1, &text, nullptr);
+            break;
+        }
+        case GlTraceOp::CompileShader: glCompileShader(replay.shaders.Get(in.Get<GLuint>())); break;
+        case GlTraceOp::DeleteShader: {
+            GLuint shader = replay.shaders.Remove(in.Get<GLuint>());
+            if (shader) { glDeleteShader(shader); }
+            break;
+        }
+        case GlTraceOp::CreateProgram: replay.programs.Set(in.Get<GLuint>(), glCreateProgram()); break;
+        case GlTraceOp::AttachShader:
+        case GlTraceOp::DetachShader: {
+            GLuint program = replay.programs.Get(in.Get<GLuint>());
+            GLuint shader = replay.shaders.Get(in.Get<GLuint>());
+            if (!program || !shader) { break; }
+            if (record.op == GlTraceOp::AttachShader) { glAttachShader(program, shader); }
+            else { glDetachShader(program, shader); }
+            break;
+        }
+        case GlTraceOp::LinkProgram: glLinkProgram(replay.programs.Get(in.Get<GLuint>())); break;
+        case GlTraceOp::DeleteProgram: {
+            GLuint program = replay.programs.Remove(in.Get<GLuint>());
+            if (program) { glDeleteProgram(program); }
+            break;
+        }
+        case GlTraceOp::UseProgram: glUseProgram(replay.programs.Get(in.Get<GLuint>())); break;
+        case GlTraceOp::Uniform1i: {
+            GLint location = in.Get<int32_t>();
+            glUniform1i(location, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::Uniform1ui: {
+            GLint location = in.Get<int32_t>();
+            glUniform1ui(location, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::Uniform1f: {
+            GLint location = in.Get<int32_t>();
+            glUniform1f(location, in.Get<float>());
+            break;
+        }
+        case GlTraceOp::Uniform2i: {
+            GLint location = in.Get<int32_t>();
+            GLint x = in.Get<int32_t>();
+            glUniform2i(location, x, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::Uniform2f: {
+            GLint location = in.Get<int32_t>();
+            float x = in.Get<float>();
+            glUniform2f(location, x, in.Get<float>());
+            break;
+        }
+        case GlTraceOp::Uniform2fv:
+        case GlTraceOp::Uniform3fv: {
+            GLint location = (GLint)in.Get<int64_t>();
+            float values[UNIFORM_FLOATS];
+            const unsigned char *data = in.GetBytes(size);
+            if (record.op == GlTraceOp::Uniform2fv) { glUniform2fv(location, copyFloats(data, size, values, 2), values); }
+            else { glUniform3fv(location, copyFloats(data, size, values, 3), values); }
+            break;
+        }
+        case GlTraceOp::UniformMatrix4fv: {
+            GLint location = (GLint)in.Get<int64_t>();
+            GLboolean transpose = (GLboolean)in.Get<uint64_t>();
+            float values[UNIFORM_FLOATS];
+            const unsigned char *data = in.GetBytes(size);
+            glUniformMatrix4fv(location, copyFloats(data, size, values, 16), transpose, values);
+            break;
+        }
+
+        case GlTraceOp::ActiveTexture: glActiveTexture(in.Get<uint32_t>()); break;
+        case GlTraceOp::GenTextures: generate(in, replay.textures, glGenTextures); break;
+        case GlTraceOp::DeleteTextures: destroy(in, replay.textures, glDeleteTextures); break;
+        case GlTraceOp::BindTexture: {
+            GLenum target = in.Get<uint32_t>();
+            glBindTexture(target, replay.textures.Get(in.Get<GLuint>()));
+            break;
+        }
+        case GlTraceOp::TexParameteri: {
+            GLenum target = in.Get<uint32_t>();
+            GLenum name = in.Get<uint32_t>();
+            glTexParameteri(target, name, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::TexStorage3D: {
+            GLenum target = in.Get<uint32_t>();
+            GLsizei levels = in.Get<int32_t>();
+            GLenum internalFormat = in.Get<uint32_t>();
+            GLsizei width = in.Get<int32_t>();
+            GLsizei height = in.Get<int32_t>();
+            glTexStorage3D(target, levels, internalFormat, width, height, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::TexStorage2D: {
+            GLenum target = in.Get<uint32_t>();
+            GLsizei levels = in.Get<int32_t>();
+            GLenum internalFormat = in.Get<uint32_t>();
+            GLsizei width = in.Get<int32_t>();
+            glTexStorage2D(target, levels, internalFormat, width, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::TexSubImage2D: {
+            // Without bytes the pixels came from a pixel unpack buffer, at the offset
+            uint32_t a[8];
+            for (uint32_t &arg : a) { arg = in.Get<uint32_t>(); }
+            int64_t offset = in.Get<int64_t>();
+            const unsigned char *data = in.GetBytes(size);
+            glTexSubImage2D(a[0], (GLint)a[1], (GLint)a[2], (GLint)a[3], (GLsizei)a[4], (GLsizei)a[5], a[6], a[7],
+                            data ? (const void*)data : (const void*)(intptr_t)offset);
+            break;
+        }
+        case GlTraceOp::CopyTexSubImage2D: {
+            int32_t a[8];
+            for (int32_t &arg : a) { arg = in.Get<int32_t>(); }
+            glCopyTexSubImage2D((GLenum)a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+            break;
+        }
+        case GlTraceOp::GetTexImage: {
+            // Into the pixel pack buffer bound, at the offset
+            GLenum target = in.Get<uint32_t>();
+            GLint level = in.Get<int32_t>();
+            GLenum format = in.Get<uint32_t>();
+            GLenum type = in.Get<uint32_t>();
+            glGetTexImage(target, level, format, type, (void*)(intptr_t)in.Get<int64_t>());
+            break;
+        }
+        case GlTraceOp::BindImageTexture: {
+            GLuint unit = in.Get<uint32_t>();
+            GLuint texture = replay.textures.Get(in.Get<GLuint>());
+            GLint level = in.Get<int32_t>();
+            GLboolean layered = in.Get<uint8_t>();
+            GLint layer = in.Get<int32_t>();
+            GLenum access = in.Get<uint32_t>();
+            glBindImageTexture(unit, texture, level, layered, layer, access, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::CompressedTexSubImage3D: {
+            uint32_t a[9];
+            for (uint32_t &arg : a) { arg = in.Get<uint32_t>(); }
+            const unsigned char *data = in.GetBytes(size);
+            glCompressedTexSubImage3D(a[0], (GLint)a[1], (GLint)a[2], (GLint)a[3], (GLint)a[4],
+                                      (GLsizei)a[5], (GLsizei)a[6], (GLsizei)a[7], a[8], (GLsizei)size, data);
+            break;
+        }
+        case GlTraceOp::GenerateMipmap: glGenerateMipmap(in.Get<uint32_t>()); break;
+
+        case GlTraceOp::GenQueries: generate(in, replay.queries, glGenQueries); break;
+        case GlTraceOp::QueryCounter: {
+            // Queries from before the first frame are made on first use
+            GLuint captured = in.Get<GLuint>();
+            GLuint query = replay.queries.Get(captured);
+            if (!query) {
+                glGenQueries(1, &query);
+                replay.queries.Set(captured, query);
+            }
+            glQueryCounter(query, in.Get<uint32_t>());
+            break;
+        }
+
+        case GlTraceOp::FenceSync: {
+            uint64_t id = in.Get<uint64_t>();
+            GLenum condition = in.Get<uint32_t>();
+            replay.syncs[id] = glFenceSync(condition, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::ClientWaitSync: {
+            // Waits as long as the program did in the end, however many tries that took there
+            auto found = replay.syncs.find(in.Get<uint64_t>());
+            GLbitfield flags = in.Get<uint32_t>();
+            if (found == replay.syncs.end()) { break; }
+            while (glClientWaitSync(found->second, flags, 1000000) == GL_TIMEOUT_EXPIRED) { }
+            break;
+        }
+        case GlTraceOp::DeleteSync: {
+            auto found = replay.syncs.find(in.Get<uint64_t>());
+            if (found == replay.syncs.end()) { break; }
+            glDeleteSync(found->second);
+            replay.syncs.erase(found);
+            break;
+        }
+
+        case GlTraceOp::Clear: glClear(in.Get<uint32_t>()); break;
+        case GlTraceOp::ClearColor: {
+            float c[4];
+            for (float &component : c) { component = in.Get<float>(); }
+            glClearColor(c[0], c[1], c[2], c[3]);
+            break;
+        }
+        case GlTraceOp::Enable: glEnable(in.Get<uint32_t>()); break;
+        case GlTraceOp::Disable: glDisable(in.Get<uint32_t>()); break;
+        case GlTraceOp::BlendFunc: {
+            GLenum source = in.Get<uint32_t>();
+            glBlendFunc(source, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::DepthFunc: glDepthFunc(in.Get<uint32_t>()); break;
+        case GlTraceOp::DepthMask: glDepthMask(in.Get<uint8_t>()); break;
+        case GlTraceOp::ColorMask: {
+            uint8_t m[4];
+            for (uint8_t &mask : m) { mask = in.Get<uint8_t>(); }
+            glColorMask(m[0], m[1], m[2], m[3]);
+            break;
+        }
+        case GlTraceOp::PolygonMode: {
+            GLenum face = in.Get<uint32_t>();
+            glPolygonMode(face, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::PointSize: glPointSize(in.Get<float>()); break;
+        case GlTraceOp::Viewport: {
+            GLint v[4];
+            for (GLint &value : v) { value = in.Get<int32_t>(); }
+            glViewport(v[0], v[1], v[2], v[3]);
+            break;
+        }
+        case GlTraceOp::DrawArrays: {
+            GLenum mode = in.Get<uint32_t>();
+            GLint first = in.Get<int32_t>();
+            glDrawArrays(mode, first, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::DrawElements: {
+            GLenum mode = in.Get<uint32_t>();
+            GLsizei count = in.Get<int32_t>();
+            GLenum type = in.Get<uint32_t>();
+            glDrawElements(mode, count, type, (const void*)(intptr_t)in.Get<int64_t>());
+            break;
+        }
+
+        case GlTraceOp::DispatchCompute: {
+            GLuint x = in.Get<uint32_t>();
+            GLuint y = in.Get<uint32_t>();
+            glDispatchCompute(x, y, in.Get<uint32_t>());
+            break;
+        }
+        case GlTraceOp::DispatchComputeIndirect: glDispatchComputeIndirect((GLintptr)in.Get<int64_t>()); break;
+        case GlTraceOp::MemoryBarrier: glMemoryBarrier(in.Get<uint32_t>()); break;
+        case GlTraceOp::DrawArraysIndirect: {
+            GLenum mode = in.Get<uint32_t>();
+            glDrawArraysIndirect(mode, (const void*)(intptr_t)in.Get<int64_t>());
+            break;
+        }
+        case GlTraceOp::MultiDrawElementsIndirect: {
+            GLenum mode = in.Get<uint32_t>();
+            GLenum type = in.Get<uint32_t>();
+            const void *indirect = (const void*)(intptr_t)in.Get<int64_t>();
+            GLsizei drawCount = in.Get<int32_t>();
+            glMultiDrawElementsIndirect(mode, type, indirect, drawCount, in.Get<int32_t>());
+            break;
+        }
+        case GlTraceOp::MultiDrawElementsIndirectCountARB: {
+            // Without the extension the count is unknown, drawing every slot would draw stale commands
+            if (!GLEW_ARB_indirect_parameters) {
+                replay.unsupported++;
+                break;
+            }
+            GLenum mode = in.Get<uint32_t>();
+            GLenum type = in.Get<uint32_t>();
+            const void *indirect = (const void*)(intptr_t)in.Get<int64_t>();
+            GLintptr drawCount = (GLintptr)in.Get<int64_t>();
+            GLsizei maxDrawCount = in.Get<int32_t>();
+            glMultiDrawElementsIndirectCountARB(mode, type, indirect, drawCount, maxDrawCount, in.Get<int32_t>());
+            break;
+        }
+
+        default:
+            replay.unsupported++;
+            break;
+    }
+    if (in.Overrun()) {
+        std::cout << "Record " << glTraceOpName(record.op) << " is shorter than its arguments" << std::endl;
+    }
+}
+
+// The back buffer, first row at the top
+static Image readFramebuffer(int width, int height) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    std::vector<unsigned char> rows(image.pixels.size());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+    size_t rowSize = (size_t)width * 4;
+    for (int y = 0; y < height; y++) {
+        std::copy(&rows[(size_t)(height - 1 - y) * rowSize], &rows[(size_t)(height - y) * rowSize], &image.pixels[(size_t)y * rowSize]);
+    }
+    return image;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    std::filesystem::path tracePath = argv[1];
+    int loops = 10;
+    std::filesystem::path framePath;
+    for (int i = 2; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--loops" && i + 1 < argc) { loops = (std::max)(1, std::atoi(argv[++i])); }
+        else if (option == "--frame" && i + 1 < argc) { framePath = argv[++i]; }
+        else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::ifstream file(tracePath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cout << "Could not read " << tracePath.string() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<unsigned char> trace((size_t)file.tellg());
+    file.seekg(0);
+    file.read((char*)trace.data(), (std::streamsize)trace.size());
+
+    GlTraceHeader header;
+    std::vector<GlTraceRecord> records;
+    std::string error;
+    if (!parseGlTrace(trace, header, records, error)) {
+        std::cout << tracePath.string() << ": " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The records before the first frame set up the objects and state, then each frame is a range
+    std::vector<std::pair<size_t, size_t>> frames;
+    size_t setupEnd = records.size();
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i].op == GlTraceOp::FrameBegin) {
+            setupEnd = (std::min)(setupEnd, i);
+            frames.push_back({ i, records.size() });
+        }
+        else if (records[i].op == GlTraceOp::FrameEnd && !frames.empty()) { frames.back().second = i + 1; }
+    }
+    if (frames.empty()) {
+        std::cout << tracePath.string() << " has no frames" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << tracePath.string() << ": " << header.width << "x" << header.height << ", " << frames.size() << " frames, "
+              << records.size() << " calls, " << (trace.size() >> 10) << " KB" << std::endl;
+
+    // A hidden window of the size the frames were drawn at
+    if (!glfwInit()) {
+        std::cout << "Failed to init GLFW" << std::endl;
+        return EXIT_FAILURE;
+    }
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow((int)header.width, (int)header.height, "GlReplay", NULL, NULL);
+    if (!window) {
+        glfwTerminate();
+        std::cout << "Failed to init openGL context" << std::endl;
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK) {
+        glfwTerminate();
+        std::cout << "Failed to init GLEW" << std::endl;
+        return EXIT_FAILURE;
+    }
+    glfwSwapInterval(0);
+
+    int exitCode = EXIT_SUCCESS;
+    {
+        Replay replay;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < setupEnd; i++) { execute(records[i], replay); }
+        glFinish();
+        double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Set up " << replay.buffers.names.size() << " buffers, " << replay.textures.names.size() << " textures and "
+                  << replay.programs.names.size() << " programs in " << setupMs << " ms" << std::endl;
+
+        // Time spent issuing each frame's calls, and each pass from first call until the GPU is done
+        std::vector<double> submitMs(frames.size(), 0.0);
+        double minSubmitMs = 1e30, maxSubmitMs = 0.0;
+        double passMs = 0.0;
+        for (int loop = 0; loop < loops; loop++) {
+            bool counted = loop > 0 || loops == 1;
+            auto passStart = std::chrono::steady_clock::now();
+            for (size_t f = 0; f < frames.size(); f++) {
+                auto frameStart = std::chrono::steady_clock::now();
+                for (size_t i = frames[f].first; i < frames[f].second; i++) { execute(records[i], replay); }
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+                if (counted) {
+                    submitMs[f] += ms;
+                    minSubmitMs = (std::min)(minSubmitMs, ms);
+                    maxSubmitMs = (std::max)(maxSubmitMs, ms);
+                }
+                if (loop == loops - 1 && f == frames.size() - 1 && !framePath.empty()) {
+                    if (writeTga(framePath, readFramebuffer((int)header.width, (int)header.height))) {
+                        std::cout << "Wrote " << framePath.string() << std::endl;
+                    }
+                    else {
+                        std::cout << "Can not write " << framePath.string() << std::endl;
+                        exitCode = EXIT_FAILURE;
+                    }
+                }
+                glfwSwapBuffers(window);
+            }
+            glFinish();
+            if (counted) { passMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - passStart).count(); }
+        }
+
+        int countedLoops = loops == 1 ? 1 : loops - 1;
+        double frameMs = passMs / ((double)countedLoops * frames.size());
+        double meanSubmitMs = 0.0;
+        for (double ms : submitMs) { meanSubmitMs += ms; }
+        meanSubmitMs /= (double)countedLoops * frames.size();
+        std::cout << "Replayed " << frames.size() << " frames " << countedLoops << " times: " << frameMs << " ms per frame ("
+                  << 1000.0 / frameMs << " fps)" << std::endl
+                  << "Submitting a frame took " << meanSubmitMs << " ms, " << minSubmitMs << " to " << maxSubmitMs << " ms" << std::endl;
+        if (replay.unsupported) { std::cout << replay.unsupported << " calls were not replayed" << std::endl; }
+
+        for (auto &sync : replay.syncs) { glDeleteSync(sync.second); }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return exitCode;
+}
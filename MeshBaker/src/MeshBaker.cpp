@@ -0,0 +1,137 @@
+// Bakes the generated shapes into mesh files (see MeshFile.hpp), so the program can map them
+// instead of generating them at every start.
+//
+// MeshBaker sphere <longSegments> <latSegments> <radius> <out.mesh> [--lods n] [--compress]
+// MeshBaker cylinder <height> <radius> <sides> <out.mesh> [--lods n] [--compress]
+// MeshBaker box <width> <height> <depth> <out.mesh> [--compress]
+// MeshBaker import <in.obj|in.glb> <out.mesh> [--compress]
+//
+// Each further level of detail halves the segments of the one before.
+// Imported meshes (see MeshImport.hpp) get a single level of detail.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <filesystem>
+#include "MeshFile.hpp"
+#include "MeshImport.hpp"
+#include "MappedFile.hpp"
+#include "Vfs.hpp"
+#include "Log.hpp"
+#include "Shapes\Geometry.hpp"
+
+static void printUsage() {
+    std::cout << "MeshBaker sphere <longSegments> <latSegments> <radius> <out.mesh> [--lods n] [--compress]" << std::endl
+              << "MeshBaker cylinder <height> <radius> <sides> <out.mesh> [--lods n] [--compress]" << std::endl
+              << "MeshBaker box <width> <height> <depth> <out.mesh> [--compress]" << std::endl
+              << "MeshBaker import <in.obj|in.glb> <out.mesh> [--compress]" << std::endl;
+}
+
+// Appends a level of detail to the geometry of all levels
+static void appendLod(Geometry &all, std::vector<MeshFileLod> &lods, Geometry lod) {
+    uint32_t firstVertex = (uint32_t)(all.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX);
+    uint32_t vertexCount = (uint32_t)(lod.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX);
+    lods.push_back({ (uint32_t)all.indices.size(), (uint32_t)lod.indices.size(), firstVertex, vertexCount });
+
+    all.vertices.insert(all.vertices.end(), lod.vertices.begin(), lod.vertices.end());
+    for (unsigned int index : lod.indices) { all.indices.push_back(index + firstVertex); }
+}
+
+static bool writeMesh(const std::string &out, Geometry &all, std::vector<MeshFileLod> &lods, bool compress) {
+    if (!writeMeshFile(out, all.vertices.data(), (uint32_t)(all.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX), GEOMETRY_FLOATS_PER_VERTEX,
+                       all.indices.data(), (uint32_t)all.indices.size(), lods, compress)) {
+        std::cout << "Could not write " << out << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote " << out << ": " << all.vertices.size() / GEOMETRY_FLOATS_PER_VERTEX << " vertices, "
+              << all.indices.size() / 3 << " triangles in " << lods.size() << " levels of detail" << std::endl;
+    return true;
+}
+
+static int importMain(int argc, char** argv) {
+    std::filesystem::path in = argv[2];
+    std::string out = argv[3];
+    bool compress = argc > 4 && std::string(argv[4]) == "--compress";
+
+    MappedFile file(in);
+    if (!file.IsOpen()) {
+        std::cout << "Could not read " << in.string() << std::endl;
+        return EXIT_FAILURE;
+    }
+    Geometry geometry, all;
+    std::string error;
+    if (!importMesh(packName(in.extension().string()), file.Data(), file.Size(), geometry, error)) {
+        std::cout << "Could not import " << in.string() << ": " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<MeshFileLod> lods;
+    appendLod(all, lods, std::move(geometry));
+    return writeMesh(out, all, lods, compress) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+    // The vfs reports through the log, which prints what is left when the program ends
+    Log::Start(LogSeverity::Low, 0);
+    if (argc >= 4 && std::string(argv[1]) == "import") {
+        return importMain(argc, argv);
+    }
+    if (argc < 6) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::string kind = argv[1];
+    float a = (float)std::atof(argv[2]);
+    float b = (float)std::atof(argv[3]);
+    float c = (float)std::atof(argv[4]);
+    std::string out = argv[5];
+
+    unsigned int lodCount = 1;
+    bool compress = false;
+    for (int i = 6; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--compress") { compress = true; }
+        else if (option == "--lods" && i + 1 < argc) { lodCount = (unsigned int)std::atoi(argv[++i]); }
+        else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (lodCount < 1) { lodCount = 1; }
+
+    Geometry all;
+    std::vector<MeshFileLod> lods;
+    if (kind == "sphere") {
+        unsigned int longSegments = (unsigned int)a, latSegments = (unsigned int)b;
+        for (unsigned int i = 0; i < lodCount && longSegments >= 4 && latSegments >= 3; i++) {
+            appendLod(all, lods, sphereGeometry(longSegments, latSegments, c));
+            longSegments /= 2;
+            latSegments /= 2;
+        }
+    }
+    else if (kind == "cylinder") {
+        unsigned int sides = (unsigned int)c;
+        for (unsigned int i = 0; i < lodCount && sides >= 3; i++) {
+            appendLod(all, lods, cylinderGeometry(a, b, sides));
+            sides /= 2;
+        }
+    }
+    else if (kind == "box") {
+        appendLod(all, lods, boxGeometry(a, b, c));
+    }
+    else {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (lods.empty()) {
+        std::cout << "Too few segments for a " << kind << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return writeMesh(out, all, lods, compress) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
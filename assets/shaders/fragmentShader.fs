@@ -1,8 +1,35 @@
 #version 430 core
-uniform vec3 color;
+#ifdef INDIRECT
+struct ObjectData {
+    mat4 model;
+    mat4 normalMatrix;
+    uvec4 material;
+};
+layout (std430, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+flat in uint objectIndex;
+#else
+layout (std140, binding = 1) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;
+    uvec4 material;
+};
+#endif
+struct Material {
+    vec4 color;
+    vec4 surface;
+    uvec4 tex;
+};
+layout (std430, binding = 0) readonly buffer Materials {
+    Material materials[];
+};
 out vec4 FragColor;
 
 void main()
 {
-    FragColor = vec4(color, 1.0f);
+#ifdef INDIRECT
+    uvec4 material = objects[objectIndex].material;
+#endif
+    FragColor = vec4(materials[material.x].color.rgb, 1.0f);
 }
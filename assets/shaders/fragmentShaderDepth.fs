@@ -0,0 +1,6 @@
+#version 430 core
+// The depth pre-pass only writes depth, there is no color to compute
+
+void main()
+{
+}
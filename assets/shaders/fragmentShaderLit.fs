@@ -0,0 +1,40 @@
+#version 430 core
+
+#ifdef GOURAUD
+in vec3 diffuse;
+in vec3 specular;
+#else
+in vec3 norm;
+in vec3 fragPos;
+#endif
+
+#ifdef TEXTURED
+in vec2 TexCoord;
+#endif
+
+#ifdef INDIRECT
+flat in uint objectIndex;
+#endif
+
+out vec4 FragColor;
+
+void main()
+{
+#ifdef INDIRECT
+    loadObject(objectIndex);
+#endif
+#ifdef TEXTURED
+    vec3 surfaceColor = sampleMaterial(TexCoord).xyz;
+#else
+    vec3 surfaceColor = materials[material.x].color.rgb;
+#endif
+
+#ifndef GOURAUD
+    vec3 diffuse;
+    vec3 specular;
+    shade(normalize(norm), fragPos, diffuse, specular);
+#endif
+
+    // The specular component is not multiplied by the surface color
+    FragColor = vec4(specular + diffuse * surfaceColor, 1.0);
+}
@@ -0,0 +1,151 @@
+// Shared by every variant of the lit shaders. It is inserted after the feature #defines
+// (GOURAUD, DIR_LIGHT, POINT_LIGHT, TEXTURED, BINDLESS, INDIRECT, MAX_POINT_LIGHTS, MAX_TEXTURE_ARRAYS,
+// ENVIRONMENT_TEXTURE_UNIT)
+// and before the body of each stage.
+
+struct PointLight {
+    vec4 color;
+    vec4 position;
+    vec4 attenuation;      // quadratic, linear, constant
+};
+
+layout (std140, binding = 0) uniform Frame {
+    mat4 viewProj;
+    vec4 cameraPos;
+    vec4 dirLightColor;
+    vec4 dirLightDir;
+    ivec4 pointLightCount; // only x is used
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    vec4 irradiance[9];    // SH9 of the environment, see EnvironmentMap
+    vec4 environment;      // diffuse and specular strength, last level of environmentMap; no environment while 0
+};
+
+// The environment convolved with Phong lobes, narrow at level 0 and a quarter of the exponent each level further
+layout (binding = ENVIRONMENT_TEXTURE_UNIT) uniform samplerCube environmentMap;
+
+// Average radiance of the environment over the hemisphere around n
+vec3 irradianceAt(vec3 n)
+{
+    vec3 e = irradiance[0].rgb
+           + irradiance[1].rgb * n.y + irradiance[2].rgb * n.z + irradiance[3].rgb * n.x
+           + irradiance[4].rgb * (n.x * n.y) + irradiance[5].rgb * (n.y * n.z) + irradiance[6].rgb * (3.0 * n.z * n.z - 1.0)
+           + irradiance[7].rgb * (n.x * n.z) + irradiance[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(e, vec3(0.0));
+}
+
+// The environment in direction r, blurred like a Phong highlight with the exponent alpha.
+// Level 1 was convolved with an exponent of 512, the last level with 2.
+vec3 reflectionAt(vec3 r, float alpha)
+{
+    float level = clamp(environment.z + 0.5 - 0.5 * log2(max(alpha, 1.0)), 0.0, environment.z);
+    return textureLod(environmentMap, r, level).rgb;
+}
+
+#ifdef INDIRECT
+// GPU-driven draws take their object from the object buffer by instance instead of a uniform block.
+// Each stage calls loadObject first, after that model, normalMatrix and material are as below.
+struct ObjectData {
+    mat4 model;
+    mat4 normalMatrix;
+    uvec4 material;
+};
+layout (std430, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+mat4 model;
+mat4 normalMatrix;
+uvec4 material;
+void loadObject(uint index)
+{
+    model = objects[index].model;
+    normalMatrix = objects[index].normalMatrix;
+    material = objects[index].material;
+}
+#else
+layout (std140, binding = 1) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;
+    uvec4 material;        // index into materials, only x is used
+};
+#endif
+
+struct Material {
+    vec4 color;
+    vec4 surface;          // ka, kd, ks, alpha
+    uvec4 tex;             // array, layer, bindless handle
+};
+
+layout (std430, binding = 0) readonly buffer Materials {
+    Material materials[];
+};
+
+#if defined(TEXTURED) && !defined(BINDLESS)
+layout (binding = 0) uniform sampler2DArray textureArrays[MAX_TEXTURE_ARRAYS];
+#endif
+
+#ifdef TEXTURED
+// The texture of the object's material. The material is the same for the whole draw,
+// so indexing the sampler array with it is allowed. With INDIRECT that is each draw of a multi-draw.
+vec4 sampleMaterial(vec2 texCoord)
+{
+    uvec4 tex = materials[material.x].tex;
+#ifdef BINDLESS
+    return texture(sampler2DArray(tex.zw), vec3(texCoord, float(tex.y)));
+#else
+    return texture(textureArrays[tex.x], vec3(texCoord, float(tex.y)));
+#endif
+}
+#endif
+
+// Phong lighting of a point on a surface, split into the part that is modulated by the
+// surface color and the specular part that is not, to get the white sheen of the reference solution.
+void shade(vec3 nNorm, vec3 fragPos, out vec3 diffuse, out vec3 specular)
+{
+    vec4 surface = materials[material.x].surface;
+    float ka    = surface.x;
+    float kd    = surface.y;
+    float ks    = surface.z;
+    float alpha = surface.w;
+
+    // Vector from the fragment to the camera
+    vec3 viewDir = normalize(cameraPos.xyz - fragPos);
+
+    diffuse  = vec3(0.0);
+    specular = vec3(0.0);
+
+    // Once there is an environment, it lights the ambient part instead of the directional light
+    bool environmentLit = environment.x > 0.0 || environment.y > 0.0;
+    if (environmentLit) {
+        diffuse  += ka * environment.x * irradianceAt(nNorm);
+        specular += ks * environment.y * reflectionAt(reflect(-viewDir, nNorm), alpha);
+    }
+
+#ifdef DIR_LIGHT
+    // Note that ka, the ambient component, is only part of the directional light
+    float dirAmbient = environmentLit ? 0.0 : ka;
+    float dirDiff = max(dot(nNorm, -normalize(dirLightDir.xyz)), 0.0);
+    vec3 dirReflectDir = reflect(normalize(dirLightDir.xyz), nNorm);
+    float dirSpec = pow(max(dot(viewDir, dirReflectDir), 0.0), alpha);
+
+    diffuse  += (dirAmbient + kd * dirDiff) * dirLightColor.rgb;
+    specular += ks * dirSpec * dirLightColor.rgb;
+#endif
+
+#ifdef POINT_LIGHT
+    // If both lights had ambient components the objects appeared too light,
+    // even if both used ka/2 instead. (Since the point light is brighter).
+    for (int i = 0; i < pointLightCount.x; i++) {
+        PointLight light = pointLights[i];
+        vec3 pointLightDir = fragPos - light.position.xyz;
+        float d = length(pointLightDir);
+        float att = 1.0 / (light.attenuation.z + d * light.attenuation.y + d * d * light.attenuation.x);
+
+        float pointDiff = max(dot(nNorm, -normalize(pointLightDir)), 0.0);
+        vec3 pointReflectDir = reflect(normalize(pointLightDir), nNorm);
+        float pointSpec = pow(max(dot(viewDir, pointReflectDir), 0.0), alpha);
+
+        diffuse  += att * kd * pointDiff * light.color.rgb;
+        specular += att * ks * pointSpec * light.color.rgb;
+    }
+#endif
+}
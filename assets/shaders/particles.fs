@@ -0,0 +1,13 @@
+#version 430 core
+// A soft round spot, blended additively
+in vec2 corner;
+in vec4 color;
+
+out vec4 FragColor;
+
+void main()
+{
+    float r = dot(corner, corner);
+    if (r > 1.0) { discard; }
+    FragColor = vec4(color.rgb, color.a * (1.0 - r));
+}
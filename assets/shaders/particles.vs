@@ -0,0 +1,53 @@
+#version 430 core
+// Draws every live particle as an instance of a camera-facing quad, read straight from the
+// particle buffer. MAX_POINT_LIGHTS, and LIT to light them by the point lights, are injected.
+struct PointLight {
+    vec4 color;
+    vec4 position;
+    vec4 attenuation;      // quadratic, linear, constant
+};
+
+layout (std140, binding = 0) uniform Frame {
+    mat4 viewProj;
+    vec4 cameraPos;
+    vec4 dirLightColor;
+    vec4 dirLightDir;
+    ivec4 pointLightCount; // only x is used
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+struct Particle {
+    vec4 position; // w: seconds left to live
+    vec4 velocity; // w: seconds it lives in all
+};
+layout (std430, binding = 7) readonly buffer Particles {
+    Particle particles[];
+};
+
+layout (location = 0) uniform float size;
+
+out vec2 corner;
+out vec4 color;
+
+void main()
+{
+    Particle p = particles[gl_InstanceID];
+    // The first rows of viewProj point along the screen's right and up in world space
+    vec3 right = normalize(vec3(viewProj[0][0], viewProj[1][0], viewProj[2][0]));
+    vec3 up = normalize(vec3(viewProj[0][1], viewProj[1][1], viewProj[2][1]));
+    corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    gl_Position = viewProj * vec4(p.position.xyz + (right * corner.x + up * corner.y) * size, 1.0);
+
+    // From hot to glowing embers, fading out at the end
+    float age = 1.0 - p.position.w / max(p.velocity.w, 0.0001);
+    color = vec4(mix(vec3(1.0, 0.85, 0.4), vec3(0.8, 0.2, 0.05), age), 1.0 - age * age);
+#ifdef LIT
+    vec3 light = vec3(0.3);
+    for (int i = 0; i < pointLightCount.x; i++) {
+        float d = length(pointLights[i].position.xyz - p.position.xyz);
+        vec3 a = pointLights[i].attenuation.xyz;
+        light += pointLights[i].color.rgb / (a.z + d * a.y + d * d * a.x);
+    }
+    color.rgb *= light;
+#endif
+}
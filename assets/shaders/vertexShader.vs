@@ -1,9 +1,38 @@
 #version 430 core
 layout (location = 0) in vec3 aPos;
-uniform mat4 model;
-uniform mat4 viewProj;
+layout (std140, binding = 0) uniform Frame {
+    mat4 viewProj;
+};
+#ifdef INDIRECT
+// GPU-driven draws, the object is the base instance of the draw (see GpuCuller)
+struct ObjectData {
+    mat4 model;
+    mat4 normalMatrix;
+    uvec4 material;
+};
+layout (std430, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+layout (location = 3) in uint aObject;
+flat out uint objectIndex;
+#else
+layout (std140, binding = 1) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;
+    uvec4 material;
+};
+#endif
+
+// The depth pre-pass draws with this shader and the lit shaders test against it with GL_EQUAL,
+// so all of them compute the position the same way
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = viewProj * model * vec4(aPos,1);
+#ifdef INDIRECT
+    mat4 model = objects[aObject].model;
+    objectIndex = aObject;
+#endif
+    vec4 worldPos = model * vec4(aPos, 1);
+    gl_Position = viewProj * worldPos;
 }
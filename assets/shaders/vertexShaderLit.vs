@@ -0,0 +1,47 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNorm;
+layout (location = 2) in vec2 aTexCoord;
+
+#ifdef GOURAUD
+// Lighting is evaluated per vertex and interpolated
+out vec3 diffuse;
+out vec3 specular;
+#else
+out vec3 norm;
+out vec3 fragPos;
+#endif
+
+#ifdef TEXTURED
+out vec2 TexCoord;
+#endif
+
+#ifdef INDIRECT
+// The base instance of the draw, see GpuCuller
+layout (location = 3) in uint aObject;
+flat out uint objectIndex;
+#endif
+
+// Matches the depth pre-pass, see vertexShader.vs
+invariant gl_Position;
+
+void main()
+{
+#ifdef INDIRECT
+    loadObject(aObject);
+    objectIndex = aObject;
+#endif
+    vec4 worldPos = model * vec4(aPos, 1);
+    gl_Position = viewProj * worldPos;
+
+#ifdef GOURAUD
+    shade(normalize(mat3(normalMatrix) * aNorm), worldPos.xyz, diffuse, specular);
+#else
+    norm = mat3(normalMatrix) * aNorm;
+    fragPos = worldPos.xyz;
+#endif
+
+#ifdef TEXTURED
+    TexCoord = aTexCoord;
+#endif
+}